@@ -31,6 +31,9 @@
 #ifndef __MOTION_SDK_CLIENT_HPP_
 #define __MOTION_SDK_CLIENT_HPP_
 
+#include <detail/instrument.hpp>
+
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -83,12 +86,80 @@ class Client {
   */
   typedef std::vector<char> data_type;
 
+  /**
+    Define a non-owning view of a single binary message. The view points into
+    the receive buffer owned by the Client object. It is only valid until the
+    next call to any of the read methods, or until the connection is closed.
+
+    @code
+    Client::data_view_type data;
+    while (client.readData(data)) {
+      Format::preview_service_type preview =
+        Format::Preview(data.begin(), data.end());
+    }
+    @endcode
+  */
+  class data_view_type {
+   public:
+    typedef char value_type;
+    typedef const char *const_iterator;
+    typedef std::size_t size_type;
+
+    data_view_type()
+      : m_data(NULL), m_size(0)
+    {
+    }
+
+    data_view_type(const char *data, const size_type &size)
+      : m_data(data), m_size(size)
+    {
+    }
+
+    const_iterator begin() const
+    {
+      return m_data;
+    }
+
+    const_iterator end() const
+    {
+      return m_data + m_size;
+    }
+
+    const char *data() const
+    {
+      return m_data;
+    }
+
+    size_type size() const
+    {
+      return m_size;
+    }
+
+    bool empty() const
+    {
+      return 0 == m_size;
+    }
+
+    void clear()
+    {
+      m_data = NULL;
+      m_size = 0;
+    }
+
+   private:
+    const char *m_data;
+    size_type m_size;
+  }; // class data_view_type
+
   /**
     Create a client connection to a remote Motion Service.
 
     @param   host IP address of remote host, the empty string
              defaults to "127.0.0.1"
     @param   port port name of remote host
+    @param   buffer_size size in bytes of the receive buffer, 0 value
+             specifies the default size, values smaller than one maximum
+             length message are rounded up
     @pre     a service is accepting connections on the socket
              described by the host, port pair
     @post    this client is connected to the remote service described
@@ -96,7 +167,8 @@ class Client {
     @throws  std::runtime_error if the client connection fails for
              any reason
   */
-  Client(const std::string &host, const unsigned &port);
+  Client(const std::string &host, const unsigned &port,
+         const std::size_t &buffer_size=0);
 
   /**
     Does not throw any exceptions. Close this client connection if it is open.
@@ -131,7 +203,9 @@ class Client {
 
   /**
     Read a variable length binary message into the output vector. The output
-    vector will be resized as necessary.
+    vector will be resized as necessary. It keeps its capacity, so a read
+    loop only allocates when a message is longer than all of the previous
+    ones.
 
     @param   time_out_second time out and return false after
              this many seconds, 0 value specifies no time out,
@@ -142,6 +216,170 @@ class Client {
   */
   virtual bool readData(data_type &data, const int &time_out_second=-1);
 
+  /**
+    Read a variable length binary message into an output vector that uses any
+    allocator, for example detail::arena_allocator. The vector keeps its
+    capacity, so a steady state read loop does not allocate.
+
+    @see     Client#readData
+  */
+  template <typename Allocator>
+  bool readData(std::vector<char, Allocator> &data,
+                const int &time_out_second=-1)
+  {
+    data.clear();
+
+    data_view_type message;
+    if (readData(message, time_out_second)) {
+      data.assign(message.begin(), message.end());
+
+      return true;
+    }
+
+    return false;
+  }
+
+  /**
+    Read a variable length binary message without copying it. The output view
+    points directly into the receive buffer owned by this object. No memory is
+    allocated once the connection is established.
+
+    @param   data output view of the next message, only valid until the next
+             call to waitForData or readData
+    @param   time_out_second time out and return false after
+             this many seconds, 0 value specifies no time out,
+             negative value specifies default time out
+    @pre     this object has an open socket connection
+    @throws  std::runtime_error if this client is not connected
+             or for any communication error
+  */
+  virtual bool readData(data_view_type &data, const int &time_out_second=-1);
+
+  /**
+    Read a variable length binary message into a caller owned buffer. Never
+    allocates any memory.
+
+    If the message does not fit, copy nothing and leave it at the front of
+    the receive buffer. Call again with a buffer of at least <tt>size</tt>
+    bytes to read it.
+
+    @param   data output buffer of <tt>capacity</tt> bytes
+    @param   size set to the length of the message, in bytes, or 0 if there
+             is no message
+    @param   time_out_second time out and return false after
+             this many seconds, 0 value specifies no time out,
+             negative value specifies default time out
+    @return  <tt>false</tt> if there is no message or if it is longer than
+             <tt>capacity</tt>
+    @pre     this object has an open socket connection
+    @throws  std::runtime_error if this client is not connected
+             or for any communication error
+  */
+  virtual bool readData(char *data, const std::size_t &capacity,
+                        std::size_t &size, const int &time_out_second=-1);
+
+  /**
+    Read all of the messages that are currently available on this client
+    connection. Block until the first message arrives, then deliver every
+    complete message that is already in the receive buffer or in the system
+    socket buffer. Makes at most one extra non-blocking system recv call.
+
+    Catch up with a backlog of messages in one call instead of one call per
+    message.
+
+    @code
+    class Handler {
+     public:
+      void operator()(const Client::data_view_type &data)
+      {
+        // Do something useful with the current real-time sample
+      }
+    };
+
+    client.readBatch(Handler());
+    @endcode
+
+    @param   fn function object called as <tt>fn(data)</tt> with a
+             Client::data_view_type for each message, in order, the view is
+             only valid for the duration of the call
+    @param   max_messages deliver at most this many messages, 0 value
+             specifies no limit
+    @param   time_out_second time out and return 0 after
+             this many seconds, 0 value specifies no time out,
+             negative value specifies default time out
+    @return  the number of messages delivered to <tt>fn</tt>
+    @pre     this object has an open socket connection
+    @throws  std::runtime_error if this client is not connected
+             or for any communication error
+  */
+  template <typename Function>
+  std::size_t readBatch(Function fn, const std::size_t &max_messages=0,
+                        const int &time_out_second=-1)
+  {
+    std::size_t result = 0;
+
+    data_view_type data;
+    if (readData(data, time_out_second)) {
+      bool allow_receive = true;
+      do {
+        fn(data);
+        ++result;
+      } while (((0 == max_messages) || (result < max_messages)) &&
+               receiveBufferedMessage(data, allow_receive));
+    }
+
+    return result;
+  }
+
+  /**
+    Read all of the messages that are currently available on this client
+    connection into a list of message views.
+
+    @param   data output list of message views, only valid until the next
+             call to waitForData or readData
+    @param   max_messages read at most this many messages, 0 value
+             specifies no limit
+    @param   time_out_second time out and return 0 after
+             this many seconds, 0 value specifies no time out,
+             negative value specifies default time out
+    @return  the number of messages in the output list
+    @see     Client#readBatch(Function, const std::size_t &, const int &)
+  */
+  virtual std::size_t readBatch(std::vector<data_view_type> &data,
+                                const std::size_t &max_messages=0,
+                                const int &time_out_second=-1);
+
+  /**
+    Read the most recent message on this client connection and skip all of
+    the older ones. Block until the first message arrives, then drain every
+    complete message that is already in the receive buffer or in the system
+    socket buffer without blocking. The skipped messages are not copied.
+    Incoming XML messages are intercepted as usual and are not counted.
+
+    Use this in a consumer that only wants the newest sample, like a render
+    loop, so that a stall does not turn into a backlog of stale samples.
+
+    @param   data output view of the newest message, only valid until the next
+             call to waitForData or readData
+    @param   dropped set to the number of older messages that were skipped
+    @param   time_out_second time out and return false after
+             this many seconds, 0 value specifies no time out,
+             negative value specifies default time out
+    @pre     this object has an open socket connection
+    @throws  std::runtime_error if this client is not connected
+             or for any communication error
+  */
+  virtual bool readLatest(data_view_type &data, std::size_t &dropped,
+                          const int &time_out_second=-1);
+
+  /**
+    Read the most recent message into the output vector.
+
+    @see     Client#readLatest(data_view_type &, std::size_t &, const int &)
+  */
+  virtual bool readLatest(data_type &data, std::size_t &dropped,
+                          const int &time_out_second=-1);
+
   /**
     Write a variable length binary message to the socket link.
 
@@ -154,6 +392,76 @@ class Client {
   */
   virtual bool writeData(const data_type &data, const int &time_out_second=-1);
 
+  /**
+    Write a list of variable length binary messages to the socket link.
+    Gather all of the length headers and messages into as few system send
+    calls as possible, usually one. Use this to send a burst of small
+    messages, like a list of Console chunks.
+
+    @param   data list of messages, none of them may be empty
+    @param   time_out_second time out and return false after
+             this many seconds, 0 value specifies no time out,
+             negative value specifies default time out
+    @return  <tt>true</tt> iff all of the messages were written, nothing is
+             written if the list is empty or has an invalid message
+    @pre     this object has an open socket connection
+    @throws  std::runtime_error if this client is not connected
+             or for any communication error
+  */
+  virtual bool writeBatch(const std::vector<data_type> &data,
+                          const int &time_out_second=-1);
+
+  /**
+    Enable or disable the Nagle algorithm on the socket link, the
+    <tt>TCP_NODELAY</tt> option. The algorithm is enabled by default. Disable
+    it to send each small message as soon as it is written, instead of
+    waiting for the acknowledgement of the previous one.
+
+    @param   no_delay <tt>true</tt> to disable the Nagle algorithm
+    @return  <tt>true</tt> iff the socket option is set
+    @pre     this object has an open socket connection
+    @throws  std::runtime_error if this client is not connected
+             or for any error in the system setsockopt call
+  */
+  bool setNoDelay(bool no_delay);
+
+  /**
+    Set the length of the longest message that this connection will read or
+    write. The default is 65535 bytes, we assume that a longer message is a
+    protocol error. Raise it for services that send larger messages, for
+    example the Configurable service with many nodes and channels.
+
+    Grow the receive buffer to hold one message of this length. Any message
+    view from a previous read is no longer valid.
+
+    @param   length in bytes, 0 value restores the default
+    @return  <tt>true</tt> iff the length is accepted, it may not exceed
+             256 MiB
+    @throws  std::runtime_error if the length is too large
+  */
+  bool setMaximumMessageLength(const std::size_t &length);
+
+  /** @see Client#setMaximumMessageLength */
+  std::size_t getMaximumMessageLength() const;
+
+  /**
+    Set the time outs that the read and write methods use when their
+    <tt>time_out_second</tt> argument is negative. Specified in milliseconds,
+    for reads that need a budget shorter than one second. Both default to
+    1000 milliseconds. Does not make any system calls.
+
+    A time out is a deadline for the whole call. The socket is non-blocking,
+    each call waits for it with the system poll call until the data arrives
+    or the deadline passes.
+
+    @param   read_millisecond time out of readData, readBatch, and
+             readLatest, 0 value specifies no time out, negative value
+             restores the default
+    @param   write_millisecond time out of writeData and writeBatch
+  */
+  void setDefaultTimeOut(const int &read_millisecond,
+                         const int &write_millisecond);
+
   /**
     Return the most recent XML message that this client connection received.
     The message could be anything so client applications need to user a
@@ -175,6 +483,31 @@ class Client {
   */
   virtual bool getErrorString(std::string &message);
 
+  /** Receive path counters. @see detail::client_statistics */
+  typedef detail::client_statistics statistics_type;
+
+  /**
+    Copy the receive path counters of this connection. Only available if the
+    library is built with MOTION_SDK_INSTRUMENT.
+
+    @param  result will contain a snapshot of the counters
+    @return <tt>true</tt> iff the instrumentation is compiled in
+  */
+  bool getStatistics(statistics_type &result) const;
+
+  /** Set all of the receive path counters to zero. */
+  void resetStatistics();
+
+  /**
+    Arrival time of the message returned by the most recent read, on the
+    detail::monotonic_time clock. This is the time that the system recv call
+    which completed the message returned.
+
+    @return the arrival time in seconds, or zero if the instrumentation is
+            not compiled in
+  */
+  double getMessageTime() const;
+
  protected:
   /** Raw socket file descriptor. */
   int m_socket;
@@ -218,6 +551,77 @@ class Client {
              communication protocol
   */
   Client &operator>>(std::string &message);
+
+  /**
+    Read a single binary message defined by a length header directly from the
+    receive buffer. Parse the length header in place and do not copy the
+    message.
+
+    This will block until is receives a non-empty message or the system recv
+    call times out. A partial message is kept in the receive buffer across a
+    time out.
+
+    @param   message output view of the next message, if
+             <tt>message.empty()</tt> then the receive timed out or the
+             socket connection has been gracefully terminated
+    @param   block if <code>false</code> then only read the bytes that are
+             already available on the socket, and return immediately if that
+             does not complete a message
+    @return  <tt>true</tt> iff message contains a complete binary message
+    @pre     this object has an open socket connection
+    @post    the message view is valid until the next call to this method
+    @throws  std::runtime_error for any errors in the message
+             communication protocol
+  */
+  bool receiveMessage(data_view_type &message, bool block=true);
+
+  /**
+    Return the next complete message without blocking, skipping any XML
+    messages if we are intercepting them. Read everything that is already
+    available on the socket. A graceful disconnection of the remote host
+    closes this client.
+
+    @param   message output view of the next message
+    @return  <tt>true</tt> iff message contains a complete binary message
+    @post    the message view is valid until the next call to any of the
+             read methods
+    @throws  std::runtime_error for any errors in the message
+             communication protocol
+  */
+  bool receiveAvailableMessage(data_view_type &message);
+
+  /**
+    Return the next complete message that is already in the receive buffer,
+    skipping any XML messages if we are intercepting them. If there is none,
+    make at most one non-blocking recv call to top up the buffer.
+
+    This never moves data inside of the receive buffer. All of the message
+    views handed out since the last call to receiveMessage remain valid.
+
+    @param   message output view of the next message
+    @param   allow_receive if <code>true</code> then we are allowed to make
+             one non-blocking recv call, set to <code>false</code> once we
+             have done so
+    @return  <tt>true</tt> iff message contains a complete binary message
+    @throws  std::runtime_error for any errors in the message
+             communication protocol
+  */
+  bool receiveBufferedMessage(data_view_type &message, bool &allow_receive);
+
+  /**
+    Skip to the last complete message that is available without blocking,
+    skipping any XML messages if we are intercepting them. Keep the current
+    message in the receive buffer until we find a newer one, and move it to
+    the front along with any partial message if we run out of space.
+
+    @param   message input view of the current message from receiveMessage,
+             output view of the newest message
+    @return  the number of messages that were skipped
+    @throws  std::runtime_error for any errors in the message
+             communication protocol
+  */
+  std::size_t receiveLatestMessage(data_view_type &message);
+
   /**
     Write a single binary message defined by a length header.
 
@@ -231,47 +635,91 @@ class Client {
   Client &operator<<(const std::string &message);
 
   /**
-    Low level socket receive command. Read a chunk into our object local buffer.
+    Low level socket receive command. Read a chunk into the caller buffer.
     This will block until it receives a non-empty message.
 
-    @param   data output storage for the next message, if <tt>data.empty()</tt>
-             after this call then the socket connection has been gracefully
-             terminated while we were blocking for incoming data
+    @param   data output storage for the next chunk
+    @param   size maximum number of bytes to write to <tt>data</tt>
     @param   receive_timed_out will be set to <code>true</code> if the
              system recv call timed out
+    @param   block if <code>false</code> then return immediately, with
+             <tt>receive_timed_out</tt> set, if there is no data available
     @return  the number of bytes read from the open socket connnection or 0 if
              the socket connection has been closed
     @pre     this object has an open socket connection
     @post    data contains N bytes of raw data from the socket connection
     @throws  std::runtime_error for any errors in the system socket recv call
   */
-  unsigned receive(std::string &data, bool &receive_timed_out);
+  unsigned receive(char *data, const std::size_t &size,
+                   bool &receive_timed_out, bool block=true);
+
+  /**
+    One contiguous range of bytes in a gather send.
+  */
+  struct send_buffer_type {
+    const char *data;
+    std::size_t size;
+  };
 
   /**
-    Low level socket send command. Write a chunk of data to the remote
-    socket endpoint.
+    Low level socket send command. Write a list of buffers to the remote
+    socket endpoint in one gather system call.
 
-    @param   data raw buffer of bytes to write to the socket
+    @param   buffer list of raw buffers of bytes to write to the socket
+    @param   count number of entries in <tt>buffer</tt>, the system call
+             writes at most detail::MaximumSendBuffer of them
     @param   send_timed_out will be set to <code>true</code> if the
              system send call timed out
-    @return  the number of bytes read from the open socket connnection or 0 if
-             the socket connection has been closed
+    @return  the number of bytes written to the open socket connnection or 0
+             if the socket connection has been closed
     @pre     this object has an open socket connection
-    @pre     data is not empty
+    @pre     there is at least one non-empty buffer
     @post    N bytes of data was written to the socket
     @throws  std::runtime_error for any errors in the system socket send call
   */  
-  unsigned send(const std::string &data, bool &send_timed_out);
+  unsigned send(const send_buffer_type *buffer, const std::size_t &count,
+                bool &send_timed_out);
+
+  /**
+    Write all of the buffers to the remote socket endpoint. Resume partial
+    writes until every byte is sent. Close the connection if the remote
+    endpoint stops accepting data.
+
+    @return  <tt>true</tt> iff all of the bytes were sent
+    @throws  std::runtime_error for any errors in the message
+             communication protocol
+  */
+  bool sendAll(const send_buffer_type *buffer, const std::size_t &count);
 
   /**
-    Set the receive time out for this socket.
+    Pack the 4 byte message length header in network byte order.
+
+    @return  <tt>false</tt> iff the message is empty or too long to send
+  */
+  bool packHeader(const std::size_t &size, unsigned &header);
+
+  /**
+    Set the receive time out for a read call. Negative value specifies the
+    default time out, in milliseconds.
+  */
+  void setReadTimeout(const int &time_out_second,
+                      const std::size_t &default_millisecond);
+
+  /**
+    Set the send time out for a write call. Negative value specifies the
+    default time out.
+  */
+  void setWriteTimeout(const int &time_out_second);
+
+  /**
+    Set the receive time out for this socket. Only stores the value, each
+    blocking receive waits for the socket with a deadline.
 
     @param   second specifies the number of seconds
     @pre     this object has an open socket connection
     @post    any calls to receive will time out after <code>second</code>
              seconds
-    @throws  std::runtime_error for any errors in the system socket
-             setsockopt call
+    @throws  std::runtime_error if this client is not connected
   */
   bool setReceiveTimeout(const std::size_t &second);
 
@@ -282,8 +730,7 @@ class Client {
     @pre     this object has an open socket connection
     @post    any calls to send will time out after <code>second</code>
              seconds
-    @throws  std::runtime_error for any errors in the system socket
-             setsockopt call
+    @throws  std::runtime_error if this client is not connected
   */
   bool setSendTimeout(const std::size_t &second);
 
@@ -292,21 +739,74 @@ class Client {
   */
   friend class ClientAccess;
 
+  /**
+    The Reactor drives many connections from one thread. It waits on the raw
+    socket descriptors and reads with receiveAvailableMessage.
+  */
+  friend class Reactor;
+
  private:
   /** Initialization flag. Specific to the Winsock API. */
   bool m_initialize;
 
-  /** Input buffer for receiving raw data. */
+  /**
+    Input buffer for receiving raw data. Allocated once at construction and
+    reused for the lifetime of this object, setMaximumMessageLength may grow
+    it. Incoming messages are parsed in place.
+  */
   std::vector<char> m_buffer;
 
-  /** Temporary message storage spans multiple high level receive calls. */
-  std::string m_nextMessage;
+  /** Index of the first unread byte in the receive buffer. */
+  std::size_t m_buffer_first;
+
+  /** Index one past the last received byte in the receive buffer. */
+  std::size_t m_buffer_last;
+
+  /**
+    Number of bytes, header included, of the message view we handed out in the
+    previous call to receiveMessage. Release them at the start of the next one.
+  */
+  std::size_t m_buffer_release;
+
+  /**
+    Parse the length header of the message at the front of the receive buffer.
+
+    @param   message output view of the message iff it is complete
+    @param   required set to the number of contiguous bytes, header included,
+             that the front message needs
+    @return  <tt>true</tt> iff message contains a complete binary message
+    @throws  std::runtime_error if the header specifies an invalid length
+  */
+  bool parseMessage(data_view_type &message, std::size_t &required);
+
+  /** Receive path counters. Only updated with MOTION_SDK_INSTRUMENT. */
+  statistics_type m_statistics;
+
+  /** Time that the most recent call to the system recv returned. */
+  double m_receive_time;
+
+  /** Arrival time of the most recent message that we parsed. */
+  double m_message_time;
 
-  /** Set this internal value to the current socket receive time out. */
-  std::size_t m_time_out_second;
+  /** Current receive time out in milliseconds, 0 for no time out. */
+  std::size_t m_time_out_receive;
+
+  /** Current send time out in milliseconds, 0 for no time out. */
+  std::size_t m_time_out_send;
+
+  /** Time outs, in milliseconds, of the read and write methods. */
+  std::size_t m_time_out_read_default;
+  std::size_t m_time_out_write_default;
+
+  /**
+    Deadlines of the receive and send in progress, on the
+    detail::monotonic_time clock. Negative for no deadline.
+  */
+  double m_receive_deadline;
+  double m_send_deadline;
 
-  /** Set this internal value to the current socket send time out. */
-  std::size_t m_time_out_second_send;
+  /** Longest message, in bytes, that we will read or write. */
+  std::size_t m_maximum_length;
 
   /**
     Initialize any network subsystems and create a socket descriptor.
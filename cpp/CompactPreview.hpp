@@ -0,0 +1,320 @@
+/*
+  @file    tools/sdk/cpp/CompactPreview.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_COMPACT_PREVIEW_HPP_
+#define __MOTION_SDK_COMPACT_PREVIEW_HPP_
+
+#include <Format.hpp>
+
+#include <string>
+#include <vector>
+
+
+namespace Motion { namespace SDK {
+
+/**
+  Decode the compact encoding of the Preview data service. A standard Preview
+  element is 14 single precision floats and a 4 byte id, 60 bytes per node in
+  every message. The compact encoding quantizes the channels and sends most
+  messages as a delta against the most recent keyframe. A typical element is
+  17 bytes.
+
+  Ask for the compact encoding with the initialization string at the start of
+  the connection. A service that does not support it ignores the request and
+  sends standard messages. The decoder accepts both, so the same read loop
+  works either way. Every decode reconstructs a standard Preview message and
+  then uses the regular Format methods.
+
+  @code
+  try {
+    using Motion::SDK::Client;
+    using Motion::SDK::CompactPreview;
+    using Motion::SDK::Format;
+
+    Client client("", 32079);
+
+    const std::string xml = CompactPreview::getInitialize();
+    client.writeData(Client::data_type(xml.begin(), xml.end()));
+
+    CompactPreview decoder;
+
+    Client::data_type data;
+    Format::PreviewFrame frame;
+    while (client.readData(data)) {
+      if (decoder.decode(data.begin(), data.end(), frame)) {
+        // Same as Format::Preview(data.begin(), data.end(), frame).
+      }
+    }
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+  }
+  @endcode
+
+  Message format, all values are little-endian:
+  @code
+  header  => {uint32 magic "MCP1", uint8 version, uint8 flags,
+              uint16 keyframe sequence, uint32 number of elements}
+  element => {uint32 id, field[4]} if flags & Keyframe
+             {uint32 id, uint8 mode, field[0..4]} otherwise
+  @endcode
+
+  The four fields, in order, are the global quaternion, local quaternion,
+  Euler angles, and acceleration. A keyframe element has every field in its
+  quantized form, 6 bytes each. A delta element has 2 bits of mode per field,
+  the first field in the low bits.
+  - ModeKeyframe, same value as the keyframe, 0 bytes
+  - ModeDelta, three int8 differences from the keyframe, 3 bytes
+  - ModeFull, quantized value, 6 bytes
+
+  Quaternions use the "smallest three" encoding. Drop the component with the
+  largest magnitude, send its index in 2 bits and the other three in 15 bits
+  each. The decoder restores the fourth component from the unit length and
+  always makes it positive, so a decoded quaternion may be the negation of
+  the original. Both describe the same rotation. Euler angles are int16 on
+  <tt>[-pi, pi]</tt> and acceleration is int16 in units of 1/4096 g.
+*/
+class CompactPreview {
+ public:
+  typedef Format::id_type id_type;
+  typedef std::vector<char> data_type;
+
+  enum {
+    /** First four bytes of a compact message, "MCP1". */
+    Magic = 0x3150434d,
+    Version = 1,
+    HeaderSize = 12,
+
+    /** Bits of the header flags. */
+    Keyframe = 0x01,
+
+    /** Per field mode of a delta element. */
+    ModeKeyframe = 0,
+    ModeDelta = 1,
+    ModeFull = 2,
+
+    /** Global quaternion, local quaternion, Euler angles, acceleration. */
+    FieldSize = 4,
+
+    DefaultKeyframeInterval = 30
+  };
+
+  /**
+    Quantized field of one element. A quaternion stores the index of the
+    dropped component, or 4 for the all zero quaternion.
+  */
+  struct Field {
+    unsigned char index;
+    short value[3];
+  }; // struct Field
+
+  /** Quantized element. */
+  struct Element {
+    id_type id;
+    Field field[FieldSize];
+  }; // struct Element
+
+  typedef std::vector<Element> element_list_type;
+
+  /**
+    Initialization string that asks the Preview service for the compact
+    encoding.
+
+    @param   keyframe_interval send a keyframe at least once every this many
+             messages
+  */
+  static std::string getInitialize(
+    const std::size_t &keyframe_interval=DefaultKeyframeInterval);
+
+  /**
+    @return  <tt>true</tt> iff the message starts with a compact header
+  */
+  static bool isCompact(const char *data, const std::size_t &size);
+
+  CompactPreview();
+
+  /**
+    Reconstruct the standard Preview message. Copy a standard message as is.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  <tt>false</tt> if the message is not valid, or if it is a delta
+             and there is no matching keyframe yet
+  */
+  template <typename InputIterator>
+  bool decode(InputIterator first, InputIterator last, data_type &message)
+  {
+    const std::size_t bytes =
+      static_cast<std::size_t>(std::distance(first, last));
+    if (0 == bytes) {
+      message.clear();
+      return false;
+    }
+
+    const char *data = &(*first);
+    if (!isCompact(data, bytes)) {
+      message.assign(data, data + bytes);
+      return true;
+    }
+
+    return expand(data, bytes, message);
+  }
+
+  /**
+    Decode a compact or standard message into an associative container of
+    PreviewElement entries.
+
+    @see     Format#Preview
+  */
+  template <typename InputIterator>
+  bool decode(InputIterator first, InputIterator last,
+              Format::preview_service_type &result)
+  {
+    const char *data = NULL;
+    std::size_t bytes = 0;
+    if (!prepare(first, last, data, bytes)) {
+      result.clear();
+      return false;
+    }
+
+    result = Format::Preview(data, data + bytes);
+    return !result.empty();
+  }
+
+  /**
+    Decode a compact or standard message into a flat PreviewFrame.
+
+    @see     Format#Preview
+  */
+  template <typename InputIterator>
+  bool decode(InputIterator first, InputIterator last,
+              Format::PreviewFrame &frame)
+  {
+    const char *data = NULL;
+    std::size_t bytes = 0;
+    if (!prepare(first, last, data, bytes)) {
+      frame.clear();
+      return false;
+    }
+
+    return Format::Preview(data, data + bytes, frame);
+  }
+
+  /**
+    Forget the current keyframe. Call this after a new connection.
+  */
+  void reset();
+
+  /**
+    @return  <tt>true</tt> iff a keyframe has arrived and delta messages
+             can be decoded
+  */
+  bool hasKeyframe() const;
+
+  /**
+    Quantize standard Preview messages into the compact encoding. This is the
+    service side of the stream, use it for tests and for tools that store or
+    forward Preview data.
+  */
+  class Encoder {
+   public:
+    explicit Encoder(
+      const std::size_t &keyframe_interval=DefaultKeyframeInterval);
+
+    /**
+      Encode one standard Preview message. Send a keyframe on the first call
+      and then once every keyframe interval messages.
+
+      @pre     <tt>[first, last)</tt> is a valid, contiguous range
+      @return  <tt>false</tt> if the input is not a valid Preview message
+    */
+    template <typename InputIterator>
+    bool encode(InputIterator first, InputIterator last, data_type &message)
+    {
+      const std::size_t bytes =
+        static_cast<std::size_t>(std::distance(first, last));
+      if (0 == bytes) {
+        message.clear();
+        return false;
+      }
+
+      return encode(&(*first), bytes, message);
+    }
+
+    /** Send a keyframe with the next message. */
+    void reset();
+
+   private:
+    std::size_t m_keyframe_interval;
+    std::size_t m_count;
+    unsigned m_sequence;
+    element_list_type m_keyframe;
+    element_list_type m_element;
+
+    bool encode(const char *data, const std::size_t &size, data_type &message);
+  }; // class Encoder
+
+ private:
+  element_list_type m_keyframe;
+  unsigned m_sequence;
+  bool m_valid;
+
+  /** Reconstructed standard message, reused between calls. */
+  data_type m_message;
+
+  bool expand(const char *data, const std::size_t &size, data_type &message);
+
+  /**
+    Point at the standard message, in place or in the reconstructed buffer.
+  */
+  template <typename InputIterator>
+  bool prepare(InputIterator first, InputIterator last, const char *&data,
+               std::size_t &size)
+  {
+    size = static_cast<std::size_t>(std::distance(first, last));
+    if (0 == size) {
+      return false;
+    }
+
+    data = &(*first);
+    if (isCompact(data, size)) {
+      if (!expand(data, size, m_message)) {
+        return false;
+      }
+
+      data = &m_message[0];
+      size = m_message.size();
+    }
+
+    return true;
+  }
+}; // class CompactPreview
+
+}} // namespace Motion::SDK
+
+#endif // __MOTION_SDK_COMPACT_PREVIEW_HPP_
@@ -0,0 +1,250 @@
+/*
+  @file    tools/sdk/cpp/ConfigurableSchema.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_CONFIGURABLE_SCHEMA_HPP_
+#define __MOTION_SDK_CONFIGURABLE_SCHEMA_HPP_
+
+#include <Format.hpp>
+
+#include <string>
+#include <vector>
+
+
+namespace Motion { namespace SDK {
+
+/**
+  Channel layout of the Configurable data service. The client selects the
+  channels at the start of the connection with an XML definition. Build a
+  schema from the same definition once and look up the position of every
+  named channel in the flat element, instead of slicing each element with
+  ConfigurableElement::getRange and hand coded offsets.
+
+  A complete schema also knows the number of channels per element in
+  advance, so the decode uses a fixed stride and skips the length check of
+  every element. An incomplete schema falls back to the generic decode.
+
+  @code
+  try {
+    using Motion::SDK::Client;
+    using Motion::SDK::ConfigurableSchema;
+    using Motion::SDK::Format;
+
+    const std::string xml =
+      "<configurable><preview><Gq/></preview><sensor><a/></sensor>"
+      "</configurable>";
+
+    ConfigurableSchema schema(xml);
+    const ConfigurableSchema::Channel Gq = schema.getChannel("Gq");
+    const ConfigurableSchema::Channel a = schema.getChannel("a");
+
+    Client client("", 32076);
+    client.writeData(Client::data_type(xml.begin(), xml.end()));
+
+    Client::data_type data;
+    Format::ConfigurableFrame frame;
+    while (client.readData(data)) {
+      if (schema.decode(data.begin(), data.end(), frame)) {
+        // Gq.length arrays of frame.size() values, one per node.
+        const float *quaternion = Gq.get(frame);
+        const float *accelerometer = a.get(frame);
+      }
+    }
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+  }
+  @endcode
+*/
+class ConfigurableSchema {
+ public:
+  typedef std::size_t size_type;
+  typedef Format::ConfigurableFrame::value_type value_type;
+
+  /**
+    Position of a single named channel in a Configurable data element.
+  */
+  class Channel {
+   public:
+    Channel();
+
+    Channel(const std::string &name_in, const size_type &base_in,
+            const size_type &length_in);
+
+    /**
+      Channel name as it appears in the XML definition, for example "Gq".
+    */
+    std::string name;
+
+    /**
+      Index of the first value of this channel in the element.
+    */
+    size_type base;
+
+    /**
+      Number of values in this channel, for example 4 for a quaternion. Zero
+      if the channel is unknown.
+    */
+    size_type length;
+
+    /**
+      Get a pointer to the <tt>length</tt> contiguous arrays of
+      <tt>frame.size()</tt> values of this channel.
+
+      @return NULL if the frame does not contain this channel
+    */
+    const value_type *get(const Format::ConfigurableFrame &frame) const
+    {
+      if (0 == length) {
+        return NULL;
+      }
+
+      return frame.getRange(base, length);
+    }
+
+    /**
+      Copy the values of this channel of a single element in the frame.
+
+      @return <tt>true</tt> iff the frame contains this element and channel
+    */
+    template <typename OutputIterator>
+    bool get(const Format::ConfigurableFrame &frame, const size_type &index,
+             OutputIterator result) const
+    {
+      if (0 == length) {
+        return false;
+      }
+
+      return frame.getData(index, base, length, result);
+    }
+
+    /**
+      Copy the values of this channel out of a single element view.
+
+      @return <tt>true</tt> iff the element contains this channel
+    */
+    bool get(const Format::ConfigurableElementView &element,
+             value_type *result) const
+    {
+      if (0 == length) {
+        return false;
+      }
+
+      return element.getRange(base, length, result);
+    }
+  }; // class Channel
+
+  typedef std::vector<Channel> channel_list_type;
+
+  /**
+    Empty schema. Decode with the generic Format::Configurable method.
+  */
+  ConfigurableSchema();
+
+  /**
+    Build the schema from the XML definition sent to the Configurable service.
+    Every leaf element, for example <tt>&lt;Gq/&gt;</tt>, is a channel in
+    document order. The section elements, for example
+    <tt>&lt;preview&gt;</tt>, only group channels.
+
+    Channels not in the built in table of the Motion Service channels have
+    an unknown length. Set it with @ref setChannelLength.
+
+    @param   xml the definition as sent by Client::writeData
+    @throws  std::runtime_error if the definition is not well formed
+  */
+  explicit ConfigurableSchema(const std::string &xml);
+
+  /**
+    @return  <tt>true</tt> iff all of the channel lengths are known and the
+             decode uses a fixed stride
+  */
+  bool isValid() const;
+
+  /**
+    Total number of values in a single Configurable data element.
+  */
+  size_type length() const;
+
+  /**
+    Ordered list of channels.
+  */
+  const channel_list_type &getChannelList() const;
+
+  /**
+    Look up a channel by name.
+
+    @return  the channel, or a channel with zero length if there is no match
+  */
+  Channel getChannel(const std::string &name) const;
+
+  /**
+    Set the number of values of a channel and update the position of all
+    of the channels after it.
+
+    @return  <tt>false</tt> if there is no channel with this name
+  */
+  bool setChannelLength(const std::string &name, const size_type &length);
+
+  /**
+    Number of values in one of the standard Configurable service channels.
+
+    @return  the channel length, or zero if the name is not in the table
+  */
+  static size_type getStandardLength(const std::string &name);
+
+  /**
+    Decode a Configurable service message into a flat frame. Use the fixed
+    stride decode if the schema is valid, otherwise the generic decode.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  <tt>true</tt> iff the message is valid and matches this schema,
+             otherwise the frame is empty
+  */
+  template <typename InputIterator>
+  bool decode(InputIterator first, InputIterator last,
+              Format::ConfigurableFrame &frame) const
+  {
+    if (isValid()) {
+      return Format::Configurable(first, last, m_length, frame);
+    }
+
+    return Format::Configurable(first, last, frame);
+  }
+
+ private:
+  channel_list_type m_channel;
+  size_type m_length;
+  bool m_valid;
+
+  void update();
+}; // class ConfigurableSchema
+
+}} // namespace Motion::SDK
+
+#endif // __MOTION_SDK_CONFIGURABLE_SCHEMA_HPP_
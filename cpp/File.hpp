@@ -132,10 +132,7 @@ public:
         if (m_input.read(reinterpret_cast<char *>(&data[0]), data_byte_size)) {
           // Motion data is store in little-endian format. Transform it
           // to the native byte-order now.
-          std::transform(
-            data.begin(), data.end(),
-            data.begin(),
-            &detail::little_endian_to_native<T>);
+          detail::transform_little_endian_to_native(&data[0], data.size());
 
           result = true;
         } else {
@@ -153,6 +150,66 @@ public:
 
     return result;
   }
+
+  /**
+    Read up to <tt>n_frames</tt> samples of <tt>length</tt> values each from
+    the current position in the input file stream, in one read call. Convert
+    them into contiguous arrays of type <tt>T</tt> elements.
+
+    The output array is resized to hold the samples that were read. It keeps
+    its capacity, so a loop that reads blocks of the same size allocates on
+    the first call only.
+
+    @code
+    std::vector<float> data;
+    while (std::size_t n = file.readBlock(data, Format::SensorElement::Length, 1024)) {
+      // Sample i is data[i * Format::SensorElement::Length] ...
+    }
+    @endcode
+
+    @param   data is the output array, <tt>length</tt> values per sample
+    @param   length number of values in one sample
+    @param   n_frames maximum number of samples to read
+    @return  number of complete samples read, less than <tt>n_frames</tt>
+    at the end of the file. A partial sample at the end of the file is
+    discarded.
+    @pre     type <tt>T</tt> is a primitive data type
+    @throws  std::runtime_error if there is any error reading from
+    the file stream, not including an EOF
+  */
+  template <typename T>
+  std::size_t readBlock(std::vector<T> &data, const std::size_t &length,
+                        const std::size_t &n_frames)
+  {
+    std::size_t result = 0;
+
+    if ((length > 0) && (n_frames > 0) && m_input.good()) {
+      data.resize(length * n_frames);
+
+      // Read a block of data from the input stream directly into
+      // the data buffer.
+      m_input.read(
+        reinterpret_cast<char *>(&data[0]),
+        static_cast<std::streamsize>(data.size() * sizeof(T)));
+
+      result = static_cast<std::size_t>(m_input.gcount()) /
+        (length * sizeof(T));
+
+      if (result < n_frames) {
+        // EOF, close the input stream.
+        close();
+      }
+    }
+
+    data.resize(result * length);
+    if (!data.empty()) {
+      // Motion data is store in little-endian format. Transform it
+      // to the native byte-order now.
+      detail::transform_little_endian_to_native(&data[0], data.size());
+    }
+
+    return result;
+  }
 private:
   /**
     Input file stream. Current input state. The #readData function simply
@@ -32,12 +32,16 @@
 #define __MOTION_SDK_FORMAT_HPP_
 
 #include <algorithm>
+#include <cstring>
 #include <iterator>
 #include <map>
 #include <vector>
 
+#include <detail/array.hpp>
 #include <detail/endian_to_native.hpp>
 #include <detail/exception.hpp>
+#include <detail/kernel.hpp>
+#include <detail/layout.hpp>
 
 
 namespace Motion { namespace SDK {
@@ -88,6 +92,9 @@ public:
   /** Container size. Use the vector defined type. */
   typedef data_type::size_type size_type;
 
+  /** Sorted list of element ids to select from a message. */
+  typedef std::vector<id_type> id_list_type;
+
 
   /**
     The Motion Service send a list of data elements. The @ref Format
@@ -152,6 +159,44 @@ public:
       return result;
     }
 
+    /**
+      Utility function to copy portions of the packed data array into a fixed
+      size array. Does not allocate any memory.
+
+      @param base starting index to copy data from the internal data array
+      @param result assigned to <tt>{m_data[i] ... m_data[i+N]}</tt> if there
+      are valid values available or zeros otherwise
+    */
+    template <std::size_t N>
+    void getData(const size_type &base, detail::array<T, N> &result) const
+    {
+      if (base + N <= m_data.size()) {
+        std::copy(
+          m_data.begin() + base, m_data.begin() + base + N, result.begin());
+      } else {
+        result.assign(T());
+      }
+    }
+
+    /**
+      Copy a channel described by a compile time layout descriptor, for
+      example <tt>getData<PreviewLayout::Euler>()</tt>.
+
+      @see detail::channel
+    */
+    template <typename Channel>
+    data_type getData() const
+    {
+      return getData(Channel::Base, Channel::Length);
+    }
+
+    /** @see Element#getData */
+    template <typename Channel>
+    void getData(detail::array<T, Channel::Length> &result) const
+    {
+      getData(Channel::Base, result);
+    }
+
    private:
     /**
       Array of packed binary data for this element. If <tt>data.empty() ==
@@ -179,6 +224,9 @@ public:
     */
     friend class ElementAccess;
 
+    /** Decode into the data buffer of an existing element, see ApplyInto. */
+    friend class Format;
+
    public:
     const data_type &access() const
     {
@@ -186,6 +234,69 @@ public:
     }
   }; // class Element
 
+  /**
+    Compile time channel layout of the Preview format. Each channel is a
+    @ref detail::channel type with the <tt>Base</tt> index and
+    <tt>Length</tt> of the channel in the packed element. Use the layout
+    types with the templated accessors and the @ref Format#Decode method so
+    that the offsets are checked and folded at compile time.
+
+    @code
+    typedef Format::PreviewLayout layout_type;
+
+    std::vector<Format::FixedElement<layout_type> > list;
+    if (Format::Decode(data.begin(), data.end(), list) && !list.empty()) {
+      const float *euler = list.front().get<layout_type::Euler>();
+    }
+    @endcode
+  */
+  struct PreviewLayout {
+    typedef float value_type;
+
+    typedef detail::channel<0, 4> GlobalQuaternion;
+    typedef detail::channel<GlobalQuaternion::End, 4> LocalQuaternion;
+    typedef detail::channel<LocalQuaternion::End, 3> Euler;
+    typedef detail::channel<Euler::End, 3> Accelerate;
+
+    enum {
+      Length = Accelerate::End
+    };
+  }; // struct PreviewLayout
+
+  /**
+    Compile time channel layout of the Sensor format.
+
+    @see PreviewLayout
+  */
+  struct SensorLayout {
+    typedef float value_type;
+
+    typedef detail::channel<0, 3> Accelerometer;
+    typedef detail::channel<Accelerometer::End, 3> Magnetometer;
+    typedef detail::channel<Magnetometer::End, 3> Gyroscope;
+
+    enum {
+      Length = Gyroscope::End
+    };
+  }; // struct SensorLayout
+
+  /**
+    Compile time channel layout of the Raw format.
+
+    @see PreviewLayout
+  */
+  struct RawLayout {
+    typedef short value_type;
+
+    typedef detail::channel<0, 3> Accelerometer;
+    typedef detail::channel<Accelerometer::End, 3> Magnetometer;
+    typedef detail::channel<Magnetometer::End, 3> Gyroscope;
+
+    enum {
+      Length = Gyroscope::End
+    };
+  }; // struct RawLayout
+
   /**
     The Configurable data services provides access to all data streams in
     a single message. The client selects channels and ordering at the
@@ -238,8 +349,13 @@ public:
    public:
     typedef Format::Element<float>::data_type data_type;
 
+    /** Fixed size types for the output parameter accessors. */
+    typedef detail::array<float, 4> quaternion_type;
+    typedef detail::array<float, 3> vector_type;
+    typedef detail::array<float, 16> matrix_type;
+
     /** Two quaternion channels, two 3-axis channels. */
-    const static std::size_t Length = 2 * 4 + 2 * 3;
+    const static std::size_t Length = PreviewLayout::Length;
     static std::string Name;
 
     /**
@@ -266,6 +382,9 @@ public:
       in radians or zeros if there is no available data
     */
     data_type getEuler() const;
+
+    /** @see PreviewElement#getEuler */
+    void getEuler(vector_type &result) const;
 	  
     /**
       Get a 4-by-4 rotation matrix from the current global or local quaternion
@@ -275,6 +394,9 @@ public:
       to false to get the global orientation
     */
     data_type getMatrix(bool local) const;
+
+    /** @see PreviewElement#getMatrix */
+    void getMatrix(bool local, matrix_type &result) const;
 	  
     /**
       Get the global or local unit quaternion that defines the current
@@ -287,6 +409,9 @@ public:
       if there is no available data
     */
     data_type getQuaternion(bool local) const;
+
+    /** @see PreviewElement#getQuaternion */
+    void getQuaternion(bool local, quaternion_type &result) const;
 	  
     /**
       Get x, y, and z of the current estimate of linear acceleration.
@@ -296,6 +421,9 @@ public:
       channels specified in g or zeros if there is no available data
     */
     data_type getAccelerate() const;
+
+    /** @see PreviewElement#getAccelerate */
+    void getAccelerate(vector_type &result) const;
   }; // class PreviewElement
 
 
@@ -313,8 +441,11 @@ public:
    public:
     typedef Format::Element<float>::data_type data_type;
 
+    /** Fixed size type for the output parameter accessors. */
+    typedef detail::array<float, 3> vector_type;
+
     /** Three 3-axis channels. */
-    const static std::size_t Length = 3 * 3;
+    const static std::size_t Length = SensorLayout::Length;
     static std::string Name;
 
     /**
@@ -340,6 +471,9 @@ public:
     */
     data_type getAccelerometer() const;
 
+    /** @see SensorElement#getAccelerometer */
+    void getAccelerometer(vector_type &result) const;
+
     /**
       Get a set of x, y, and z values of the current un-filtered
       gyroscope signal. Specified in <tt>degree/second</tt>.
@@ -352,19 +486,25 @@ public:
       in <tt>degree/second</tt> or zeros if there is no available data
     */
     data_type getGyroscope() const;
+
+    /** @see SensorElement#getGyroscope */
+    void getGyroscope(vector_type &result) const;
 	  
     /**
       Get a set of x, y, and z values of the current un-filtered
-      magnetometer signal. Specified in <tt>T</tt> (microtesla).
+      magnetometer signal. Specified in <tt>�T</tt> (microtesla).
 
       Domain varies with local magnetic field strength. Expect values
-      on domain <tt>[-60, 60]</tt> <tt>T</tt> (microtesla).
+      on domain <tt>[-60, 60]</tt> <tt>�T</tt> (microtesla).
 
       @return a three element array <tt>{x, y, z}</tt> of magnetic field
-      strength in <tt>T</tt> (microtesla) or zeros if there is no
+      strength in <tt>�T</tt> (microtesla) or zeros if there is no
       available data
     */
     data_type getMagnetometer() const;
+
+    /** @see SensorElement#getMagnetometer */
+    void getMagnetometer(vector_type &result) const;
   }; // class SensorElement
 
 
@@ -385,8 +525,11 @@ public:
    public:
     typedef Format::Element<short>::data_type data_type;
 
+    /** Fixed size type for the output parameter accessors. */
+    typedef detail::array<short, 3> vector_type;
+
     /** Three 3-axis channels. */
-    const static std::size_t Length = 3 * 3;
+    const static std::size_t Length = RawLayout::Length;
     static std::string Name;
 
     /**
@@ -410,6 +553,9 @@ public:
     */
     data_type getAccelerometer() const;
 
+    /** @see RawElement#getAccelerometer */
+    void getAccelerometer(vector_type &result) const;
+
     /**
       Get a set of x, y, and z values of the current unprocessed
       gyroscope signal.
@@ -420,6 +566,9 @@ public:
       gyroscope output or zeros if there is no available data
     */
     data_type getGyroscope() const;
+
+    /** @see RawElement#getGyroscope */
+    void getGyroscope(vector_type &result) const;
 	  
     /**
       Get a set of x, y, and z values of the current unprocessed
@@ -431,158 +580,1472 @@ public:
       magnetometer output or zeros if there is no available data
     */
     data_type getMagnetometer() const;
+
+    /** @see RawElement#getMagnetometer */
+    void getMagnetometer(vector_type &result) const;
   }; // class RawElement
 
 
   /**
-    Define the associative container type for PreviewElement
-    entries.
+    Non-owning view of a single data element in a binary message. Reads the
+    packed little-endian values directly from the message buffer. The view
+    does not allocate any memory and is only valid as long as the message
+    buffer is unchanged.
+
+    Example usage:
+    @code
+    Client::data_view_type data;
+    Format::PreviewElementView element;
+    Format::PreviewElement::quaternion_type q;
+    while (client.readData(data)) {
+      if (Format::Preview(data.begin(), data.end(), 1, element)) {
+        element.getQuaternion(false, q);
+      }
+    }
+    @endcode
+
+    @see Format#Preview
   */
-  typedef std::map<
-    id_type,
-    ConfigurableElement
-  > configurable_service_type;
+  template <typename T>
+  class ElementView {
+   public:
+    typedef T value_type;
 
-  /**
-    Convert a range of binary data into an associative
-    container (std::map) of ConfigurableElement entries.
+    ElementView()
+      : m_data(NULL), m_length(0)
+    {
+    }
 
-    @pre     <tt>[first, last)</tt> is a valid range
-    @return  an associative container ConfigurableElement entries
-  */
-  template <typename InputIterator>
-  static inline configurable_service_type Configurable(InputIterator first,
-                                                       InputIterator last)
-  {
-    return Apply<ConfigurableElement>(first, last);
-  }
+    /**
+      @param data pointer to the first packed value of this element
+      @param length number of values in this element
+    */
+    ElementView(const char *data, const size_type &length)
+      : m_data(data), m_length(length)
+    {
+    }
 
-  /**
-    Define the associative container type for PreviewElement
-    entries.
-  */
-  typedef std::map<
-    id_type,
-    PreviewElement
-  > preview_service_type;
+    /**
+      @return the number of values in this element
+    */
+    size_type size() const
+    {
+      return m_length;
+    }
 
-  /**
-    Convert a range of binary data into an associative
-    container (std::map) of PreviewElement entries.
+    bool empty() const
+    {
+      return 0 == m_length;
+    }
 
-    @pre     <tt>[first, last)</tt> is a valid range
-    @return  an associative container PreviewElement entries
-  */
-  template <typename InputIterator>
-  static inline preview_service_type Preview(InputIterator first,
-                                             InputIterator last)
-  {
-    return Apply<PreviewElement>(first, last);
-  }
+    /**
+      @pre <tt>index < size()</tt>
+      @return the value at <tt>index</tt> in native byte order
+    */
+    value_type operator[](const size_type &index) const
+    {
+      value_type result = value_type();
+      detail::copy_little_endian_to_native(
+        m_data + index * sizeof(value_type), 1, &result);
+      return result;
+    }
+
+   protected:
+    /**
+      Copy a range of values into an output array.
+
+      @param base starting index to copy data from the element
+      @param length number of values to copy
+      @param result output array of at least <tt>length</tt> values,
+      assigned to zeros if there are no valid values available
+      @return true if there were valid values available
+    */
+    bool getData(const size_type &base, const size_type &length,
+                 value_type *result) const
+    {
+      if ((NULL != m_data) && (base + length <= m_length)) {
+        detail::copy_little_endian_to_native(
+          m_data + base * sizeof(value_type), length, result);
+        return true;
+      } else {
+        std::fill(result, result + length, value_type());
+        return false;
+      }
+    }
+
+    /** @see ElementView#getData */
+    template <std::size_t N>
+    void getData(const size_type &base, detail::array<T, N> &result) const
+    {
+      getData(base, N, result.data());
+    }
+
+    /** @see Element#getData */
+    template <typename Channel>
+    void getData(detail::array<T, Channel::Length> &result) const
+    {
+      getData(Channel::Base, result);
+    }
+
+   private:
+    const char *m_data;
+    size_type m_length;
+  }; // class ElementView
 
   /**
-    Define the associative container type for SensorElement
-    entries.
+    Non-owning view of a single Configurable data element.
+
+    @see ConfigurableElement
   */
-  typedef std::map<
-    id_type,
-    SensorElement
-  > sensor_service_type;
+  class ConfigurableElementView : public ElementView<float> {
+   public:
+    typedef Format::ElementView<float>::value_type value_type;
+
+    /**
+      Copy a contiguous range of channel entries specified by start index and
+      number of elements into an output array.
+
+      @return true if there were valid values available
+    */
+    bool getRange(const size_type &base, const size_type &length,
+                  value_type *result) const;
+  }; // class ConfigurableElementView
 
   /**
-    Convert a range of binary data into an associative
-    container (std::map) of SensorElement entries.
+    Non-owning view of a single Preview data element.
 
-    @pre     <tt>[first, last)</tt> is a valid range
-    @return  an associative container SensorElement entries
+    @see PreviewElement
   */
-  template <typename InputIterator>
-  static inline sensor_service_type Sensor(InputIterator first,
-                                           InputIterator last)
-  {
-    return Apply<SensorElement>(first, last);
-  }
+  class PreviewElementView : public ElementView<float> {
+   public:
+    typedef PreviewElement::quaternion_type quaternion_type;
+    typedef PreviewElement::vector_type vector_type;
+    typedef PreviewElement::matrix_type matrix_type;
+
+    /** @see PreviewElement#getEuler */
+    void getEuler(vector_type &result) const;
+
+    /** @see PreviewElement#getMatrix */
+    void getMatrix(bool local, matrix_type &result) const;
+
+    /** @see PreviewElement#getQuaternion */
+    void getQuaternion(bool local, quaternion_type &result) const;
+
+    /** @see PreviewElement#getAccelerate */
+    void getAccelerate(vector_type &result) const;
+  }; // class PreviewElementView
 
   /**
-    Define the associative container type for RawElement
-    entries.
+    Non-owning view of a single Sensor data element.
+
+    @see SensorElement
   */
-  typedef std::map<
-    id_type,
-    RawElement
-  > raw_service_type;
+  class SensorElementView : public ElementView<float> {
+   public:
+    typedef SensorElement::vector_type vector_type;
+
+    /** @see SensorElement#getAccelerometer */
+    void getAccelerometer(vector_type &result) const;
+
+    /** @see SensorElement#getGyroscope */
+    void getGyroscope(vector_type &result) const;
+
+    /** @see SensorElement#getMagnetometer */
+    void getMagnetometer(vector_type &result) const;
+  }; // class SensorElementView
 
   /**
-    Convert a range of binary data into an associative
-    container (std::map) of RawElement entries.
+    Non-owning view of a single Raw data element.
 
-    @pre     <tt>[first, last)</tt> is a valid range
-    @return  an associative container RawElement entries
+    @see RawElement
   */
-  template <typename InputIterator>
-  static inline raw_service_type Raw(InputIterator first,
-                                     InputIterator last)
-  {
-    return Apply<RawElement>(first, last);
-  }
+  class RawElementView : public ElementView<short> {
+   public:
+    typedef RawElement::vector_type vector_type;
+
+    /** @see RawElement#getAccelerometer */
+    void getAccelerometer(vector_type &result) const;
+
+    /** @see RawElement#getGyroscope */
+    void getGyroscope(vector_type &result) const;
+
+    /** @see RawElement#getMagnetometer */
+    void getMagnetometer(vector_type &result) const;
+  }; // class RawElementView
 
- private:
   /**
-    Convert a binary packed data representation from the Motion Service into a
-    std::map<Format::id_type, Format::*Element>. Use the IdToValueArray method
-    to handle the low level message parsing.
+    Offsets of all of the elements in a binary message, built with one walk
+    over the element headers. Nothing is decoded or byte swapped until the
+    caller asks for an element or a range of channels. If the elements have
+    a fixed length the offsets are computed, not stored.
+
+    Index the same message buffer over and over. The index keeps its memory
+    and is only valid as long as the message buffer is unchanged.
+
+    @code
+    Format::ElementIndex<float> index;
+    Format::PreviewElementView element;
+    while (client.readData(data)) {
+      if (Format::Preview(data.begin(), data.end(), index)) {
+        // Decode just the two nodes we need.
+        if (index.getView(index.find(1), element)) {
+          element.getQuaternion(false, q);
+        }
+        if (index.getView(index.find(7), element)) {
+          element.getAccelerate(a);
+        }
+      }
+    }
+    @endcode
   */
-  template <typename T, typename InputIterator>
-  static std::map<id_type,T> Apply(InputIterator first,
-                                   InputIterator last)
-  {
-    std::map<id_type,T> result;
+  template <typename T>
+  class ElementIndex {
+   public:
+    typedef T value_type;
 
+    ElementIndex()
+      : m_data(NULL), m_id(), m_offset(), m_length(0), m_header_size(0),
+        m_is_sorted(true)
     {
-      // Use this to do most of the dirty work.
-      std::map<id_type,typename T::data_type> map =
-        IdToValueArray<id_type,typename T::data_type>(first, last, T::Length);
-      if (!map.empty()) {
-        // Copy each [id] => vector<float> entry into the [id] => PreviewMap
-        // result map. Use the range insert operator since we can statically
-        // cast a vector<float> object directly into a PreviewElement. 
-        result.insert(map.begin(), map.end());
+    }
 
-        // Make sure that we were able to insert all of the elements.
-        if (map.size() != result.size()) {
-          result.clear();
+    /** Number of elements in the message. */
+    size_type size() const
+    {
+      return m_id.size();
+    }
+
+    bool empty() const
+    {
+      return m_id.empty();
+    }
+
+    /** Forget the message. Keep the allocated memory. */
+    void clear()
+    {
+      m_data = NULL;
+      m_id.clear();
+      m_offset.clear();
+      m_length = 0;
+      m_header_size = 0;
+      m_is_sorted = true;
+    }
+
+    /** Element ids in message order. */
+    const id_list_type &getId() const
+    {
+      return m_id;
+    }
+
+    /**
+      Look up the index of the element with the specified id. A binary
+      search if the message is in id order.
+
+      @return index of the element in <tt>[0, size())</tt>, or
+      <tt>size()</tt> if there is no element with this id
+    */
+    size_type find(const id_type &id) const
+    {
+      id_list_type::const_iterator itr = m_id.end();
+      if (m_is_sorted) {
+        itr = std::lower_bound(m_id.begin(), m_id.end(), id);
+        if ((m_id.end() != itr) && (id != *itr)) {
+          itr = m_id.end();
         }
+      } else {
+        itr = std::find(m_id.begin(), m_id.end(), id);
       }
+
+      return static_cast<size_type>(itr - m_id.begin());
     }
 
-    return result;
-  }
-  
-  /**
-    Convert a binary packed data representation from the Motion Service into a
-    std::map<integral type, container type>.
+    /**
+      Number of values in the element at <tt>index</tt>.
 
-    @pre <tt>[first, last)</tt> is a valid range
-    @pre type <tt>Key</tt> is an integral type
-    @pre type <tt>Value</tt> is a model of a Sequence (STL) 
-  */
-  template <typename Key, typename Value, typename InputIterator>
-  static std::map<Key,Value> IdToValueArray(InputIterator first,
-                                            InputIterator last,
-                                            const std::size_t &length)
-  {
-    typedef typename std::iterator_traits<
-      InputIterator
-    >::difference_type difference_type;
-    typedef unsigned packed_key_type;
+      @return zero if the index is not valid
+    */
+    size_type length(const size_type &index) const
+    {
+      if (index >= m_id.size()) {
+        return 0;
+      } else if (0 != m_length) {
+        return m_length;
+      }
 
-    std::map<Key,Value> result;
+      return unpack<unsigned>(m_data + m_offset[index] + sizeof(unsigned));
+    }
 
-    if (std::distance(first, last) > 0) {
-      // While we have enough bytes to create a complete element.
-      InputIterator itr = first;
-      while (itr != last) {
-        std::pair<Key,Value> value;
+    /**
+      View the element at <tt>index</tt>, does not copy any data.
+
+      @return <tt>false</tt> if the index is not valid, the view is empty
+    */
+    bool getView(const size_type &index, ElementView<T> &element) const
+    {
+      const char *first = getValue(index);
+      if (NULL == first) {
+        element = ElementView<T>();
+        return false;
+      }
+
+      element = ElementView<T>(first, length(index));
+      return true;
+    }
+
+    /**
+      Copy a range of channels of one element into an output array. Byte
+      swap only those values.
+
+      @param index of the element in <tt>[0, size())</tt>
+      @param base first channel to copy
+      @param length number of channels to copy
+      @param result output array of at least <tt>length</tt> values
+      @return <tt>true</tt> iff there are valid values available, output is
+      not modified otherwise
+    */
+    bool getData(const size_type &index, const size_type &base,
+                 const size_type &length, value_type *result) const
+    {
+      const char *first = getValue(index);
+      if ((NULL == first) || (base + length > this->length(index))) {
+        return false;
+      }
+
+      detail::copy_little_endian_to_native(
+        first + base * sizeof(value_type), length, result);
+      return true;
+    }
+
+   private:
+    /** Start of the message. */
+    const char *m_data;
+
+    /** Element ids in message order. */
+    id_list_type m_id;
+
+    /** Byte offset of each element header, only for variable length. */
+    std::vector<std::size_t> m_offset;
+
+    /** Number of values per element, zero for variable length. */
+    size_type m_length;
+
+    /** Bytes in front of the values of each element. */
+    std::size_t m_header_size;
+
+    bool m_is_sorted;
+
+    /** @return pointer to the first packed value, or NULL */
+    const char *getValue(const size_type &index) const
+    {
+      if (index >= m_id.size()) {
+        return NULL;
+      } else if (0 != m_length) {
+        return m_data +
+          index * (m_header_size + sizeof(T) * m_length) + m_header_size;
+      }
+
+      return m_data + m_offset[index] + m_header_size;
+    }
+
+    friend class Format;
+  }; // class ElementIndex
+
+
+  /**
+    Flat, struct-of-arrays representation of a complete message from the
+    Motion Service. Stores a sorted array of element ids and one contiguous
+    array of channel data. Each channel is contiguous across all of the
+    elements in the frame, so channel <tt>c</tt> of element <tt>i</tt> is
+    stored at <tt>data[c * size() + i]</tt>.
+
+    Decode into the same frame object over and over. Once the frame has seen
+    a message of the maximum size, decoding does not allocate any memory.
+
+    This is a base class to implement a single format specific frame. A child
+    class implements a format specific interface (API) to access the channels
+    of all elements at once. The template parameter defines the type of the
+    packed data elements.
+
+    @code
+    Format::PreviewFrame frame;
+    while (client.readData(data)) {
+      if (Format::Preview(data.begin(), data.end(), frame)) {
+        // Four contiguous arrays of frame.size() values, {w..., x..., y...,
+        // z...}, one entry per element.
+        const float *q = frame.getQuaternion(false);
+      }
+    }
+    @endcode
+  */
+  template <typename T>
+  class Frame {
+   public:
+    typedef T value_type;
+    typedef std::vector<T> data_type;
+    typedef std::vector<id_type> id_list_type;
+
+    Frame()
+      : m_id(), m_data(), m_length(0), m_order(), m_id_scratch(),
+        m_data_scratch()
+    {
+    }
+
+    /**
+      Number of elements in this frame.
+    */
+    size_type size() const
+    {
+      return m_id.size();
+    }
+
+    /**
+      Number of channels in each element of this frame.
+    */
+    size_type length() const
+    {
+      return m_length;
+    }
+
+    bool empty() const
+    {
+      return m_id.empty();
+    }
+
+    /**
+      Remove all elements. Keep the allocated memory for the next decode.
+    */
+    void clear()
+    {
+      m_id.clear();
+      m_data.clear();
+      m_length = 0;
+    }
+
+    /**
+      Set up a frame that is not decoded from a message, for example the
+      output of a filter. Keep the allocated memory. The caller fills in the
+      channel values through the returned pointer.
+
+      @pre <tt>id</tt> is sorted and has no duplicates
+      @return pointer to the channel-major array of <tt>length * id.size()</tt>
+      values or NULL if there are no elements
+    */
+    value_type *assign(const id_list_type &id, const size_type &length)
+    {
+      m_id = id;
+      m_length = length;
+      m_data.resize(length * id.size());
+
+      if (m_data.empty()) {
+        return NULL;
+      }
+
+      return &m_data[0];
+    }
+
+    /**
+      Sorted array of element ids.
+    */
+    const id_list_type &getId() const
+    {
+      return m_id;
+    }
+
+    /**
+      Look up the index of the element with the specified id.
+
+      @return index of the element in <tt>[0, size())</tt>, or
+      <tt>size()</tt> if there is no element with this id
+    */
+    size_type find(const id_type &id) const
+    {
+      typename id_list_type::const_iterator itr =
+        std::lower_bound(m_id.begin(), m_id.end(), id);
+      if ((m_id.end() != itr) && (id == *itr)) {
+        return static_cast<size_type>(itr - m_id.begin());
+      }
+
+      return size();
+    }
+
+    /**
+      Get a pointer to the contiguous array of <tt>size()</tt> values of the
+      specified channel, one entry per element.
+
+      @return pointer to the channel array or NULL if the channel index is
+      not valid
+    */
+    const value_type *getChannel(const size_type &channel) const
+    {
+      if (channel < m_length && !m_id.empty()) {
+        return &m_data[channel * m_id.size()];
+      }
+
+      return NULL;
+    }
+
+    /**
+      Get a single channel value of a single element.
+
+      @pre <tt>index < size()</tt>, <tt>channel < length()</tt>
+    */
+    const value_type &operator()(const size_type &index,
+                                 const size_type &channel) const
+    {
+      return m_data[channel * m_id.size() + index];
+    }
+
+    /**
+      Copy a contiguous range of channels of a single element into the output
+      iterator.
+
+      @param index of the element in <tt>[0, size())</tt>
+      @param base first channel to copy
+      @param length number of channels to copy
+      @return <tt>true</tt> iff there are valid values available, output is
+      not modified otherwise
+    */
+    template <typename OutputIterator>
+    bool getData(const size_type &index, const size_type &base,
+                 const size_type &length, OutputIterator result) const
+    {
+      if ((index < m_id.size()) && (base + length <= m_length)) {
+        const size_type n = m_id.size();
+        for (size_type i=0; i<length; ++i) {
+          *result++ = m_data[(base + i) * n + index];
+        }
+
+        return true;
+      }
+
+      return false;
+    }
+
+    /**
+      Direct access to the channel-major data array.
+    */
+    const data_type &access() const
+    {
+      return m_data;
+    }
+
+   protected:
+    /**
+      Get a pointer to <tt>length</tt> contiguous channel arrays starting at
+      channel <tt>base</tt>.
+
+      @return pointer to <tt>length * size()</tt> values or NULL if there
+      is no data available
+    */
+    const value_type *getRange(const size_type &base,
+                               const size_type &length) const
+    {
+      if ((base + length <= m_length) && !m_id.empty()) {
+        return &m_data[base * m_id.size()];
+      }
+
+      return NULL;
+    }
+
+    /** @see Frame#getRange */
+    template <typename Channel>
+    const value_type *getRange() const
+    {
+      return getRange(Channel::Base, Channel::Length);
+    }
+
+   private:
+    /** Sorted array of element ids. */
+    id_list_type m_id;
+
+    /** Channel-major array of element data. */
+    data_type m_data;
+
+    /** Number of channels per element. */
+    size_type m_length;
+
+    /**
+      Scratch space to sort the elements of a message that did not arrive in
+      id order. Kept around to avoid allocating it again.
+    */
+    std::vector<size_type> m_order;
+    id_list_type m_id_scratch;
+    data_type m_data_scratch;
+
+    friend class Format;
+  }; // class Frame
+
+  /**
+    Flat frame of Configurable data elements. Each element in the frame has the
+    same number of channels.
+  */
+  class ConfigurableFrame : public Frame<float> {
+   public:
+    typedef Format::Frame<float>::value_type value_type;
+    typedef Format::Frame<float>::data_type data_type;
+
+    /**
+      Get a contiguous range of channel arrays specified by start index and
+      number of channels.
+
+      @return pointer to <tt>length * size()</tt> values or NULL if there
+      is no data available
+    */
+    const value_type *getRange(const size_type &base,
+                               const size_type &length) const
+    {
+      return Frame<float>::getRange(base, length);
+    }
+  }; // class ConfigurableFrame
+
+  /**
+    Flat frame of Preview data elements.
+
+    @see PreviewElement
+  */
+  class PreviewFrame : public Frame<float> {
+   public:
+    typedef Format::Frame<float>::value_type value_type;
+    typedef Format::Frame<float>::data_type data_type;
+
+    /**
+      Get the local Euler angles of all elements.
+
+      @return pointer to three contiguous arrays of <tt>size()</tt> values
+      <tt>{x..., y..., z...}</tt> or NULL if there is no data available
+    */
+    const value_type *getEuler() const
+    {
+      return getRange<PreviewLayout::Euler>();
+    }
+
+    /**
+      Get the global or local quaternion of all elements.
+
+      @param local set local to true get the local orientation, set local
+      to false to get the global orientation
+      @return pointer to four contiguous arrays of <tt>size()</tt> values
+      <tt>{w..., x..., y..., z...}</tt> or NULL if there is no data
+      available
+    */
+    const value_type *getQuaternion(bool local) const
+    {
+      if (local) {
+        return getRange<PreviewLayout::LocalQuaternion>();
+      } else {
+        return getRange<PreviewLayout::GlobalQuaternion>();
+      }
+    }
+
+    /**
+      Get the linear acceleration of all elements.
+
+      @return pointer to three contiguous arrays of <tt>size()</tt> values
+      <tt>{x..., y..., z...}</tt> or NULL if there is no data available
+    */
+    const value_type *getAccelerate() const
+    {
+      return getRange<PreviewLayout::Accelerate>();
+    }
+
+    /**
+      Compute the global or local rotation matrix of all elements.
+
+      @param local set local to true get the local orientation, set local
+      to false to get the global orientation
+      @param result pointer to an array of at least <tt>16 * size()</tt>
+      values, filled with one row major 4-by-4 matrix per element
+      @return true if the result array was filled
+    */
+    bool getMatrix(bool local, value_type *result) const
+    {
+      const value_type *q = getQuaternion(local);
+      if ((NULL == q) || (NULL == result)) {
+        return false;
+      }
+
+      const size_type n = size();
+      detail::quaternion_to_matrix(q, q + n, q + 2 * n, q + 3 * n, n, result);
+
+      return true;
+    }
+
+    /**
+      Compute the global or local Euler angles of all elements from the
+      quaternion channels, <tt>R = Rz * Ry * Rx</tt>.
+
+      @param local set local to true get the local orientation, set local
+      to false to get the global orientation
+      @param result pointer to an array of at least <tt>3 * size()</tt>
+      values, filled with three contiguous arrays <tt>{x..., y..., z...}</tt>
+      in radians
+      @return true if the result array was filled
+    */
+    bool getEuler(bool local, value_type *result) const
+    {
+      const value_type *q = getQuaternion(local);
+      if ((NULL == q) || (NULL == result)) {
+        return false;
+      }
+
+      const size_type n = size();
+      detail::quaternion_to_euler(q, q + n, q + 2 * n, q + 3 * n, n, result);
+
+      return true;
+    }
+  }; // class PreviewFrame
+
+  /**
+    Flat frame of Sensor data elements.
+
+    @see SensorElement
+  */
+  class SensorFrame : public Frame<float> {
+   public:
+    typedef Format::Frame<float>::value_type value_type;
+    typedef Format::Frame<float>::data_type data_type;
+
+    /**
+      @return pointer to three contiguous arrays of <tt>size()</tt> values
+      <tt>{x..., y..., z...}</tt> or NULL if there is no data available
+    */
+    const value_type *getAccelerometer() const
+    {
+      return getRange<SensorLayout::Accelerometer>();
+    }
+
+    /** @see SensorFrame#getAccelerometer */
+    const value_type *getGyroscope() const
+    {
+      return getRange<SensorLayout::Gyroscope>();
+    }
+
+    /** @see SensorFrame#getAccelerometer */
+    const value_type *getMagnetometer() const
+    {
+      return getRange<SensorLayout::Magnetometer>();
+    }
+  }; // class SensorFrame
+
+  /**
+    Flat frame of Raw data elements.
+
+    @see RawElement
+  */
+  class RawFrame : public Frame<short> {
+   public:
+    typedef Format::Frame<short>::value_type value_type;
+    typedef Format::Frame<short>::data_type data_type;
+
+    /**
+      @return pointer to three contiguous arrays of <tt>size()</tt> values
+      <tt>{x..., y..., z...}</tt> or NULL if there is no data available
+    */
+    const value_type *getAccelerometer() const
+    {
+      return getRange<RawLayout::Accelerometer>();
+    }
+
+    /** @see RawFrame#getAccelerometer */
+    const value_type *getGyroscope() const
+    {
+      return getRange<RawLayout::Gyroscope>();
+    }
+
+    /** @see RawFrame#getAccelerometer */
+    const value_type *getMagnetometer() const
+    {
+      return getRange<RawLayout::Magnetometer>();
+    }
+  }; // class RawFrame
+
+
+  /**
+    Single element of a fixed length format, decoded into native byte order
+    and stored in place. The number of values is a compile time constant of
+    the layout, and the channel accessors compute their offsets at compile
+    time. Accessing a channel value is a single load.
+
+    @code
+    typedef Format::SensorLayout layout_type;
+
+    Format::FixedElement<layout_type> element;
+    const float gx = element.get<layout_type::Gyroscope, 0>();
+    @endcode
+
+    @see Format#Decode
+  */
+  template <typename Layout>
+  class FixedElement {
+   public:
+    typedef Layout layout_type;
+    typedef typename Layout::value_type value_type;
+    typedef detail::array<value_type, Layout::Length> data_type;
+
+    FixedElement()
+      : id(), data()
+    {
+    }
+
+    /**
+      Get a pointer to the <tt>Channel::Length</tt> values of a channel.
+      Fails to compile if the channel is not part of this layout.
+    */
+    template <typename Channel>
+    const value_type *get() const
+    {
+      static_cast<void>(
+        detail::channel_in_range<Channel, Layout::Length>::value);
+      return data.data() + Channel::Base;
+    }
+
+    /**
+      Get a single value of a channel. Fails to compile if the index is not
+      part of the channel, or the channel is not part of this layout.
+    */
+    template <typename Channel, std::size_t Index>
+    value_type get() const
+    {
+      typedef detail::channel<Channel::Base + Index, 1> value_channel;
+      static_cast<void>(
+        detail::channel_in_range<value_channel, Channel::End>::value);
+      static_cast<void>(
+        detail::channel_in_range<value_channel, Layout::Length>::value);
+      return data[Channel::Base + Index];
+    }
+
+    /**
+      Copy all of the values of a channel into a fixed size array.
+    */
+    template <typename Channel>
+    void get(detail::array<value_type, Channel::Length> &result) const
+    {
+      const value_type *first = get<Channel>();
+      std::copy(first, first + Channel::Length, result.begin());
+    }
+
+    /** Element id from the message. */
+    id_type id;
+
+    /** Packed channel values in native byte order. */
+    data_type data;
+  }; // class FixedElement
+
+
+  /**
+    Define the associative container type for PreviewElement
+    entries.
+  */
+  typedef std::map<
+    id_type,
+    ConfigurableElement
+  > configurable_service_type;
+
+  /**
+    Convert a range of binary data into an associative
+    container (std::map) of ConfigurableElement entries.
+
+    @pre     <tt>[first, last)</tt> is a valid range
+    @return  an associative container ConfigurableElement entries
+  */
+  template <typename InputIterator>
+  static inline configurable_service_type Configurable(InputIterator first,
+                                                       InputIterator last)
+  {
+    return Apply<ConfigurableElement>(first, last);
+  }
+
+  /**
+    Define the associative container type for PreviewElement
+    entries.
+  */
+  typedef std::map<
+    id_type,
+    PreviewElement
+  > preview_service_type;
+
+  /**
+    Convert a range of binary data into an associative
+    container (std::map) of PreviewElement entries.
+
+    @pre     <tt>[first, last)</tt> is a valid range
+    @return  an associative container PreviewElement entries
+  */
+  template <typename InputIterator>
+  static inline preview_service_type Preview(InputIterator first,
+                                             InputIterator last)
+  {
+    return Apply<PreviewElement>(first, last);
+  }
+
+  /**
+    Define the associative container type for SensorElement
+    entries.
+  */
+  typedef std::map<
+    id_type,
+    SensorElement
+  > sensor_service_type;
+
+  /**
+    Convert a range of binary data into an associative
+    container (std::map) of SensorElement entries.
+
+    @pre     <tt>[first, last)</tt> is a valid range
+    @return  an associative container SensorElement entries
+  */
+  template <typename InputIterator>
+  static inline sensor_service_type Sensor(InputIterator first,
+                                           InputIterator last)
+  {
+    return Apply<SensorElement>(first, last);
+  }
+
+  /**
+    Define the associative container type for RawElement
+    entries.
+  */
+  typedef std::map<
+    id_type,
+    RawElement
+  > raw_service_type;
+
+  /**
+    Convert a range of binary data into an associative
+    container (std::map) of RawElement entries.
+
+    @pre     <tt>[first, last)</tt> is a valid range
+    @return  an associative container RawElement entries
+  */
+  template <typename InputIterator>
+  static inline raw_service_type Raw(InputIterator first,
+                                     InputIterator last)
+  {
+    return Apply<RawElement>(first, last);
+  }
+
+  /**
+    Convert a range of binary data into an existing associative container of
+    ConfigurableElement entries. Reuse the map nodes and element buffers that
+    are already in the container. If the message has the same elements as the
+    previous one, which is the normal case for a live stream, this does not
+    allocate any memory.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @post    <tt>result</tt> has the same entries as the container that
+             Format#Configurable(first, last) returns
+    @return  <tt>true</tt> iff the container is not empty
+  */
+  template <typename InputIterator>
+  static inline bool Configurable(InputIterator first, InputIterator last,
+                                  configurable_service_type &result)
+  {
+    return ApplyInto(first, last, result);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline bool Preview(InputIterator first, InputIterator last,
+                             preview_service_type &result)
+  {
+    return ApplyInto(first, last, result);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline bool Sensor(InputIterator first, InputIterator last,
+                            sensor_service_type &result)
+  {
+    return ApplyInto(first, last, result);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline bool Raw(InputIterator first, InputIterator last,
+                         raw_service_type &result)
+  {
+    return ApplyInto(first, last, result);
+  }
+
+  /**
+    Decode a range of binary data into a flat ConfigurableFrame. Each element
+    in the message must have the same number of channels.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  <tt>true</tt> iff the message is valid, otherwise the frame is
+             empty
+  */
+  template <typename InputIterator>
+  static inline bool Configurable(InputIterator first, InputIterator last,
+                                  ConfigurableFrame &frame)
+  {
+    return ApplyFrame(first, last, ConfigurableElement::Length, frame);
+  }
+
+  /**
+    Decode a range of binary data into a flat ConfigurableFrame where the
+    number of channels per element is known in advance, for example from a
+    @ref ConfigurableSchema. Every element has the same stride so only the
+    length in the first element header is checked.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  <tt>true</tt> iff the message is valid and has <tt>length</tt>
+             channels per element, otherwise the frame is empty
+  */
+  template <typename InputIterator>
+  static inline bool Configurable(InputIterator first, InputIterator last,
+                                  const std::size_t &length,
+                                  ConfigurableFrame &frame)
+  {
+    if (0 == length) {
+      frame.clear();
+      return false;
+    }
+
+    return ApplyFrame(
+      first, last, ConfigurableElement::Length, frame, length);
+  }
+
+  /**
+    Decode a range of binary data into a flat PreviewFrame.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  <tt>true</tt> iff the message is valid, otherwise the frame is
+             empty
+  */
+  template <typename InputIterator>
+  static inline bool Preview(InputIterator first, InputIterator last,
+                             PreviewFrame &frame)
+  {
+    return ApplyFrame(first, last, PreviewElement::Length, frame);
+  }
+
+  /**
+    Decode a range of binary data into a flat SensorFrame.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  <tt>true</tt> iff the message is valid, otherwise the frame is
+             empty
+  */
+  template <typename InputIterator>
+  static inline bool Sensor(InputIterator first, InputIterator last,
+                            SensorFrame &frame)
+  {
+    return ApplyFrame(first, last, SensorElement::Length, frame);
+  }
+
+  /**
+    Decode a range of binary data into a flat RawFrame.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  <tt>true</tt> iff the message is valid, otherwise the frame is
+             empty
+  */
+  template <typename InputIterator>
+  static inline bool Raw(InputIterator first, InputIterator last,
+                         RawFrame &frame)
+  {
+    return ApplyFrame(first, last, RawElement::Length, frame);
+  }
+
+  /**
+    Decode a range of binary data from a fixed length service into a list of
+    elements in message order. The element size is a compile time constant
+    of the layout, so the copy of each element is fully inlined. Clear the
+    list, but reuse the memory that it already holds.
+
+    @code
+    std::vector<Format::FixedElement<Format::PreviewLayout> > list;
+    while (client.readData(data)) {
+      if (Format::Decode(data.begin(), data.end(), list)) {
+        // ...
+      }
+    }
+    @endcode
+
+    The list may use any allocator, for example detail::arena_allocator.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  <tt>true</tt> iff the message is valid, otherwise the list is
+             empty
+  */
+  template <typename Layout, typename Allocator, typename InputIterator>
+  static bool Decode(InputIterator first, InputIterator last,
+                     std::vector<FixedElement<Layout>, Allocator> &result)
+  {
+    typedef unsigned packed_key_type;
+    typedef typename Layout::value_type value_type;
+
+    const std::size_t ElementSize =
+      sizeof(packed_key_type) + sizeof(value_type) * Layout::Length;
+
+    result.clear();
+
+    const std::size_t bytes =
+      static_cast<std::size_t>(std::distance(first, last));
+    if ((0 == bytes) || (0 != (bytes % ElementSize))) {
+      return false;
+    }
+
+    const char *data = &(*first);
+
+    const std::size_t n = bytes / ElementSize;
+    result.resize(n);
+
+    for (std::size_t i=0; i<n; ++i) {
+      const char *itr = data + i * ElementSize;
+
+      result[i].id = static_cast<id_type>(unpack<packed_key_type>(itr));
+      detail::copy_little_endian_to_native(
+        itr + sizeof(packed_key_type), Layout::Length, result[i].data.data());
+    }
+
+    return true;
+  }
+
+  /**
+    Decode a range of binary data from a fixed length service into a map of
+    elements by id. The elements store their values in place, so with a
+    pooled allocator like detail::arena_allocator the only allocations are
+    the map nodes and a steady state read loop does not use the global heap.
+
+    @code
+    typedef Format::FixedElement<Format::PreviewLayout> element_type;
+    typedef std::map<
+      Format::id_type, element_type, std::less<Format::id_type>,
+      detail::arena_allocator<std::pair<const Format::id_type, element_type> >
+    > map_type;
+
+    detail::arena memory;
+    const map_type::allocator_type allocator(&memory);
+    map_type map(map_type::key_compare(), allocator);
+    while (client.readData(data)) {
+      if (Format::Decode(data.begin(), data.end(), map)) {
+        // ...
+      }
+    }
+    @endcode
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  <tt>true</tt> iff the message is valid and has no duplicate ids,
+             otherwise the map is empty
+  */
+  template <typename Layout, typename Compare, typename Allocator,
+            typename InputIterator>
+  static bool Decode(
+    InputIterator first, InputIterator last,
+    std::map<id_type, FixedElement<Layout>, Compare, Allocator> &result)
+  {
+    typedef unsigned packed_key_type;
+    typedef typename Layout::value_type value_type;
+    typedef std::map<id_type, FixedElement<Layout>, Compare, Allocator>
+      map_type;
+
+    const std::size_t ElementSize =
+      sizeof(packed_key_type) + sizeof(value_type) * Layout::Length;
+
+    result.clear();
+
+    const std::size_t bytes =
+      static_cast<std::size_t>(std::distance(first, last));
+    if ((0 == bytes) || (0 != (bytes % ElementSize))) {
+      return false;
+    }
+
+    const char *data = &(*first);
+
+    const std::size_t n = bytes / ElementSize;
+    for (std::size_t i=0; i<n; ++i) {
+      const char *itr = data + i * ElementSize;
+
+      const id_type id = static_cast<id_type>(unpack<packed_key_type>(itr));
+
+      // Messages are usually in id order, so the end is the right hint.
+      typename map_type::iterator element = result.insert(
+        result.end(), typename map_type::value_type(id, FixedElement<Layout>()));
+      element->second.id = id;
+      detail::copy_little_endian_to_native(
+        itr + sizeof(packed_key_type), Layout::Length,
+        element->second.data.data());
+    }
+
+    if (result.size() != n) {
+      result.clear();
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+    Find a single element in a range of binary data by id. Does not copy any
+    data or allocate any memory.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range that outlives
+             the element view
+    @return  <tt>true</tt> iff the message contains an element with this id,
+             otherwise the element view is empty
+  */
+  template <typename InputIterator>
+  static inline bool Configurable(InputIterator first, InputIterator last,
+                                  const id_type &id,
+                                  ConfigurableElementView &element)
+  {
+    return ApplyView(first, last, id, ConfigurableElement::Length, element);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline bool Preview(InputIterator first, InputIterator last,
+                             const id_type &id, PreviewElementView &element)
+  {
+    return ApplyView(first, last, id, PreviewElement::Length, element);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline bool Sensor(InputIterator first, InputIterator last,
+                            const id_type &id, SensorElementView &element)
+  {
+    return ApplyView(first, last, id, SensorElement::Length, element);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline bool Raw(InputIterator first, InputIterator last,
+                         const id_type &id, RawElementView &element)
+  {
+    return ApplyView(first, last, id, RawElement::Length, element);
+  }
+
+  /**
+    Index the elements of a range of binary data. Validate the whole message
+    but do not decode any of it. Use the index to look up any number of
+    elements by id.
+
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range that outlives
+             the index
+    @return  <tt>true</tt> iff the message is valid, otherwise the index is
+             empty
+  */
+  template <typename InputIterator>
+  static inline bool Configurable(InputIterator first, InputIterator last,
+                                  ElementIndex<float> &index)
+  {
+    return ApplyIndex(first, last, ConfigurableElement::Length, index);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline bool Preview(InputIterator first, InputIterator last,
+                             ElementIndex<float> &index)
+  {
+    return ApplyIndex(first, last, PreviewElement::Length, index);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline bool Sensor(InputIterator first, InputIterator last,
+                            ElementIndex<float> &index)
+  {
+    return ApplyIndex(first, last, SensorElement::Length, index);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline bool Raw(InputIterator first, InputIterator last,
+                         ElementIndex<short> &index)
+  {
+    return ApplyIndex(first, last, RawElement::Length, index);
+  }
+
+  /**
+    Convert a range of binary data into an associative container of only the
+    elements with an id in the list. The other elements are validated but
+    not decoded.
+
+    @param   id sorted list of element ids
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  an associative container of the selected entries, empty if the
+             message is not valid
+  */
+  template <typename InputIterator>
+  static inline configurable_service_type Configurable(InputIterator first,
+                                                       InputIterator last,
+                                                       const id_list_type &id)
+  {
+    return ApplySelect<ConfigurableElement>(first, last, id);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline preview_service_type Preview(InputIterator first,
+                                             InputIterator last,
+                                             const id_list_type &id)
+  {
+    return ApplySelect<PreviewElement>(first, last, id);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline sensor_service_type Sensor(InputIterator first,
+                                           InputIterator last,
+                                           const id_list_type &id)
+  {
+    return ApplySelect<SensorElement>(first, last, id);
+  }
+
+  /** @see Format#Configurable */
+  template <typename InputIterator>
+  static inline raw_service_type Raw(InputIterator first, InputIterator last,
+                                     const id_list_type &id)
+  {
+    return ApplySelect<RawElement>(first, last, id);
+  }
+
+ private:
+  /**
+    Convert a binary packed data representation from the Motion Service into a
+    std::map<Format::id_type, Format::*Element>. Use the IdToValueArray method
+    to handle the low level message parsing.
+  */
+  template <typename T, typename InputIterator>
+  static std::map<id_type,T> Apply(InputIterator first,
+                                   InputIterator last)
+  {
+    std::map<id_type,T> result;
+
+    {
+      // Use this to do most of the dirty work.
+      std::map<id_type,typename T::data_type> map =
+        IdToValueArray<id_type,typename T::data_type>(first, last, T::Length);
+      if (!map.empty()) {
+        // Copy each [id] => vector<float> entry into the [id] => PreviewMap
+        // result map. Use the range insert operator since we can statically
+        // cast a vector<float> object directly into a PreviewElement. 
+        result.insert(map.begin(), map.end());
+
+        // Make sure that we were able to insert all of the elements.
+        if (map.size() != result.size()) {
+          result.clear();
+        }
+      }
+    }
+
+    return result;
+  }
+  
+  /**
+    Same result as Apply, but decode into the existing nodes of the output
+    map. Walk the message and the map together. The service sends elements in
+    ascending id order, so each element is either the next node, a new node,
+    or follows nodes that are no longer in the stream. Anything else, or an
+    invalid message, takes the slow path through Apply.
+  */
+  template <typename T, typename InputIterator>
+  static bool ApplyInto(InputIterator first, InputIterator last,
+                        std::map<id_type,T> &result)
+  {
+    typedef unsigned packed_key_type;
+    typedef typename T::value_type value_type;
+    typedef typename std::map<id_type,T>::iterator iterator;
+
+    const std::size_t bytes =
+      static_cast<std::size_t>(std::distance(first, last));
+    if (0 == bytes) {
+      result.clear();
+      return false;
+    }
+
+    const char *data = &(*first);
+
+    std::size_t header_size = sizeof(packed_key_type);
+    if (0 == T::Length) {
+      header_size += sizeof(packed_key_type);
+    }
+
+    iterator itr = result.begin();
+    bool valid = true;
+    id_type previous = 0;
+
+    std::size_t offset = 0;
+    while (offset < bytes) {
+      const char *element = data + offset;
+      if (header_size > bytes - offset) {
+        valid = false;
+        break;
+      }
+
+      std::size_t element_length = T::Length;
+      if (0 == element_length) {
+        element_length =
+          unpack<packed_key_type>(element + sizeof(packed_key_type));
+      }
+
+      const std::size_t element_size =
+        header_size + sizeof(value_type) * element_length;
+      const id_type key = static_cast<id_type>(unpack<packed_key_type>(element));
+      if ((0 == element_length) || (element_size > bytes - offset) ||
+          ((offset > 0) && (key <= previous))) {
+        valid = false;
+        break;
+      }
+
+      // Drop the nodes of elements that are no longer in the stream.
+      while ((result.end() != itr) && (itr->first < key)) {
+        result.erase(itr++);
+      }
+
+      if ((result.end() == itr) || (key != itr->first)) {
+        itr = result.insert(
+          itr, std::make_pair(key, T(typename T::data_type(element_length))));
+      }
+
+      typename T::data_type &value = static_cast<Element<value_type> &>(
+        itr->second).m_data;
+      value.resize(element_length);
+      detail::copy_little_endian_to_native(
+        element + header_size, element_length, &value[0]);
+      ++itr;
+
+      previous = key;
+      offset += element_size;
+    }
+
+    if (valid) {
+      result.erase(itr, result.end());
+    } else {
+      result = Apply<T>(first, last);
+    }
+
+    return !result.empty();
+  }
+
+  /**
+    Convert a binary packed data representation from the Motion Service into a
+    std::map<integral type, container type>.
+
+    @pre <tt>[first, last)</tt> is a valid range
+    @pre type <tt>Key</tt> is an integral type
+    @pre type <tt>Value</tt> is a model of a Sequence (STL) 
+  */
+  template <typename Key, typename Value, typename InputIterator>
+  static std::map<Key,Value> IdToValueArray(InputIterator first,
+                                            InputIterator last,
+                                            const std::size_t &length)
+  {
+    typedef typename std::iterator_traits<
+      InputIterator
+    >::difference_type difference_type;
+    typedef unsigned packed_key_type;
+
+    std::map<Key,Value> result;
+
+    if (std::distance(first, last) > 0) {
+      // While we have enough bytes to create a complete element.
+      InputIterator itr = first;
+      while (itr != last) {
+        std::pair<Key,Value> value;
 
         // Read the integer id for this element. Unpack the unsigned 32-bit
         // integer into our host system key type.
@@ -620,23 +2083,19 @@ public:
         if ((element_length > 0) &&
             (bytes_in_array <= std::distance(itr, last))) {
 
-          // Read the array of values for this element.
+          // Read the array of values for this element. Big-endian systems
+          // need to implement byte swapping here. All service data is
+          // little-endian.
           value.second.resize(element_length);
-          for (typename Value::iterator value_itr=value.second.begin();
-               value_itr!=value.second.end(); ++value_itr) {
-            *value_itr =
-              *reinterpret_cast<const typename Value::value_type *>(&(*itr));
-            std::advance(itr, sizeof(typename Value::value_type));
-          }
+          detail::copy_little_endian_to_native(
+            &(*itr), element_length, &value.second[0]);
+          std::advance(itr, bytes_in_array);
 
-          // Big-endian systems need to implement byte swapping here. All
-          // service data is little-endian.
-          std::transform(
-            value.second.begin(), value.second.end(),
-            value.second.begin(),
-            &detail::little_endian_to_native<typename Value::value_type>);
-
-          result.insert(value);
+          if (!result.insert(value).second) {
+            // Duplicate id. Invalid message.
+            result.clear();
+            break;
+          }
         }
       }
 
@@ -650,6 +2109,412 @@ public:
     return result;
   }
 
+  /**
+    Convert a binary packed data representation from the Motion Service into a
+    flat Format::Frame in a single pass. All elements must have the same
+    number of channels. Reuse the memory that the frame already holds.
+
+    If the elements store their own length, pass a non-zero
+    <tt>fixed_length</tt> to skip the length check of every element after the
+    first one.
+
+    @pre <tt>[first, last)</tt> is a valid, contiguous range
+  */
+  template <typename T, typename InputIterator>
+  static bool ApplyFrame(InputIterator first, InputIterator last,
+                         const std::size_t &length, Frame<T> &frame,
+                         const std::size_t &fixed_length=0)
+  {
+    typedef unsigned packed_key_type;
+
+    frame.clear();
+
+    const std::size_t bytes =
+      static_cast<std::size_t>(std::distance(first, last));
+    if (0 == bytes) {
+      return false;
+    }
+
+    const char *data = &(*first);
+
+    // Size of the header in front of the array of values of each element.
+    // Configurable elements store their own length.
+    std::size_t header_size = sizeof(packed_key_type);
+    std::size_t element_length = length;
+    if (0 == element_length) {
+      header_size += sizeof(packed_key_type);
+      if (bytes < header_size) {
+        return false;
+      }
+
+      element_length = unpack<packed_key_type>(data + sizeof(packed_key_type));
+      if ((0 != fixed_length) && (fixed_length != element_length)) {
+        return false;
+      }
+    }
+
+    const std::size_t element_size = header_size + sizeof(T) * element_length;
+    if ((0 == element_length) || (0 != (bytes % element_size))) {
+      return false;
+    }
+
+    const std::size_t n = bytes / element_size;
+    frame.m_id.resize(n);
+    frame.m_data.resize(n * element_length);
+
+    bool is_sorted = true;
+    for (std::size_t i=0; i<n; ++i) {
+      const char *itr = data + i * element_size;
+
+      frame.m_id[i] = static_cast<id_type>(unpack<packed_key_type>(itr));
+      if ((i > 0) && !(frame.m_id[i - 1] < frame.m_id[i])) {
+        is_sorted = false;
+      }
+
+      if ((0 == length) && (0 == fixed_length) &&
+          (element_length !=
+           unpack<packed_key_type>(itr + sizeof(packed_key_type)))) {
+        // Variable length elements. Invalid message.
+        frame.clear();
+        return false;
+      }
+
+      itr += header_size;
+      for (std::size_t j=0; j<element_length; ++j) {
+        frame.m_data[j * n + i] = unpack<T>(itr);
+        itr += sizeof(T);
+      }
+    }
+
+    frame.m_length = element_length;
+
+    if (!is_sorted && !SortFrame(frame)) {
+      frame.clear();
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+    Scan a binary packed data representation from the Motion Service for the
+    element with the given id. Stop at the first match, only the elements in
+    front of it are validated.
+
+    @pre <tt>[first, last)</tt> is a valid, contiguous range
+  */
+  template <typename T, typename InputIterator>
+  static bool ApplyView(InputIterator first, InputIterator last,
+                        const id_type &id, const std::size_t &length,
+                        ElementView<T> &element)
+  {
+    typedef unsigned packed_key_type;
+
+    element = ElementView<T>();
+
+    const std::size_t bytes =
+      static_cast<std::size_t>(std::distance(first, last));
+    if (0 == bytes) {
+      return false;
+    }
+
+    const char *data = &(*first);
+
+    std::size_t header_size = sizeof(packed_key_type);
+    if (0 == length) {
+      header_size += sizeof(packed_key_type);
+    }
+
+    std::size_t offset = 0;
+    while ((offset < bytes) && (header_size <= bytes - offset)) {
+      const char *itr = data + offset;
+
+      std::size_t element_length = length;
+      if (0 == element_length) {
+        element_length = unpack<packed_key_type>(itr + sizeof(packed_key_type));
+      }
+
+      const std::size_t element_size =
+        header_size + sizeof(T) * element_length;
+      if ((0 == element_length) || (element_size > bytes - offset)) {
+        // Not enough bytes remaining. Invalid message.
+        break;
+      }
+
+      if (id == static_cast<id_type>(unpack<packed_key_type>(itr))) {
+        element = ElementView<T>(itr + header_size, element_length);
+        return true;
+      }
+
+      offset += element_size;
+    }
+
+    return false;
+  }
+
+  /**
+    Index a binary packed data representation from the Motion Service. One
+    walk over the element headers. Fixed length elements are a single size
+    check and a strided read of the ids.
+
+    @pre <tt>[first, last)</tt> is a valid, contiguous range
+  */
+  template <typename T, typename InputIterator>
+  static bool ApplyIndex(InputIterator first, InputIterator last,
+                         const std::size_t &length, ElementIndex<T> &index)
+  {
+    typedef unsigned packed_key_type;
+
+    index.clear();
+
+    const std::size_t bytes =
+      static_cast<std::size_t>(std::distance(first, last));
+    if (0 == bytes) {
+      return false;
+    }
+
+    const char *data = &(*first);
+
+    std::size_t header_size = sizeof(packed_key_type);
+    if (0 == length) {
+      header_size += sizeof(packed_key_type);
+    }
+
+    if (0 != length) {
+      const std::size_t element_size = header_size + sizeof(T) * length;
+      if (0 != (bytes % element_size)) {
+        return false;
+      }
+
+      const std::size_t n = bytes / element_size;
+      index.m_id.resize(n);
+      for (std::size_t i=0; i<n; ++i) {
+        index.m_id[i] =
+          static_cast<id_type>(unpack<packed_key_type>(data + i * element_size));
+      }
+    } else {
+      std::size_t offset = 0;
+      while (offset < bytes) {
+        if (header_size > bytes - offset) {
+          index.clear();
+          return false;
+        }
+
+        const char *itr = data + offset;
+
+        const std::size_t element_length =
+          unpack<packed_key_type>(itr + sizeof(packed_key_type));
+        const std::size_t element_size =
+          header_size + sizeof(T) * element_length;
+        if ((0 == element_length) || (element_size > bytes - offset)) {
+          // Not enough bytes remaining. Invalid message.
+          index.clear();
+          return false;
+        }
+
+        index.m_id.push_back(
+          static_cast<id_type>(unpack<packed_key_type>(itr)));
+        index.m_offset.push_back(offset);
+
+        offset += element_size;
+      }
+    }
+
+    for (std::size_t i=1; i<index.m_id.size(); ++i) {
+      if (!(index.m_id[i - 1] < index.m_id[i])) {
+        index.m_is_sorted = false;
+        break;
+      }
+    }
+
+    index.m_data = data;
+    index.m_length = length;
+    index.m_header_size = header_size;
+
+    return true;
+  }
+
+  /**
+    Convert only the selected elements of a binary packed data
+    representation from the Motion Service into a
+    std::map<Format::id_type, Format::*Element>. Walk all of the element
+    headers to validate the message, skip the values of the others.
+
+    @pre <tt>[first, last)</tt> is a valid, contiguous range
+    @pre <tt>id</tt> is sorted
+  */
+  template <typename T, typename InputIterator>
+  static std::map<id_type,T> ApplySelect(InputIterator first,
+                                         InputIterator last,
+                                         const id_list_type &id)
+  {
+    typedef unsigned packed_key_type;
+    typedef typename T::value_type value_type;
+
+    std::map<id_type,T> result;
+
+    const std::size_t bytes =
+      static_cast<std::size_t>(std::distance(first, last));
+    if ((0 == bytes) || id.empty()) {
+      return result;
+    }
+
+    const char *data = &(*first);
+
+    std::size_t header_size = sizeof(packed_key_type);
+    if (0 == T::Length) {
+      header_size += sizeof(packed_key_type);
+    }
+
+    typename T::data_type value;
+
+    // Check every id in the message, not only the selected ones, so that
+    // this rejects the same duplicates as Apply. The ids are usually strictly
+    // increasing and then the previous id is all we need.
+    id_type previous = 0;
+    bool increasing = true;
+
+    std::size_t offset = 0;
+    while (offset < bytes) {
+      if (header_size > bytes - offset) {
+        result.clear();
+        break;
+      }
+
+      const char *itr = data + offset;
+
+      std::size_t element_length = T::Length;
+      if (0 == element_length) {
+        element_length = unpack<packed_key_type>(itr + sizeof(packed_key_type));
+      }
+
+      const std::size_t element_size =
+        header_size + sizeof(value_type) * element_length;
+      if ((0 == element_length) || (element_size > bytes - offset)) {
+        // Not enough bytes remaining. Invalid message.
+        result.clear();
+        break;
+      }
+
+      const id_type key = static_cast<id_type>(unpack<packed_key_type>(itr));
+      if ((0 != offset) && !(previous < key)) {
+        increasing = false;
+      }
+      previous = key;
+
+      if (std::binary_search(id.begin(), id.end(), key)) {
+        value.resize(element_length);
+        detail::copy_little_endian_to_native(
+          itr + header_size, element_length, &value[0]);
+
+        if (!result.insert(std::make_pair(key, T(value))).second) {
+          // Duplicate id. Invalid message.
+          result.clear();
+          break;
+        }
+      }
+
+      offset += element_size;
+    }
+
+    if (!increasing && !result.empty()) {
+      // Out of order. The message is valid, walk the element headers again
+      // and look for a duplicate in all of the ids.
+      id_list_type seen;
+      for (offset=0; offset<bytes;) {
+        const char *itr = data + offset;
+
+        std::size_t element_length = T::Length;
+        if (0 == element_length) {
+          element_length =
+            unpack<packed_key_type>(itr + sizeof(packed_key_type));
+        }
+
+        seen.push_back(static_cast<id_type>(unpack<packed_key_type>(itr)));
+        offset += header_size + sizeof(value_type) * element_length;
+      }
+
+      std::sort(seen.begin(), seen.end());
+      if (seen.end() != std::adjacent_find(seen.begin(), seen.end())) {
+        // Duplicate id. Invalid message.
+        result.clear();
+      }
+    }
+
+    return result;
+  }
+
+  /**
+    Sort the elements of a frame by id.
+
+    @return <tt>false</tt> if there are duplicate ids, this is an invalid
+    message
+  */
+  template <typename T>
+  static bool SortFrame(Frame<T> &frame)
+  {
+    const std::size_t n = frame.m_id.size();
+
+    frame.m_order.resize(n);
+    for (std::size_t i=0; i<n; ++i) {
+      frame.m_order[i] = i;
+    }
+
+    std::sort(
+      frame.m_order.begin(), frame.m_order.end(),
+      IndexLess(frame.m_id));
+
+    frame.m_id_scratch.resize(n);
+    for (std::size_t i=0; i<n; ++i) {
+      frame.m_id_scratch[i] = frame.m_id[frame.m_order[i]];
+      if ((i > 0) && (frame.m_id_scratch[i - 1] == frame.m_id_scratch[i])) {
+        return false;
+      }
+    }
+    frame.m_id.swap(frame.m_id_scratch);
+
+    frame.m_data_scratch.resize(frame.m_data.size());
+    for (std::size_t j=0; j<frame.m_length; ++j) {
+      for (std::size_t i=0; i<n; ++i) {
+        frame.m_data_scratch[j * n + i] = frame.m_data[j * n + frame.m_order[i]];
+      }
+    }
+    frame.m_data.swap(frame.m_data_scratch);
+
+    return true;
+  }
+
+  /**
+    Compare two indices by the id they refer to.
+  */
+  class IndexLess {
+   public:
+    explicit IndexLess(const std::vector<id_type> &id)
+      : m_id(id)
+    {
+    }
+
+    bool operator()(const std::size_t &lhs, const std::size_t &rhs) const
+    {
+      return m_id[lhs] < m_id[rhs];
+    }
+
+   private:
+    const std::vector<id_type> &m_id;
+  }; // class IndexLess
+
+  /**
+    Read a single little-endian value of type <tt>T</tt> from a packed, and
+    possibly unaligned, array of bytes.
+  */
+  template <typename T>
+  static inline T unpack(const char *data)
+  {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return detail::little_endian_to_native(value);
+  }
+
   /**
     Hide the constructor. There is no need to instantiate the Format object.
   */
@@ -31,8 +31,11 @@
 #ifndef __MOTION_SDK_LUA_CONSOLE_HPP_
 #define __MOTION_SDK_LUA_CONSOLE_HPP_
 
+#include <algorithm>
+#include <cstddef>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <detail/exception.hpp>
 
@@ -115,28 +118,355 @@ class LuaConsole {
     typename Client::data_type data(chunk.begin(), chunk.end());
 
     if (client.writeData(data, time_out_second) &&
-        client.readData(data, time_out_second) &&
-        !data.empty()) {
-      // First character is the response code.
-      char code = data[0];
-      if ((code >= Success) && (code <= Continue)) {
-        result.first = static_cast<ResultCode>(code);
-        // The rest of the message is any printed output from the
-        // Lua environment.
-        if (data.size() > 1) {
-          result.second.assign(data.begin() + 1, data.end());
+        client.readData(data, time_out_second)) {
+      ParseResult(data, result);
+    }
+
+    return result;
+  }
+
+  /**
+    Send many Lua chunks to the Console service without waiting for the result
+    of each one before sending the next. The service runs the chunks in order
+    and sends one result per chunk, in the same order. Keep up to
+    <tt>window</tt> chunks in flight so that the total cost is close to one
+    round trip instead of one per chunk. Chunks that fit in the window are
+    written together with Client#writeBatch.
+
+    Incomplete chunks behave exactly like they do with #SendChunk, the service
+    keeps the text and waits for the rest of it in the next chunk.
+
+    Example usage:
+    @code
+    LuaConsole::Pipeline<Client> pipeline(client);
+    for (std::size_t i=0; i<node_list.size(); ++i) {
+      pipeline.push("node.select('" + node_list[i] + "')");
+      pipeline.push("node.configure({gain = 2})");
+    }
+
+    std::vector<LuaConsole::result_type> result;
+    if (pipeline.flush(result) < pipeline.size()) {
+      // Lost the connection or timed out, the tail of the list has no
+      // results.
+    }
+    @endcode
+  */
+  template <typename Client>
+  class Pipeline {
+   public:
+    typedef std::vector<std::string> chunk_list_type;
+
+    /**
+      @param  client open connection to the Console service, must stay valid
+              for the lifetime of this object
+      @param  window maximum number of chunks sent ahead of the results, the
+              results queue up on the socket so keep this well below the
+              socket buffer size divided by the result size
+    */
+    Pipeline(Client &client, const std::size_t &window=32)
+      : m_client(client), m_window((window > 0) ? window : 1), m_chunk()
+    {
+    }
+
+    /** Queue a chunk. Nothing is sent until the next #flush. */
+    template <typename String>
+    void push(const String &chunk)
+    {
+      m_chunk.push_back(std::string(chunk.begin(), chunk.end()));
+    }
+
+    /** Number of queued chunks. */
+    std::size_t size() const
+    {
+      return m_chunk.size();
+    }
+
+    /** Discard all of the queued chunks. */
+    void clear()
+    {
+      m_chunk.clear();
+    }
+
+    /**
+      Send all of the queued chunks and call <tt>fn(index, result)</tt> for
+      each result, in order. The queue is empty when this returns.
+
+      @param  fn function object called as <tt>fn(index, result)</tt> with the
+              index of the chunk in the queue and its @ref result_type
+      @param  time_out_second passed to each write and read call
+      @return the number of results delivered to <tt>fn</tt>, less than the
+              queue size if a write or read call failed or timed out, in which
+              case the remaining chunks may or may not have run
+      @throws std::runtime_error for any communication error
+    */
+    template <typename Function>
+    std::size_t flush(Function fn, const int &time_out_second=-1)
+    {
+      chunk_list_type chunk;
+      chunk.swap(m_chunk);
+
+      std::vector<typename Client::data_type> batch;
+      typename Client::data_type data;
+      std::size_t written = 0;
+      std::size_t read = 0;
+      bool write_failed = false;
+      while (read < chunk.size()) {
+        // Fill the window before waiting for the oldest result. Send all of
+        // the new chunks in one batch.
+        if (!write_failed && (written < chunk.size()) &&
+            (written - read < m_window)) {
+          const std::size_t n =
+            std::min(chunk.size() - written, m_window - (written - read));
+
+          batch.resize(n);
+          for (std::size_t i=0; i<n; ++i) {
+            batch[i].assign(
+              chunk[written + i].begin(), chunk[written + i].end());
+          }
+
+          if (m_client.writeBatch(batch, time_out_second)) {
+            written += n;
+          } else {
+            write_failed = true;
+          }
+        }
+
+        if ((read == written) || !m_client.readData(data, time_out_second)) {
+          break;
         }
+
+        result_type result(Failure, result_type::second_type());
+        ParseResult(data, result);
+        fn(read, result);
+        ++read;
+      }
+
+      return read;
+    }
+
+    /**
+      Send all of the queued chunks and store the results in order.
+
+      @param  result output list, one entry per delivered result
+      @return the number of results, <tt>result.size()</tt>
+      @see    Pipeline#flush(Function, const int &)
+    */
+    std::size_t flush(std::vector<result_type> &result,
+                      const int &time_out_second=-1)
+    {
+      result.clear();
+      result.reserve(m_chunk.size());
+      return flush(Append(result), time_out_second);
+    }
+
+   private:
+    Client &m_client;
+    std::size_t m_window;
+    chunk_list_type m_chunk;
+
+    class Append {
+     public:
+      Append(std::vector<result_type> &result)
+        : m_result(result)
+      {
+      }
+
+      void operator()(const std::size_t &, const result_type &result)
+      {
+        m_result.push_back(result);
+      }
+
+     private:
+      std::vector<result_type> &m_result;
+    };
+
+    Pipeline(const Pipeline &rhs);
+    const Pipeline &operator=(const Pipeline &lhs);
+  };  // class Pipeline
+
+  /**
+    Run a list of Lua statements as one combined chunk, one round trip in
+    total, and get a separate result for each statement. Each statement is
+    compiled and called in protected mode, so a failure only affects that
+    statement and the rest of the list still runs. The printed output of each
+    statement is returned in its own result.
+
+    The result code of a statement is Success, Failure with the error message,
+    or Continue if the statement is an incomplete chunk. Unlike #SendChunk,
+    an incomplete statement is not kept for the next call.
+
+    Example usage:
+    @code
+    std::vector<std::string> statement;
+    statement.push_back("print(node.num_reading())");
+    statement.push_back("node.start()");
+
+    std::vector<LuaConsole::result_type> result;
+    LuaConsole::result_type batch = LuaConsole::SendBatch(
+      client, statement.begin(), statement.end(), result);
+    if (LuaConsole::Success == batch.first) {
+      // One result per statement.
+    }
+    @endcode
+
+    @param  result output list, one entry per statement if the combined chunk
+            ran, otherwise empty
+    @return the result of the combined chunk, only Success if there is a
+            result for every statement
+  */
+  template <typename Client, typename InputIterator>
+  static result_type SendBatch(Client &client,
+                               InputIterator first, InputIterator last,
+                               std::vector<result_type> &result,
+                               const int &time_out_second=-1)
+  {
+    result.clear();
+
+    std::string chunk =
+      "do"
+      " local _print = print"
+      " local load = loadstring or load"
+      " local list = {";
+    std::size_t count = 0;
+    for (; first != last; ++first, ++count) {
+      AppendLongString(chunk, std::string(first->begin(), first->end()));
+      chunk.append(",");
+    }
+    chunk.append(
+      "}"
+      " for i=1,#list do"
+      "  local out = {}"
+      "  print = function(...)"
+      "   local n = select('#', ...)"
+      "   local t = {}"
+      "   for j=1,n do t[j] = tostring((select(j, ...))) end"
+      "   out[#out+1] = table.concat(t, '\\t') .. '\\n'"
+      "  end"
+      "  local code = 0"
+      "  local f, e = load(list[i])"
+      "  if f then"
+      "   local ok, m = pcall(f)"
+      "   if not ok then code = 1 out[#out+1] = tostring(m) end"
+      "  else"
+      "   code = string.find(e, '<eof>', 1, true) and 2 or 1"
+      "   out[#out+1] = e"
+      "  end"
+      "  print = _print"
+      "  local text = table.concat(out)"
+      "  _print(code .. ' ' .. #text .. ' ' .. text)"
+      " end"
+      " print = _print"
+      " end");
+
+    result_type batch = SendChunk(client, chunk, time_out_second);
+    if (Success == batch.first) {
+      if (ParseBatch(batch.second, count, result)) {
+        batch.second.clear();
       } else {
+        result.clear();
+        batch.first = Failure;
 #if MOTION_SDK_USE_EXCEPTIONS
-        throw detail::error("unknown return code from Console service");
+        throw detail::error("invalid batch result from Console service");
 #endif  // MOTION_SDK_USE_EXCEPTIONS
       }
     }
 
-    return result;
+    return batch;
   }
 
  private:
+  /**
+    Read the response code and printed output of one Console service
+    message.
+  */
+  template <typename Data>
+  static void ParseResult(const Data &data, result_type &result)
+  {
+    if (data.empty()) {
+      return;
+    }
+
+    // First character is the response code.
+    char code = data[0];
+    if ((code >= Success) && (code <= Continue)) {
+      result.first = static_cast<ResultCode>(code);
+      // The rest of the message is any printed output from the
+      // Lua environment.
+      if (data.size() > 1) {
+        result.second.assign(data.begin() + 1, data.end());
+      }
+    } else {
+#if MOTION_SDK_USE_EXCEPTIONS
+      throw detail::error("unknown return code from Console service");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+    }
+  }
+
+  /**
+    Append a Lua long string literal, <tt>[==[text]==]</tt>, with a level
+    that does not appear in the text. Long strings are not escaped.
+  */
+  static void AppendLongString(std::string &out, const std::string &text)
+  {
+    std::string level;
+    while (text.find("]" + level + "]") != std::string::npos) {
+      level.append("=");
+    }
+
+    // A newline right after the opening bracket is skipped by Lua, add one
+    // so that a leading newline in the text is kept.
+    out.append("[" + level + "[\n");
+    out.append(text);
+    out.append("]" + level + "]");
+  }
+
+  /** Read an unsigned decimal number followed by a space. */
+  static bool ParseNumber(const std::string &text, std::size_t &offset,
+                          std::size_t &value)
+  {
+    const std::size_t first = offset;
+    value = 0;
+    while ((offset < text.size()) && (text[offset] >= '0') &&
+           (text[offset] <= '9')) {
+      value = value * 10 + static_cast<std::size_t>(text[offset] - '0');
+      ++offset;
+    }
+
+    if ((first == offset) || (offset >= text.size()) ||
+        (' ' != text[offset])) {
+      return false;
+    }
+    ++offset;
+
+    return true;
+  }
+
+  /**
+    Split the printed output of a batch into one result per statement. Each
+    statement prints one record, <tt>code length text\n</tt>.
+  */
+  static bool ParseBatch(const std::string &text, const std::size_t &count,
+                         std::vector<result_type> &result)
+  {
+    std::size_t offset = 0;
+    for (std::size_t i=0; i<count; ++i) {
+      std::size_t code = 0;
+      std::size_t length = 0;
+      if (!ParseNumber(text, offset, code) || (code > Continue) ||
+          !ParseNumber(text, offset, length) ||
+          (text.size() - offset < length + 1) ||
+          ('\n' != text[offset + length])) {
+        return false;
+      }
+
+      result.push_back(result_type(
+        static_cast<ResultCode>(code), text.substr(offset, length)));
+      offset += length + 1;
+    }
+
+    return offset == text.size();
+  }
+
   /**
     Hide the constructor. There is no need to instantiate a LuaConsole object.
   */
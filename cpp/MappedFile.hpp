@@ -0,0 +1,350 @@
+/*
+  @file    tools/sdk/cpp/MappedFile.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_MAPPED_FILE_HPP_
+#define __MOTION_SDK_MAPPED_FILE_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace Motion { namespace SDK {
+
+/**
+  Read only view of a contiguous array of fixed length frames. Each frame is
+  <tt>length()</tt> elements of type <tt>T</tt>. Does not own the memory, the
+  view is valid as long as the @ref MappedFile it came from is open.
+*/
+template <typename T>
+class FrameSpan {
+public:
+  typedef T value_type;
+  typedef const T *const_iterator;
+
+  FrameSpan()
+    : m_data(NULL), m_length(0), m_size(0)
+  {
+  }
+
+  FrameSpan(const T *data, const std::size_t &length, const std::size_t &size)
+    : m_data(data), m_length(length), m_size(size)
+  {
+  }
+
+  /** Number of frames. */
+  std::size_t size() const
+  {
+    return m_size;
+  }
+
+  bool empty() const
+  {
+    return 0 == m_size;
+  }
+
+  /** Number of elements per frame. */
+  std::size_t length() const
+  {
+    return m_length;
+  }
+
+  /** Iterate over all of the elements of all of the frames. */
+  const_iterator begin() const
+  {
+    return m_data;
+  }
+
+  const_iterator end() const
+  {
+    return m_data + m_length * m_size;
+  }
+
+  /**
+    Constant time access to a single frame.
+
+    @return pointer to the first of <tt>length()</tt> elements
+    @pre    <tt>frame < size()</tt>
+  */
+  const T *operator[](const std::size_t &frame) const
+  {
+    return m_data + m_length * frame;
+  }
+
+  /**
+    Contiguous sub range of at most <tt>count</tt> frames, starting at index
+    <tt>first</tt>. Returns an empty span if <tt>first</tt> is past the end.
+  */
+  FrameSpan block(const std::size_t &first, const std::size_t &count) const
+  {
+    if (first < m_size) {
+      return FrameSpan(
+        m_data + m_length * first, m_length, std::min(count, m_size - first));
+    } else {
+      return FrameSpan();
+    }
+  }
+
+private:
+  const T *m_data;
+  std::size_t m_length;
+  std::size_t m_size;
+}; // class FrameSpan
+
+/**
+  Implements a random access interface for reading Motion binary take data
+  files. Map the whole file into memory and provide a zero-copy view of the
+  samples as an array of fixed length frames. If the file can not be mapped
+  read it into memory in large blocks instead.
+
+  Use this class instead of @ref File to scan large take files more than once,
+  to seek by frame number, or to process blocks of frames at once.
+
+  @code
+  try {
+    using Motion::SDK::FrameSpan;
+    using Motion::SDK::MappedFile;
+    using Motion::SDK::Format;
+
+    MappedFile file("sensor_data.bin");
+
+    // Random access to all of the frames in the take.
+    FrameSpan<float> frames =
+      file.getFrames<float>(Format::SensorElement::Length);
+
+    for (std::size_t i=0; i<frames.size(); ++i) {
+      const float *sample = frames[i];
+      // ...
+    }
+
+    // Or process sequential blocks of up to 256 frames.
+    file.seek<float>(0, Format::SensorElement::Length);
+
+    FrameSpan<float> block;
+    while (!(block = file.readBlock<float>(frames.length(), 256)).empty()) {
+      // ...
+    }
+
+  } catch (std::runtime_error & e) {
+    std::cerr << e.what() << std::endl;
+  }
+  @endcode
+*/
+class MappedFile {
+public:
+  /**
+    Open a Motion Take data file for reading and map it into memory.
+
+    @param   pathname
+    @pre     the input file exists and is readable
+    @post    the input file contents are available for reading
+    @throws  std::runtime_error if the input file can not be opened or read
+  */
+  MappedFile(const std::string &pathname);
+
+  /**
+    Does not throw any exceptions.
+  */
+  virtual ~MappedFile();
+
+  /**
+    Unmap the file. Invalidates all of the FrameSpan views.
+
+    @throws  std::runtime_error if the file is not open
+  */
+  virtual void close();
+
+  /**
+    @return  <tt>true</tt> if the file contents are mapped into memory,
+    <tt>false</tt> if we fell back to reading them into a buffer
+  */
+  bool isMapped() const;
+
+  /** Size of the file in bytes. */
+  std::size_t size() const;
+
+  /**
+    View the whole file as an array of frames of <tt>length</tt>
+    elements. A trailing partial frame is not included.
+
+    @pre     type <tt>T</tt> is a primitive data type
+    @throws  std::runtime_error on big-endian platforms, if the file was
+             already accessed with an element type of a different size
+  */
+  template <typename T>
+  FrameSpan<T> getFrames(const std::size_t &length) const
+  {
+    FrameSpan<T> result;
+
+    if (length > 0) {
+      const char *first = data(sizeof(T));
+      if (NULL != first) {
+        result = FrameSpan<T>(
+          reinterpret_cast<const T *>(first), length,
+          m_size / (length * sizeof(T)));
+      }
+    }
+
+    return result;
+  }
+
+  /**
+    Move the current read position to the start of a frame. Constant time.
+
+    @param   frame index of the frame
+    @param   length number of elements per frame
+    @return  <tt>true</tt> iff the position is within the file
+  */
+  template <typename T>
+  bool seek(const std::size_t &frame, const std::size_t &length)
+  {
+    const std::size_t offset = frame * length * sizeof(T);
+    if (offset <= m_size) {
+      m_offset = offset;
+      return true;
+    }
+
+    return false;
+  }
+
+  /**
+    Read up to <tt>count</tt> frames of <tt>length</tt> elements from the
+    current position and advance past them. Does not copy the data.
+
+    @return  empty span at the end of the file
+  */
+  template <typename T>
+  FrameSpan<T> readBlock(const std::size_t &length, const std::size_t &count)
+  {
+    FrameSpan<T> result;
+
+    const std::size_t frame_size = length * sizeof(T);
+    if ((frame_size > 0) && (m_offset < m_size)) {
+      const char *first = data(sizeof(T));
+      if (NULL != first) {
+        result = FrameSpan<T>(
+          reinterpret_cast<const T *>(first + m_offset), length,
+          std::min(count, (m_size - m_offset) / frame_size));
+
+        m_offset += result.size() * frame_size;
+      }
+    }
+
+    return result;
+  }
+
+  /**
+    Copy the frame at the current position, same as File#readData. Does not
+    close the file at the end, use #seek to read it again.
+
+    @param   data is the output array, <tt>data.size()</tt> specifies the
+    number of elements to read for this single sample
+    @return  <tt>true</tt> iff <tt>data.size()</tt> elements are copied into
+    <tt>data</tt>, otherwise returns false and <tt>data</tt> is filled with
+    zeros
+  */
+  template <typename T>
+  bool readData(std::vector<T> &data)
+  {
+    bool result = false;
+
+    if (!data.empty()) {
+      FrameSpan<T> block = readBlock<T>(data.size(), 1);
+      if (!block.empty()) {
+        std::copy(block.begin(), block.end(), data.begin());
+        result = true;
+      }
+    }
+
+    if (!result) {
+      // Initialize the data buffer.
+      std::fill(data.begin(), data.end(), T());
+    }
+
+    return result;
+  }
+
+private:
+  /** Start of the mapped file, or of the buffer. */
+  const char *m_data;
+
+  /** Size of the file in bytes. */
+  std::size_t m_size;
+
+  /** Current position in bytes for #readBlock and #readData. */
+  std::size_t m_offset;
+
+  /** True until #close. */
+  bool m_open;
+
+  /** True if m_data points to a mapped view of the file. */
+  bool m_mapped;
+
+  /**
+    Fall back storage if we can not map the file. Always used on big-endian
+    platforms, we convert the samples to native byte order in place.
+  */
+  mutable std::vector<char> m_buffer;
+
+  /** Element size of the in place byte order conversion. */
+  mutable std::size_t m_native_size;
+
+  /**
+    @return  pointer to the file contents in native byte order, or
+    <tt>NULL</tt> if the file is not open
+  */
+  const char *data(const std::size_t &element_size) const;
+
+  bool map(const std::string &pathname);
+
+  bool read(const std::string &pathname);
+
+  void unmap();
+
+  /**
+    Disable the copy constructor.
+
+    This is a resource object. Copy constructor semantics would be confusing
+    at the very least. Disable it instead.
+  */
+  MappedFile(const MappedFile &rhs);
+
+  /**
+    Disable the assignment operator.
+
+    @see MappedFile#MappedFile(const MappedFile &)
+  */
+  const MappedFile &operator=(const MappedFile &lhs);
+}; // class MappedFile
+
+}} // namespace Motion::SDK
+
+#endif // __MOTION_SDK_MAPPED_FILE_HPP_
@@ -0,0 +1,255 @@
+/*
+  @file    tools/sdk/cpp/Reactor.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_REACTOR_HPP_
+#define __MOTION_SDK_REACTOR_HPP_
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include <Client.hpp>
+
+
+namespace Motion { namespace SDK {
+
+/**
+  Drive many @ref Client connections from a single thread. Wait for incoming
+  data on all of the attached connections at once with the best event
+  notification system call available on this platform (epoll on Linux,
+  kqueue on Mac OS X and BSD, WSAPoll on Windows, poll everywhere else). Then
+  read every complete message without blocking and pass it to the per
+  connection handler.
+
+  @code
+  try {
+    using Motion::SDK::Client;
+    using Motion::SDK::Reactor;
+
+    class Handler : public Reactor::Handler {
+     public:
+      bool onMessage(Client &client, const Client::data_view_type &data)
+      {
+        // Do something useful with the current real-time sample. Return false
+        // to detach this connection from the reactor.
+        return true;
+      }
+    };
+
+    Client preview("", 32079);
+    Client sensor("", 32078);
+
+    Handler handler;
+
+    Reactor reactor;
+    reactor.add(preview, handler);
+    reactor.add(sensor, handler);
+
+    // Dispatch messages until all of the connections close, or another
+    // thread calls Reactor#stop.
+    reactor.run();
+
+  } catch (std::runtime_error &e) {
+    // The Reactor class with throw std::runtime_error for any unrecoverable
+    // conditions.
+  }
+  @endcode
+
+  All methods, with the exception of Reactor#interrupt and Reactor#stop, must
+  be called from the same thread.
+*/
+class Reactor {
+ public:
+  /**
+    Per connection callback interface. A single handler may be shared by any
+    number of connections.
+  */
+  class Handler {
+   public:
+    virtual ~Handler()
+    {
+    }
+
+    /**
+      Called for each complete binary message, in order.
+
+      @param client connection that received the message
+      @param data view of the message, only valid for the duration of the call
+      @return <tt>false</tt> to detach this connection from the reactor
+    */
+    virtual bool onMessage(Client &client,
+                           const Client::data_view_type &data) = 0;
+
+    /**
+      Called once when the remote host closes the connection, or there is a
+      communication error. The reactor has already detached the connection.
+    */
+    virtual void onClose(Client &client)
+    {
+      static_cast<void>(client);
+    }
+  }; // class Handler
+
+  /**
+    Create the event notification descriptor and the interrupt channel.
+
+    @throws  std::runtime_error if the system calls fail for any reason
+  */
+  Reactor();
+
+  /**
+    Does not throw any exceptions. Does not close any of the attached client
+    connections.
+  */
+  virtual ~Reactor();
+
+  /**
+    Attach a connection to this reactor. The client and handler must outlive
+    the attachment.
+
+    @pre     client has an open socket connection
+    @return  <tt>true</tt> iff the client was attached
+  */
+  virtual bool add(Client &client, Handler &handler);
+
+  /**
+    Detach a connection from this reactor. Safe to call from inside a
+    Handler callback. Does not close the client connection.
+
+    @return  <tt>true</tt> iff the client was attached
+  */
+  virtual bool remove(Client &client);
+
+  /**
+    Return the number of attached connections.
+  */
+  std::size_t size() const;
+
+  bool empty() const;
+
+  /**
+    Wait for incoming data on any of the attached connections and dispatch all
+    of the complete messages.
+
+    @param   time_out_millisecond wait at most this many milliseconds, 0
+             value returns immediately, negative value waits until there is
+             data or an interrupt
+    @return  the number of messages passed to the handlers
+    @throws  std::runtime_error if the system wait call fails
+  */
+  virtual std::size_t poll(const int &time_out_millisecond=-1);
+
+  /**
+    Call Reactor#poll in a loop until all of the connections are detached, or
+    another thread calls Reactor#stop.
+
+    @return  the number of messages passed to the handlers
+  */
+  virtual std::size_t run();
+
+  /**
+    Wake up the thread that is blocked in Reactor#poll. Thread safe.
+  */
+  void interrupt();
+
+  /**
+    Ask the thread in Reactor#run to return. Thread safe.
+  */
+  void stop();
+
+  /**
+    Return the name of the event notification system call this reactor uses.
+  */
+  static const char *backend();
+
+ protected:
+  /** Attached client connection. */
+  class Connection {
+   public:
+    Connection(Client *client, Handler *handler)
+      : client(client), handler(handler)
+    {
+    }
+
+    Client *client;
+    Handler *handler;
+  }; // class Connection
+
+  typedef std::map<int, Connection> container_type;
+
+  /** Attached connections, indexed by socket descriptor. */
+  container_type m_connection;
+
+ private:
+  /** Event notification descriptor. Not used by the poll back end. */
+  int m_descriptor;
+
+  /**
+    Read and write end of the interrupt channel. A pipe, or a loopback socket
+    on Windows.
+  */
+  int m_interrupt[2];
+
+  /** Set by a stop request on the interrupt channel. */
+  bool m_stop;
+
+  /** Scratch list of ready socket descriptors. Reused by every poll call. */
+  std::vector<int> m_ready;
+
+  /** Scratch storage for the system event array. */
+  std::vector<char> m_event;
+
+  /**
+    Read and dispatch all of the available messages on one connection.
+  */
+  std::size_t dispatch(const int &socket);
+
+  /** Consume any bytes on the interrupt channel. */
+  void drainInterrupt();
+
+  /** Write one byte to the interrupt channel. */
+  void writeInterrupt(const char &value);
+
+  /** Add or remove a descriptor from the system event set. */
+  bool watch(const int &socket, bool enable);
+
+  /** Wait for ready descriptors, fill the m_ready list. */
+  bool wait(const int &time_out_millisecond);
+
+  /** Disable the copy constructor. This is a resource object. */
+  Reactor(const Reactor &rhs);
+
+  /** Disable the assignment operator. */
+  const Reactor &operator=(const Reactor &lhs);
+}; // class Reactor
+
+}}  // namespace Motion::SDK
+
+#endif  // __MOTION_SDK_REACTOR_HPP_
@@ -0,0 +1,214 @@
+/*
+  @file    tools/sdk/cpp/Resampler.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_RESAMPLER_HPP_
+#define __MOTION_SDK_RESAMPLER_HPP_
+
+#include <Format.hpp>
+
+#include <vector>
+
+
+namespace Motion { namespace SDK {
+
+/**
+  Resample a stream of Preview frames at an arbitrary time. The Motion Service
+  sends frames at its own rate, a renderer or physics loop runs at a
+  different one. Push each frame with its arrival time and sample the pose at
+  the time of the display or simulation step.
+
+  Keep a short history of frames. Interpolate between the two frames that
+  bracket the sample time, slerp for the quaternion channels and linear
+  interpolation for the acceleration. All of the elements are interpolated at
+  once with the batch kernels. The Euler angle channel is computed from the
+  interpolated local quaternion, interpolating the angles directly fails
+  where they wrap around.
+
+  Optionally extrapolate past the newest frame to hide some of the network
+  latency. Continue at the angular velocity between the two newest frames.
+  The extrapolation is limited to the setExtrapolate time and to one frame
+  interval.
+
+  @code
+  try {
+    using Motion::SDK::Client;
+    using Motion::SDK::Format;
+    using Motion::SDK::Resampler;
+
+    Client client("", 32079);
+
+    Resampler resampler;
+    resampler.setExtrapolate(0.01);
+
+    Client::data_type data;
+    Resampler::frame_type pose;
+    while (client.readData(data)) {
+      resampler.push(
+        Motion::SDK::detail::monotonic_time(), data.begin(), data.end());
+
+      // Usually in the render thread, at the time of the next display.
+      if (resampler.sample(Motion::SDK::detail::monotonic_time(), pose)) {
+        const float *q = pose.getQuaternion(false);
+      }
+    }
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+  }
+  @endcode
+
+  Times are in seconds on any clock that only moves forward. The Client
+  message arrival times from Client#getMessageTime and detail::monotonic_time
+  are both good choices. Not thread safe, synchronize push and sample if they
+  are called from different threads.
+*/
+class Resampler {
+ public:
+  typedef Format::PreviewFrame frame_type;
+  typedef frame_type::value_type value_type;
+  typedef frame_type::data_type data_type;
+  typedef Format::size_type size_type;
+
+  enum {
+    /** Number of frames to keep, the minimum is two. */
+    DefaultHistory = 4
+  };
+
+  explicit Resampler(const size_type &history=DefaultHistory);
+
+  /**
+    Decode a Preview message and add it to the history.
+
+    @param   time arrival time of the message in seconds
+    @pre     <tt>[first, last)</tt> is a valid, contiguous range
+    @return  <tt>false</tt> if the message is not valid or if the time is not
+             newer than the most recent frame, the history is not changed
+  */
+  template <typename InputIterator>
+  bool push(const double &time, InputIterator first, InputIterator last)
+  {
+    if (!isNewer(time)) {
+      return false;
+    }
+
+    frame_type &frame = m_frame[getNext()];
+    if (!Format::Preview(first, last, frame)) {
+      discard();
+      return false;
+    }
+
+    commit(time);
+    return true;
+  }
+
+  /** @see Resampler#push */
+  bool push(const double &time, const frame_type &frame);
+
+  /**
+    Add the output of a Device::Sampler, or any other map of Preview
+    elements.
+
+    @see     Resampler#push
+  */
+  bool push(const double &time, const Format::preview_service_type &preview);
+
+  /**
+    Compute the pose of every element at the specified time. Before the oldest
+    frame use the oldest frame, after the newest frame extrapolate or use the
+    newest frame.
+
+    @param   time sample time in seconds
+    @param   result the interpolated frame, reuses its memory
+    @return  <tt>false</tt> if there are no frames yet
+  */
+  bool sample(const double &time, frame_type &result);
+
+  /**
+    Set the maximum time that a sample may extrapolate past the newest
+    frame. Defaults to zero, hold the newest frame.
+
+    @param   seconds extrapolation time limit, negative values are zero
+  */
+  void setExtrapolate(const double &seconds);
+
+  /** @see Resampler#setExtrapolate */
+  double getExtrapolate() const;
+
+  /**
+    Remove all frames. Call this after the stream reconnects.
+  */
+  void clear();
+
+  /** Number of frames in the history. */
+  size_type size() const;
+
+  bool empty() const;
+
+  /**
+    Time of the oldest and newest frame in the history.
+
+    @return  <tt>false</tt> if the history is empty
+  */
+  bool getTime(double &first, double &last) const;
+
+ private:
+  /** Ring of frames, in time order starting at m_first. */
+  std::vector<frame_type> m_frame;
+  std::vector<double> m_time;
+  size_type m_first;
+  size_type m_size;
+
+  double m_extrapolate;
+
+  /** Predicted quaternions for extrapolation, reused between calls. */
+  data_type m_scratch;
+
+  bool isNewer(const double &time) const;
+
+  /** Index of the ring entry that the next frame is stored in. */
+  size_type getNext() const;
+
+  size_type getIndex(const size_type &i) const;
+
+  /** Add the frame that is stored at getNext. */
+  void commit(const double &time);
+
+  /** The frame at getNext was overwritten but is not valid. */
+  void discard();
+
+  void interpolate(const frame_type &a, const frame_type &b,
+                   const value_type &t, frame_type &result);
+
+  void extrapolate(const frame_type &a, const frame_type &b,
+                   const value_type &s, frame_type &result);
+}; // class Resampler
+
+}} // namespace Motion::SDK
+
+#endif // __MOTION_SDK_RESAMPLER_HPP_
@@ -0,0 +1,464 @@
+/*
+  @file    tools/sdk/cpp/TakeSet.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_TAKE_SET_HPP_
+#define __MOTION_SDK_TAKE_SET_HPP_
+
+#include <File.hpp>
+#include <MappedFile.hpp>
+#include <detail/endian_to_native.hpp>
+#include <detail/thread.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <vector>
+
+
+namespace Motion { namespace SDK {
+
+/**
+  Process a list of Motion take data files in parallel. Call a kernel function
+  object on contiguous blocks of frames from each take, one copy of the
+  kernel per take. Collect the per take kernels as the result, or merge them
+  into one reduction.
+
+  Schedule the takes over a work stealing pool of native threads, largest
+  files first. Each worker hints the system to prefetch the next take in its
+  queue while it processes the current one. The take files are read
+  sequentially in large, page aligned blocks.
+
+  The SDK library does not use any threads, this header starts them. Link
+  the program with the native thread library, <tt>-lpthread</tt>.
+
+  @code
+  try {
+    using Motion::SDK::FrameSpan;
+    using Motion::SDK::TakeSet;
+    using Motion::SDK::Format;
+
+    // Count the frames and find the largest accelerometer value.
+    struct Kernel {
+      std::size_t count;
+      float maximum;
+
+      Kernel() : count(0), maximum(0) {}
+
+      void operator()(const FrameSpan<float> &block)
+      {
+        count += block.size();
+        for (std::size_t i=0; i<block.size(); ++i) {
+          maximum = std::max(maximum, std::fabs(block[i][0]));
+        }
+      }
+    };
+
+    struct Merge {
+      void operator()(Kernel &lhs, const Kernel &rhs) const
+      {
+        lhs.count += rhs.count;
+        lhs.maximum = std::max(lhs.maximum, rhs.maximum);
+      }
+    };
+
+    TakeSet::path_list_type pathname;
+    pathname.push_back("take0/sensor_data.bin");
+    pathname.push_back("take1/sensor_data.bin");
+
+    TakeSet take(pathname);
+
+    Kernel result;
+    if (!take.reduce<float>(Format::SensorElement::Length, result, Merge())) {
+      for (std::size_t i=0; i<take.size(); ++i) {
+        if (!take.getError(i).empty()) {
+          std::cerr << take.getPathname(i) << ": " << take.getError(i)
+            << std::endl;
+        }
+      }
+    }
+
+  } catch (std::runtime_error & e) {
+    std::cerr << e.what() << std::endl;
+  }
+  @endcode
+*/
+class TakeSet {
+public:
+  typedef std::vector<std::string> path_list_type;
+
+  /**
+    How to read the take files.
+  */
+  enum Backend {
+    /**
+      Sequential reads of large, page aligned blocks into one buffer per
+      take. Ask the system to read ahead. The default.
+    */
+    Read,
+    /** Map each file into memory with the @ref MappedFile class. */
+    Map,
+    /**
+      One frame at a time with the @ref File#readData method, the same as a
+      sequential File loop but with many takes at once.
+    */
+    Stream
+  };
+
+  enum {
+    /** Number of bytes in one read from a take file. */
+    DefaultReadSize = 1 << 20,
+    /** Number of bytes of the next take in the queue to prefetch. */
+    PrefetchSize = 1 << 23
+  };
+
+  /**
+    Sequential reader for a single take file. Returns the samples in blocks
+    of whole frames, in native byte order. The TakeSet uses one of these for
+    each take, use it directly to read one take with the same backends.
+  */
+  class Reader {
+  public:
+    /**
+      Open a Motion take data file for reading. Does not throw any
+      exceptions, check #isOpen.
+
+      @param   read_size number of bytes to read at once, rounded up to a
+               whole page
+    */
+    Reader(const std::string &pathname, const Backend &backend=Read,
+           const std::size_t &read_size=DefaultReadSize);
+
+    ~Reader();
+
+    /** @return <tt>true</tt> if the file is open for reading */
+    bool isOpen() const;
+
+    /** @return <tt>true</tt> if a read failed, not including an EOF */
+    bool isError() const;
+
+    /**
+      Read the next block of frames of <tt>length</tt> elements. A trailing
+      partial frame is not included. The view is valid until the next call.
+
+      @return  empty span at the end of the file
+      @pre     type <tt>T</tt> is a primitive data type
+    */
+    template <typename T>
+    FrameSpan<T> readBlock(const std::size_t &length)
+    {
+      const std::size_t frame_size = length * sizeof(T);
+      if (0 == frame_size) {
+        return FrameSpan<T>();
+      }
+
+      if (NULL != m_map) {
+        return m_map->readBlock<T>(
+          length, std::max<std::size_t>(m_read_size / frame_size, 1));
+      }
+
+      std::size_t count = 0;
+      T *first = NULL;
+      if (NULL != m_file) {
+        // Fill the buffer one frame at a time from the file stream.
+        count = std::max<std::size_t>(m_read_size / frame_size, 1);
+        first = reinterpret_cast<T *>(reserve(count * frame_size));
+
+        std::vector<T> data(length);
+        std::size_t i = 0;
+        for (; (i < count) && m_file->readData(data); ++i) {
+          std::copy(data.begin(), data.end(), first + i * length);
+        }
+        count = i;
+      } else {
+        first = reinterpret_cast<T *>(read(frame_size, count));
+        if (NULL != first) {
+          // Motion data is store in little-endian format. Transform it
+          // to the native byte-order now.
+          detail::transform_little_endian_to_native(first, count * length);
+        }
+      }
+
+      return FrameSpan<T>(first, length, (NULL != first) ? count : 0);
+    }
+
+  private:
+    Backend m_backend;
+    std::size_t m_read_size;
+
+    /** Map backend. */
+    MappedFile *m_map;
+
+    /** Stream backend. */
+    File *m_file;
+
+    /** Read backend, native file handle or descriptor. */
+#if defined(_WIN32)
+    void *m_handle;
+#else
+    int m_handle;
+#endif  // _WIN32
+
+    /** Page aligned buffer inside of m_storage. */
+    char *m_storage;
+    char *m_buffer;
+    std::size_t m_capacity;
+
+    /** Unread bytes of a partial frame at <tt>[m_first, m_last)</tt>. */
+    std::size_t m_first;
+    std::size_t m_last;
+
+    bool m_open;
+    bool m_error;
+
+    /**
+      Read the next block of whole frames into the buffer. Keep the trailing
+      partial frame for the next call.
+
+      @param   count number of frames in the block
+      @return  pointer to the first frame, <tt>NULL</tt> at the end of the
+               file
+    */
+    char *read(const std::size_t &frame_size, std::size_t &count);
+
+    /** @return page aligned buffer of at least <tt>size</tt> bytes */
+    char *reserve(const std::size_t &size);
+
+    Reader(const Reader &rhs);
+    const Reader &operator=(const Reader &lhs);
+  }; // class Reader
+
+  /**
+    @param   pathname list of take data files, the files are not opened
+             until #process
+  */
+  explicit TakeSet(const path_list_type &pathname);
+
+  /** Number of takes. */
+  std::size_t size() const;
+
+  const std::string &getPathname(const std::size_t &index) const;
+
+  /**
+    @return  reason that the take failed in the most recent call to
+             #process, empty string if it succeeded
+  */
+  const std::string &getError(const std::size_t &index) const;
+
+  /**
+    Number of worker threads, including the calling thread. Zero, the
+    default, means one per processor. One processes the takes in order on
+    the calling thread.
+  */
+  void setThreadCount(const std::size_t &count);
+
+  /** @see TakeSet#setThreadCount */
+  std::size_t getThreadCount() const;
+
+  /** Select how to read the take files. Defaults to Read. */
+  void setBackend(const Backend &backend);
+
+  /** @see TakeSet#setBackend */
+  Backend getBackend() const;
+
+  /**
+    Number of bytes to read from a take file at once, rounded up to a whole
+    page. Sets the number of frames in each block of the kernel.
+  */
+  void setReadSize(const std::size_t &read_size);
+
+  /** @see TakeSet#setReadSize */
+  std::size_t getReadSize() const;
+
+  /**
+    Read every take and call a copy of the kernel on each block of frames.
+
+    @code
+    void Kernel::operator()(const FrameSpan<T> &block);
+    @endcode
+
+    @param   length number of elements per frame
+    @param   kernel prototype, copied once for each take
+    @param   result output, one kernel for each take in the same order as
+             the pathname list
+    @return  <tt>true</tt> iff all of the takes were read to the end, see
+             #getError for the takes that failed. An exception from the
+             kernel fails only that take.
+  */
+  template <typename T, typename Kernel>
+  bool process(const std::size_t &length, const Kernel &kernel,
+               std::vector<Kernel> &result)
+  {
+    result.assign(m_pathname.size(), kernel);
+    m_error.assign(m_pathname.size(), std::string());
+
+    std::size_t thread_count = m_thread_count;
+    if (0 == thread_count) {
+      thread_count = detail::processor_count();
+    }
+    thread_count = std::max<std::size_t>(
+      std::min(thread_count, m_pathname.size()), 1);
+
+    Job<T, Kernel> job(*this, length, result, thread_count);
+    detail::run_threads(&Job<T, Kernel>::worker, &job, thread_count);
+
+    for (std::size_t i=0; i<m_error.size(); ++i) {
+      if (!m_error[i].empty()) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+    Read every take and merge the per take kernels, in take order, into one.
+
+    @code
+    void Merge::operator()(Kernel &lhs, const Kernel &rhs);
+    @endcode
+
+    @param   kernel input prototype, output merged result
+    @return  @see TakeSet#process
+  */
+  template <typename T, typename Kernel, typename Merge>
+  bool reduce(const std::size_t &length, Kernel &kernel, Merge merge)
+  {
+    std::vector<Kernel> result;
+    const bool ok = process<T>(length, kernel, result);
+
+    if (!result.empty()) {
+      kernel = result.front();
+      for (std::size_t i=1; i<result.size(); ++i) {
+        merge(kernel, result[i]);
+      }
+    }
+
+    return ok;
+  }
+
+private:
+  path_list_type m_pathname;
+  std::vector<std::string> m_error;
+  std::size_t m_thread_count;
+  Backend m_backend;
+  std::size_t m_read_size;
+
+  /**
+    Order to process the takes in, largest file first. The longest takes
+    start early and the short ones fill in at the end.
+  */
+  std::vector<std::size_t> getSchedule() const;
+
+  /** Ask the system to start reading the first part of a take file. */
+  static void prefetch(const std::string &pathname);
+
+  /**
+    State of one call to #process, shared by all of the worker threads.
+    Each take writes only its own result and error entries.
+  */
+  template <typename T, typename Kernel>
+  class Job {
+  public:
+    Job(TakeSet &set, const std::size_t &length, std::vector<Kernel> &result,
+        const std::size_t &thread_count)
+      : m_set(set), m_length(length), m_result(result), m_queue(thread_count)
+    {
+      // Deal the takes out to the workers. Worker i gets takes i, i + n,
+      // i + 2n, ... of the schedule.
+      const std::vector<std::size_t> schedule = m_set.getSchedule();
+      for (std::size_t i=0; i<schedule.size(); ++i) {
+        m_queue.push(i, schedule[i]);
+      }
+    }
+
+    static void worker(void *argument, std::size_t index)
+    {
+      Job &job = *static_cast<Job *>(argument);
+
+      std::size_t task = 0;
+      while (job.m_queue.pop(index, task)) {
+        std::size_t next = 0;
+        if (job.m_queue.peek(index, next)) {
+          TakeSet::prefetch(job.m_set.m_pathname[next]);
+        }
+
+        job.run(task);
+      }
+    }
+
+  private:
+    TakeSet &m_set;
+    std::size_t m_length;
+    std::vector<Kernel> &m_result;
+    detail::task_queue m_queue;
+
+    void run(const std::size_t &task)
+    {
+      std::string &error = m_set.m_error[task];
+
+      Reader reader(m_set.m_pathname[task], m_set.m_backend, m_set.m_read_size);
+      if (!reader.isOpen()) {
+        error = "failed to open input file";
+        return;
+      }
+
+#if MOTION_SDK_USE_EXCEPTIONS
+      try {
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+        Kernel &kernel = m_result[task];
+
+        FrameSpan<T> block;
+        while (!(block = reader.readBlock<T>(m_length)).empty()) {
+          kernel(block);
+        }
+
+        if (reader.isError()) {
+          error = "failed to read from input file";
+        }
+#if MOTION_SDK_USE_EXCEPTIONS
+      } catch (std::exception &e) {
+        error = e.what();
+        if (error.empty()) {
+          error = "unknown error in kernel";
+        }
+      } catch (...) {
+        error = "unknown error in kernel";
+      }
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+    }
+
+    Job(const Job &rhs);
+    const Job &operator=(const Job &lhs);
+  }; // class Job
+}; // class TakeSet
+
+}} // namespace Motion::SDK
+
+#endif // __MOTION_SDK_TAKE_SET_HPP_
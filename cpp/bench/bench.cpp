@@ -0,0 +1,1488 @@
+/**
+  Benchmark suite for the C++ Motion SDK.
+
+  Stream synthetic or recorded service messages from a fake Motion Service on
+  the loopback interface and time the Client receive path. Time the Format
+  decoders, the element accessors, the File reader, and the binary_to_text
+  utility on the same data. Print one CSV row per benchmark.
+
+  @file    tools/sdk/cpp/bench/bench.cpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Client.hpp>
+#include <CompactPreview.hpp>
+#include <ConfigurableSchema.hpp>
+#include <File.hpp>
+#include <Format.hpp>
+#include <detail/instrument.hpp>
+#include <detail/thread.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Use the native sockets directly for the fake service.
+#if defined(_WIN32)
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#else
+#  include <arpa/inet.h>
+#  include <errno.h>
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <sys/socket.h>
+#  include <sys/types.h>
+#  include <unistd.h>
+#endif  // _WIN32
+
+#if defined(_WIN32)
+#  define SHUT_WR SD_SEND
+typedef SOCKET socket_type;
+const socket_type InvalidSocket = INVALID_SOCKET;
+#else
+typedef int socket_type;
+const socket_type InvalidSocket = -1;
+#endif  // _WIN32
+
+#if !defined(MSG_NOSIGNAL)
+#  define MSG_NOSIGNAL 0
+#endif
+
+
+using Motion::SDK::Client;
+using Motion::SDK::File;
+using Motion::SDK::Format;
+using Motion::SDK::detail::monotonic_time;
+
+const std::size_t MaxOptionLength = 1024;
+
+// Largest single send call when there is no fragmentation.
+const std::size_t SendSize = 65536;
+
+// Number of samples per channel group in the Sensor and Raw take files.
+const std::size_t FileChannel = 9;
+
+// Temporary files for the File and binary_to_text benchmarks. Written to the
+// current directory and removed after the benchmarks.
+const std::string TakeFile = "bench_take.bin";
+const std::string TextFile = "bench_take.txt";
+const std::string ColumnFile = "bench_take.bin.col";
+
+// Keep the optimizer from removing the benchmark loops.
+volatile double Sink = 0;
+
+
+/**
+  All of the command line settings. Written to every output row so that rows
+  from different runs can be compared.
+*/
+struct Options {
+  Options()
+    : service("preview"), node(16), channel(8), message(20000), rate(0),
+      xml(0), fragment(0), repeat(3), replay(), filter(), output(),
+      append(false), binary_to_text(), serve(0)
+  {
+#if defined(_WIN32)
+    binary_to_text = "binary_to_text.exe";
+#else
+    binary_to_text = "./binary_to_text";
+#endif  // _WIN32
+  }
+
+  std::string service;
+  std::size_t node;
+  std::size_t channel;
+  std::size_t message;
+  double rate;
+  std::size_t xml;
+  std::size_t fragment;
+  std::size_t repeat;
+  std::string replay;
+  std::string filter;
+  std::string output;
+  bool append;
+  std::string binary_to_text;
+  unsigned serve;
+};
+
+/**
+  Result of one benchmark run. Rate columns are computed from these.
+*/
+struct Measure {
+  Measure() : valid(false), skip(false), operations(0), bytes(0), seconds(0)
+  {
+  }
+
+  bool valid;
+  /** The benchmark does not apply to this run. Not an error. */
+  bool skip;
+  std::size_t operations;
+  double bytes;
+  double seconds;
+};
+
+/**
+  List of service messages, and the same list in wire format. The wire stream
+  starts with the service description and may have XML messages interleaved
+  with the data messages.
+*/
+struct Stream {
+  Stream() : message(), wire(), description_size(0), boundary(), bytes(0) {}
+
+  std::vector<std::string> message;
+  std::string wire;
+  std::size_t description_size;
+  /** End offset of each data message in the wire stream. */
+  std::vector<std::size_t> boundary;
+  /** Sum of the data message sizes, not including headers or XML. */
+  double bytes;
+};
+
+
+void put_u32(std::string &out, const unsigned long &value)
+{
+  for (int i=0; i<4; ++i) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+void put_value(std::string &out, const float &value)
+{
+  unsigned int bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  put_u32(out, bits);
+}
+
+void put_value(std::string &out, const short &value)
+{
+  const unsigned short bits = static_cast<unsigned short>(value);
+  out.push_back(static_cast<char>(bits & 0xff));
+  out.push_back(static_cast<char>((bits >> 8) & 0xff));
+}
+
+/**
+  Append a message in wire format, an unsigned 4 byte length in network byte
+  order followed by the message bytes.
+*/
+void put_message(std::string &out, const std::string &message)
+{
+  const unsigned long size = static_cast<unsigned long>(message.size());
+  for (int i=3; i>=0; --i) {
+    out.push_back(static_cast<char>((size >> (8 * i)) & 0xff));
+  }
+  out.append(message);
+}
+
+/**
+  Smooth synthetic channel value. Unique per sample, node, and channel.
+*/
+float synthetic(const std::size_t &sample, const std::size_t &node,
+                const std::size_t &channel)
+{
+  return static_cast<float>(
+    std::sin(0.01 * sample + 0.37 * node + 1.3 * channel));
+}
+
+void put_quaternion(std::string &out, const std::size_t &sample,
+                    const std::size_t &node, const std::size_t &channel)
+{
+  float q[4];
+  float length = 0;
+  for (std::size_t i=0; i<4; ++i) {
+    q[i] = synthetic(sample, node, channel + i);
+    length += q[i] * q[i];
+  }
+  length = std::sqrt(length);
+  for (std::size_t i=0; i<4; ++i) {
+    put_value(out, (length > 0) ? q[i] / length : 0);
+  }
+}
+
+
+/**
+  Adapt each service type to the benchmarks. Generate synthetic messages,
+  decode them with the three Format interfaces, and read one channel through
+  the element accessors.
+*/
+struct PreviewTraits {
+  typedef Format::PreviewElement element_type;
+  typedef Format::preview_service_type map_type;
+  typedef Format::PreviewFrame frame_type;
+  typedef std::vector<Format::FixedElement<Format::PreviewLayout> > list_type;
+
+  static map_type map(const char *first, const char *last)
+  {
+    return Format::Preview(first, last);
+  }
+
+  static bool frame(const char *first, const char *last, frame_type &frame)
+  {
+    return Format::Preview(first, last, frame);
+  }
+
+  static void generate(std::string &out, const std::size_t &sample,
+                       const std::size_t &node, const std::size_t &)
+  {
+    put_quaternion(out, sample, node, 0);
+    put_quaternion(out, sample, node, 4);
+    for (std::size_t i=8; i<element_type::Length; ++i) {
+      put_value(out, synthetic(sample, node, i));
+    }
+  }
+
+  static bool decode(const char *first, const char *last, list_type &list,
+                     const std::size_t &)
+  {
+    return Format::Decode(first, last, list);
+  }
+
+  static double access(const element_type &element)
+  {
+    element_type::vector_type value;
+    element.getEuler(value);
+    return value[0] + value[1] + value[2];
+  }
+
+  static double access_vector(const element_type &element)
+  {
+    const element_type::data_type value = element.getEuler();
+    return value[0] + value[1] + value[2];
+  }
+};
+
+struct SensorTraits {
+  typedef Format::SensorElement element_type;
+  typedef Format::sensor_service_type map_type;
+  typedef Format::SensorFrame frame_type;
+  typedef std::vector<Format::FixedElement<Format::SensorLayout> > list_type;
+
+  static map_type map(const char *first, const char *last)
+  {
+    return Format::Sensor(first, last);
+  }
+
+  static bool frame(const char *first, const char *last, frame_type &frame)
+  {
+    return Format::Sensor(first, last, frame);
+  }
+
+  static void generate(std::string &out, const std::size_t &sample,
+                       const std::size_t &node, const std::size_t &)
+  {
+    for (std::size_t i=0; i<element_type::Length; ++i) {
+      put_value(out, synthetic(sample, node, i));
+    }
+  }
+
+  static bool decode(const char *first, const char *last, list_type &list,
+                     const std::size_t &)
+  {
+    return Format::Decode(first, last, list);
+  }
+
+  static double access(const element_type &element)
+  {
+    element_type::vector_type value;
+    element.getAccelerometer(value);
+    return value[0] + value[1] + value[2];
+  }
+
+  static double access_vector(const element_type &element)
+  {
+    const element_type::data_type value = element.getAccelerometer();
+    return value[0] + value[1] + value[2];
+  }
+};
+
+struct RawTraits {
+  typedef Format::RawElement element_type;
+  typedef Format::raw_service_type map_type;
+  typedef Format::RawFrame frame_type;
+  typedef std::vector<Format::FixedElement<Format::RawLayout> > list_type;
+
+  static map_type map(const char *first, const char *last)
+  {
+    return Format::Raw(first, last);
+  }
+
+  static bool frame(const char *first, const char *last, frame_type &frame)
+  {
+    return Format::Raw(first, last, frame);
+  }
+
+  static void generate(std::string &out, const std::size_t &sample,
+                       const std::size_t &node, const std::size_t &)
+  {
+    for (std::size_t i=0; i<element_type::Length; ++i) {
+      put_value(
+        out, static_cast<short>(2048 + 1024 * synthetic(sample, node, i)));
+    }
+  }
+
+  static bool decode(const char *first, const char *last, list_type &list,
+                     const std::size_t &)
+  {
+    return Format::Decode(first, last, list);
+  }
+
+  static double access(const element_type &element)
+  {
+    element_type::vector_type value;
+    element.getAccelerometer(value);
+    return value[0] + value[1] + value[2];
+  }
+
+  static double access_vector(const element_type &element)
+  {
+    const element_type::data_type value = element.getAccelerometer();
+    return value[0] + value[1] + value[2];
+  }
+};
+
+struct ConfigurableTraits {
+  typedef Format::ConfigurableElement element_type;
+  typedef Format::configurable_service_type map_type;
+  typedef Format::ConfigurableFrame frame_type;
+  typedef Format::ConfigurableFrame list_type;
+
+  static map_type map(const char *first, const char *last)
+  {
+    return Format::Configurable(first, last);
+  }
+
+  static bool frame(const char *first, const char *last, frame_type &frame)
+  {
+    return Format::Configurable(first, last, frame);
+  }
+
+  static void generate(std::string &out, const std::size_t &sample,
+                       const std::size_t &node, const std::size_t &channel)
+  {
+    put_u32(out, static_cast<unsigned long>(channel));
+    for (std::size_t i=0; i<channel; ++i) {
+      put_value(out, synthetic(sample, node, i));
+    }
+  }
+
+  /** The channel count is known from the XML definition. */
+  static bool decode(const char *first, const char *last, list_type &list,
+                     const std::size_t &channel)
+  {
+    return Format::Configurable(first, last, channel, list);
+  }
+
+  static double access(const element_type &element)
+  {
+    double result = 0;
+    for (std::size_t i=0; i<element.size(); ++i) {
+      result += element[i];
+    }
+    return result;
+  }
+
+  static double access_vector(const element_type &element)
+  {
+    const element_type::data_type value = element.getRange(0, element.size());
+    double result = 0;
+    for (std::size_t i=0; i<value.size(); ++i) {
+      result += value[i];
+    }
+    return result;
+  }
+};
+
+/**
+  Generate the data messages, or load them from a recording, and build the
+  wire stream.
+
+  A recording is a file of messages in wire format, the @ref Device::Recorder
+  output or a capture of a service connection. Repeat it to get the requested
+  number of messages.
+*/
+template <typename Traits>
+bool make_stream(const Options &options, Stream &stream)
+{
+  if (!options.replay.empty()) {
+    std::ifstream input(options.replay.c_str(), std::ios_base::binary);
+    if (!input.is_open()) {
+      std::cerr
+        << "failed to open replay file, \"" << options.replay << "\""
+        << std::endl;
+      return false;
+    }
+
+    const std::string data(
+      (std::istreambuf_iterator<char>(input)),
+      std::istreambuf_iterator<char>());
+
+    std::vector<std::string> recording;
+    std::size_t offset = 0;
+    while (data.size() - offset >= 4) {
+      const unsigned char *p =
+        reinterpret_cast<const unsigned char *>(data.data() + offset);
+      const std::size_t size =
+        (static_cast<std::size_t>(p[0]) << 24) |
+        (static_cast<std::size_t>(p[1]) << 16) |
+        (static_cast<std::size_t>(p[2]) << 8) |
+        static_cast<std::size_t>(p[3]);
+      if (data.size() - offset - 4 < size) {
+        break;
+      }
+
+      const std::string message(data, offset + 4, size);
+      offset += 4 + size;
+
+      // Keep the data messages, we interleave our own XML.
+      if (0 != message.compare(0, 5, "<?xml")) {
+        recording.push_back(message);
+      }
+    }
+
+    if (recording.empty()) {
+      std::cerr
+        << "no data messages in replay file, \"" << options.replay << "\""
+        << std::endl;
+      return false;
+    }
+
+    for (std::size_t i=0; i<options.message; ++i) {
+      stream.message.push_back(recording[i % recording.size()]);
+    }
+  } else {
+    for (std::size_t i=0; i<options.message; ++i) {
+      std::string message;
+      for (std::size_t node=0; node<options.node; ++node) {
+        put_u32(message, static_cast<unsigned long>(node + 1));
+        Traits::generate(message, i, node, options.channel);
+      }
+      stream.message.push_back(message);
+    }
+  }
+
+  put_message(
+    stream.wire,
+    "<?xml version=\"1.0\"?><service name=\"" + options.service +
+    "\" description=\"Motion SDK benchmark service\"/>");
+  stream.description_size = stream.wire.size();
+
+  for (std::size_t i=0; i<stream.message.size(); ++i) {
+    if ((options.xml > 0) && (0 == i % options.xml)) {
+      char buffer[MaxOptionLength];
+      std::sprintf(
+        buffer,
+        "<?xml version=\"1.0\"?><node id=\"%lu\" key=\"N%lu\""
+        " name=\"Node %lu\" selected=\"1\"/>",
+        static_cast<unsigned long>(i % options.node + 1),
+        static_cast<unsigned long>(i % options.node),
+        static_cast<unsigned long>(i % options.node + 1));
+      put_message(stream.wire, buffer);
+    }
+
+    put_message(stream.wire, stream.message[i]);
+    stream.boundary.push_back(stream.wire.size());
+    stream.bytes += static_cast<double>(stream.message[i].size());
+  }
+
+  return true;
+}
+
+
+/**
+  Sleep until a point on the monotonic clock.
+*/
+void sleep_until(const double &time)
+{
+  const double remaining = time - monotonic_time();
+  if (remaining > 0) {
+#if defined(_WIN32)
+    ::Sleep(static_cast<DWORD>(remaining * 1e3));
+#else
+    ::usleep(static_cast<useconds_t>(remaining * 1e6));
+#endif  // _WIN32
+  }
+}
+
+void close_socket(const socket_type &socket)
+{
+#if defined(_WIN32)
+  ::closesocket(socket);
+#else
+  ::close(socket);
+#endif  // _WIN32
+}
+
+
+/**
+  Fake Motion Service on the loopback interface. Accept one connection at a
+  time, send the service description, wait for one message from the client,
+  and then stream the data messages.
+
+  The Configurable service waits for the XML channel definition before it
+  sends any data. Do the same for every service type so that the client can
+  start its clock just before the stream starts.
+
+  Optionally pace the messages at a fixed rate and split the stream into send
+  calls of random size, including splits inside of the 4 byte length header.
+*/
+class Service {
+public:
+  Service(const Stream &stream, const Options &options, bool forever)
+    : m_stream(stream), m_rate(options.rate), m_fragment(options.fragment),
+      m_forever(forever), m_socket(InvalidSocket), m_port(0), m_random(1),
+      m_thread()
+  {
+  }
+
+  ~Service()
+  {
+    if (InvalidSocket != m_socket) {
+      close_socket(m_socket);
+    }
+  }
+
+  /**
+    Listen on the loopback interface. Port zero picks any free port.
+  */
+  bool listen(const unsigned &port)
+  {
+    m_socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (InvalidSocket == m_socket) {
+      return false;
+    }
+
+    const int option = 1;
+    ::setsockopt(
+      m_socket, SOL_SOCKET, SO_REUSEADDR,
+      reinterpret_cast<const char *>(&option), sizeof(option));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<unsigned short>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if ((0 != ::bind(m_socket, reinterpret_cast<sockaddr *>(&address),
+                     sizeof(address))) ||
+        (0 != ::listen(m_socket, 1))) {
+      return false;
+    }
+
+    socklen_t length = sizeof(address);
+    if (0 != ::getsockname(m_socket, reinterpret_cast<sockaddr *>(&address),
+                           &length)) {
+      return false;
+    }
+    m_port = ntohs(address.sin_port);
+
+    return true;
+  }
+
+  unsigned port() const
+  {
+    return m_port;
+  }
+
+  /** Run the service in a new thread. */
+  bool start()
+  {
+    return m_thread.start(&Service::worker, this);
+  }
+
+  void join()
+  {
+    m_thread.join();
+  }
+
+  /** Serve connections in the current thread. */
+  void run()
+  {
+    do {
+      const socket_type client = ::accept(m_socket, NULL, NULL);
+      if (InvalidSocket == client) {
+        break;
+      }
+
+      // Send small fragments as separate segments.
+      const int option = 1;
+      ::setsockopt(
+        client, IPPROTO_TCP, TCP_NODELAY,
+        reinterpret_cast<const char *>(&option), sizeof(option));
+
+      if (send(client, 0, m_stream.description_size) && receive(client)) {
+        do {
+          if (!stream(client)) {
+            break;
+          }
+        } while (m_forever);
+      }
+
+      // Let the client read everything before we close the connection.
+      ::shutdown(client, SHUT_WR);
+      char buffer[256];
+      while (::recv(client, buffer, sizeof(buffer), 0) > 0) {
+      }
+      close_socket(client);
+    } while (m_forever);
+  }
+
+private:
+  const Stream &m_stream;
+  double m_rate;
+  std::size_t m_fragment;
+  bool m_forever;
+  socket_type m_socket;
+  unsigned m_port;
+  unsigned long m_random;
+  Motion::SDK::detail::thread m_thread;
+
+  /** Send all of the data messages, paced at the stream rate. */
+  bool stream(const socket_type &client)
+  {
+    if (m_rate > 0) {
+      const double start = monotonic_time();
+      std::size_t offset = m_stream.description_size;
+      for (std::size_t i=0; i<m_stream.boundary.size(); ++i) {
+        sleep_until(start + i / m_rate);
+        if (!send(client, offset, m_stream.boundary[i])) {
+          return false;
+        }
+        offset = m_stream.boundary[i];
+      }
+      return true;
+    }
+
+    return send(client, m_stream.description_size, m_stream.wire.size());
+  }
+
+  /** Send the range of the wire stream, split into fragments. */
+  bool send(const socket_type &client, std::size_t first,
+            const std::size_t &last)
+  {
+    while (first < last) {
+      std::size_t size = std::min(last - first, SendSize);
+      if (m_fragment > 0) {
+        // Simple linear congruential generator, the same sequence every run.
+        m_random = (m_random * 1103515245UL + 12345UL) & 0x7fffffffUL;
+        size = std::min(size, 1 + (m_random >> 8) % m_fragment);
+      }
+
+      const int result = static_cast<int>(::send(
+        client, m_stream.wire.data() + first, static_cast<int>(size),
+        MSG_NOSIGNAL));
+      if (result <= 0) {
+#if !defined(_WIN32)
+        if ((result < 0) && (EINTR == errno)) {
+          continue;
+        }
+#endif  // _WIN32
+        return false;
+      }
+
+      first += static_cast<std::size_t>(result);
+    }
+
+    return true;
+  }
+
+  /** Receive one message from the client, and ignore it. */
+  bool receive(const socket_type &client)
+  {
+    std::string data;
+    char buffer[MaxOptionLength];
+    for (;;) {
+      if (data.size() >= 4) {
+        const unsigned char *p =
+          reinterpret_cast<const unsigned char *>(data.data());
+        const std::size_t size =
+          (static_cast<std::size_t>(p[0]) << 24) |
+          (static_cast<std::size_t>(p[1]) << 16) |
+          (static_cast<std::size_t>(p[2]) << 8) |
+          static_cast<std::size_t>(p[3]);
+        if (data.size() >= size + 4) {
+          return true;
+        }
+      }
+
+      const int result =
+        static_cast<int>(::recv(client, buffer, sizeof(buffer), 0));
+      if (result <= 0) {
+        return false;
+      }
+      data.append(buffer, static_cast<std::size_t>(result));
+    }
+  }
+
+  static void worker(void *arg, std::size_t)
+  {
+    static_cast<Service *>(arg)->run();
+  }
+
+  Service(const Service &rhs);
+  const Service &operator=(const Service &lhs);
+}; // class Service
+
+
+/**
+  Benchmark modes. Each benchmark function handles a group of them.
+*/
+enum {
+  ReadData,
+  ReadDataView,
+  ReadBatch,
+  ReadLatest,
+  FormatMap,
+  FormatFrame,
+  FormatDecode,
+  CompactEncode,
+  CompactDecode,
+  AccessArray,
+  AccessVector,
+  FileSensor,
+  FileRaw,
+  BinaryToText,
+  BinaryToColumns
+};
+
+class BatchCounter {
+public:
+  BatchCounter(std::size_t &count, double &bytes)
+    : m_count(count), m_bytes(bytes)
+  {
+  }
+
+  void operator()(const Client::data_view_type &data)
+  {
+    ++m_count;
+    m_bytes += static_cast<double>(data.size());
+  }
+
+private:
+  std::size_t &m_count;
+  double &m_bytes;
+};
+
+/**
+  Stream all of the messages from the fake service to a Client. Count the
+  messages that the client reads. Time from the request message to the end of
+  the stream.
+*/
+Measure bench_client(const Options &options, const Stream &stream,
+                     const int &mode)
+{
+  Measure result;
+
+  Service service(stream, options, false);
+  if (!service.listen(0) || !service.start()) {
+    std::cerr << "failed to start the benchmark service" << std::endl;
+    return result;
+  }
+
+  try {
+    Client client("", service.port());
+
+    const std::string xml = "<?xml version=\"1.0\"?><configurable/>";
+    const Client::data_type request(xml.begin(), xml.end());
+
+    const double start = monotonic_time();
+    if (client.writeData(request)) {
+      Client::data_type data;
+      Client::data_view_type view;
+      std::size_t dropped = 0;
+
+      for (;;) {
+        if (ReadData == mode) {
+          if (!client.readData(data)) {
+            break;
+          }
+          ++result.operations;
+          result.bytes += static_cast<double>(data.size());
+        } else if (ReadDataView == mode) {
+          if (!client.readData(view)) {
+            break;
+          }
+          ++result.operations;
+          result.bytes += static_cast<double>(view.size());
+        } else if (ReadBatch == mode) {
+          if (0 == client.readBatch(
+                BatchCounter(result.operations, result.bytes))) {
+            break;
+          }
+        } else {
+          if (!client.readLatest(view, dropped)) {
+            break;
+          }
+          // Count the skipped messages as handled, the conflation is what we
+          // are measuring.
+          result.operations += 1 + dropped;
+          result.bytes += static_cast<double>(view.size());
+        }
+
+        if (result.operations >= stream.message.size()) {
+          break;
+        }
+      }
+    }
+    result.seconds = monotonic_time() - start;
+    result.valid = (result.operations > 0);
+
+    client.close();
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    result.valid = false;
+  }
+
+  service.join();
+
+  return result;
+}
+
+/**
+  Decode every message with one of the Format interfaces.
+*/
+template <typename Traits>
+Measure bench_format(const Options &options, const Stream &stream,
+                     const int &mode)
+{
+  Measure result;
+
+  typename Traits::frame_type frame;
+  typename Traits::list_type list;
+
+  const double start = monotonic_time();
+  for (std::size_t i=0; i<stream.message.size(); ++i) {
+    const std::string &message = stream.message[i];
+    const char *first = message.data();
+    const char *last = first + message.size();
+
+    std::size_t size = 0;
+    if (FormatMap == mode) {
+      size = Traits::map(first, last).size();
+    } else if (FormatFrame == mode) {
+      if (Traits::frame(first, last, frame)) {
+        size = frame.size();
+      }
+    } else {
+      if (Traits::decode(first, last, list, options.channel)) {
+        size = list.size();
+      }
+    }
+
+    if (0 == size) {
+      std::cerr << "failed to decode message " << i << std::endl;
+      return result;
+    }
+
+    Sink = Sink + static_cast<double>(size);
+    result.bytes += static_cast<double>(message.size());
+  }
+  result.seconds = monotonic_time() - start;
+  result.operations = stream.message.size();
+  result.valid = true;
+
+  return result;
+}
+
+/**
+  Encode every Preview message in the compact encoding, or decode it back into
+  a flat frame. Encode the messages up front for the decode, only time the
+  decode. Count the compact bytes.
+*/
+Measure bench_compact(const Options &options, const Stream &stream,
+                      const int &mode)
+{
+  Measure result;
+  if ("preview" != options.service) {
+    result.skip = true;
+    return result;
+  }
+
+  using Motion::SDK::CompactPreview;
+
+  CompactPreview::Encoder encoder;
+  CompactPreview decoder;
+
+  CompactPreview::data_type compact;
+  std::vector<CompactPreview::data_type> list;
+  if (CompactDecode == mode) {
+    list.resize(stream.message.size());
+    for (std::size_t i=0; i<stream.message.size(); ++i) {
+      const std::string &message = stream.message[i];
+      if (!encoder.encode(message.begin(), message.end(), list[i])) {
+        std::cerr << "failed to encode message " << i << std::endl;
+        return result;
+      }
+    }
+  }
+
+  Format::PreviewFrame frame;
+
+  const double start = monotonic_time();
+  for (std::size_t i=0; i<stream.message.size(); ++i) {
+    std::size_t size = 0;
+    if (CompactEncode == mode) {
+      const std::string &message = stream.message[i];
+      if (encoder.encode(message.begin(), message.end(), compact)) {
+        size = compact.size();
+      }
+    } else if (decoder.decode(list[i].begin(), list[i].end(), frame)) {
+      size = list[i].size();
+    }
+
+    if (0 == size) {
+      std::cerr << "failed to process message " << i << std::endl;
+      return result;
+    }
+
+    Sink = Sink + static_cast<double>(frame.size());
+    result.bytes += static_cast<double>(size);
+  }
+  result.seconds = monotonic_time() - start;
+  result.operations = stream.message.size();
+  result.valid = true;
+
+  return result;
+}
+
+/**
+  Read one channel of every element of every message through the element
+  accessors. Decode the messages up front, only time the accessors.
+*/
+template <typename Traits>
+Measure bench_access(const Options &, const Stream &stream, const int &mode)
+{
+  typedef typename Traits::map_type map_type;
+
+  Measure result;
+
+  // Decode a bounded number of distinct messages and cycle through them.
+  std::vector<map_type> list;
+  for (std::size_t i=0; (i<stream.message.size()) && (i<256); ++i) {
+    const std::string &message = stream.message[i];
+    list.push_back(
+      Traits::map(message.data(), message.data() + message.size()));
+  }
+
+  double sum = 0;
+  const double start = monotonic_time();
+  for (std::size_t i=0; i<stream.message.size(); ++i) {
+    const map_type &map = list[i % list.size()];
+    for (typename map_type::const_iterator itr=map.begin(); itr!=map.end();
+         ++itr) {
+      if (AccessArray == mode) {
+        sum += Traits::access(itr->second);
+      } else {
+        sum += Traits::access_vector(itr->second);
+      }
+    }
+    result.operations += map.size();
+  }
+  result.seconds = monotonic_time() - start;
+  result.valid = (result.operations > 0);
+
+  Sink = Sink + sum;
+
+  return result;
+}
+
+/**
+  Write a take file of samples in the Sensor or Raw format. One sample per
+  node per message.
+*/
+bool write_take(const Options &options, bool raw)
+{
+  std::ofstream output(TakeFile.c_str(), std::ios_base::binary);
+  if (!output.is_open()) {
+    std::cerr
+      << "failed to open take file, \"" << TakeFile << "\"" << std::endl;
+    return false;
+  }
+
+  std::string buffer;
+  for (std::size_t i=0; i<options.message; ++i) {
+    for (std::size_t node=0; node<options.node; ++node) {
+      for (std::size_t j=0; j<FileChannel; ++j) {
+        // Keep every channel non-zero, binary_to_text takes a zero in the
+        // tenth channel of the first sample as a temperature channel.
+        const float value = 1.5f + synthetic(i, node, j);
+        if (raw) {
+          put_value(buffer, static_cast<short>(1024 * value));
+        } else {
+          put_value(buffer, value);
+        }
+      }
+    }
+
+    if (buffer.size() >= SendSize) {
+      output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      buffer.clear();
+    }
+  }
+  output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+  return output.good();
+}
+
+template <typename T>
+Measure read_take()
+{
+  Measure result;
+
+  const double start = monotonic_time();
+  File file(TakeFile);
+  std::vector<T> data(FileChannel);
+  while (file.readData(data)) {
+    ++result.operations;
+    Sink = Sink + static_cast<double>(data[0]);
+  }
+  result.seconds = monotonic_time() - start;
+  result.bytes =
+    static_cast<double>(result.operations * FileChannel * sizeof(T));
+  result.valid = (result.operations > 0);
+
+  return result;
+}
+
+/**
+  Read a take file one sample at a time with File::readData.
+*/
+Measure bench_file(const Options &options, const Stream &, const int &mode)
+{
+  const bool raw = (FileRaw == mode);
+  if (!write_take(options, raw)) {
+    return Measure();
+  }
+
+  Measure result;
+  try {
+    if (raw) {
+      result = read_take<short>();
+    } else {
+      result = read_take<float>();
+    }
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+  }
+
+  std::remove(TakeFile.c_str());
+
+  return result;
+}
+
+/**
+  Convert a Sensor take file with the binary_to_text program. Includes the
+  process start up time, use a large number of messages.
+*/
+Measure bench_binary_to_text(const Options &options, const Stream &,
+                             const int &mode)
+{
+  Measure result;
+
+  {
+    std::ifstream program(options.binary_to_text.c_str());
+    if (!program.is_open()) {
+      std::cerr
+        << "skip binary_to_text, program not found \""
+        << options.binary_to_text << "\"" << std::endl;
+      result.skip = true;
+      return result;
+    }
+  }
+
+  if (!write_take(options, false)) {
+    return result;
+  }
+
+  std::string command = "\"" + options.binary_to_text + "\" ";
+  if (BinaryToColumns == mode) {
+    command += "--columnar ";
+  } else {
+    command += "--file " + TextFile + " ";
+  }
+  command += TakeFile;
+
+  const double start = monotonic_time();
+  const int status = std::system(command.c_str());
+  result.seconds = monotonic_time() - start;
+
+  if (0 == status) {
+    result.operations = options.message * options.node;
+    result.bytes =
+      static_cast<double>(result.operations * FileChannel * sizeof(float));
+    result.valid = true;
+  } else {
+    std::cerr << "failed to run \"" << command << "\"" << std::endl;
+  }
+
+  std::remove(TakeFile.c_str());
+  std::remove(TextFile.c_str());
+  std::remove(ColumnFile.c_str());
+
+  return result;
+}
+
+
+typedef Measure (*benchmark_type)(const Options &, const Stream &,
+                                  const int &);
+
+void print_header(std::ostream &out)
+{
+  out
+    << "name,service,node,channel,message,rate,xml,fragment,"
+    << "operations,bytes,seconds,nanoseconds_per_operation,"
+    << "operations_per_second,megabytes_per_second" << std::endl;
+}
+
+/**
+  Run a benchmark <tt>options.repeat</tt> times and print one CSV row for the
+  fastest run.
+
+  @return  false if the benchmark failed
+*/
+bool run(const Options &options, const Stream &stream, std::ostream &out,
+         const std::string &name, benchmark_type fn, const int &mode)
+{
+  if (0 != name.compare(0, options.filter.size(), options.filter)) {
+    return true;
+  }
+
+  Measure best;
+  for (std::size_t i=0; i<options.repeat; ++i) {
+    const Measure measure = fn(options, stream, mode);
+    if (measure.skip) {
+      return true;
+    } else if (!measure.valid) {
+      return false;
+    }
+
+    if (!best.valid || (measure.seconds < best.seconds)) {
+      best = measure;
+    }
+  }
+
+  const double seconds = std::max(best.seconds, 1e-9);
+  const double operations = static_cast<double>(best.operations);
+
+  out
+    << name << "," << options.service << ","
+    << options.node << "," << options.channel << ","
+    << options.message << "," << options.rate << ","
+    << options.xml << "," << options.fragment << ","
+    << best.operations << "," << std::setprecision(12) << best.bytes << ","
+    << std::setprecision(6) << best.seconds << ","
+    << (1e9 * seconds / std::max(operations, 1.0)) << ","
+    << (operations / seconds) << ","
+    << (best.bytes / seconds / 1e6) << std::endl;
+
+  return true;
+}
+
+template <typename Traits>
+bool run_all(const Options &options, std::ostream &out)
+{
+  Stream stream;
+  if (!make_stream<Traits>(options, stream)) {
+    return false;
+  }
+
+  if (0 != options.serve) {
+    Service service(stream, options, true);
+    if (!service.listen(options.serve)) {
+      std::cerr
+        << "failed to listen on port " << options.serve << std::endl;
+      return false;
+    }
+
+    std::cerr
+      << "serving " << options.service << " on 127.0.0.1:"
+      << service.port() << std::endl;
+    service.run();
+    return true;
+  }
+
+  bool result = true;
+
+  result &= run(options, stream, out, "client_readData",
+                &bench_client, ReadData);
+  result &= run(options, stream, out, "client_readData_view",
+                &bench_client, ReadDataView);
+  result &= run(options, stream, out, "client_readBatch",
+                &bench_client, ReadBatch);
+  result &= run(options, stream, out, "client_readLatest",
+                &bench_client, ReadLatest);
+
+  result &= run(options, stream, out, "format_map",
+                &bench_format<Traits>, FormatMap);
+  result &= run(options, stream, out, "format_frame",
+                &bench_format<Traits>, FormatFrame);
+  result &= run(options, stream, out, "format_decode",
+                &bench_format<Traits>, FormatDecode);
+  result &= run(options, stream, out, "compact_encode",
+                &bench_compact, CompactEncode);
+  result &= run(options, stream, out, "compact_decode",
+                &bench_compact, CompactDecode);
+
+  result &= run(options, stream, out, "element_access",
+                &bench_access<Traits>, AccessArray);
+  result &= run(options, stream, out, "element_access_vector",
+                &bench_access<Traits>, AccessVector);
+
+  result &= run(options, stream, out, "file_readData_sensor",
+                &bench_file, FileSensor);
+  result &= run(options, stream, out, "file_readData_raw",
+                &bench_file, FileRaw);
+
+  result &= run(options, stream, out, "binary_to_text",
+                &bench_binary_to_text, BinaryToText);
+  result &= run(options, stream, out, "binary_to_text_columnar",
+                &bench_binary_to_text, BinaryToColumns);
+
+  return result;
+}
+
+
+/**
+  @return  true iff the option name is one of the options with an argument
+*/
+bool takes_argument(const std::string &option)
+{
+  const char *Name[] = {
+    "binary", "b", "channel", "c", "file", "f", "message", "m", "node", "n",
+    "repeat", "r", "service", "s", "filter", "fragment", "rate", "replay",
+    "serve", "xml"
+  };
+  const std::size_t Size = sizeof(Name) / sizeof(Name[0]);
+
+  return std::find(Name, Name + Size, option) != Name + Size;
+}
+
+void print_usage(const std::string &name, std::ostream &out)
+{
+  out
+    << "Usage: " << name << " [OPTION]..." << std::endl
+    << "Benchmark the Motion SDK receive, decode, and file reading paths. Stream synthetic" << std::endl
+    << "or recorded messages from a fake Motion Service on the loopback interface. Print" << std::endl
+    << "one CSV row per benchmark, the fastest of the repeated runs." << std::endl
+    << std::endl
+    << "Options" << std::endl
+    << "-a, --append              append to the output file, do not print the CSV header" << std::endl
+    << "-b, --binary PATH         binary_to_text program, default is " << Options().binary_to_text << std::endl
+    << "-c, --channel N           channels per node for the configurable service, default is 8" << std::endl
+    << "-f, --file FILENAME       output results to a file, default is standard output" << std::endl
+    << "-h, --help                prints this message" << std::endl
+    << "-m, --message N           number of data messages per run, default is 20000" << std::endl
+    << "-n, --node N              number of nodes per message, default is 16" << std::endl
+    << "-r, --repeat N            number of runs of each benchmark, default is 3" << std::endl
+    << "-s, --service NAME        preview, sensor, raw, or configurable, default is preview" << std::endl
+    << "--filter PREFIX           only run the benchmarks whose name starts with PREFIX" << std::endl
+    << "--fragment N              split the stream into sends of 1 to N bytes" << std::endl
+    << "--rate HZ                 send messages at a fixed rate, default is as fast as possible" << std::endl
+    << "--replay FILENAME         send the data messages from a recording instead of synthetic ones" << std::endl
+    << "--serve PORT              only run the fake service, stream the messages in a loop" << std::endl
+    << "--xml N                   send an XML message before every Nth data message" << std::endl
+    << std::endl;
+}
+
+// Entry point. Parse arguments and run the benchmarks for the selected
+// service type.
+int main(int argc, char **argv)
+{
+  // Initialize all options.
+  std::string name;
+  if (argc > 0) {
+    name.assign(argv[0]);
+  }
+
+  Options options;
+
+#if defined(_WIN32)
+  // The fake service may start before any Client initializes Winsock.
+  WSADATA wsaData;
+  if (0 != WSAStartup(MAKEWORD(1, 1), &wsaData)) {
+    std::cerr << "failed to initialize Winsock" << std::endl;
+    return 1;
+  }
+#endif  // _WIN32
+
+  // Parse command line options. Override the defaults we
+  // just set above.
+  bool valid_command_line = true;
+  for (int i=1; i<argc; i++) {
+    const std::size_t length = strlen(argv[i]);
+
+    // Look for an option of the form:
+    // /option, --option, -option, or -o
+    if ((length > 1) && (('-' == *argv[i]) || ('/' == *argv[i]))) {
+      std::string option(argv[i] + 1, length-1);
+      std::transform(
+        option.begin(), option.end(),
+        option.begin(),
+        tolower);
+
+      // Remove a leading '-' character if it exists.
+      if (!option.empty() && ('-' == option[0])) {
+        option = option.substr(1);
+      }
+
+      // Flags without an argument.
+      if ("append" == option || "a" == option) {
+        options.append = true;
+        continue;
+      } else if ("help" == option || "h" == option) {
+        valid_command_line = false;
+        continue;
+      } else if (!takes_argument(option)) {
+        std::cerr
+          << "unknown option: " << std::string(argv[i], length) << std::endl;
+        valid_command_line = false;
+        continue;
+      }
+
+      if (argc <= i + 1) {
+        std::cerr
+          << "invalid option, missing argument: " << std::string(argv[i], length) << std::endl;
+        valid_command_line = false;
+        break;
+      }
+
+      i++;
+      const std::string value(argv[i]);
+      const unsigned long number = strtoul(argv[i], NULL, 10);
+
+      // Do the actual option handling and assign
+      // local values.
+      if ("binary" == option || "b" == option) {
+        options.binary_to_text = value;
+      } else if ("channel" == option || "c" == option) {
+        options.channel = number;
+      } else if ("file" == option || "f" == option) {
+        options.output = value;
+      } else if ("message" == option || "m" == option) {
+        options.message = number;
+      } else if ("node" == option || "n" == option) {
+        options.node = number;
+      } else if ("repeat" == option || "r" == option) {
+        options.repeat = number;
+      } else if ("service" == option || "s" == option) {
+        options.service = value;
+      } else if ("filter" == option) {
+        options.filter = value;
+      } else if ("fragment" == option) {
+        options.fragment = number;
+      } else if ("rate" == option) {
+        options.rate = atof(argv[i]);
+      } else if ("replay" == option) {
+        options.replay = value;
+      } else if ("serve" == option) {
+        options.serve = static_cast<unsigned>(number);
+      } else if ("xml" == option) {
+        options.xml = number;
+      }
+
+    } else if (length > 0) {
+      std::cerr
+        << "unknown argument: " << std::string(argv[i], length) << std::endl;
+      valid_command_line = false;
+    }
+  }
+
+  if ((0 == options.node) || (0 == options.channel) ||
+      (0 == options.message) || (0 == options.repeat)) {
+    std::cerr
+      << "invalid option, counts must be greater than zero" << std::endl;
+    valid_command_line = false;
+  }
+
+  if (!valid_command_line) {
+    print_usage(name, std::cerr);
+    return 1;
+  }
+
+  std::ofstream *fout = NULL;
+  if (0 != options.serve) {
+    // No benchmark results.
+  } else if (!options.output.empty()) {
+    bool header = true;
+    if (options.append) {
+      std::ifstream input(options.output.c_str());
+      header = !input.is_open() ||
+        (std::ifstream::traits_type::eof() == input.peek());
+    }
+
+    fout = new std::ofstream(
+      options.output.c_str(),
+      options.append ? (std::ios_base::out | std::ios_base::app) :
+      std::ios_base::out);
+    if (!fout->is_open()) {
+      delete fout;
+      std::cerr
+        << "failed to open output file, \"" << options.output << "\""
+        << std::endl;
+      return 1;
+    }
+
+    if (header) {
+      print_header(*fout);
+    }
+  } else if (!options.append) {
+    print_header(std::cout);
+  }
+
+  std::ostream &out = (NULL != fout) ? *fout : std::cout;
+
+  bool result = false;
+  if ("preview" == options.service) {
+    result = run_all<PreviewTraits>(options, out);
+  } else if ("sensor" == options.service) {
+    result = run_all<SensorTraits>(options, out);
+  } else if ("raw" == options.service) {
+    result = run_all<RawTraits>(options, out);
+  } else if ("configurable" == options.service) {
+    result = run_all<ConfigurableTraits>(options, out);
+  } else {
+    std::cerr
+      << "unknown service type: " << options.service << std::endl;
+  }
+
+  if (NULL != fout) {
+    fout->close();
+    delete fout;
+    fout = NULL;
+  }
+
+  return result ? 0 : 1;
+}
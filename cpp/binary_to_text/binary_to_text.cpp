@@ -32,12 +32,16 @@
   ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
   POSSIBILITY OF SUCH DAMAGE.
 */
-#include <File.hpp>
 #include <Format.hpp>
+#include <MappedFile.hpp>
+#include <detail/thread.hpp>
 
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
-#include <iterator>
 #include <stdexcept>
 
 #include <cstring>
@@ -53,127 +57,876 @@ const std::string ChannelName[MaxChannel] = {
   "temp"
 };
 
+// Number of samples formatted as one unit of work.
+const std::size_t ChunkFrames = 16384;
+
+// Number of chunks per thread that may be formatted ahead of the writer.
+const std::size_t ChunksAhead = 4;
+
+/**
+  Format a float exactly like the default std::ostream settings, "%g" with six
+  significant digits. Scale the value to a six digit integer with double
+  arithmetic, which is far more accurate than we need. Fall back to sprintf
+  for values close to a rounding tie and for zero, infinity, and NaN.
+
+  @return number of characters written to the result buffer, at most 16
+*/
+std::size_t format_float(const float &value, char *result)
+{
+  static const double Power[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  const int MaxPower = 22;
+
+  const double x = value;
+  if ((0 == x) || (x != x) || (0 != x - x)) {
+    return static_cast<std::size_t>(std::sprintf(result, "%g", x));
+  }
+
+  const double magnitude = (x < 0) ? -x : x;
+  int exponent = static_cast<int>(std::floor(std::log10(magnitude)));
+
+  // Six significant digits, scaled = magnitude * 10^(5 - exponent).
+  double scaled = 0;
+  for (int i=0; i<2; ++i) {
+    scaled = magnitude;
+    int power = 5 - exponent;
+    if (power >= 0) {
+      for (; power > MaxPower; power -= MaxPower) {
+        scaled *= Power[MaxPower];
+      }
+      scaled *= Power[power];
+    } else {
+      for (power = -power; power > MaxPower; power -= MaxPower) {
+        scaled /= Power[MaxPower];
+      }
+      scaled /= Power[power];
+    }
+
+    // The log10 estimate of the decimal exponent can be off by one.
+    if (scaled < 1e5) {
+      --exponent;
+    } else if (scaled >= 1e6) {
+      ++exponent;
+    } else {
+      break;
+    }
+  }
+
+  const double whole = std::floor(scaled);
+  const double fraction = scaled - whole;
+  if ((scaled < 1e5) || (scaled >= 1e6) ||
+      (std::fabs(fraction - 0.5) < 1e-6)) {
+    return static_cast<std::size_t>(std::sprintf(result, "%g", x));
+  }
+
+  unsigned long digits = static_cast<unsigned long>(whole);
+  if (fraction > 0.5) {
+    if (++digits == 1000000) {
+      digits = 100000;
+      ++exponent;
+    }
+  }
+
+  char digit[6];
+  for (int i=5; i>=0; --i) {
+    digit[i] = static_cast<char>('0' + digits % 10);
+    digits /= 10;
+  }
+
+  char *p = result;
+  if (x < 0) {
+    *p++ = '-';
+  }
+
+  if ((exponent < -4) || (exponent >= 6)) {
+    // Style e, one digit before the decimal point.
+    int last = 5;
+    while ((last > 0) && ('0' == digit[last])) {
+      --last;
+    }
+
+    *p++ = digit[0];
+    if (last > 0) {
+      *p++ = '.';
+      for (int i=1; i<=last; ++i) {
+        *p++ = digit[i];
+      }
+    }
+
+    *p++ = 'e';
+    *p++ = (exponent < 0) ? '-' : '+';
+    const int e = (exponent < 0) ? -exponent : exponent;
+    if (e >= 100) {
+      *p++ = static_cast<char>('0' + e / 100);
+    }
+    *p++ = static_cast<char>('0' + (e / 10) % 10);
+    *p++ = static_cast<char>('0' + e % 10);
+  } else {
+    // Style f, strip the trailing zeros of the fractional part.
+    int last = 5;
+    while ((last > exponent) && ('0' == digit[last])) {
+      --last;
+    }
+
+    if (exponent >= 0) {
+      for (int i=0; i<=exponent; ++i) {
+        *p++ = digit[i];
+      }
+      if (last > exponent) {
+        *p++ = '.';
+        for (int i=exponent+1; i<=last; ++i) {
+          *p++ = digit[i];
+        }
+      }
+    } else {
+      *p++ = '0';
+      *p++ = '.';
+      for (int i=exponent+1; i<0; ++i) {
+        *p++ = '0';
+      }
+      for (int i=0; i<=last; ++i) {
+        *p++ = digit[i];
+      }
+    }
+  }
+
+  return static_cast<std::size_t>(p - result);
+}
+
+void append_value(std::string &out, const std::string &value)
+{
+  out.append(value);
+}
+
+void append_value(std::string &out, const float &value)
+{
+  char buffer[32];
+  out.append(buffer, format_float(value, buffer));
+}
+
+void append_value(std::string &out, const short &value)
+{
+  char buffer[8];
+  char *p = buffer + sizeof(buffer);
+
+  int n = value;
+  const bool negative = n < 0;
+  if (negative) {
+    n = -n;
+  }
+
+  do {
+    *--p = static_cast<char>('0' + n % 10);
+    n /= 10;
+  } while (n > 0);
+
+  if (negative) {
+    *--p = '-';
+  }
+
+  out.append(p, buffer + sizeof(buffer));
+}
+
+/**
+  Append one line of text. Same layout as the std::ostream version that this
+  replaced, including the trailing separator in the accelerometer only mode.
+*/
 template <typename T>
-void print_fields(std::ostream &out,
-                  const T &data,
-                  const std::size_t &data_size,
-                  const std::string &separator,
-                  bool is_accel)
+void append_fields(std::string &out,
+                   const T *data,
+                   const std::size_t &data_size,
+                   const std::string &separator,
+                   bool is_accel)
 {
   if ((data_size >= MinChannel) && (data_size <= MaxChannel)) {
     for (std::size_t i=0; i<data_size; ++i) {
       if (!is_accel || (i < 3) || (i >= 9)) {
-        out
-          << data[i];
+        append_value(out, data[i]);
         if (i < data_size - 1) {
-          out << separator;
+          out.append(separator);
         }
       }
     }
 
-    out << std::endl;
+    out.push_back('\n');
   }
 }
 
-void print_header(std::ostream &out,
-                  const std::size_t &data_size,
-                  const std::string &separator,
-                  bool is_accel)
+/**
+  Columnar output, one file per input. Channel major, all values are stored in
+  little-endian byte order.
+
+  Header, 32 bytes
+     0  char[4]  magic, "MCOL"
+     4  uint32   version, 1
+     8  uint32   element type, 1 = float32, 2 = int16
+    12  uint32   number of channels
+    16  uint32   number of frames
+    20  float32  sample rate in Hz, 0 if unknown
+    24  uint32   node id, 0 if unknown
+    28  uint32   reserved, 0
+
+  Followed by a 48 byte entry for each channel
+     0  char[16] channel name, NUL padded
+    16  uint32   encoding, 0 = none, 1 = delta
+    20  uint32   reserved, 0
+    24  uint64   offset of the column data from the start of the file
+    32  uint64   size of the column data in bytes
+    40  uint64   reserved, 0
+
+  The column data starts on a 64 byte boundary. A column with no encoding is a
+  plain array of values that can be mapped and read directly.
+
+  Delta encoding
+    int16    Difference from the previous value, the first value is relative
+             to zero. Zigzag and LEB128 variable length integer.
+    float32  Bits XOR the previous value, the first value is relative to zero.
+             Pairs of values share a control byte. The low nibble is the number
+             of bytes of the first value, the high nibble of the second. Then
+             the low order bytes of the first and second value.
+*/
+const char ColumnMagic[4] = { 'M', 'C', 'O', 'L' };
+const std::size_t ColumnVersion = 1;
+const std::size_t ColumnHeaderSize = 32;
+const std::size_t ColumnEntrySize = 48;
+const std::size_t ColumnNameSize = 16;
+const std::size_t ColumnAlignment = 64;
+const std::size_t ColumnBufferSize = 1 << 20;
+
+enum {
+  ColumnFloat32 = 1,
+  ColumnInt16 = 2
+};
+
+enum {
+  ColumnNone = 0,
+  ColumnDelta = 1
+};
+
+std::size_t column_type(const float &)
 {
-  print_fields(out, ChannelName, data_size, separator, is_accel);
+  return ColumnFloat32;
 }
 
-template <typename T>
-void print_container(std::ostream &out,
-                     const T &data,
-                     const std::string &separator,
-                     bool is_accel)
+std::size_t column_type(const short &)
 {
-  print_fields(out, data, data.size(), separator, is_accel);
+  return ColumnInt16;
 }
 
-template <typename ElementT>
-bool binary_to_text(const std::string &pathname,
-                    std::ostream &out,
-                    bool show_channel_names,
-                    const std::string & separator)
+void put_u8(std::string &out, const unsigned &value)
 {
-  bool result = true;
+  out.push_back(static_cast<char>(value & 0xff));
+}
+
+void put_u32(std::string &out, const unsigned long &value)
+{
+  for (int i=0; i<4; ++i) {
+    put_u8(out, static_cast<unsigned>(value >> (8 * i)));
+  }
+}
+
+void put_u64(std::string &out, const std::streamoff &value)
+{
+  put_u32(out, static_cast<unsigned long>(value & 0xffffffff));
+  put_u32(out, static_cast<unsigned long>(((value >> 16) >> 16) & 0xffffffff));
+}
+
+unsigned int float_bits(const float &value)
+{
+  unsigned int result = 0;
+  std::memcpy(&result, &value, sizeof(result));
+  return result;
+}
+
+void put_value(std::string &out, const float &value)
+{
+  put_u32(out, float_bits(value));
+}
+
+void put_value(std::string &out, const short &value)
+{
+  const unsigned bits = static_cast<unsigned short>(value);
+  put_u8(out, bits);
+  put_u8(out, bits >> 8);
+}
+
+void flush_column(std::ostream &out, std::string &buffer, bool force)
+{
+  if (force || (buffer.size() >= ColumnBufferSize)) {
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+  }
+}
+
+void encode_column(std::ostream &out,
+                   const Motion::SDK::FrameSpan<short> &frames,
+                   const std::size_t &channel)
+{
+  std::string buffer;
+  buffer.reserve(ColumnBufferSize + 16);
+
+  int previous = 0;
+  for (std::size_t i=0; i<frames.size(); ++i) {
+    const int value = frames[i][channel];
+    const int delta = value - previous;
+    previous = value;
+
+    unsigned long zigzag = (delta < 0) ?
+      (static_cast<unsigned long>(-(delta + 1)) << 1) | 1 :
+      static_cast<unsigned long>(delta) << 1;
+    while (zigzag >= 0x80) {
+      put_u8(buffer, static_cast<unsigned>(zigzag | 0x80));
+      zigzag >>= 7;
+    }
+    put_u8(buffer, static_cast<unsigned>(zigzag));
+
+    flush_column(out, buffer, false);
+  }
+
+  flush_column(out, buffer, true);
+}
+
+void encode_column(std::ostream &out,
+                   const Motion::SDK::FrameSpan<float> &frames,
+                   const std::size_t &channel)
+{
+  std::string buffer;
+  buffer.reserve(ColumnBufferSize + 16);
+
+  unsigned int previous = 0;
+  for (std::size_t i=0; i<frames.size(); i+=2) {
+    unsigned int value[2] = { 0, 0 };
+    unsigned length[2] = { 0, 0 };
+    for (std::size_t j=0; (j<2) && (i+j<frames.size()); ++j) {
+      const unsigned int bits = float_bits(frames[i+j][channel]);
+      value[j] = bits ^ previous;
+      previous = bits;
+
+      for (unsigned int x=value[j]; x > 0; x >>= 8) {
+        ++length[j];
+      }
+    }
+
+    put_u8(buffer, length[0] | (length[1] << 4));
+    for (std::size_t j=0; j<2; ++j) {
+      for (unsigned k=0; k<length[j]; ++k) {
+        put_u8(buffer, value[j] >> (8 * k));
+      }
+    }
+
+    flush_column(out, buffer, false);
+  }
+
+  flush_column(out, buffer, true);
+}
+
+template <typename T>
+void write_column(std::ostream &out,
+                  const Motion::SDK::FrameSpan<T> &frames,
+                  const std::size_t &channel)
+{
+  std::string buffer;
+  buffer.reserve(ColumnBufferSize + 16);
+
+  for (std::size_t i=0; i<frames.size(); ++i) {
+    put_value(buffer, frames[i][channel]);
+    flush_column(out, buffer, false);
+  }
+
+  flush_column(out, buffer, true);
+}
+
+
+/**
+  One input file. Map it and detect the sample layout up front so that the
+  samples can be split into chunks that are formatted independently.
+*/
+class Input {
+public:
+  Input(const std::string &pathname_in)
+    : pathname(pathname_in), file(NULL), error(), stride(0), frame_count(0),
+      is_accel(false), first_chunk(0), chunk_count(0)
+  {
+  }
+
+  ~Input()
+  {
+    delete file;
+  }
+
+  template <typename ElementT>
+  void open(bool show_channel_names, const std::string &separator)
+  {
+    typedef typename ElementT::data_type::value_type value_type;
+
+    try {
+      file = new Motion::SDK::MappedFile(pathname);
+    } catch (std::runtime_error &e) {
+      error.assign(e.what());
+      return;
+    }
+
+    // Look at the first sample and one more element. Same rules as the
+    // original streaming converter.
+    Motion::SDK::FrameSpan<value_type> all =
+      file->getFrames<value_type>(ElementT::Length + 1);
+    if (all.empty()) {
+      return;
+    }
+
+    const value_type *data = all[0];
+
+    // Detect MotionNode Accel data streams.
+    is_accel = ElementT::Length > 3;
+    for (std::size_t i=3; i<ElementT::Length; ++i) {
+      if (0 != data[i]) {
+        is_accel = false;
+        break;
+      }
+    }
+
+    // A zero in the extra element means there is a temperature channel.
+    if (0 == data[ElementT::Length]) {
+      stride = ElementT::Length + 1;
+    } else {
+      stride = ElementT::Length;
+    }
+
+    frame_count = file->getFrames<value_type>(stride).size();
+    chunk_count = (frame_count + ChunkFrames - 1) / ChunkFrames;
+
+    if (show_channel_names) {
+      append_fields(header, ChannelName, stride, separator, is_accel);
+    }
+  }
+
+  template <typename ElementT>
+  void format(std::string &out, const std::size_t &chunk,
+              const std::string &separator) const
+  {
+    typedef typename ElementT::data_type::value_type value_type;
+
+    Motion::SDK::FrameSpan<value_type> block =
+      file->getFrames<value_type>(stride).block(
+        chunk * ChunkFrames, ChunkFrames);
+
+    if (0 == chunk) {
+      out.append(header);
+    }
 
-  try {
-    using Motion::SDK::File;
+    out.reserve(out.size() + block.size() * stride * 12);
+    for (std::size_t i=0; i<block.size(); ++i) {
+      append_fields(out, block[i], stride, separator, is_accel);
+    }
+  }
+
+  /**
+    Write all of the channels of this input to a columnar file. Write the
+    header last, once we know where each column starts.
+
+    @return  false if the output stream failed
+  */
+  template <typename ElementT>
+  bool write_columns(std::ostream &out, bool delta, const float &rate,
+                     const unsigned long &node) const
+  {
+    typedef typename ElementT::data_type::value_type value_type;
+
+    Motion::SDK::FrameSpan<value_type> frames;
+    if (stride > 0) {
+      frames = file->getFrames<value_type>(stride);
+    }
+
+    // Same channel selection as the text output.
+    std::vector<std::size_t> channel;
+    for (std::size_t i=0; i<stride; ++i) {
+      if (!is_accel || (i < 3) || (i >= 9)) {
+        channel.push_back(i);
+      }
+    }
+
+    const std::streamoff start = out.tellp();
+    const std::size_t header_size =
+      ColumnHeaderSize + channel.size() * ColumnEntrySize;
+    out.write(
+      std::string(header_size, '\0').data(),
+      static_cast<std::streamsize>(header_size));
+
+    std::vector<std::streamoff> offset(channel.size());
+    std::vector<std::streamoff> size(channel.size());
+    for (std::size_t i=0; i<channel.size(); ++i) {
+      const std::streamoff position = out.tellp() - start;
+      const std::size_t padding = static_cast<std::size_t>(
+        (ColumnAlignment - position % ColumnAlignment) % ColumnAlignment);
+      out.write(
+        std::string(padding, '\0').data(),
+        static_cast<std::streamsize>(padding));
+
+      offset[i] = out.tellp() - start;
+      if (delta) {
+        encode_column(out, frames, channel[i]);
+      } else {
+        write_column(out, frames, channel[i]);
+      }
+      size[i] = out.tellp() - start - offset[i];
+    }
+
+    std::string header(ColumnMagic, sizeof(ColumnMagic));
+    put_u32(header, ColumnVersion);
+    put_u32(header, column_type(value_type()));
+    put_u32(header, channel.size());
+    put_u32(header, frames.size());
+    put_u32(header, float_bits(rate));
+    put_u32(header, node);
+    put_u32(header, 0);
+
+    for (std::size_t i=0; i<channel.size(); ++i) {
+      std::string name = ChannelName[channel[i]];
+      name.resize(ColumnNameSize, '\0');
+
+      header.append(name);
+      put_u32(header, delta ? ColumnDelta : ColumnNone);
+      put_u32(header, 0);
+      put_u64(header, offset[i]);
+      put_u64(header, size[i]);
+      put_u64(header, 0);
+    }
+
+    out.seekp(start);
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.seekp(0, std::ios_base::end);
+
+    return out.good();
+  }
+
+  std::string pathname;
+  Motion::SDK::MappedFile *file;
+  std::string error;
+  std::string header;
+  std::size_t stride;
+  std::size_t frame_count;
+  bool is_accel;
+  std::size_t first_chunk;
+  std::size_t chunk_count;
+
+private:
+  Input(const Input &rhs);
+  const Input &operator=(const Input &lhs);
+}; // class Input
+
+/**
+  Format all of the chunks of all of the input files on a pool of worker
+  threads. The main thread writes the formatted text in order. Workers may run
+  a fixed number of chunks ahead of the writer, across input file boundaries,
+  which bounds the memory use.
+*/
+class Converter {
+public:
+  Converter(bool raw_format, const std::string &separator,
+            const std::size_t &thread_count)
+    : m_raw_format(raw_format), m_separator(separator), m_input(),
+      m_chunk(), m_text(), m_done(), m_next(0), m_written(0),
+      m_ahead(ChunksAhead * thread_count), m_mutex(), m_condition()
+  {
+  }
+
+  ~Converter()
+  {
+    for (std::size_t i=0; i<m_input.size(); ++i) {
+      delete m_input[i];
+    }
+  }
+
+  void add(const std::string &pathname, bool show_channel_names)
+  {
     using Motion::SDK::Format;
 
-    File file(pathname);
+    Input *input = new Input(pathname);
+    m_input.push_back(input);
 
-    typename ElementT::data_type data(ElementT::Length + 1);
-    if (file.readData(data)) {
-      // Detect MotionNode Accel data streams.
-      bool is_accel = ElementT::Length > 3;
-      for (std::size_t i=3; i<ElementT::Length; ++i) {
-        if (0 != data[i]) {
-          is_accel = false;
-          break;
-        }
+    if (m_raw_format) {
+      input->open<Format::RawElement>(show_channel_names, m_separator);
+    } else {
+      input->open<Format::SensorElement>(show_channel_names, m_separator);
+    }
+
+    input->first_chunk = m_chunk.size();
+    for (std::size_t i=0; i<input->chunk_count; ++i) {
+      m_chunk.push_back(std::make_pair(m_input.size() - 1, i));
+    }
+  }
+
+  /**
+    Run the worker threads and write the results. Calls the output function
+    once for each input to select the output stream.
+
+    @return true iff all of the input files were converted
+  */
+  template <typename OutputFunction>
+  bool run(const std::size_t &thread_count, OutputFunction &output)
+  {
+    m_text.assign(m_chunk.size(), std::string());
+    m_done.assign(m_chunk.size(), false);
+    m_next = 0;
+    m_written = 0;
+
+    // The writer is thread 0, the other threads format chunks. The writer
+    // formats the next chunk itself if no one else has taken it yet, so this
+    // finishes even if no worker thread starts.
+    run_type<OutputFunction> item(*this, output);
+    Motion::SDK::detail::run_threads(
+      &Converter::thread_main<OutputFunction>, &item, thread_count + 1);
+
+    return item.result;
+  }
+
+private:
+  template <typename OutputFunction>
+  struct run_type {
+    run_type(Converter &in_converter, OutputFunction &in_output)
+      : converter(in_converter), output(in_output), result(true)
+    {
+    }
+
+    Converter &converter;
+    OutputFunction &output;
+    bool result;
+  };
+
+  template <typename OutputFunction>
+  static void thread_main(void *argument, std::size_t index)
+  {
+    run_type<OutputFunction> &item =
+      *static_cast<run_type<OutputFunction> *>(argument);
+    if (0 == index) {
+      item.result = item.converter.write(item.output);
+    } else {
+      item.converter.work();
+    }
+  }
+
+  template <typename OutputFunction>
+  bool write(OutputFunction &output)
+  {
+    using Motion::SDK::detail::scoped_lock;
+
+    bool result = true;
+
+    for (std::size_t i=0; i<m_input.size(); ++i) {
+      const Input &input = *m_input[i];
+
+      std::ostream &out = output(input.pathname);
+
+      if (!input.error.empty()) {
+        std::cerr << input.error << std::endl;
+        result = false;
       }
 
-      if (0 == data.back()) {
-        if (show_channel_names) {
-          print_header(out, data.size(), separator, is_accel);
+      for (std::size_t j=0; j<input.chunk_count; ++j) {
+        const std::size_t index = input.first_chunk + j;
+
+        std::string text;
+        bool claimed = false;
+        {
+          scoped_lock lock(m_mutex);
+          if (m_next == index) {
+            ++m_next;
+            claimed = true;
+          } else {
+            while (!m_done[index]) {
+              m_condition.wait(lock);
+            }
+            text.swap(m_text[index]);
+          }
         }
-      } else {
-        typename ElementT::data_type::value_type tmp = data.back();
-        data.resize(ElementT::Length);
 
-        if (show_channel_names) {
-          print_header(out, data.size(), separator, is_accel);
+        if (claimed) {
+          format(index, text);
         }
 
-        print_container(out, data, separator, is_accel);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
 
-        typename ElementT::data_type next_data(ElementT::Length - 1);
-        if (file.readData(next_data)) {
-          data.front() = tmp;
-          std::copy(
-            next_data.begin(), next_data.end(),
-            data.begin() + 1);
-        } else {
-          data.clear();
+        {
+          scoped_lock lock(m_mutex);
+          m_written = index + 1;
+          m_condition.notify_all();
+        }
+      }
+
+      out.flush();
+
+      output.close();
+    }
+
+    // Release any workers still waiting on the window.
+    {
+      scoped_lock lock(m_mutex);
+      m_written = m_chunk.size();
+      m_condition.notify_all();
+    }
+
+    return result;
+  }
+
+  bool m_raw_format;
+  std::string m_separator;
+  std::vector<Input *> m_input;
+
+  /** Global list of chunks, pairs of input index and chunk index. */
+  std::vector<std::pair<std::size_t,std::size_t> > m_chunk;
+
+  std::vector<std::string> m_text;
+  std::vector<bool> m_done;
+  std::size_t m_next;
+  std::size_t m_written;
+  std::size_t m_ahead;
+  Motion::SDK::detail::mutex m_mutex;
+  Motion::SDK::detail::condition m_condition;
+
+  void format(const std::size_t &index, std::string &text) const
+  {
+    using Motion::SDK::Format;
+
+    const Input &input = *m_input[m_chunk[index].first];
+    if (m_raw_format) {
+      input.format<Format::RawElement>(
+        text, m_chunk[index].second, m_separator);
+    } else {
+      input.format<Format::SensorElement>(
+        text, m_chunk[index].second, m_separator);
+    }
+  }
+
+  void work()
+  {
+    using Motion::SDK::detail::scoped_lock;
+
+    for (;;) {
+      std::size_t index = 0;
+      {
+        scoped_lock lock(m_mutex);
+        while ((m_next < m_chunk.size()) &&
+               (m_next >= m_written + m_ahead)) {
+          m_condition.wait(lock);
+        }
+
+        if (m_next >= m_chunk.size()) {
+          return;
         }
+
+        index = m_next++;
       }
 
-      if (!data.empty()) {
-        do {
-          print_container(out, data, separator, is_accel);
-        } while (file.readData(data));
+      std::string text;
+      format(index, text);
+
+      {
+        scoped_lock lock(m_mutex);
+        m_text[index].swap(text);
+        m_done[index] = true;
+        m_condition.notify_all();
       }
     }
+  }
 
-  } catch (std::runtime_error &e) {
-    std::cerr << e.what() << std::endl;
-    result = false;
+  Converter(const Converter &rhs);
+  const Converter &operator=(const Converter &lhs);
+}; // class Converter
+
+/**
+  Select the output stream for each input file. Either one stream for all of
+  them, or generate the output file names from the input file names.
+*/
+class Output {
+public:
+  Output(std::ostream *out)
+    : m_out(out), m_file(NULL)
+  {
   }
 
-  return result;
-}
+  ~Output()
+  {
+    close();
+  }
+
+  std::ostream &operator()(const std::string &pathname)
+  {
+    if (NULL != m_out) {
+      return *m_out;
+    }
+
+    const std::string output_file = pathname + ".csv";
+
+    m_file = new std::ofstream(output_file.c_str(), std::ios_base::binary | std::ios_base::out);
+    if (!m_file->is_open()) {
+      delete m_file;
+      m_file = NULL;
+
+      return std::cout;
+    }
+
+    return *m_file;
+  }
+
+  void close()
+  {
+    if (NULL != m_file) {
+      m_file->close();
+      delete m_file;
+      m_file = NULL;
+    }
+  }
+
+private:
+  std::ostream *m_out;
+  std::ofstream *m_file;
+}; // class Output
 
-bool binary_to_text(const std::string &input_file,
-                    std::ostream &out,
-                    bool raw_format,
-                    bool show_channel_names,
-                    const std::string &separator)
+/**
+  Convert one input file to one columnar output file.
+*/
+bool binary_to_columns(const std::string &input_file,
+                       const std::string &output_file,
+                       bool raw_format,
+                       bool delta,
+                       const float &rate,
+                       const unsigned long &node)
 {
   using Motion::SDK::Format;
 
+  Input input(input_file);
+  if (raw_format) {
+    input.open<Format::RawElement>(false, std::string());
+  } else {
+    input.open<Format::SensorElement>(false, std::string());
+  }
+
+  if (!input.error.empty()) {
+    std::cerr << input.error << std::endl;
+    return false;
+  }
+
+  std::ofstream out(output_file.c_str(), std::ios_base::binary | std::ios_base::out);
+  if (!out.is_open()) {
+    std::cerr
+      << "failed to open output file, \"" << output_file << "\""
+      << std::endl;
+    return false;
+  }
+
   bool result = false;
   if (raw_format) {
-    if (binary_to_text<Format::RawElement>(input_file, out, show_channel_names, separator)) {
-      result = true;
-    }
+    result = input.write_columns<Format::RawElement>(out, delta, rate, node);
   } else {
-    if (binary_to_text<Format::SensorElement>(input_file, out, show_channel_names, separator)) {
-      result = true;
-    }
+    result = input.write_columns<Format::SensorElement>(out, delta, rate, node);
+  }
+
+  if (!result) {
+    std::cerr
+      << "failed to write output file, \"" << output_file << "\""
+      << std::endl;
   }
 
   return result;
@@ -187,11 +940,16 @@ void print_usage(const std::string &name, std::ostream &out)
     << "Read a Motion Take binary sensor or raw stream file and output a plain text, comma separated version." << std::endl
     << std::endl
     << "Options" << std::endl
+    << "-c, --columnar            write binary column files, FILENAME.col, instead of text" << std::endl
+    << "-d, --delta               delta encode the columns, requires --columnar" << std::endl
     << "-f, --file FILENAME       output results to a file, use - for standard output" << std::endl
     << "-h, --help                prints this message" << std::endl
+    << "-j, --jobs N              number of worker threads, default is one per processor" << std::endl
     << "-r, --raw                 input files are raw format data files, default is sensor format" << std::endl
     << "-n, --nonames             do not print the channel name headers" << std::endl
     << "-s, --separator STRING    element delimiter string, default is \",\" (CSV)" << std::endl
+    << "--node ID                 store the node id in the column file header" << std::endl
+    << "--rate HZ                 store the sample rate in the column file header" << std::endl
     << std::endl;
 }
 
@@ -213,6 +971,11 @@ int main(int argc, char **argv)
   bool show_channel_names = true;
   bool output_stdout = false;
   std::string output_file;
+  std::size_t thread_count = Motion::SDK::detail::processor_count();
+  bool columnar = false;
+  bool delta = false;
+  float rate = 0;
+  unsigned long node = 0;
 
   // Parse command line options. Override the defaults we
   // just set above.
@@ -259,6 +1022,39 @@ int main(int argc, char **argv)
             << "invalid option, missing argument: " << std::string(argv[i], length) << std::endl;
           valid_command_line = false;
         }
+      } else if ("jobs" == option || "j" == option) {
+        if (argc > i + 1) {
+          i++;
+          const int value = atoi(argv[i]);
+          if (value > 0) {
+            thread_count = static_cast<std::size_t>(value);
+          } else {
+            std::cerr
+              << "invalid option, number of jobs: " << argv[i] << std::endl;
+            valid_command_line = false;
+          }
+        } else {
+          std::cerr
+            << "invalid option, missing argument: " << std::string(argv[i], length) << std::endl;
+          valid_command_line = false;
+        }
+      } else if ("columnar" == option || "c" == option) {
+        columnar = true;
+      } else if ("delta" == option || "d" == option) {
+        delta = true;
+      } else if ("rate" == option || "node" == option) {
+        if (argc > i + 1) {
+          i++;
+          if ("rate" == option) {
+            rate = static_cast<float>(atof(argv[i]));
+          } else {
+            node = strtoul(argv[i], NULL, 10);
+          }
+        } else {
+          std::cerr
+            << "invalid option, missing argument: " << std::string(argv[i], length) << std::endl;
+          valid_command_line = false;
+        }
       } else if ("raw" == option || "r" == option) {
         raw_format = true;
       } else if ("nonames" == option || "n" == option) {
@@ -277,9 +1073,33 @@ int main(int argc, char **argv)
     }
   }
 
+  if (columnar) {
+    // Binary output needs a seekable file for each input.
+    if (output_stdout || (!output_file.empty() && (input_file.size() > 1))) {
+      std::cerr
+        << "invalid option, columnar output requires one output file per input" << std::endl;
+      valid_command_line = false;
+    }
+  } else if (delta) {
+    std::cerr
+      << "invalid option, --delta requires --columnar" << std::endl;
+    valid_command_line = false;
+  }
+
   // If we have valid options and at least one input file, run the conversion loop.
   // Otherwise, print out the usage information.
-  if (valid_command_line && !input_file.empty()) {
+  if (valid_command_line && !input_file.empty() && columnar) {
+
+    result = 0;
+    for (std::vector<std::string>::const_iterator itr=input_file.begin(); itr!=input_file.end(); ++itr) {
+      const std::string pathname =
+        output_file.empty() ? ((*itr) + ".col") : output_file;
+      if (!binary_to_columns(*itr, pathname, raw_format, delta, rate, node)) {
+        result = 1;
+      }
+    }
+
+  } else if (valid_command_line && !input_file.empty()) {
 
     std::ofstream *fout = NULL;
     if (!output_stdout && !output_file.empty()) {
@@ -299,29 +1119,14 @@ int main(int argc, char **argv)
     // file names.
     const bool auto_file_name = !output_stdout && (NULL == fout);
 
-    result = 0;
-    for (std::vector<std::string>::const_iterator itr=input_file.begin(); itr!=input_file.end(); ++itr) {
-      if (auto_file_name) {
-        output_file = (*itr) + ".csv";
-
-        fout = new std::ofstream(output_file.c_str(), std::ios_base::binary | std::ios_base::out);
-        if (!fout->is_open()) {
-          delete fout;
-          fout = NULL;
-        }
+    {
+      Converter converter(raw_format, separator, thread_count);
+      for (std::vector<std::string>::const_iterator itr=input_file.begin(); itr!=input_file.end(); ++itr) {
+        converter.add(*itr, show_channel_names);
       }
 
-      if (!binary_to_text(*itr, (NULL != fout) ? *fout : std::cout, raw_format, show_channel_names, separator)) {
-        result = 1;
-      }
-
-      if (auto_file_name) {
-        if (NULL != fout) {
-          fout->close();
-          delete fout;
-          fout = NULL;
-        }
-      }
+      Output output(auto_file_name ? NULL : ((NULL != fout) ? fout : &std::cout));
+      result = converter.run(thread_count, output) ? 0 : 1;
     }
 
     if (NULL != fout) {
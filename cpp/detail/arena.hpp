@@ -0,0 +1,246 @@
+/**
+  @file    tools/sdk/cpp/detail/arena.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_DETAIL_ARENA_HPP_
+#define __MOTION_SDK_DETAIL_ARENA_HPP_
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+
+namespace Motion { namespace SDK { namespace detail {
+
+/**
+  Memory resource for the arena_allocator. Hand out memory from a list of
+  large blocks. A freed small allocation goes on a free list by size and is
+  reused by the next allocation of that size, so a container that is cleared
+  and filled again every frame reaches a steady state with no calls to the
+  global heap. Larger allocations are only reclaimed by reset, once per
+  frame or once per message.
+
+  Not thread safe. Use one arena per thread, or protect it with the same lock
+  as the containers that allocate from it.
+
+  @code
+  detail::arena memory;
+
+  typedef Format::FixedElement<Format::PreviewLayout> element_type;
+  typedef std::map<
+    Format::id_type, element_type, std::less<Format::id_type>,
+    detail::arena_allocator<std::pair<const Format::id_type, element_type> >
+  > map_type;
+
+  const map_type::allocator_type allocator(&memory);
+  map_type frame(map_type::key_compare(), allocator);
+  while (client.readData(data)) {
+    Format::Decode<Format::PreviewLayout>(data.begin(), data.end(), frame);
+  }
+  @endcode
+*/
+class arena {
+ public:
+  enum {
+    DefaultBlockSize = 1 << 16,
+
+    /** All allocations are aligned to this many bytes. */
+    Alignment = 16,
+
+    /**
+      Keep free lists for allocations up to 64 * 16 = 1024 bytes. Covers the
+      nodes of the standard maps and the blocks of a std::deque.
+    */
+    FreeListSize = 64
+  };
+
+  explicit arena(const std::size_t &block_size=DefaultBlockSize);
+
+  ~arena();
+
+  /**
+    @return pointer to <tt>size</tt> bytes
+    @throws std::bad_alloc if the global heap is out of memory
+  */
+  void *allocate(const std::size_t &size);
+
+  /**
+    Return a small allocation to its free list. Do nothing for a large one.
+  */
+  void deallocate(void *pointer, const std::size_t &size);
+
+  /**
+    Release all of the allocations at once. Keep the blocks for reuse.
+
+    @pre no container holds memory from this arena
+  */
+  void reset();
+
+  /**
+    Number of blocks allocated from the global heap. Stops growing once the
+    application reaches a steady state.
+  */
+  std::size_t getBlockCount() const;
+
+ private:
+  struct block_type {
+    char *data;
+    std::size_t size;
+  }; // struct block_type
+
+  struct free_type {
+    free_type *next;
+  }; // struct free_type
+
+  std::vector<block_type> m_block;
+  std::size_t m_block_size;
+
+  /** Current block and the first unused byte in it. */
+  std::size_t m_current;
+  std::size_t m_offset;
+
+  free_type *m_free[FreeListSize];
+
+  arena(const arena &rhs);
+  const arena &operator=(const arena &rhs);
+}; // class arena
+
+/**
+  Standard allocator that allocates from an arena. Use it as the allocator of
+  the Client message buffer, the Format containers, or the Device::Sampler
+  queue. A default constructed allocator has no arena and uses the global
+  heap like std::allocator.
+*/
+template <typename T>
+class arena_allocator {
+ public:
+  typedef T value_type;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef arena_allocator<U> other;
+  }; // struct rebind
+
+  arena_allocator()
+    : m_arena(NULL)
+  {
+  }
+
+  explicit arena_allocator(arena *resource)
+    : m_arena(resource)
+  {
+  }
+
+  template <typename U>
+  arena_allocator(const arena_allocator<U> &rhs)
+    : m_arena(rhs.get_arena())
+  {
+  }
+
+  pointer address(reference value) const
+  {
+    return &value;
+  }
+
+  const_pointer address(const_reference value) const
+  {
+    return &value;
+  }
+
+  pointer allocate(size_type n, const void * =NULL)
+  {
+    if (n > max_size()) {
+      throw std::bad_alloc();
+    }
+
+    const std::size_t size = n * sizeof(T);
+    if (NULL == m_arena) {
+      return static_cast<pointer>(::operator new(size));
+    }
+
+    return static_cast<pointer>(m_arena->allocate(size));
+  }
+
+  void deallocate(pointer p, size_type n)
+  {
+    if (NULL == m_arena) {
+      ::operator delete(p);
+    } else {
+      m_arena->deallocate(p, n * sizeof(T));
+    }
+  }
+
+  size_type max_size() const
+  {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+  void construct(pointer p, const T &value)
+  {
+    new (static_cast<void *>(p)) T(value);
+  }
+
+  void destroy(pointer p)
+  {
+    p->~T();
+  }
+
+  arena *get_arena() const
+  {
+    return m_arena;
+  }
+
+ private:
+  arena *m_arena;
+}; // class arena_allocator
+
+template <typename T, typename U>
+inline bool operator==(const arena_allocator<T> &lhs,
+                       const arena_allocator<U> &rhs)
+{
+  return lhs.get_arena() == rhs.get_arena();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const arena_allocator<T> &lhs,
+                       const arena_allocator<U> &rhs)
+{
+  return lhs.get_arena() != rhs.get_arena();
+}
+
+}}} // namespace Motion::SDK::detail
+
+#endif // __MOTION_SDK_DETAIL_ARENA_HPP_
@@ -0,0 +1,132 @@
+/**
+  @file    tools/sdk/cpp/detail/array.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_DETAIL_ARRAY_HPP_
+#define __MOTION_SDK_DETAIL_ARRAY_HPP_
+
+#include <cstddef>
+
+
+namespace Motion { namespace SDK { namespace detail {
+
+/**
+  Fixed size array of <tt>N</tt> values stored in place. This is a minimal
+  version of the Boost.Array (std::array) class template. Use it to return
+  small component vectors without a heap allocation.
+
+  Example usage:
+  @code
+  detail::array<float, 4> q = {{1, 0, 0, 0}};
+
+  for (std::size_t i=0; i<q.size(); ++i) {
+    std::cout << q[i] << " ";
+  }
+  @endcode
+*/
+template <typename T, std::size_t N>
+class array {
+ public:
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+  typedef std::size_t size_type;
+
+  /**
+    Public member so that this class is an aggregate and supports brace
+    initialization.
+  */
+  T elems[N];
+
+  iterator begin()
+  {
+    return elems;
+  }
+
+  const_iterator begin() const
+  {
+    return elems;
+  }
+
+  iterator end()
+  {
+    return elems + N;
+  }
+
+  const_iterator end() const
+  {
+    return elems + N;
+  }
+
+  reference operator[](const size_type &index)
+  {
+    return elems[index];
+  }
+
+  const_reference operator[](const size_type &index) const
+  {
+    return elems[index];
+  }
+
+  T *data()
+  {
+    return elems;
+  }
+
+  const T *data() const
+  {
+    return elems;
+  }
+
+  static size_type size()
+  {
+    return N;
+  }
+
+  static bool empty()
+  {
+    return false;
+  }
+
+  /**
+    Set all of the values to <tt>value</tt>.
+  */
+  void assign(const T &value)
+  {
+    for (size_type i=0; i<N; ++i) {
+      elems[i] = value;
+    }
+  }
+}; // class array
+
+}}} // namespace Motion::SDK::detail
+
+#endif // __MOTION_SDK_DETAIL_ARRAY_HPP_
@@ -34,6 +34,8 @@
 #include "endian.hpp"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
 
 #if defined(BOOST_BIG_ENDIAN)
 #  define MOTION_SDK_BIG_ENDIAN 1
@@ -81,6 +83,54 @@ inline T little_endian_to_native(T &value)
 #endif  // MOTION_SDK_BIG_ENDIAN
 }
 
+/**
+  In place byte swapping of an array of little-endian values to native type.
+  This is a no-op on little-endian systems.
+
+  @param first array of <tt>n</tt> values
+  @param n number of values in the array
+*/
+template <typename T>
+inline void transform_little_endian_to_native(T *first, const std::size_t &n)
+{
+#if MOTION_SDK_BIG_ENDIAN
+  for (std::size_t i=0; i<n; ++i) {
+    first[i] = little_endian_to_native(first[i]);
+  }
+#else
+  static_cast<void>(first);
+  static_cast<void>(n);
+#endif  // MOTION_SDK_BIG_ENDIAN
+}
+
+/**
+  Copy an array of little-endian values from a packed, and possibly unaligned,
+  byte buffer into an array of native type values. This is a single memcpy on
+  little-endian systems.
+
+  Example usage:
+  @code
+  std::vector<char> message;
+  std::vector<float> buffer(message.size() / sizeof(float));
+
+  detail::copy_little_endian_to_native(
+    &message[0], buffer.size(), &buffer[0]);
+  @endcode
+
+  @param first byte buffer of at least <tt>n * sizeof(T)</tt> bytes
+  @param n number of values to copy
+  @param result output array of <tt>n</tt> values
+*/
+template <typename T>
+inline void copy_little_endian_to_native(const char *first,
+                                         const std::size_t &n, T *result)
+{
+  if (n > 0) {
+    std::memcpy(result, first, n * sizeof(T));
+    transform_little_endian_to_native(result, n);
+  }
+}
+
 }}} // namespace Motion::SDK::detail
 
 #endif // __MOTION_SDK_DETAIL_ENDIAN_TO_NATIVE_HPP_
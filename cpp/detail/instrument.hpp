@@ -0,0 +1,168 @@
+/**
+  @file    tools/sdk/cpp/detail/instrument.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_DETAIL_INSTRUMENT_HPP_
+#define __MOTION_SDK_DETAIL_INSTRUMENT_HPP_
+
+#include <cstddef>
+
+/**
+  Define MOTION_SDK_INSTRUMENT to 1 to record timestamps and counters on the
+  receive path of the Client class and in the Device::Sampler queues. By
+  default all of the instrumentation code is compiled out, the statistics
+  accessors are still available but report that there is no data.
+
+  Define it the same way for the library and the client program.
+*/
+#if !defined(MOTION_SDK_INSTRUMENT)
+#  define MOTION_SDK_INSTRUMENT 0
+#endif  // MOTION_SDK_INSTRUMENT
+
+
+namespace Motion { namespace SDK { namespace detail {
+
+/**
+  Current time in seconds on a monotonic clock with an arbitrary origin.
+  Only use it to measure intervals.
+*/
+double monotonic_time();
+
+/**
+  Distribution of time intervals in power of two buckets of microseconds.
+  Bucket <tt>i</tt> counts intervals in
+  <tt>[2^(i-1), 2^i)</tt> microseconds, bucket zero counts intervals shorter
+  than one microsecond, and the last bucket also counts everything longer.
+  Fixed size, recording a value never allocates.
+
+  Example usage:
+  @code
+  detail::histogram h;
+  h.add(0.010);
+  h.add(0.011);
+
+  std::cout << h.count << " " << h.mean() << " " << h.max << std::endl;
+  @endcode
+*/
+class histogram {
+ public:
+  enum {
+    /** Last bucket starts at 2^22 microseconds, about 4 seconds. */
+    Size = 24
+  };
+
+  histogram();
+
+  /** Record one interval in seconds. Negative values count as zero. */
+  void add(const double &second);
+
+  void clear();
+
+  /** Mean interval in seconds, zero if there are none. */
+  double mean() const;
+
+  /** Standard deviation of the intervals in seconds, the jitter. */
+  double deviation() const;
+
+  /** Number of intervals. */
+  std::size_t count;
+
+  /** Sum and sum of squares of the intervals in seconds. */
+  double sum;
+  double sum_square;
+
+  /** Shortest and longest interval in seconds. */
+  double min;
+  double max;
+
+  std::size_t bucket[Size];
+}; // class histogram
+
+/**
+  Counters for a single Client connection.
+*/
+class client_statistics {
+ public:
+  client_statistics();
+
+  void clear();
+
+  /** Number of bytes received. */
+  std::size_t bytes;
+
+  /** Number of complete messages parsed, XML messages included. */
+  std::size_t messages;
+
+  /** Number of system recv calls, including the ones that timed out. */
+  std::size_t receive_calls;
+
+  /**
+    Number of times the front message in the receive buffer was incomplete
+    and needed another recv call.
+  */
+  std::size_t partial_reads;
+
+  /** Number of XML messages intercepted into the XML string. */
+  std::size_t xml_messages;
+
+  /**
+    Arrival time, on the monotonic_time clock, of the recv call that
+    completed the most recent message.
+  */
+  double last_arrival;
+
+  /** Time between the arrival of consecutive messages. */
+  histogram interval;
+}; // class client_statistics
+
+/**
+  Counters for a single Device::Sampler.
+*/
+class sampler_statistics {
+ public:
+  sampler_statistics();
+
+  void clear();
+
+  /** Number of samples stored by the communication thread. */
+  std::size_t stored;
+
+  /** Number of samples read by the get_data methods. */
+  std::size_t delivered;
+
+  /** Largest number of queued samples right after a store. */
+  std::size_t depth_max;
+
+  /** Time between storing a sample and reading it. */
+  histogram dwell;
+}; // class sampler_statistics
+
+}}} // namespace Motion::SDK::detail
+
+#endif // __MOTION_SDK_DETAIL_INSTRUMENT_HPP_
@@ -0,0 +1,135 @@
+/**
+  @file    tools/sdk/cpp/detail/kernel.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_DETAIL_KERNEL_HPP_
+#define __MOTION_SDK_DETAIL_KERNEL_HPP_
+
+#include <cstddef>
+
+
+namespace Motion { namespace SDK { namespace detail {
+
+/**
+  Batch math kernels for arrays of quaternions. Each kernel has a scalar
+  implementation and vectorized SSE, AVX2 or NEON implementations. The fastest
+  one that the current processor supports is chosen at run time.
+
+  Input quaternions are in struct-of-arrays layout, four arrays of
+  <tt>n</tt> values <tt>{w..., x..., y..., z...}</tt>. This is the layout of
+  the Format::PreviewFrame quaternion channels.
+
+  Example usage:
+  @code
+  Format::PreviewFrame frame;
+  // ... Decode a Preview message into the frame ...
+
+  std::vector<float> matrix(16 * frame.size());
+
+  const float *q = frame.getQuaternion(false);
+  detail::quaternion_to_matrix(
+    q, q + frame.size(), q + 2 * frame.size(), q + 3 * frame.size(),
+    frame.size(), &matrix[0]);
+  @endcode
+*/
+
+/**
+  Convert <tt>n</tt> quaternions to <tt>n</tt> 4-by-4 rotation matrices.
+  Each matrix is a 16 element array in row-major order. A quaternion with zero
+  length results in the identity matrix.
+
+  @param w array of <tt>n</tt> real components
+  @param x array of <tt>n</tt> i components
+  @param y array of <tt>n</tt> j components
+  @param z array of <tt>n</tt> k components
+  @param n number of quaternions
+  @param result output array of <tt>16 * n</tt> values
+*/
+void quaternion_to_matrix(const float *w, const float *x, const float *y,
+                          const float *z, const std::size_t &n,
+                          float *result);
+
+/**
+  Convert <tt>n</tt> quaternions to <tt>n</tt> sets of x, y, and z Euler
+  angles. Specified in radians assuming <tt>x-y-z</tt> rotation order, the
+  same convention as the rotation matrix <tt>R = Rz * Ry * Rx</tt>. Each
+  angle lies on the domain <tt>[-pi, pi]</tt>.
+
+  The vectorized implementations agree with the scalar one to within a few
+  units in the last place.
+
+  @param w array of <tt>n</tt> real components
+  @param x array of <tt>n</tt> i components
+  @param y array of <tt>n</tt> j components
+  @param z array of <tt>n</tt> k components
+  @param n number of quaternions
+  @param result output array of <tt>3 * n</tt> values, three contiguous arrays
+  of <tt>n</tt> values <tt>{rx..., ry..., rz...}</tt>
+*/
+void quaternion_to_euler(const float *w, const float *x, const float *y,
+                         const float *z, const std::size_t &n,
+                         float *result);
+
+/**
+  Spherical linear interpolation of <tt>n</tt> pairs of unit quaternions,
+  along the shorter arc. Uses a polynomial approximation instead of
+  trigonometric functions. For <tt>t</tt> on the domain <tt>[0, 1]</tt> the
+  error is below <tt>1e-7</tt> for quaternions within 30 degrees and about
+  <tt>4e-5</tt> at the worst case of 90 degrees apart. Consecutive samples
+  from a live stream are a few degrees apart.
+
+  The result may be the same array as <tt>a</tt> or <tt>b</tt>.
+
+  @param a array of <tt>4 * n</tt> values, the quaternions at <tt>t = 0</tt>
+  in the same layout as the other kernels, <tt>{w..., x..., y..., z...}</tt>
+  @param b array of <tt>4 * n</tt> values, the quaternions at <tt>t = 1</tt>
+  @param n number of quaternions
+  @param t interpolation parameter
+  @param result output array of <tt>4 * n</tt> values
+*/
+void quaternion_slerp(const float *a, const float *b, const std::size_t &n,
+                      const float &t, float *result);
+
+/**
+  Linear interpolation of <tt>n</tt> values,
+  <tt>result = (1 - t) * a + t * b</tt>. The result may be the same array as
+  <tt>a</tt> or <tt>b</tt>.
+*/
+void linear_interpolate(const float *a, const float *b, const std::size_t &n,
+                        const float &t, float *result);
+
+/**
+  Name of the instruction set that the batch kernels are using on this
+  processor. One of "avx2", "sse2", "neon", or "scalar".
+*/
+const char *kernel_name();
+
+}}} // namespace Motion::SDK::detail
+
+#endif // __MOTION_SDK_DETAIL_KERNEL_HPP_
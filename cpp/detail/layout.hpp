@@ -0,0 +1,94 @@
+/**
+  @file    tools/sdk/cpp/detail/layout.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_DETAIL_LAYOUT_HPP_
+#define __MOTION_SDK_DETAIL_LAYOUT_HPP_
+
+#include <cstddef>
+
+
+namespace Motion { namespace SDK { namespace detail {
+
+/**
+  Compile time descriptor of a single channel in a packed data element. The
+  channel is the contiguous range <tt>[Base, Base + Length)</tt> of values.
+
+  Example usage:
+  @code
+  typedef detail::channel<8, 3> euler_type;
+
+  float data[14];
+  const float *euler = data + euler_type::Base;
+  @endcode
+*/
+template <std::size_t BaseN, std::size_t LengthN>
+struct channel {
+  enum {
+    Base = BaseN,
+    Length = LengthN,
+    End = BaseN + LengthN
+  };
+}; // struct channel
+
+/**
+  Compile time assertion. Only the <tt>true</tt> specialization is defined,
+  so <tt>sizeof(static_check<false>)</tt> does not compile.
+*/
+template <bool Condition>
+struct static_check;
+
+template <>
+struct static_check<true> {
+  enum {
+    value = 1
+  };
+}; // struct static_check
+
+/**
+  Compile time check that a channel fits in an element of <tt>Length</tt>
+  values. Use it in a typedef or at namespace scope.
+
+  @code
+  enum {
+    EulerInRange = detail::channel_in_range<euler_type, 14>::value
+  };
+  @endcode
+*/
+template <typename Channel, std::size_t Length>
+struct channel_in_range {
+  enum {
+    value = sizeof(static_check<
+      (static_cast<std::size_t>(Channel::End) <= Length)>)
+  };
+}; // struct channel_in_range
+
+}}} // namespace Motion::SDK::detail
+
+#endif // __MOTION_SDK_DETAIL_LAYOUT_HPP_
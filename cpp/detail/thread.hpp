@@ -0,0 +1,449 @@
+/**
+  @file    tools/sdk/cpp/detail/thread.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_DETAIL_THREAD_HPP_
+#define __MOTION_SDK_DETAIL_THREAD_HPP_
+
+#include <cstddef>
+#include <deque>
+
+// The SDK library does not depend on a thread library. Everything in here is
+// inline, only programs that include it need to link the native threads.
+#if defined(_WIN32)
+#  if !defined(WIN32_LEAN_AND_MEAN)
+#    define WIN32_LEAN_AND_MEAN 1
+#  endif  // WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#  include <process.h>
+#else
+#  include <pthread.h>
+#  include <unistd.h>
+#endif  // _WIN32
+
+
+namespace Motion { namespace SDK { namespace detail {
+
+/**
+  Minimal mutex on top of the native threads.
+*/
+class mutex {
+public:
+  mutex()
+  {
+#if defined(_WIN32)
+    ::InitializeCriticalSection(&m_mutex);
+#else
+    ::pthread_mutex_init(&m_mutex, NULL);
+#endif  // _WIN32
+  }
+
+  ~mutex()
+  {
+#if defined(_WIN32)
+    ::DeleteCriticalSection(&m_mutex);
+#else
+    ::pthread_mutex_destroy(&m_mutex);
+#endif  // _WIN32
+  }
+
+  void lock()
+  {
+#if defined(_WIN32)
+    ::EnterCriticalSection(&m_mutex);
+#else
+    ::pthread_mutex_lock(&m_mutex);
+#endif  // _WIN32
+  }
+
+  void unlock()
+  {
+#if defined(_WIN32)
+    ::LeaveCriticalSection(&m_mutex);
+#else
+    ::pthread_mutex_unlock(&m_mutex);
+#endif  // _WIN32
+  }
+
+private:
+#if defined(_WIN32)
+  CRITICAL_SECTION m_mutex;
+#else
+  pthread_mutex_t m_mutex;
+#endif  // _WIN32
+
+  friend class condition;
+
+  mutex(const mutex &rhs);
+  const mutex &operator=(const mutex &lhs);
+}; // class mutex
+
+/**
+  Lock a mutex for the lifetime of this object.
+*/
+class scoped_lock {
+public:
+  explicit scoped_lock(mutex &m)
+    : m_mutex(m)
+  {
+    m_mutex.lock();
+  }
+
+  ~scoped_lock()
+  {
+    m_mutex.unlock();
+  }
+
+private:
+  mutex &m_mutex;
+
+  friend class condition;
+
+  scoped_lock(const scoped_lock &rhs);
+  const scoped_lock &operator=(const scoped_lock &lhs);
+}; // class scoped_lock
+
+/**
+  Minimal condition variable to go with the mutex.
+*/
+class condition {
+public:
+  condition()
+  {
+#if defined(_WIN32)
+    ::InitializeConditionVariable(&m_condition);
+#else
+    ::pthread_cond_init(&m_condition, NULL);
+#endif  // _WIN32
+  }
+
+  ~condition()
+  {
+#if !defined(_WIN32)
+    ::pthread_cond_destroy(&m_condition);
+#endif  // _WIN32
+  }
+
+  /** Wait for a notification. Unlocks the mutex while it waits. */
+  void wait(scoped_lock &lock)
+  {
+#if defined(_WIN32)
+    ::SleepConditionVariableCS(
+      &m_condition, &lock.m_mutex.m_mutex, INFINITE);
+#else
+    ::pthread_cond_wait(&m_condition, &lock.m_mutex.m_mutex);
+#endif  // _WIN32
+  }
+
+  void notify_all()
+  {
+#if defined(_WIN32)
+    ::WakeAllConditionVariable(&m_condition);
+#else
+    ::pthread_cond_broadcast(&m_condition);
+#endif  // _WIN32
+  }
+
+private:
+#if defined(_WIN32)
+  CONDITION_VARIABLE m_condition;
+#else
+  pthread_cond_t m_condition;
+#endif  // _WIN32
+
+  condition(const condition &rhs);
+  const condition &operator=(const condition &lhs);
+}; // class condition
+
+/**
+  Number of processors that are online, at least one.
+*/
+inline std::size_t processor_count()
+{
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  ::GetSystemInfo(&info);
+  const long result = static_cast<long>(info.dwNumberOfProcessors);
+#else
+  const long result = ::sysconf(_SC_NPROCESSORS_ONLN);
+#endif  // _WIN32
+  return (result > 0) ? static_cast<std::size_t>(result) : 1;
+}
+
+/**
+  Work stealing queue of task indices. Each worker has its own double ended
+  queue. A worker takes tasks from the front of its own queue and, once that
+  is empty, steals from the back of the other queues. The owner and the thief
+  work at opposite ends so they rarely want the same task.
+
+  One mutex per queue. The tasks here are whole files, so the lock is never
+  the bottleneck.
+*/
+class task_queue {
+public:
+  explicit task_queue(const std::size_t &worker_count)
+    : m_slot(new slot_type[(worker_count > 0) ? worker_count : 1]),
+      m_size((worker_count > 0) ? worker_count : 1)
+  {
+  }
+
+  ~task_queue()
+  {
+    delete [] m_slot;
+  }
+
+  std::size_t size() const
+  {
+    return m_size;
+  }
+
+  /** Add a task to the back of the queue of one worker. */
+  void push(const std::size_t &worker, const std::size_t &task)
+  {
+    slot_type &slot = m_slot[worker % m_size];
+
+    scoped_lock lock(slot.mutex);
+    slot.task.push_back(task);
+  }
+
+  /**
+    Take the next task for this worker, steal one from another worker if
+    its own queue is empty.
+
+    @return <tt>false</tt> if all of the queues are empty
+  */
+  bool pop(const std::size_t &worker, std::size_t &task)
+  {
+    for (std::size_t i=0; i<m_size; ++i) {
+      slot_type &slot = m_slot[(worker + i) % m_size];
+
+      scoped_lock lock(slot.mutex);
+      if (!slot.task.empty()) {
+        if (0 == i) {
+          task = slot.task.front();
+          slot.task.pop_front();
+        } else {
+          task = slot.task.back();
+          slot.task.pop_back();
+        }
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+    Look at the task that this worker will take next from its own queue.
+
+    @return <tt>false</tt> if the queue is empty
+  */
+  bool peek(const std::size_t &worker, std::size_t &task)
+  {
+    slot_type &slot = m_slot[worker % m_size];
+
+    scoped_lock lock(slot.mutex);
+    if (!slot.task.empty()) {
+      task = slot.task.front();
+      return true;
+    }
+
+    return false;
+  }
+
+private:
+  struct slot_type {
+    detail::mutex mutex;
+    std::deque<std::size_t> task;
+  };
+
+  slot_type *m_slot;
+  std::size_t m_size;
+
+  task_queue(const task_queue &rhs);
+  const task_queue &operator=(const task_queue &lhs);
+}; // class task_queue
+
+/** Entry point of a thread, with its argument and index. */
+typedef void (*thread_function_type)(void *argument, std::size_t index);
+
+namespace thread_impl {
+
+struct start_type {
+  thread_function_type function;
+  void *argument;
+  std::size_t index;
+};
+
+#if defined(_WIN32)
+inline unsigned __stdcall start(void *argument)
+#else
+extern "C" inline void *start(void *argument)
+#endif  // _WIN32
+{
+  const start_type *item = static_cast<const start_type *>(argument);
+  item->function(item->argument, item->index);
+  return 0;
+}
+
+} // namespace thread_impl
+
+/**
+  One native thread. Joins in the destructor if the owner did not.
+
+  @code
+  void worker(void *argument, std::size_t index);
+
+  detail::thread thread;
+  if (thread.start(&worker, &state)) {
+    // ...
+    thread.join();
+  }
+  @endcode
+*/
+class thread {
+public:
+  thread()
+    : m_item(), m_handle(), m_started(false)
+  {
+  }
+
+  ~thread()
+  {
+    join();
+  }
+
+  /**
+    Call function(argument, index) on a new thread.
+
+    @return <tt>false</tt> if the system can not start the thread, or this
+            one is already running
+  */
+  bool start(thread_function_type function, void *argument,
+             const std::size_t &index=0)
+  {
+    if (m_started) {
+      return false;
+    }
+
+    m_item.function = function;
+    m_item.argument = argument;
+    m_item.index = index;
+
+#if defined(_WIN32)
+    const uintptr_t handle =
+      ::_beginthreadex(NULL, 0, &thread_impl::start, &m_item, 0, NULL);
+    if (0 != handle) {
+      m_handle = reinterpret_cast<HANDLE>(handle);
+      m_started = true;
+    }
+#else
+    m_started =
+      (0 == ::pthread_create(&m_handle, NULL, &thread_impl::start, &m_item));
+#endif  // _WIN32
+
+    return m_started;
+  }
+
+  /** Wait for the thread to exit. Does nothing if it is not running. */
+  void join()
+  {
+    if (m_started) {
+#if defined(_WIN32)
+      ::WaitForSingleObject(m_handle, INFINITE);
+      ::CloseHandle(m_handle);
+#else
+      ::pthread_join(m_handle, NULL);
+#endif  // _WIN32
+      m_started = false;
+    }
+  }
+
+  bool joinable() const
+  {
+    return m_started;
+  }
+
+private:
+  thread_impl::start_type m_item;
+#if defined(_WIN32)
+  HANDLE m_handle;
+#else
+  pthread_t m_handle;
+#endif  // _WIN32
+  bool m_started;
+
+  thread(const thread &rhs);
+  const thread &operator=(const thread &lhs);
+}; // class thread
+
+/**
+  Run one function on a group of native threads and wait for all of them.
+
+  @code
+  void worker(void *argument, std::size_t index);
+
+  // Calls worker(&state, 0) on this thread, and worker(&state, 1) through
+  // worker(&state, 3) on three new threads.
+  detail::run_threads(&worker, &state, 4);
+  @endcode
+
+  The calling thread is worker 0. If the system can not start a thread the
+  function still runs on all of the threads that did start, so work sharing
+  callers like the task_queue finish all of the work anyways.
+
+  @return number of threads that ran the function, including the caller
+*/
+inline std::size_t run_threads(thread_function_type function, void *argument,
+                               const std::size_t &count)
+{
+  if (0 == count) {
+    return 0;
+  }
+
+  thread *worker = new thread[count - 1];
+
+  std::size_t result = 1;
+  for (std::size_t i=1; i<count; ++i) {
+    if (worker[i - 1].start(function, argument, i)) {
+      ++result;
+    }
+  }
+
+  function(argument, 0);
+
+  // Joins all of the threads that started.
+  delete [] worker;
+
+  return result;
+}
+
+}}} // namespace Motion::SDK::detail
+
+#endif // __MOTION_SDK_DETAIL_THREAD_HPP_
@@ -0,0 +1,829 @@
+/**
+  Reusable skeleton view for the C++ Motion SDK examples.
+
+  Draw a coordinate system for every node in a Preview stream. The client
+  thread decodes each message into a flat @ref Format::PreviewFrame and
+  computes all of the rotation matrices at once with the batch kernels. It
+  hands them to the drawing thread through a lock free triple buffer, so
+  neither thread ever waits for the other.
+
+  The drawing thread copies the matrices into a persistently mapped OpenGL
+  buffer and draws all of the nodes with one instanced draw call. Requires
+  OpenGL 4.4, or the ARB_buffer_storage extension, and GLSL 1.50. Falls back
+  to one immediate mode draw per node on older drivers.
+
+  @file    tools/sdk/cpp/example_sdl/SkeletonView.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_EXAMPLE_SKELETON_VIEW_HPP_
+#define __MOTION_SDK_EXAMPLE_SKELETON_VIEW_HPP_
+
+#include <Format.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif  // _MSC_VER
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_opengl.h>
+
+
+/**
+  Atomic exchange and load of a shared index. Full barrier on the exchange,
+  acquire on the load. The SDL 1.2 library does not have atomic operations,
+  use the compiler intrinsics.
+*/
+inline long atomic_exchange(volatile long *value, long desired)
+{
+#if defined(_MSC_VER)
+  return _InterlockedExchange(value, desired);
+#else
+  return __atomic_exchange_n(value, desired, __ATOMIC_ACQ_REL);
+#endif  // _MSC_VER
+}
+
+inline long atomic_load(volatile long *value)
+{
+#if defined(_MSC_VER)
+  return _InterlockedCompareExchange(value, 0, 0);
+#else
+  return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif  // _MSC_VER
+}
+
+
+/**
+  Lock free handoff of the newest value from one producer thread to one
+  consumer thread. There are three copies of the value. The producer owns one
+  and fills it, the consumer owns one and reads it, and the third sits in the
+  middle. Both threads swap their copy with the middle one, a single atomic
+  exchange. The producer never waits and the consumer always sees the newest
+  complete value.
+
+  Example usage:
+  @code
+  triple_buffer<SkeletonPose> buffer;
+
+  // Producer thread.
+  buffer.back().assign(frame);
+  buffer.publish();
+
+  // Consumer thread.
+  buffer.update();
+  const SkeletonPose &pose = buffer.front();
+  @endcode
+*/
+template <typename T>
+class triple_buffer {
+public:
+  triple_buffer()
+    : m_back(0), m_middle(1), m_front(2)
+  {
+  }
+
+  /**
+    Producer thread only. The copy to fill in before the next call to
+    publish.
+  */
+  T &back()
+  {
+    return m_buffer[m_back];
+  }
+
+  /**
+    Producer thread only. Make the back copy the newest value. Take the old
+    middle copy, the consumer is not reading it.
+  */
+  void publish()
+  {
+    m_back = atomic_exchange(&m_middle, m_back | Fresh) & Mask;
+  }
+
+  /**
+    Consumer thread only. Take the newest value if there is one.
+
+    @return true if the front copy changed
+  */
+  bool update()
+  {
+    if (0 == (atomic_load(&m_middle) & Fresh)) {
+      return false;
+    }
+
+    m_front = atomic_exchange(&m_middle, m_front) & Mask;
+    return true;
+  }
+
+  /**
+    Consumer thread only. The newest value as of the last call to update.
+  */
+  const T &front() const
+  {
+    return m_buffer[m_front];
+  }
+
+private:
+  enum {
+    Mask = 3,
+    Fresh = 4
+  };
+
+  T m_buffer[3];
+
+  /** Index of the producer copy. */
+  long m_back;
+
+  /** Index of the middle copy, flagged fresh if the consumer has not seen it. */
+  volatile long m_middle;
+
+  /** Index of the consumer copy. */
+  long m_front;
+
+  /** Disable the copy constructor. */
+  triple_buffer(const triple_buffer &);
+
+  /** Disable assignment operator. */
+  const triple_buffer & operator=(const triple_buffer &);
+}; // class triple_buffer
+
+
+/**
+  Rotation matrices of all of the nodes in one Preview message.
+*/
+class SkeletonPose {
+public:
+  SkeletonPose()
+    : m_matrix(), m_size(0)
+  {
+  }
+
+  /**
+    Compute the global rotation matrix of all nodes in the frame at once.
+    Keeps the storage, does not allocate once it has seen the largest frame.
+  */
+  bool assign(const Motion::SDK::Format::PreviewFrame &frame)
+  {
+    m_size = 0;
+    if (frame.empty()) {
+      return false;
+    }
+
+    m_matrix.resize(16 * frame.size());
+    if (!frame.getMatrix(false, &m_matrix[0])) {
+      return false;
+    }
+
+    m_size = frame.size();
+    return true;
+  }
+
+  /** Number of nodes. */
+  std::size_t size() const
+  {
+    return m_size;
+  }
+
+  /** One row major 4-by-4 matrix per node, or NULL if there are none. */
+  const float *matrix() const
+  {
+    return (m_size > 0) ? &m_matrix[0] : NULL;
+  }
+
+private:
+  std::vector<float> m_matrix;
+  std::size_t m_size;
+}; // class SkeletonPose
+
+
+#ifndef GL_ARRAY_BUFFER
+#  define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_STATIC_DRAW
+#  define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#  define GL_FRAGMENT_SHADER 0x8B30
+#endif
+#ifndef GL_VERTEX_SHADER
+#  define GL_VERTEX_SHADER 0x8B31
+#endif
+#ifndef GL_COMPILE_STATUS
+#  define GL_COMPILE_STATUS 0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#  define GL_LINK_STATUS 0x8B82
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#  define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#  define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#  define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#  define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#  define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+
+#ifndef APIENTRY
+#  define APIENTRY
+#endif
+
+
+/**
+  Draw one coordinate system per node of a SkeletonPose. The nodes are laid
+  out on a square grid, scaled to fit in the same view as a single node.
+
+  All of the methods must be called from the thread that owns the OpenGL
+  context, after it is created.
+
+  Each frame writes the matrices into one of three regions of a persistently
+  mapped buffer, with a fence for each region. The driver reads one region
+  while we write the next. Only wait if the GPU is still three frames behind.
+*/
+class SkeletonView {
+public:
+  enum {
+    /** Maximum number of nodes. */
+    DefaultCapacity = 1024
+  };
+
+  explicit SkeletonView(const std::size_t &capacity=DefaultCapacity)
+    : m_capacity(capacity), m_instanced(false), m_program(0),
+      m_columns_location(-1), m_mesh(0), m_transform(0), m_mapped(NULL),
+      m_region(0), m_api()
+  {
+    for (int i=0; i<RegionCount; i++) {
+      m_fence[i] = NULL;
+    }
+  }
+
+  ~SkeletonView()
+  {
+    destroy();
+  }
+
+  /**
+    OpenGL function, initialize parameters. Set up the instanced drawing
+    path if the driver supports it.
+
+    @return true if the instanced path is available, otherwise draw in
+            immediate mode
+  */
+  bool init()
+  {
+    glClearColor(0, 0, 0, 0);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+
+    destroy();
+    if (has_buffer_storage() && m_api.load()) {
+      m_instanced = create();
+      if (!m_instanced) {
+        destroy();
+      }
+    }
+
+    return m_instanced;
+  }
+
+  /**
+    OpenGL function, resize the parent window.
+  */
+  void reshape(int width, int height)
+  {
+    if (height <= 0) {
+      height = 1;
+    }
+    float height_real = static_cast<float>(width) / static_cast<float>(height);
+
+    glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+
+    glMatrixMode(GL_PROJECTION);
+    {
+      glLoadIdentity();
+      gluPerspective(60, height_real, 1, 1000);
+    }
+
+    glMatrixMode(GL_MODELVIEW);
+    {
+      glLoadIdentity();
+      gluLookAt(-2, 2, 2, 0, 0, 0, 0, 1, 0);
+    }
+  }
+
+  /**
+    OpenGL function, draw the current frame.
+  */
+  void display(const SkeletonPose &pose)
+  {
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    {
+      // Draw a fixed mono-chromatic reference coordinate
+      // system of some sort.
+      glColor3f(0.7f, 0.7f, 0.7f);
+      glBegin(GL_LINES);
+      {
+        glVertex3f(-1, 0, 0);
+        glVertex3f(1, 0, 0);
+        glVertex3f(0, -1, 0);
+        glVertex3f(0, 1, 0);
+        glVertex3f(0, 0, -1);
+        glVertex3f(0, 0, 1);
+      }
+      glEnd();
+    }
+
+    const std::size_t n = (pose.size() < m_capacity) ? pose.size() : m_capacity;
+    if (0 == n) {
+      return;
+    }
+
+    if (m_instanced) {
+      display_instanced(pose.matrix(), n);
+    } else {
+      display_immediate(pose.matrix(), n);
+    }
+  }
+
+  /** @return true if display uses the single instanced draw call */
+  bool is_instanced() const
+  {
+    return m_instanced;
+  }
+
+private:
+  enum {
+    /** Number of frames that the CPU may run ahead of the GPU. */
+    RegionCount = 3,
+    /** Bytes in one row major 4-by-4 matrix. */
+    MatrixSize = 16 * sizeof(float),
+    /** Vertex attribute locations. */
+    PositionLocation = 0,
+    ColorLocation = 1,
+    TransformLocation = 2
+  };
+
+  typedef std::ptrdiff_t size_ptr_type;
+
+  /**
+    OpenGL 2.0 through 4.4 entry points that the system headers may not
+    declare. Loaded at run time from the current context.
+  */
+  class api_type {
+  public:
+    typedef GLuint (APIENTRY *create_shader_type)(GLenum);
+    typedef void (APIENTRY *shader_source_type)(GLuint, GLsizei, const char **, const GLint *);
+    typedef void (APIENTRY *uint_type)(GLuint);
+    typedef void (APIENTRY *get_iv_type)(GLuint, GLenum, GLint *);
+    typedef void (APIENTRY *get_log_type)(GLuint, GLsizei, GLsizei *, char *);
+    typedef GLuint (APIENTRY *create_program_type)();
+    typedef void (APIENTRY *attach_shader_type)(GLuint, GLuint);
+    typedef void (APIENTRY *bind_attrib_type)(GLuint, GLuint, const char *);
+    typedef GLint (APIENTRY *get_uniform_type)(GLuint, const char *);
+    typedef void (APIENTRY *uniform_int_type)(GLint, GLint);
+    typedef void (APIENTRY *gen_buffers_type)(GLsizei, GLuint *);
+    typedef void (APIENTRY *delete_buffers_type)(GLsizei, const GLuint *);
+    typedef void (APIENTRY *bind_buffer_type)(GLenum, GLuint);
+    typedef void (APIENTRY *buffer_data_type)(GLenum, size_ptr_type, const void *, GLenum);
+    typedef void (APIENTRY *buffer_storage_type)(GLenum, size_ptr_type, const void *, GLbitfield);
+    typedef void *(APIENTRY *map_buffer_range_type)(GLenum, size_ptr_type, size_ptr_type, GLbitfield);
+    typedef GLboolean (APIENTRY *unmap_buffer_type)(GLenum);
+    typedef void (APIENTRY *attrib_pointer_type)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void *);
+    typedef void (APIENTRY *attrib_divisor_type)(GLuint, GLuint);
+    typedef void (APIENTRY *draw_instanced_type)(GLenum, GLint, GLsizei, GLsizei);
+    typedef void *(APIENTRY *fence_sync_type)(GLenum, GLbitfield);
+    typedef GLenum (APIENTRY *client_wait_sync_type)(void *, GLbitfield, Uint64);
+    typedef void (APIENTRY *delete_sync_type)(void *);
+
+    create_shader_type CreateShader;
+    shader_source_type ShaderSource;
+    uint_type CompileShader;
+    get_iv_type GetShaderiv;
+    get_log_type GetShaderInfoLog;
+    uint_type DeleteShader;
+    create_program_type CreateProgram;
+    attach_shader_type AttachShader;
+    bind_attrib_type BindAttribLocation;
+    uint_type LinkProgram;
+    get_iv_type GetProgramiv;
+    get_log_type GetProgramInfoLog;
+    uint_type UseProgram;
+    uint_type DeleteProgram;
+    get_uniform_type GetUniformLocation;
+    uniform_int_type Uniform1i;
+    gen_buffers_type GenBuffers;
+    delete_buffers_type DeleteBuffers;
+    bind_buffer_type BindBuffer;
+    buffer_data_type BufferData;
+    buffer_storage_type BufferStorage;
+    map_buffer_range_type MapBufferRange;
+    unmap_buffer_type UnmapBuffer;
+    uint_type EnableVertexAttribArray;
+    uint_type DisableVertexAttribArray;
+    attrib_pointer_type VertexAttribPointer;
+    attrib_divisor_type VertexAttribDivisor;
+    draw_instanced_type DrawArraysInstanced;
+    fence_sync_type FenceSync;
+    client_wait_sync_type ClientWaitSync;
+    delete_sync_type DeleteSync;
+
+    api_type()
+    {
+      std::memset(this, 0, sizeof(api_type));
+    }
+
+    /** @return true if all of the entry points are available */
+    bool load()
+    {
+      return
+        get(CreateShader, "glCreateShader") &&
+        get(ShaderSource, "glShaderSource") &&
+        get(CompileShader, "glCompileShader") &&
+        get(GetShaderiv, "glGetShaderiv") &&
+        get(GetShaderInfoLog, "glGetShaderInfoLog") &&
+        get(DeleteShader, "glDeleteShader") &&
+        get(CreateProgram, "glCreateProgram") &&
+        get(AttachShader, "glAttachShader") &&
+        get(BindAttribLocation, "glBindAttribLocation") &&
+        get(LinkProgram, "glLinkProgram") &&
+        get(GetProgramiv, "glGetProgramiv") &&
+        get(GetProgramInfoLog, "glGetProgramInfoLog") &&
+        get(UseProgram, "glUseProgram") &&
+        get(DeleteProgram, "glDeleteProgram") &&
+        get(GetUniformLocation, "glGetUniformLocation") &&
+        get(Uniform1i, "glUniform1i") &&
+        get(GenBuffers, "glGenBuffers") &&
+        get(DeleteBuffers, "glDeleteBuffers") &&
+        get(BindBuffer, "glBindBuffer") &&
+        get(BufferData, "glBufferData") &&
+        get(BufferStorage, "glBufferStorage") &&
+        get(MapBufferRange, "glMapBufferRange") &&
+        get(UnmapBuffer, "glUnmapBuffer") &&
+        get(EnableVertexAttribArray, "glEnableVertexAttribArray") &&
+        get(DisableVertexAttribArray, "glDisableVertexAttribArray") &&
+        get(VertexAttribPointer, "glVertexAttribPointer") &&
+        get(VertexAttribDivisor, "glVertexAttribDivisor") &&
+        get(DrawArraysInstanced, "glDrawArraysInstanced") &&
+        get(FenceSync, "glFenceSync") &&
+        get(ClientWaitSync, "glClientWaitSync") &&
+        get(DeleteSync, "glDeleteSync");
+    }
+
+  private:
+    /**
+      ISO C++ does not allow a cast from a data pointer to a function
+      pointer. Copy the bits instead.
+    */
+    template <typename T>
+    static bool get(T &result, const char *name)
+    {
+      void *address = SDL_GL_GetProcAddress(name);
+      std::memcpy(&result, &address, sizeof(result));
+      return NULL != address;
+    }
+  }; // class api_type
+
+  std::size_t m_capacity;
+  bool m_instanced;
+  GLuint m_program;
+  GLint m_columns_location;
+
+  /** Static buffer of the coordinate axes, position and color. */
+  GLuint m_mesh;
+
+  /** Persistently mapped buffer of RegionCount sets of matrices. */
+  GLuint m_transform;
+  char *m_mapped;
+
+  /** Region that the next frame writes to. */
+  int m_region;
+
+  /** Signalled once the GPU is done with the draw that read each region. */
+  void *m_fence[RegionCount];
+
+  api_type m_api;
+
+  /**
+    The glX and WGL loaders return a non NULL address for any name, check the
+    version or the extension string first.
+  */
+  static bool has_buffer_storage()
+  {
+    const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    if (NULL != version) {
+      char *last = NULL;
+      const long major = std::strtol(version, &last, 10);
+      const long minor = ('.' == *last) ? std::strtol(last + 1, NULL, 10) : 0;
+      if ((major > 4) || ((4 == major) && (minor >= 4))) {
+        return true;
+      }
+    }
+
+    const char *extension = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+    return (NULL != extension) &&
+      (NULL != std::strstr(extension, "GL_ARB_buffer_storage"));
+  }
+
+  /**
+    Compile the shaders and allocate the buffers.
+  */
+  bool create()
+  {
+    // The matrix attribute takes four locations, one per column. Each column
+    // is loaded from one row of our row major matrix, so the shader sees the
+    // transpose and multiplies from the left.
+    const char *vertex_source =
+      "#version 150 compatibility\n"
+      "in vec3 position;\n"
+      "in vec3 color;\n"
+      "in mat4 transform;\n"
+      "uniform int columns;\n"
+      "out vec3 vertex_color;\n"
+      "void main() {\n"
+      "  vec4 p = vec4(position, 1.0) * transform;\n"
+      "  vec2 cell = vec2(gl_InstanceID % columns, gl_InstanceID / columns);\n"
+      "  cell = 2.5 * (cell - 0.5 * float(columns - 1));\n"
+      "  p.xz += cell;\n"
+      "  p.xyz /= float(columns);\n"
+      "  gl_Position = gl_ModelViewProjectionMatrix * p;\n"
+      "  vertex_color = color;\n"
+      "}\n";
+
+    const char *fragment_source =
+      "#version 150 compatibility\n"
+      "in vec3 vertex_color;\n"
+      "void main() {\n"
+      "  gl_FragColor = vec4(vertex_color, 1.0);\n"
+      "}\n";
+
+    const GLuint vertex = compile(GL_VERTEX_SHADER, vertex_source);
+    const GLuint fragment = compile(GL_FRAGMENT_SHADER, fragment_source);
+    if ((0 == vertex) || (0 == fragment)) {
+      m_api.DeleteShader(vertex);
+      m_api.DeleteShader(fragment);
+      return false;
+    }
+
+    m_program = m_api.CreateProgram();
+    m_api.AttachShader(m_program, vertex);
+    m_api.AttachShader(m_program, fragment);
+    m_api.BindAttribLocation(m_program, PositionLocation, "position");
+    m_api.BindAttribLocation(m_program, ColorLocation, "color");
+    m_api.BindAttribLocation(m_program, TransformLocation, "transform");
+    m_api.LinkProgram(m_program);
+    m_api.DeleteShader(vertex);
+    m_api.DeleteShader(fragment);
+
+    GLint status = GL_FALSE;
+    m_api.GetProgramiv(m_program, GL_LINK_STATUS, &status);
+    if (GL_TRUE != status) {
+      char log[1024] = {0};
+      m_api.GetProgramInfoLog(m_program, sizeof(log), NULL, log);
+      std::cerr << "failed to link skeleton view program: " << log << std::endl;
+      return false;
+    }
+
+    m_columns_location = m_api.GetUniformLocation(m_program, "columns");
+
+    // Coordinate axes, interleaved position and color.
+    const float mesh[6][6] = {
+      {0, 0, 0, 1, 0, 0}, {1, 0, 0, 1, 0, 0},
+      {0, 0, 0, 0, 1, 0}, {0, 1, 0, 0, 1, 0},
+      {0, 0, 0, 0, 0, 1}, {0, 0, 1, 0, 0, 1}
+    };
+
+    m_api.GenBuffers(1, &m_mesh);
+    m_api.BindBuffer(GL_ARRAY_BUFFER, m_mesh);
+    m_api.BufferData(GL_ARRAY_BUFFER, sizeof(mesh), mesh, GL_STATIC_DRAW);
+
+    // Immutable storage, mapped once for the lifetime of the view. Coherent,
+    // so our writes are visible to the next draw without a flush.
+    const GLbitfield flags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const size_ptr_type size =
+      static_cast<size_ptr_type>(RegionCount * m_capacity * MatrixSize);
+
+    m_api.GenBuffers(1, &m_transform);
+    m_api.BindBuffer(GL_ARRAY_BUFFER, m_transform);
+    m_api.BufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+    m_mapped = static_cast<char *>(
+      m_api.MapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+    m_api.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return NULL != m_mapped;
+  }
+
+  GLuint compile(GLenum type, const char *source)
+  {
+    const GLuint shader = m_api.CreateShader(type);
+    m_api.ShaderSource(shader, 1, &source, NULL);
+    m_api.CompileShader(shader);
+
+    GLint status = GL_FALSE;
+    m_api.GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (GL_TRUE != status) {
+      char log[1024] = {0};
+      m_api.GetShaderInfoLog(shader, sizeof(log), NULL, log);
+      std::cerr << "failed to compile skeleton view shader: " << log << std::endl;
+      m_api.DeleteShader(shader);
+      return 0;
+    }
+
+    return shader;
+  }
+
+  void destroy()
+  {
+    if (m_instanced || (0 != m_program) || (0 != m_mesh) || (0 != m_transform)) {
+      for (int i=0; i<RegionCount; i++) {
+        if (NULL != m_fence[i]) {
+          m_api.DeleteSync(m_fence[i]);
+          m_fence[i] = NULL;
+        }
+      }
+
+      if (NULL != m_mapped) {
+        m_api.BindBuffer(GL_ARRAY_BUFFER, m_transform);
+        m_api.UnmapBuffer(GL_ARRAY_BUFFER);
+        m_api.BindBuffer(GL_ARRAY_BUFFER, 0);
+        m_mapped = NULL;
+      }
+
+      if (0 != m_transform) {
+        m_api.DeleteBuffers(1, &m_transform);
+        m_transform = 0;
+      }
+
+      if (0 != m_mesh) {
+        m_api.DeleteBuffers(1, &m_mesh);
+        m_mesh = 0;
+      }
+
+      if (0 != m_program) {
+        m_api.DeleteProgram(m_program);
+        m_program = 0;
+      }
+    }
+
+    m_instanced = false;
+    m_region = 0;
+  }
+
+  /**
+    Write the matrices into the next region and draw all of the nodes with
+    one call.
+  */
+  void display_instanced(const float *matrix, const std::size_t &n)
+  {
+    // Wait until the GPU is done with the draw that last read this region.
+    // Normally it finished two frames ago.
+    if (NULL != m_fence[m_region]) {
+      m_api.ClientWaitSync(
+        m_fence[m_region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      m_api.DeleteSync(m_fence[m_region]);
+      m_fence[m_region] = NULL;
+    }
+
+    const std::size_t offset = m_region * m_capacity * MatrixSize;
+    std::memcpy(m_mapped + offset, matrix, n * MatrixSize);
+
+    const GLint columns = static_cast<GLint>(
+      std::ceil(std::sqrt(static_cast<double>(n))));
+
+    m_api.UseProgram(m_program);
+    m_api.Uniform1i(m_columns_location, columns);
+
+    m_api.BindBuffer(GL_ARRAY_BUFFER, m_mesh);
+    m_api.EnableVertexAttribArray(PositionLocation);
+    m_api.EnableVertexAttribArray(ColorLocation);
+    m_api.VertexAttribPointer(
+      PositionLocation, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+      reinterpret_cast<const void *>(0));
+    m_api.VertexAttribPointer(
+      ColorLocation, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+      reinterpret_cast<const void *>(3 * sizeof(float)));
+
+    m_api.BindBuffer(GL_ARRAY_BUFFER, m_transform);
+    for (int i=0; i<4; i++) {
+      const GLuint location = TransformLocation + i;
+      m_api.EnableVertexAttribArray(location);
+      m_api.VertexAttribPointer(
+        location, 4, GL_FLOAT, GL_FALSE, MatrixSize,
+        reinterpret_cast<const void *>(offset + 4 * i * sizeof(float)));
+      m_api.VertexAttribDivisor(location, 1);
+    }
+
+    m_api.DrawArraysInstanced(GL_LINES, 0, 6, static_cast<GLsizei>(n));
+
+    for (int i=0; i<4; i++) {
+      const GLuint location = TransformLocation + i;
+      m_api.VertexAttribDivisor(location, 0);
+      m_api.DisableVertexAttribArray(location);
+    }
+    m_api.DisableVertexAttribArray(PositionLocation);
+    m_api.DisableVertexAttribArray(ColorLocation);
+    m_api.BindBuffer(GL_ARRAY_BUFFER, 0);
+    m_api.UseProgram(0);
+
+    m_fence[m_region] = m_api.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_region = (m_region + 1) % RegionCount;
+  }
+
+  /**
+    Same grid layout as the shader, one matrix and a few immediate mode
+    calls per node.
+  */
+  void display_immediate(const float *matrix, const std::size_t &n)
+  {
+    const float axis[3][3] = {
+      {1, 0, 0},
+      {0, 1, 0},
+      {0, 0, 1}
+    };
+
+    const std::size_t columns = static_cast<std::size_t>(
+      std::ceil(std::sqrt(static_cast<double>(n))));
+    const float scale = 1.0f / static_cast<float>(columns);
+    const float center = 0.5f * static_cast<float>(columns - 1);
+
+    for (std::size_t node=0; node<n; node++) {
+      // Transpose matrix for OpenGL column-major order.
+      float transform[16];
+      for (int i=0; i<4; i++) {
+        for (int j=0; j<4; j++) {
+          transform[4*j+i] = matrix[16*node + 4*i+j];
+        }
+      }
+
+      glPushMatrix();
+      {
+        glScalef(scale, scale, scale);
+        glTranslatef(
+          2.5f * (static_cast<float>(node % columns) - center), 0,
+          2.5f * (static_cast<float>(node / columns) - center));
+        glMultMatrixf(transform);
+
+        for (int i=0; i<3; i++) {
+          glColor3fv(axis[i]);
+          glBegin(GL_LINES);
+          {
+            glVertex3f(0, 0, 0);
+            glVertex3fv(axis[i]);
+          }
+          glEnd();
+        }
+      }
+      glPopMatrix();
+    }
+  }
+
+  /** Disable the copy constructor. */
+  SkeletonView(const SkeletonView &);
+
+  /** Disable assignment operator. */
+  const SkeletonView & operator=(const SkeletonView &);
+}; // class SkeletonView
+
+#endif  // __MOTION_SDK_EXAMPLE_SKELETON_VIEW_HPP_
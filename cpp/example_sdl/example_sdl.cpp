@@ -1,9 +1,10 @@
 /**
   Simple test program for the C++ Motion SDK.
   
-  Draw a coordinate system that defines the real-time orientation of a single
+  Draw a coordinate system that defines the real-time orientation of each
   MotionNode IMU. Use the @ref Client class to read preview data from the remote
-  host. Use the @ref Format class to access specific preview data elements.
+  host. Use the @ref Format class to decode all of the preview data elements at
+  once. Use the @ref SkeletonView class to draw all of them in one call.
 
   Implemented in OpenGL layered on top of the Simple Directmedia
   Layer (SDL), a "cross-platform multimedia library". The SDL library
@@ -50,6 +51,8 @@
 #include <SDL/SDL_opengl.h>
 #include <SDL/SDL_thread.h>
 
+#include "SkeletonView.hpp"
+
 
 // Defaults to "127.0.0.1"
 const std::string Host = "127.0.0.1";
@@ -57,7 +60,7 @@ const std::string Host = "127.0.0.1";
 const unsigned Port = 32079;
 // Throttle down the main event and drawing loop to approximately
 // this frame rate, specified in milliseconds.
-const Uint32 TargetFrameRate = (1000/30);
+const Uint32 TargetFrameRate = (1000/60);
 
 
 /**
@@ -74,185 +77,30 @@ int sdl_thread_functor(void *instance)
 }
 
 /**
-  Scoped lock object for a SDL_mutex. Simply acquire an
-  exclusive lock for the lifetime of this object.
-
-  Example usage:
-  @code
-  SDL_mutex *mutex = SDL_CreateMutex();
-  {
-    sdl_mutex_lock lock(mutex);
-  
-    // This thread has the exclusive lock.
-
-  } // Lock object goes out of scope, release exclusive lock.
-  @endcode
-*/
-class sdl_mutex_lock {
-public:
-  /**
-    Acquire the exclusive lock for the mutex.
-
-    @param  mutex is a pointer to the mutex associated with this
-            exclusive lock
-    @pre    <tt>NULL != mutex</tt>
-    @pre    <tt>mutex</tt> is lockable with SDL_mutexP function
-    @throw  std::logic_error if <tt>NULL == mutex</tt>
-    @throw  std::runtime_error if <tt>0 != SDL_mutexP(mutex)</tt>,
-            <tt>mutex</tt> is not lockable
-  */
-  explicit sdl_mutex_lock(SDL_mutex *mutex)
-    : m_mutex(NULL)
-  {
-    if (NULL != mutex) {
-      if (0 == SDL_mutexP(mutex)) {
-        m_mutex = mutex;
-      } else {
-        throw std::runtime_error("failed to acquire exclusive lock");
-      }
-    } else {
-      throw std::logic_error("invalid mutex object");
-    }
-  }
-  /**
-    Release the exclusive lock.
-    
-    Does not throw any exceptions.
-  */
-  ~sdl_mutex_lock()
-  {
-    SDL_mutex *mutex = m_mutex;
-    m_mutex = NULL;
-
-    if (NULL != mutex) { 
-      // Do not check this. We could only throw an exception,
-      // which we do not want to do in the destructor anyways.
-      SDL_mutexV(mutex);
-    }
-  }
-private:
-  /**
-    Store the locked mutex such that we can release it in the
-    destructor.
-  */
-  SDL_mutex * m_mutex;
-
-  /** Disable the copy-constructor. */
-  sdl_mutex_lock(const sdl_mutex_lock &);
-
-  /** Disable the assignment operator. */
-  const sdl_mutex_lock & operator=(const sdl_mutex_lock &);
-}; // class sdl_mutex_lock
-
-
-/**
-  Encapsulate the OpenGL and Motion::SDK::Client code for the SDL example
-  application in this class. Implements most of the interface defined by the
+  Connect the Motion::SDK::Client code to the SkeletonView drawing code for the
+  SDL example application. Implements most of the interface defined by the
   "javax.media.opengl.GLEventListener" class used in the Java SDK.
 
   Also, implements a function object that connects to the Motion Service Preview
   stream and reads real-time orientation data. This should run in its own
-  thread. The ExampleSDL class handles synchronization of the transformation
-  matrix. Note that if there are multiple sensors, this will only use the first
-  one.
+  thread. It computes the transformation matrices of all of the nodes at once
+  and hands them to the drawing thread through a lock free triple buffer.
 */
 class ExampleSDL {
 public:
   ExampleSDL()
-    : m_mutex(NULL), m_transform(4*4), m_euler(3), m_quit(false)
-  {
-    m_mutex = SDL_CreateMutex();
-
-    for (int i=0; i<4; i++) {
-      m_transform[4*i+i] = 1;
-    }
-  }
-
-  ~ExampleSDL()
+    : m_view(), m_pose(), m_quit(0)
   {
-    if (NULL != m_mutex) {
-      SDL_DestroyMutex(m_mutex);
-      m_mutex = NULL;
-    }
   }
 
   /**
-    OpenGL function, draw the current frame.
+    OpenGL function, draw the current frame. Pick up the newest pose if
+    the client thread published one since the last frame.
   */
   void display()
   {
-    glClear(GL_COLOR_BUFFER_BIT);
-    glClear(GL_DEPTH_BUFFER_BIT);
-
-    {
-      // Draw a fixed mono-chromatic reference coordinate
-      // system of some sort.
-      glColor3f(0.7f, 0.7f, 0.7f);
-      glBegin(GL_LINES);
-      {
-        glVertex3f(-1, 0, 0);
-        glVertex3f(1, 0, 0);
-        glVertex3f(0, -1, 0);
-        glVertex3f(0, 1, 0);
-        glVertex3f(0, 0, -1);
-        glVertex3f(0, 0, 1);
-      }
-      glEnd();
-    }
-
-    {
-      // Transform a colored coordinate system by the current
-      // orientation state of this object.
-      glPushMatrix();
-      {
-        std::vector<float> transform;
-        std::vector<float> euler;
-        {
-          sdl_mutex_lock lock(m_mutex);
-          transform = m_transform;
-          euler = m_euler;
-        }
-
-        // Matrix based transformation.
-        if (4*4 == transform.size()) {
-          // Transpose matrix for OpenGL column-major order.
-          for (int i=0; i<4; i++) {
-            for (int j=(i+1); j<4; j++) {
-              float temp = transform[4*i+j];
-              transform[4*i+j] = transform[4*j+i];
-              transform[4*j+i] = temp;
-            }
-          }
-
-          glMultMatrixf(&transform[0]);
-        }
-
-        const float axis[3][3] = {
-          {1, 0, 0},
-          {0, 1, 0},
-          {0, 0, 1}
-        };
-
-        // Euler angle based transformation.
-        //if (3 == euler.size()) {
-        //  for (int i=2; i>=0; i--) {
-        //    glRotatef(euler[i] * (180.0/3.14), axis[i][0], axis[i][1], axis[i][2]);
-        //  }
-        //}
-
-
-        for (int i=0; i<3; i++) {
-          glColor3fv(axis[i]);
-          glBegin(GL_LINES);
-          {
-            glVertex3f(0, 0, 0);
-            glVertex3fv(axis[i]);
-          }
-          glEnd();
-        }
-      }
-      glPopMatrix();
-    }
+    m_pose.update();
+    m_view.display(m_pose.front());
   }
 
   /**
@@ -260,9 +108,9 @@ public:
   */
   void init()
   {
-    glClearColor(0, 0, 0, 0);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
+    if (!m_view.init()) {
+      std::cerr << "Instanced drawing not available, using immediate mode" << std::endl;
+    }
   }
 
   /**
@@ -270,24 +118,7 @@ public:
   */
   void reshape(int width, int height)
   {
-    if (height <= 0) {
-      height = 1;
-    }
-    float height_real = static_cast<float>(width) / static_cast<float>(height);
-
-    glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
-
-    glMatrixMode(GL_PROJECTION);
-    {	
-      glLoadIdentity();
-      gluPerspective(60, height_real, 1, 1000);
-    }
-
-    glMatrixMode(GL_MODELVIEW);
-    {
-      glLoadIdentity();
-      gluLookAt(-2, 2, 2, 0, 0, 0, 0, 1, 0);
-    }
+    m_view.reshape(width, height);
   }
 
   /**
@@ -295,8 +126,7 @@ public:
   */
   void quit()
   {
-    sdl_mutex_lock lock(m_mutex);
-    m_quit = true;
+    atomic_exchange(&m_quit, 1);
   }
 
   /**
@@ -315,57 +145,32 @@ public:
 
       std::cout << "Connected to " << Host << ":" << Port << std::endl;
 
-      bool quit_thread = false;
-      while (!quit_thread) {
+      // Reuse the message and the frame. Once they have seen the largest
+      // message, reading and decoding do not allocate any memory.
+      Client::data_type data;
+      Format::PreviewFrame frame;
 
-        // Make a check for the quit flag here.
-        {
-          sdl_mutex_lock lock(m_mutex);
-          if (m_quit) {
-            quit_thread = true;
-          }
-        }
+      while (0 == atomic_load(&m_quit)) {
 
         // Block on this call until a single data sample arrives from the
         // remote service. Use default time out of 5 seconds.
         if (client.waitForData()) {
 
-          // The Client#readData method will time out after 1 second. Then
+          // The Client#readLatest method will time out after 1 second. Then
           // just go back to the blocking Client#waitForData method to wait
-          // for more incoming data.
-          Client::data_type data;
-          while (!quit_thread && client.readData(data)) {
-
-            // We have a message from the remote Preview service. Use the
-            // Format::Preview method to create a std::map<integer,Format::PreviewElement>
-            // of all active device connections.
-
-            std::vector<float> transform;
-            std::vector<float> euler;
-            {
-              // Iterate through Nodes, but just grab the first one.
-              Format::preview_service_type preview = Format::Preview(data.begin(), data.end());
-              for (Format::preview_service_type::iterator itr=preview.begin(); itr!=preview.end(); ++itr) {
-                transform = itr->second.getMatrix(false);
-                euler = itr->second.getEuler();
-                break;
-              }
-            }
-
-            // Copy the new transformation matrix into the mutex protected
-            // state. The drawing thread reads this.
-            {
-              sdl_mutex_lock lock(m_mutex);
-              if (transform.size() == m_transform.size()) {
-                m_transform = transform;
-              }
-              if (euler.size() == m_euler.size()) {
-                m_euler = euler;
-              }
-              if (m_quit) {
-                quit_thread = true;
-                break;
-              }
+          // for more incoming data. We only draw the newest sample, skip any
+          // older ones that queued up while this thread was busy.
+          std::size_t dropped = 0;
+          while ((0 == atomic_load(&m_quit)) &&
+                 client.readLatest(data, dropped)) {
+
+            // We have a message from the remote Preview service. Decode all
+            // of the active nodes into one flat frame and compute all of
+            // their matrices at once. Then hand them over to the drawing
+            // thread, it picks them up at its own frame rate.
+            if (Format::Preview(data.begin(), data.end(), frame) &&
+                m_pose.back().assign(frame)) {
+              m_pose.publish();
             }
           }
 
@@ -386,20 +191,20 @@ public:
 
 private:
   /**
-    Mutex to synchronize internal state variables.
+    OpenGL drawing, accessed by the main thread only.
   */
-  SDL_mutex *m_mutex;
+  SkeletonView m_view;
 
   /**
-    Current 4-by-4 transformation matrix.
+    Transformation matrices of all nodes. Written by the client thread, read
+    by the drawing thread.
   */
-  std::vector<float> m_transform;
-  std::vector<float> m_euler;
+  triple_buffer<SkeletonPose> m_pose;
 
   /**
     Quit flag for the socket reading thread.
   */
-  bool m_quit;
+  volatile long m_quit;
 
   /** Disable the copy constructor. */
   ExampleSDL(const ExampleSDL &);
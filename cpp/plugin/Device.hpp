@@ -31,6 +31,8 @@
 #ifndef __MOTION_SDK_PLUGIN_DEVICE_HPP_
 #define __MOTION_SDK_PLUGIN_DEVICE_HPP_
 
+#include <algorithm>
+#include <deque>
 #include <map>
 #include <queue>
 #include <string>
@@ -40,6 +42,7 @@
   Depends on the Boost C++ libraries, available at http://www.boost.org/.
   Requires compilation of the Thread and System libraries.
 */
+#include <boost/atomic.hpp>
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/function.hpp>
@@ -51,6 +54,27 @@
 #include <Client.hpp>
 #include <Format.hpp>
 
+/**
+  Define MOTION_DEVICE_REACTOR to run all of the connections of a Manager on a
+  single Reactor thread instead of one Reader thread per connection.
+*/
+#if MOTION_DEVICE_REACTOR
+#  include <Reactor.hpp>
+#endif  // MOTION_DEVICE_REACTOR
+
+/**
+  Define MOTION_DEVICE_LOCKFREE to store the samples in a bounded lock free ring
+  instead of a mutex protected queue. The communication thread never blocks on
+  the readers and overwrites the oldest sample when the ring is full. Define
+  MOTION_DEVICE_LOCKFREE_CAPACITY to set the number of samples in the ring.
+*/
+#if MOTION_DEVICE_LOCKFREE
+#  include <plugin/Ring.hpp>
+#  ifndef MOTION_DEVICE_LOCKFREE_CAPACITY
+#    define MOTION_DEVICE_LOCKFREE_CAPACITY 64
+#  endif  // MOTION_DEVICE_LOCKFREE_CAPACITY
+#endif  // MOTION_DEVICE_LOCKFREE
+
 
 namespace Motion { namespace SDK { namespace Device {
 
@@ -258,6 +282,15 @@ class State {
     typename ConditionT
   >
   friend class Manager;
+
+  template <
+    typename SamplerT,
+    typename ThreadT,
+    typename MutexT,
+    typename LockT,
+    typename ConditionT
+  >
+  friend class SharedManager;
 }; // class State
 
 
@@ -267,34 +300,51 @@ class State {
   client application (the "main") and an asynchronous communication handler
   (the "thread"). The client application polls the Sampler instance at its own
   interval, independent of the rate of the associated data stream.
+
+  With MOTION_DEVICE_BUFFERED the queue of samples allocates from the
+  Allocator, for example detail::arena_allocator. The queue is only modified
+  with the Mutex locked, so an arena that is used by this queue alone does
+  not need any other locks.
 */
 template <
   typename Mutex,
   typename ScopedLock,
   typename Condition,
-  typename Data=Format::preview_service_type
+  typename Data=Format::preview_service_type,
+  typename Allocator=std::allocator<Data>
 >
 class Sampler {
 public:
   typedef Data data_type;
+  typedef Allocator allocator_type;
   typedef boost::function<bool ()> function_type;
   typedef Mutex mutex_type;
   typedef ScopedLock scoped_lock_type;
   typedef Condition condition_type;
+  typedef boost::shared_ptr<const Data> frame_type;
+  typedef Format::id_list_type key_list_type;
 
   Sampler(const std::string &address, const std::size_t &port,
           const std::string &initialize=std::string(),
-          const function_type &callback=function_type())
+          const function_type &callback=function_type(),
+          const allocator_type &allocator=allocator_type())
     : m_address(address), m_port(port), m_initialize(initialize), m_key(),
       m_sampler_id(),
-#if MOTION_DEVICE_BUFFERED
-      m_list_max(new std::size_t()), m_list(new list_type()),
+#if MOTION_DEVICE_LOCKFREE
+      m_ring(new ring_type(MOTION_DEVICE_LOCKFREE_CAPACITY)),
+      m_waiting(new waiting_type(0)),
+#elif MOTION_DEVICE_BUFFERED
+      m_list_max(new std::size_t()),
+      m_list(new list_type(
+        typename list_type::container_type(entry_allocator_type(allocator)))),
 #else
-      m_data(new data_type()),
-#endif  // MOTION_DEVICE_BUFFERED
+      m_data(new entry_type()),
+#endif  // MOTION_DEVICE_LOCKFREE
       m_mutex(new mutex_type()), m_condition(new condition_type()),
-      m_callback(callback)
+      m_callback(callback), m_statistics(new statistics_type())
   {
+    // Only the buffered queue allocates.
+    static_cast<void>(allocator);
   }
 
   virtual ~Sampler()
@@ -302,34 +352,75 @@ public:
   }
 
   virtual bool get_data(Data &data)
+  {
+    frame_type frame;
+    const bool result = get_data(frame);
+    copy_frame(frame, data);
+
+    return result;
+  }
+
+  virtual bool get_data_block(Data &data)
+  {
+    frame_type frame;
+    const bool result = get_data_block(frame);
+    copy_frame(frame, data);
+
+    return result;
+  }
+
+  virtual bool get_data_block(Data &data, const std::size_t &time_out_second)
+  {
+    frame_type frame;
+    const bool result = get_data_block(frame, time_out_second);
+    copy_frame(frame, data);
+
+    return result;
+  }
+
+  /**
+    Access the most recent sample without copying it. The frame is shared with
+    the communication thread and all of the other samplers on this stream, so
+    it must not be modified.
+
+    If this sampler filters by key the frame contains at least one of the
+    keys. It may contain other elements too, look the keys up with
+    frame->find(key).
+  */
+  bool get_data(frame_type &frame)
   {
     bool result = false;
 
-    data.clear();
+    frame.reset();
+#if MOTION_DEVICE_LOCKFREE
+    entry_type entry;
+    result = m_ring->pop(entry) && deliver(entry, frame);
+#else
     {
       ScopedLock lock(*m_mutex);
 #if MOTION_DEVICE_BUFFERED
-      if (!m_list->empty() && !m_list->front().empty()) {
-        data = m_list->front();
+      if (!m_list->empty() && deliver(m_list->front(), frame)) {
         m_list->pop();
         result = true;
       }
 #else
-      if (!m_data->empty()) {
-        data = *m_data;
-        result = true;
-      }
+      result = deliver(*m_data, frame);
 #endif // MOTION_DEVICE_BUFFERED
     }
+#endif  // MOTION_DEVICE_LOCKFREE
 
     return result;
   }
 
-  virtual bool get_data_block(Data &data)
+  bool get_data_block(frame_type &frame)
   {
     bool result = false;
 
-    data.clear();
+    frame.reset();
+#if MOTION_DEVICE_LOCKFREE
+    entry_type entry;
+    result = wait_data(entry, NULL) && deliver(entry, frame);
+#else
     {
       ScopedLock lock(*m_mutex);
 #if MOTION_DEVICE_BUFFERED
@@ -337,28 +428,25 @@ public:
         m_condition->wait(lock);
       }
 
-      if (!m_list->empty() && !m_list->front().empty()) {
-        data = m_list->front();
+      if (!m_list->empty() && deliver(m_list->front(), frame)) {
         m_list->pop();
         result = true;
       }
 #else
       m_condition->wait(lock);
-      if (!m_data->empty()) {
-        data = *m_data;
-        result = true;
-      }
+      result = deliver(*m_data, frame);
 #endif // MOTION_DEVICE_BUFFERED
     }
+#endif  // MOTION_DEVICE_LOCKFREE
 
     return result;
   }
 
-  virtual bool get_data_block(Data &data, const std::size_t &time_out_second)
+  bool get_data_block(frame_type &frame, const std::size_t &time_out_second)
   {
     bool result = false;
 
-    data.clear();
+    frame.reset();
     {
       boost::xtime timestamp;
       {
@@ -370,25 +458,26 @@ public:
         timestamp.sec += time_out_second;
       }
 
+#if MOTION_DEVICE_LOCKFREE
+      entry_type entry;
+      result = wait_data(entry, &timestamp) && deliver(entry, frame);
+#else
       ScopedLock lock(*m_mutex);
 #if MOTION_DEVICE_BUFFERED
       if (m_list->empty()) {
         m_condition->timed_wait(lock, timestamp);
       }
 
-      if (!m_list->empty() && !m_list->front().empty()) {
-        data = m_list->front();
+      if (!m_list->empty() && deliver(m_list->front(), frame)) {
         m_list->pop();
         result = true;
       }
 #else
       if (m_condition->timed_wait(lock, timestamp)) {
-        if (!m_data->empty()) {
-          data = *m_data;
-          result = true;
-        }
+        result = deliver(*m_data, frame);
       }
 #endif  // MOTION_DEVICE_BUFFERED
+#endif  // MOTION_DEVICE_LOCKFREE
     }
 
     return result;
@@ -414,9 +503,46 @@ public:
     return m_state.xml_string();
   }
 
+  /**
+    Only return the element with this key from the get_data methods. Set to
+    zero to return all of them. Call this before Manager#attach.
+  */
+  void set_key(const std::size_t &value)
+  {
+    m_key.clear();
+    if (std::size_t() != value) {
+      m_key.push_back(value);
+    }
+  }
+
+  /**
+    Only return the elements with these keys from the get_data methods. Skip
+    frames that contain none of them. An empty list returns all of the
+    elements. Call this before Manager#attach.
+
+    If every sampler on a data stream has a key list, the Manager only
+    decodes the elements with those keys. The rest of each message is
+    validated but never copied or byte swapped.
+  */
+  void set_key(const key_list_type &value)
+  {
+    m_key = value;
+    std::sort(m_key.begin(), m_key.end());
+    m_key.erase(std::unique(m_key.begin(), m_key.end()), m_key.end());
+  }
+
+  /** @see Sampler#set_key */
+  const key_list_type &get_key() const
+  {
+    return m_key;
+  }
+
   bool set_list_maximum(const std::size_t &value)
   {
-#if MOTION_DEVICE_BUFFERED
+#if MOTION_DEVICE_LOCKFREE
+    m_ring->maximum(value);
+    return true;
+#elif MOTION_DEVICE_BUFFERED
     {
       ScopedLock lock(*m_mutex);
       *m_list_max = value;
@@ -429,7 +555,9 @@ public:
 
   std::size_t get_list_size() const
   {
-#if MOTION_DEVICE_BUFFERED
+#if MOTION_DEVICE_LOCKFREE
+    return m_ring->size();
+#elif MOTION_DEVICE_BUFFERED
     {
       ScopedLock lock(*m_mutex);
       return m_list->size();
@@ -439,6 +567,40 @@ public:
 #endif // MOTION_DEVICE_BUFFERED
   }
 
+  /**
+    Number of samples that the communication thread overwrote before they were
+    read. Only counted in MOTION_DEVICE_LOCKFREE mode.
+  */
+  std::size_t get_list_dropped() const
+  {
+#if MOTION_DEVICE_LOCKFREE
+    return m_ring->dropped();
+#else
+    return 0;
+#endif // MOTION_DEVICE_LOCKFREE
+  }
+
+  /** Queue statistics. @see detail::sampler_statistics */
+  typedef detail::sampler_statistics statistics_type;
+
+  /**
+    Copy the queue depth and dwell time statistics of this sampler. Only
+    available with MOTION_SDK_INSTRUMENT.
+
+    @return true iff the instrumentation is compiled in
+  */
+  bool get_statistics(statistics_type &result) const
+  {
+#if MOTION_SDK_INSTRUMENT
+    ScopedLock lock(*m_mutex);
+    result = *m_statistics;
+    return true;
+#else
+    result = statistics_type();
+    return false;
+#endif  // MOTION_SDK_INSTRUMENT
+  }
+
  protected:
   /**
     Called by communication thread this sampler is currently attached to.
@@ -448,39 +610,46 @@ public:
     thread callbacks so hopefully that will cover everyone.
   */
   virtual bool set_data(const Data &data)
+  {
+    return set_data(frame_type(new Data(data)));
+  }
+
+  /**
+    The Manager decodes each message once and passes the same immutable frame
+    to all of the samplers attached to that stream. Store a reference to it,
+    not a copy. If we filter by key, only accept frames that contain one of
+    the allowed elements. The get_data methods copy out just those elements.
+  */
+  virtual bool set_data(const frame_type &frame)
   {
     bool result = false;
 
-    // Copy the incoming data into the buffer local to this instance.
+    const bool accept = is_accepted(*frame);
+
+    const entry_type entry(frame);
+
+#if MOTION_DEVICE_LOCKFREE
+    // Overwriting the oldest sample in a full ring is the expected behavior of
+    // the lock free mode, not an error.
+    if (accept) {
+      m_ring->push(entry);
+      result = true;
+
+#if MOTION_SDK_INSTRUMENT
+      ScopedLock lock(*m_mutex);
+      record_store(m_ring->size());
+#endif  // MOTION_SDK_INSTRUMENT
+    }
+#else
     {
       ScopedLock lock(*m_mutex);
-      if (std::size_t() == m_key) {
-        // Wholesale buffer copy.
+      if (accept) {
 #if MOTION_DEVICE_BUFFERED
-        m_list->push(data);
+        m_list->push(entry);
 #else
-        *m_data = data;
+        *m_data = entry;
 #endif  // MOTION_DEVICE_BUFFERED
         result = true;
-      } else {
-        // Filter by key. Actually, just look up the one allowed key and copy
-        // that element.
-        Data filtered_data;
-        {
-          typename Data::const_iterator itr = data.find(m_key);
-          if (data.end() != itr) {
-            filtered_data.insert(*itr);
-          }
-        }
-
-        if (!filtered_data.empty()) {
-#if MOTION_DEVICE_BUFFERED
-          m_list->push(data);
-#else
-          *m_data = data;
-#endif  // MOTION_DEVICE_BUFFERED
-          result = true;
-        }
       }
 
 #if MOTION_DEVICE_BUFFERED
@@ -500,7 +669,18 @@ public:
         }
       }
 #endif  // MOTION_DEVICE_BUFFERED
+
+#if MOTION_SDK_INSTRUMENT
+      if (accept) {
+#if MOTION_DEVICE_BUFFERED
+        record_store(m_list->size());
+#else
+        record_store(1);
+#endif  // MOTION_DEVICE_BUFFERED
+      }
+#endif  // MOTION_SDK_INSTRUMENT
     }
+#endif  // MOTION_DEVICE_LOCKFREE
 
     // Notify the listening class in this
     // thread that a new sample has arrived.
@@ -512,18 +692,166 @@ public:
     // Notify other polling threads that may
     // be blocking in get_data_block() that
     // a new sample has arrived.
+#if MOTION_DEVICE_LOCKFREE
+    // Only touch the mutex if there is a reader in wait_data. Lock and unlock
+    // it so the notify can not fall between the reader's last pop and wait.
+    if (m_waiting->load() > 0) {
+      {
+        ScopedLock lock(*m_mutex);
+      }
+      m_condition->notify_all();
+    }
+#else
     m_condition->notify_all();
+#endif  // MOTION_DEVICE_LOCKFREE
 
     return result;
   }
 
  private:
+  /**
+    Stored sample. Keep the time that it was stored to measure how long it
+    waits for a reader, only set with MOTION_SDK_INSTRUMENT.
+  */
+  struct entry_type {
+    entry_type()
+      : frame(), time(0)
+    {
+    }
+
+    explicit entry_type(const frame_type &frame_in)
+      : frame(frame_in), time(0)
+    {
+#if MOTION_SDK_INSTRUMENT
+      time = detail::monotonic_time();
+#endif  // MOTION_SDK_INSTRUMENT
+    }
+
+    frame_type frame;
+    double time;
+  }; // struct entry_type
+
   /**
     Queue of data. Save multiple samples since we
     may receive more than one between calls to
     read_data.
   */
-  typedef typename std::queue<Data> list_type;
+  typedef typename Allocator::template rebind<entry_type>::other
+    entry_allocator_type;
+  typedef typename std::queue<
+    entry_type, std::deque<entry_type, entry_allocator_type>
+  > list_type;
+
+  /**
+    Hand a stored sample to the caller. Record how long it waited. Called with
+    the mutex locked, except in the lock free mode.
+  */
+  bool deliver(const entry_type &entry, frame_type &frame)
+  {
+    if (!entry.frame || entry.frame->empty()) {
+      return false;
+    }
+
+    frame = entry.frame;
+
+#if MOTION_SDK_INSTRUMENT
+    {
+#if MOTION_DEVICE_LOCKFREE
+      ScopedLock lock(*m_mutex);
+#endif  // MOTION_DEVICE_LOCKFREE
+      ++m_statistics->delivered;
+      m_statistics->dwell.add(detail::monotonic_time() - entry.time);
+    }
+#endif  // MOTION_SDK_INSTRUMENT
+
+    return true;
+  }
+
+#if MOTION_SDK_INSTRUMENT
+  /** Called with the mutex locked after a sample is stored. */
+  void record_store(const std::size_t &depth)
+  {
+    ++m_statistics->stored;
+    if (depth > m_statistics->depth_max) {
+      m_statistics->depth_max = depth;
+    }
+  }
+#endif  // MOTION_SDK_INSTRUMENT
+
+  /** @return true if the frame contains any of our keys */
+  bool is_accepted(const Data &frame) const
+  {
+    if (m_key.empty()) {
+      return true;
+    }
+
+    BOOST_FOREACH (const std::size_t &key, m_key) {
+      if (frame.end() != frame.find(key)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+    Copy a shared frame out to the caller. If we filter by key this is the
+    only place that builds the filtered container.
+  */
+  void copy_frame(const frame_type &frame, Data &data) const
+  {
+    data.clear();
+    if (frame) {
+      if (m_key.empty()) {
+        data = *frame;
+      } else {
+        BOOST_FOREACH (const std::size_t &key, m_key) {
+          typename Data::const_iterator itr = frame->find(key);
+          if (frame->end() != itr) {
+            data.insert(data.end(), *itr);
+          }
+        }
+      }
+    }
+  }
+
+#if MOTION_DEVICE_LOCKFREE
+  typedef ring_buffer<entry_type> ring_type;
+  typedef boost::atomic<std::size_t> waiting_type;
+
+  /**
+    Pop a frame from the ring, block on the condition if it is empty. Wait
+    once, like the other get_data_block methods.
+  */
+  bool wait_data(entry_type &entry, const boost::xtime *timestamp)
+  {
+    bool result = m_ring->pop(entry);
+    if (!result) {
+      // Announce this reader before the last check of the ring. The writer
+      // reads the count after its push.
+      m_waiting->fetch_add(1);
+      {
+        ScopedLock lock(*m_mutex);
+        result = m_ring->pop(entry);
+        if (!result) {
+          bool notified = true;
+          if (NULL == timestamp) {
+            m_condition->wait(lock);
+          } else {
+            notified = m_condition->timed_wait(lock, *timestamp);
+          }
+
+          if (notified) {
+            result = m_ring->pop(entry);
+          }
+        }
+      }
+      m_waiting->fetch_sub(1);
+    }
+
+    return result;
+  }
+#endif  // MOTION_DEVICE_LOCKFREE
 
   /** Remote IP address of the data service. */
   std::string m_address;
@@ -537,13 +865,22 @@ public:
   */
   std::string m_initialize;
 
-  /** Identifier of the node data to return. */
-  std::size_t m_key;
+  /** Sorted identifiers of the node data to return, empty for all. */
+  key_list_type m_key;
 
   /** For internal usage only. Unique id for the Manager. */
   std::size_t m_sampler_id;
 
-#if MOTION_DEVICE_BUFFERED
+#if MOTION_DEVICE_LOCKFREE
+  /**
+    Ring of shared frames. Written by the communication thread only, read
+    by any number of polling threads.
+  */
+  boost::shared_ptr<ring_type> m_ring;
+
+  /** Number of readers blocked in wait_data. */
+  boost::shared_ptr<waiting_type> m_waiting;
+#elif MOTION_DEVICE_BUFFERED
   /**
     Maximum size of the sample queue. Defaults to a single
     sample. Set to zero for unlimited queue size.
@@ -556,11 +893,11 @@ public:
   boost::shared_ptr<list_type> m_list;
 #else
   /**
-    Internal data buffer. Each sampler instance has
-    its own copy of the data.
+    Most recent frame. Shared with the other samplers
+    attached to this stream.
   */
-  boost::shared_ptr<Data> m_data;
-#endif  // MOTION_DEVICE_BUFFERED
+  boost::shared_ptr<entry_type> m_data;
+#endif  // MOTION_DEVICE_LOCKFREE
 
   /** Protects the queue of data. */
   boost::shared_ptr<Mutex> m_mutex;
@@ -574,6 +911,9 @@ public:
   */
   boost::function<void ()> m_callback;
 
+  /** Queue statistics, only updated with MOTION_SDK_INSTRUMENT. */
+  boost::shared_ptr<statistics_type> m_statistics;
+
   State<Mutex,ScopedLock> m_state;
 
   template <
@@ -584,11 +924,27 @@ public:
     typename ConditionT
   >
   friend class Manager;
+
+  template <
+    typename SamplerT,
+    typename ThreadT,
+    typename MutexT,
+    typename LockT,
+    typename ConditionT
+  >
+  friend class SharedManager;
 }; // class Sampler
 
 
 /**
   Implements I/O thread for a single connection to a Motion Service data stream.
+
+  If reconnect is enabled, a lost or failed connection does not end the
+  thread. Wait and connect again, with a delay that starts at
+  ReconnectDelayMinimum milliseconds and doubles after every failed attempt
+  up to the maximum. The initialization string is sent again on every new
+  connection. The thread only quits on request or if the data callback
+  returns false.
 */
 template <
   typename DataFunction,
@@ -598,49 +954,174 @@ template <
 >
 class Reader : private boost::noncopyable {
 public:
+  /**
+    Called in the I/O thread with <tt>true</tt> when a connection opens and
+    <tt>false</tt> when it closes. Must not throw.
+  */
+  typedef boost::function<void (bool)> connection_function_type;
+
+  enum {
+    /** First reconnect delay, in milliseconds. */
+    ReconnectDelayMinimum = 100
+  };
+
   Reader(const std::string &address, const std::size_t &port,
          const std::string &initialize, DataFunction data_fn=DataFunction())
     : m_address(address), m_port(port), m_initialize(initialize),
-      m_data_fn(data_fn), m_state(), m_running()
+      m_data_fn(data_fn), m_connection_fn(), m_reconnect_maximum(0),
+      m_state(), m_running(), m_wait_mutex(), m_wait_condition()
   {
   }
 
   void operator()()
   {
-    try {
-      // Initialize book keeping flags.
+    std::size_t delay = ReconnectDelayMinimum;
+    for (;;) {
+      if (run()) {
+        delay = ReconnectDelayMinimum;
+      }
+
+      // Give up, or back off and try again.
+      if (m_state.quit() || (0 == m_reconnect_maximum) || !wait(delay)) {
+        break;
+      }
+
+      delay = std::min(2 * delay, m_reconnect_maximum);
+    }
+
+    // Initialize book keeping flags. Only when the Client object goes out of
+    // scope do we say that we are no longer connected.
+    {
       m_state.connected(false);
       m_state.reading(false);
 
+      m_state.quit(true);
+    }
 
-      // Open a connection to the Motion Service Preview stream running
-      // on Host:Port.
-      Client client(m_address, static_cast<unsigned>(m_port));
+    // Send a signal that we are no longer connected. This will propagate
+    // through the regular pipeline and notify any Sampler objects that we are
+    // going to quit.
+    if (m_data_fn) {
+      m_data_fn(Client::data_type());
+    }
 
-      // Enter the connected state.
-      m_state.connected(true);
+    // Note, if the main thread is blocking on the running flag we cannot call
+    // the data callback. We will enter sweet enternal deadlock. Set the running
+    // flag to a determined value so that running will unblock.
+    m_running = false;
+  }
 
-      // Send initialization string to the data service if
-      // we have one.
-      if (!m_initialize.empty()) {
-        Client::data_type data(m_initialize.begin(), m_initialize.end());
-        if (client.writeData(data)) {
-          // Success. But no need for feedback on this one.
-        }
-      }
+  void quit(bool value)
+  {
+    m_state.quit(value);
 
-      // We have opened up a connection. Enter the thread loop and assume that
-      // we have successfully started running this thread.
-      m_running = true;
+    // Wake up a reconnect delay. Lock and unlock the mutex so the notify can
+    // not fall between the quit check and the wait.
+    {
+      Lock lock(m_wait_mutex);
+    }
+    m_wait_condition.notify_all();
+  }
 
-      std::string xml_string;
-      while (!m_state.quit()) {
+  void set_data_fn(const DataFunction &fn)
+  {
+    m_data_fn = fn;
+  }
 
-        // Block on this call until a single data sample arrives from the remote
-        // service, timing out after the default time period (5 seconds).
-        if (client.waitForData() && !m_state.quit()) {
+  /** Call before the thread starts. */
+  void set_connection_fn(const connection_function_type &fn)
+  {
+    m_connection_fn = fn;
+  }
 
-          // Enter the reading state. 
+  /**
+    Call before the thread starts.
+
+    @param  maximum_delay_millisecond longest delay between two connection
+            attempts, 0 value disables reconnect
+  */
+  void set_reconnect(const std::size_t &maximum_delay_millisecond)
+  {
+    m_reconnect_maximum = maximum_delay_millisecond;
+    if ((m_reconnect_maximum > 0) &&
+        (m_reconnect_maximum < ReconnectDelayMinimum)) {
+      m_reconnect_maximum = ReconnectDelayMinimum;
+    }
+  }
+
+ private:
+  /** Remote IP address of the data service. */
+  const std::string m_address;
+
+  /** Remote port number of the data service. */
+  const std::size_t m_port;
+
+  /** Service intialization string. */
+  const std::string m_initialize;
+
+  /** Callback function for incoming data. */
+  DataFunction m_data_fn;
+  connection_function_type m_connection_fn;
+  std::size_t m_reconnect_maximum;
+  State<Mutex,Lock> m_state;
+  blocking_bool<Mutex,Lock,Condition> m_running;
+
+  /** Interrupt the reconnect delay on quit. */
+  Mutex m_wait_mutex;
+  Condition m_wait_condition;
+
+  /**
+    Open one connection and read from it until it closes or we quit.
+
+    @return true iff the connection was opened
+  */
+  bool run()
+  {
+    bool result = false;
+
+    try {
+      // Initialize book keeping flags.
+      m_state.connected(false);
+      m_state.reading(false);
+
+
+      // Open a connection to the Motion Service Preview stream running
+      // on Host:Port.
+      Client client(m_address, static_cast<unsigned>(m_port));
+      if (!client.isConnected()) {
+        // Without exceptions the Client constructor does not report a
+        // failed connection. Take the same path as the throw.
+        return result;
+      }
+
+      // Enter the connected state.
+      m_state.connected(true);
+      result = true;
+      if (m_connection_fn) {
+        m_connection_fn(true);
+      }
+
+      // Send initialization string to the data service if
+      // we have one.
+      if (!m_initialize.empty()) {
+        Client::data_type data(m_initialize.begin(), m_initialize.end());
+        if (client.writeData(data)) {
+          // Success. But no need for feedback on this one.
+        }
+      }
+
+      // We have opened up a connection. Enter the thread loop and assume that
+      // we have successfully started running this thread.
+      m_running = true;
+
+      std::string xml_string;
+      while (!m_state.quit()) {
+
+        // Block on this call until a single data sample arrives from the remote
+        // service, timing out after the default time period (5 seconds).
+        if (client.waitForData() && !m_state.quit()) {
+
+          // Enter the reading state. 
           m_state.reading(true);
 
           // The Client#readData method will time out after 1 second. Then just
@@ -669,6 +1150,11 @@ public:
           // Leave the reading state.
           m_state.reading(false);
         }
+
+        // The service closed the connection.
+        if (!client.isConnected()) {
+          break;
+        }
       }
 
 #if MOTION_SDK_USE_EXCEPTIONS
@@ -677,52 +1163,46 @@ public:
     } catch (...) {
     }
 
-    // Initialize book keeping flags. Only when the Client object goes out of
-    // scope do we say that we are no longer connected.
-    {
-      m_state.connected(false);
-      m_state.reading(false);
-
-      m_state.quit(true);
+    m_state.connected(false);
+    m_state.reading(false);
+    if (result && m_connection_fn) {
+      m_connection_fn(false);
     }
 
-    // Send a signal that we are no longer connected. This will propagate
-    // through the regular pipeline and notify any Sampler objects that we are
-    // going to quit.
-    if (m_data_fn) {
-      m_data_fn(Client::data_type());
-    }
-
-    // Note, if the main thread is blocking on the running flag we cannot call
-    // the data callback. We will enter sweet enternal deadlock. Set the running
-    // flag to a determined value so that running will unblock.
-    m_running = false;
+    return result;
   }
 
-  void quit(bool value)
-  {
-    m_state.quit(value);
-  }
+  /**
+    Wait for a quit request.
 
-  void set_data_fn(const DataFunction &fn)
+    @return false iff we should quit
+  */
+  bool wait(const std::size_t &millisecond)
   {
-    m_data_fn = fn;
-  }
-
- private:
-  /** Remote IP address of the data service. */
-  const std::string m_address;
-
-  /** Remote port number of the data service. */
-  const std::size_t m_port;
+    boost::xtime timestamp;
+    {
+#if BOOST_VERSION < 105000
+      boost::xtime_get(&timestamp, boost::TIME_UTC);
+#else
+      boost::xtime_get(&timestamp, boost::TIME_UTC_);
+#endif // BOOST_VERSION
+      timestamp.sec += millisecond / 1000;
+      timestamp.nsec += static_cast<int>((millisecond % 1000) * 1000000);
+      if (timestamp.nsec >= 1000000000) {
+        timestamp.sec += 1;
+        timestamp.nsec -= 1000000000;
+      }
+    }
 
-  /** Service intialization string. */
-  const std::string m_initialize;
+    Lock lock(m_wait_mutex);
+    while (!m_state.quit()) {
+      if (!m_wait_condition.timed_wait(lock, timestamp)) {
+        break;
+      }
+    }
 
-  /** Callback function for incoming data. */
-  DataFunction m_data_fn;
-  State<Mutex,Lock> m_state;
-  blocking_bool<Mutex,Lock,Condition> m_running;
+    return !m_state.quit();
+  }
 
   template <
     typename SamplerT,
@@ -742,6 +1222,11 @@ public:
 template <typename FormatType>
 FormatType format_data(const Client::data_type &data);
 
+/** Only decode the elements with an id in the sorted list. */
+template <typename FormatType>
+FormatType format_data(const Client::data_type &data,
+                       const Format::id_list_type &id);
+
 template <>
 Format::configurable_service_type format_data(const Client::data_type &data);
 
@@ -754,12 +1239,116 @@ Format::sensor_service_type format_data(const Client::data_type &data);
 template <>
 Format::raw_service_type format_data(const Client::data_type &data);
 
+template <>
+Format::configurable_service_type format_data(const Client::data_type &data,
+                                              const Format::id_list_type &id);
+
+template <>
+Format::preview_service_type format_data(const Client::data_type &data,
+                                         const Format::id_list_type &id);
+
+template <>
+Format::sensor_service_type format_data(const Client::data_type &data,
+                                        const Format::id_list_type &id);
+
+template <>
+Format::raw_service_type format_data(const Client::data_type &data,
+                                     const Format::id_list_type &id);
+
+/**
+  Decode into an existing container and reuse its map nodes and element
+  buffers. See the output container overloads of Format#Configurable.
+*/
+template <typename FormatType>
+bool format_data(const Client::data_type &data, FormatType &result);
+
+template <>
+bool format_data(const Client::data_type &data,
+                 Format::configurable_service_type &result);
+
+template <>
+bool format_data(const Client::data_type &data,
+                 Format::preview_service_type &result);
+
+template <>
+bool format_data(const Client::data_type &data,
+                 Format::sensor_service_type &result);
+
+template <>
+bool format_data(const Client::data_type &data,
+                 Format::raw_service_type &result);
+
+
+/**
+  Recycle the decoded frames that the Manager shares with its samplers. A frame
+  is free once the pool holds the only reference to it.
+*/
+template <
+  typename Data,
+  typename Mutex,
+  typename Lock
+>
+class frame_pool : private boost::noncopyable {
+ public:
+  typedef boost::shared_ptr<Data> pointer_type;
+
+  /**
+    @param  maximum keep at most this many frames, allocate a new one
+            that is not pooled if they are all in use
+  */
+  explicit frame_pool(const std::size_t &maximum)
+    : m_maximum(maximum), m_mutex(), m_list()
+  {
+  }
+
+  /**
+    Return a frame that no sampler is holding on to. It still holds an older
+    message, decode over it to reuse the memory or clear it.
+  */
+  pointer_type get()
+  {
+    Lock lock(m_mutex);
+
+    BOOST_FOREACH (pointer_type &item, m_list) {
+      if (item.unique()) {
+        // Pairs with the release in the last sampler's shared_ptr reset.
+        // Its reads of the frame happen before the caller modifies it.
+        boost::atomic_thread_fence(boost::memory_order_acquire);
+        return item;
+      }
+    }
+
+    pointer_type result(new Data());
+    if (m_list.size() < m_maximum) {
+      m_list.push_back(result);
+    }
+
+    return result;
+  }
+
+ private:
+  std::size_t m_maximum;
+  Mutex m_mutex;
+  std::vector<pointer_type> m_list;
+}; // class frame_pool
+
 
 /**
   Container for Reader and Sampler objects. Run a Reader thread
   for each Host:Port pair, route the data to any Sampler objects
   that are currently attached. A Reader thread lasts only as long
   as there is at least one Sampler attached.
+
+  If MOTION_DEVICE_REACTOR is defined then there is a single I/O thread
+  for all Host:Port pairs. It waits on all of the connections at once with a
+  Reactor. The connection is made in the call to Manager#attach.
+
+  Optional behavior, set these before the first call to attach.
+  - Manager#set_reconnect, the Reader thread reconnects with backoff after a
+    lost connection instead of closing the data stream
+  - Manager#set_keep_alive, keep the connection, and its initialization, open
+    after the last Sampler detaches so the next attach reuses it
+  - Manager#set_connection_fn, report connection changes from the I/O thread
 */
 template <
   typename SamplerType,
@@ -772,22 +1361,186 @@ class Manager {
  public:
   typedef SamplerType sampler_type;
   typedef typename sampler_type::data_type data_type;
+  typedef typename sampler_type::frame_type frame_type;
+
+  /**
+    Called in the I/O thread with the Host, Port and <tt>true</tt> when a
+    connection opens and <tt>false</tt> when it closes. Must not throw.
+  */
+  typedef boost::function<
+    void (const std::string &, const std::size_t &, bool)
+  > connection_function_type;
 
   Manager()
-    : m_id(), m_container(), m_mutex()
+    : m_id(), m_container(), m_mutex(), m_frame_pool(FramePoolSize),
+      m_reconnect_maximum(0), m_keep_alive(false), m_connection_fn()
+#if MOTION_DEVICE_REACTOR
+      , m_reactor(), m_reactor_handler(*this), m_reactor_thread(),
+      m_reactor_quit(false), m_reactor_add(), m_reactor_remove(),
+      m_reactor_key(), m_reactor_buffer(), m_reactor_xml_string()
+#else
+      , m_closing()
+#endif  // MOTION_DEVICE_REACTOR
   {
   }
 
   ~Manager()
   {
-    lock_type lock(m_mutex);
+#if MOTION_DEVICE_REACTOR
+    {
+      lock_type lock(m_mutex);
+      m_reactor_quit = true;
+    }
 
-    BOOST_FOREACH (typename container_type::value_type &item, m_container) {
-      item.second.close();
+    if (m_reactor_thread) {
+      m_reactor.interrupt();
+      m_reactor_thread->join();
     }
+#else
+    {
+      lock_type lock(m_mutex);
+
+      typename container_type::iterator itr = m_container.begin();
+      while (m_container.end() != itr) {
+        typename container_type::iterator current = itr++;
+        if (current->second.m_sampler_container.empty()) {
+          remove_node(current);
+        }
+      }
+    }
+
+    join_closing();
+#endif  // MOTION_DEVICE_REACTOR
   }
 
+  /**
+    Attach the sampler to its data stream. Open a new connection if there is
+    not one already and wait up to 5 seconds for it.
+  */
   bool attach(sampler_type &sampler)
+  {
+    const bool result = attach_impl(sampler, true);
+    join_closing();
+    return result;
+  }
+
+  /**
+    Attach the sampler to its data stream but do not wait for a new
+    connection to open. Use Sampler#is_connected, or the connection callback,
+    to find out when data is ready. Not supported with MOTION_DEVICE_REACTOR,
+    the reactor connects before it returns, the same as attach.
+  */
+  bool attach_async(sampler_type &sampler)
+  {
+    const bool result = attach_impl(sampler, false);
+    join_closing();
+    return result;
+  }
+
+  bool detach(sampler_type &sampler)
+  {
+    if (0 == sampler.m_sampler_id) {
+      // Not currently attached, or some other error.
+#if MOTION_SDK_USE_EXCEPTIONS
+      throw detail::error("sampler not attached to data stream");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+      return false;
+    }
+
+    {
+      lock_type lock(m_mutex);
+
+      // Create the map key that we can reference this address:port pair with.
+      typedef typename container_type::value_type::first_type key_type;
+      const key_type key(
+        sampler.m_address, sampler.m_port, sampler.m_initialize);
+
+      // Look up the thread attached to the address:port pair
+      // requested by the incoming sampler.
+      typename container_type::iterator node_itr = m_container.find(key);
+      if (m_container.end() != node_itr) {
+        // Iterate through all Sampler objects listening for data on from this
+        // address:port:XML tuple.
+        typename Node::sampler_container_type::iterator itr =
+          node_itr->second.m_sampler_container.begin();
+        for (; itr!=node_itr->second.m_sampler_container.end(); ++itr) {
+          if (sampler.m_sampler_id == itr->m_sampler_id) {
+            break;
+          }
+        }
+
+        if (node_itr->second.m_sampler_container.end() != itr) {
+          node_itr->second.m_sampler_container.erase(itr);
+          node_itr->second.update_key();
+          sampler.m_sampler_id = 0;
+
+          // If we just remove the last sampler that is attached
+          // to this reader thread, close down the thread. Unless we keep the
+          // connection around for the next sampler.
+          if (node_itr->second.m_sampler_container.empty() && !m_keep_alive) {
+            remove_node(node_itr);
+          }
+        }
+      }
+    }
+
+    join_closing();
+
+    return true;
+  }
+
+  /**
+    Reconnect after a lost connection, or a failed first connection attempt.
+    Wait 100 milliseconds before the first attempt and double the delay after
+    every failure, up to the maximum. Applies to data streams opened after this
+    call. Not supported with MOTION_DEVICE_REACTOR.
+
+    @param  maximum_delay_millisecond 0 value disables reconnect, which is
+            the default
+  */
+  void set_reconnect(const std::size_t &maximum_delay_millisecond)
+  {
+    lock_type lock(m_mutex);
+    m_reconnect_maximum = maximum_delay_millisecond;
+  }
+
+  /**
+    If true, leave a data stream open after the last Sampler detaches from it.
+    The next attach with the same Host:Port:initialize key reuses the open
+    connection. If false, close all of the idle data streams now.
+  */
+  void set_keep_alive(bool value)
+  {
+    {
+      lock_type lock(m_mutex);
+      m_keep_alive = value;
+
+      if (!m_keep_alive) {
+        typename container_type::iterator itr = m_container.begin();
+        while (m_container.end() != itr) {
+          typename container_type::iterator current = itr++;
+          if (current->second.m_sampler_container.empty()) {
+            remove_node(current);
+          }
+        }
+      }
+    }
+
+    join_closing();
+  }
+
+  /**
+    Applies to data streams opened after this call. Not supported with
+    MOTION_DEVICE_REACTOR.
+  */
+  void set_connection_fn(const connection_function_type &fn)
+  {
+    lock_type lock(m_mutex);
+    m_connection_fn = fn;
+  }
+
+private:
+  bool attach_impl(sampler_type &sampler, bool block)
   {
     if (0 != sampler.m_sampler_id) {
       // Already attached, or some other error.
@@ -816,6 +1569,13 @@ class Manager {
     // Look up the thread attached to the address:port pair
     // requested by the incoming sampler.
     typename container_type::iterator itr = m_container.find(key);
+    if ((m_container.end() != itr) && itr->second.state().quit() &&
+        itr->second.m_sampler_container.empty()) {
+      // An idle data stream that has since closed. Start over.
+      remove_node(itr);
+      itr = m_container.end();
+    }
+
     if (itr == m_container.end()) {
       itr = m_container.insert(
         std::make_pair(key, Node())).first;
@@ -826,12 +1586,52 @@ class Manager {
 #endif  // MOTION_SDK_USE_EXCEPTIONS
         return false;
       } else {
+#if MOTION_DEVICE_REACTOR
+        // The reactor always connects in this thread, see attach_async.
+        (void)block;
+
         // Initialize the Node.
-        // 1. Spawn a communications thread.
+        // 1. Open the connection.
+        if (!reactor_connect(itr->second, sampler.m_address, sampler.m_port,
+                             sampler.m_initialize)) {
+          m_container.erase(itr);
+          itr = m_container.end();
+
+#if MOTION_SDK_USE_EXCEPTIONS
+          throw detail::error("failed to connect to data stream");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+          return false;
+        }
+
+        // 2. Hand it over to the reactor thread.
+        m_reactor_key.insert(std::make_pair(
+          itr->second.m_client.get(), boost::shared_ptr<const key_type>(
+            new key_type(key))));
+        m_reactor_add.push_back(itr->second.m_client);
+        if (!m_reactor_thread) {
+          m_reactor_thread = boost::shared_ptr<Thread>(new Thread(
+            boost::bind(&Manager::reactor_run, this)));
+        }
+        m_reactor.interrupt();
+#else
+        // Initialize the Node.
+        // 1. Spawn a communications thread. If we are not going to wait for
+        // it, register the data callback function before the thread starts.
+        // Otherwise the thread may not call back into this object until we
+        // are done waiting, see Reader#operator().
         boost::shared_ptr<typename Node::reader_type> reader(
-          new typename Node::reader_type(sampler.m_address,
-                                         sampler.m_port,
-                                         sampler.m_initialize));
+          new typename Node::reader_type(
+            sampler.m_address, sampler.m_port, sampler.m_initialize));
+        if (!block) {
+          reader->set_data_fn(
+            boost::bind(&Manager::set_data_slot, this, key, _1));
+        }
+
+        reader->set_reconnect(m_reconnect_maximum);
+        if (m_connection_fn) {
+          reader->set_connection_fn(boost::bind(
+            m_connection_fn, sampler.m_address, sampler.m_port, _1));
+        }
 
         itr->second.m_reader = reader;
         itr->second.m_thread = boost::shared_ptr<Thread>(new Thread(
@@ -839,11 +1639,17 @@ class Manager {
 
         // Here, we may want to wait until the thread is actually running, and the
         // connection attempt has been made.
-        reader->m_running.time_out(5);
-        if (reader->m_running << true) {
-          // Wait to register the data callback function until we
-          // have a successful running thread.
-          //reader->m_data_fn = boost::bind(&Manager::set_data_slot, this, 1, _1);
+        if (block) {
+          reader->m_running.time_out(5);
+        }
+
+        if (!block) {
+          // The thread will report when it is running.
+        } else if (reader->m_running << true) {
+          // Register the data callback function now that we have a
+          // successful running thread.
+          reader->set_data_fn(
+            boost::bind(&Manager::set_data_slot, this, key, _1));
         } else {
           // Clean up the thread. It did not start up successfully. Probably
           // a failed connection to the data host.
@@ -861,8 +1667,9 @@ class Manager {
 #endif  // MOTION_SDK_USE_EXCEPTIONS
           return false;
         }
+#endif  // MOTION_DEVICE_REACTOR
       }
-    } else if (itr->second.m_reader->m_state.quit()) {
+    } else if (itr->second.state().quit()) {
       // This thread is no longer running, but a sampler is still
       // attached. We will never be able to read any data from this
       // sampler, so fail now.
@@ -886,67 +1693,13 @@ class Manager {
     sampler.m_sampler_id = ++m_id;
     // 2. Store the sampler in our local container.
     itr->second.m_sampler_container.push_back(sampler);
+    itr->second.update_key();
     // 3. Associate the sampler and thr reader thread state objects.
-    sampler.m_state = itr->second.m_reader->m_state;
-    // 4. Register the data callback functon.
-    itr->second.m_reader->m_data_fn =
-      boost::bind(&Manager::set_data_slot, this, key, _1);
-
-    return true;
-  }
-
-  bool detach(sampler_type &sampler)
-  {
-    if (0 == sampler.m_sampler_id) {
-      // Not currently attached, or some other error.
-#if MOTION_SDK_USE_EXCEPTIONS
-      throw detail::error("sampler not attached to data stream");
-#endif  // MOTION_SDK_USE_EXCEPTIONS
-      return false;
-    }
-
-    lock_type lock(m_mutex);
-
-    // Create the map key that we can reference this address:port pair with.
-    typedef typename container_type::value_type::first_type key_type;
-    const key_type key(sampler.m_address, sampler.m_port, sampler.m_initialize);
-
-    // Look up the thread attached to the address:port pair
-    // requested by the incoming sampler.
-    typename container_type::iterator node_itr = m_container.find(key);
-    if (m_container.end() != node_itr) {
-      // Iterate through all Sampler objects listening for data on from this
-      // address:port:XML tuple.
-      typename Node::sampler_container_type::iterator itr =
-        node_itr->second.m_sampler_container.begin();
-      for (; itr!=node_itr->second.m_sampler_container.end(); ++itr) {
-        if (sampler.m_sampler_id == itr->m_sampler_id) {
-          break;
-        }
-      }
-
-      if (node_itr->second.m_sampler_container.end() != itr) {
-        node_itr->second.m_sampler_container.erase(itr);
-        sampler.m_sampler_id = 0;
-
-        // If we just remove the last sampler that is attached
-        // to this reader thread, close down the thread.
-        if (node_itr->second.m_sampler_container.empty()) {
-          node_itr->second.m_reader->m_data_fn = typename Node::function_type();
-          node_itr->second.m_reader->quit(true);
-          if (NULL != node_itr->second.m_thread) {
-            node_itr->second.m_thread->join();
-          }
-
-          m_container.erase(node_itr);
-        }
-      }
-    }
+    sampler.m_state = itr->second.state();
 
     return true;
   }
 
-private:
   typedef Thread thread_type;
   typedef Mutex mutex_type;
   typedef Lock lock_type;
@@ -969,21 +1722,55 @@ private:
       sampler_type
     > sampler_container_type;
 
+    typedef State<
+      mutex_type,
+      lock_type
+    > state_type;
+
+#if MOTION_DEVICE_REACTOR
+    boost::shared_ptr<Client> m_client;
+    state_type m_state;
+
+    /** Most recent XML message. Only used by the reactor thread. */
+    std::string m_xml_string;
+
+    state_type &state()
+    {
+      return m_state;
+    }
+#else
     boost::shared_ptr<Thread> m_thread;
     boost::shared_ptr<reader_type> m_reader;
+
+    state_type &state()
+    {
+      return m_reader->m_state;
+    }
+#endif  // MOTION_DEVICE_REACTOR
+
     sampler_container_type m_sampler_container;
 
-    void close()
+    /**
+      Union of the keys of all of the attached samplers. Empty if any one of
+      them wants all of the elements.
+    */
+    Format::id_list_type m_key;
+
+    /** Call after any change to the sampler container. */
+    void update_key()
     {
-      if (m_sampler_container.empty()) {
-        m_reader->set_data_fn(function_type());
-        m_reader->quit(true);
-        if (m_thread && m_thread->joinable()) {
-          m_thread->join();
+      m_key.clear();
+      BOOST_FOREACH (const sampler_type &sampler, m_sampler_container) {
+        if (sampler.m_key.empty()) {
+          m_key.clear();
+          return;
         }
 
-        m_sampler_container.clear();
+        m_key.insert(m_key.end(), sampler.m_key.begin(), sampler.m_key.end());
       }
+
+      std::sort(m_key.begin(), m_key.end());
+      m_key.erase(std::unique(m_key.begin(), m_key.end()), m_key.end());
     }
   }; // class Node
 
@@ -1026,44 +1813,367 @@ private:
     Node
   > container_type;
 
+  enum {
+    FramePoolSize = 16
+  };
+
+  typedef frame_pool<data_type,mutex_type,lock_type> frame_pool_type;
+
   std::size_t m_id;
   container_type m_container;
   mutex_type m_mutex;
 
+  /** Decoded frames, recycled once all of the samplers let go of them. */
+  frame_pool_type m_frame_pool;
+
+  std::size_t m_reconnect_maximum;
+  bool m_keep_alive;
+  connection_function_type m_connection_fn;
+
+#if !MOTION_DEVICE_REACTOR
+  /**
+    Removed nodes whose reader thread has not been joined yet. The thread may
+    be waiting on m_mutex in set_data_slot, so join it after the lock is
+    released.
+  */
+  std::vector<Node> m_closing;
+#endif  // MOTION_DEVICE_REACTOR
+
+  /**
+    Close the data stream and erase it from the container. Call with the lock
+    held, and call join_closing once it is released.
+  */
+  void remove_node(typename container_type::iterator node_itr)
+  {
+#if MOTION_DEVICE_REACTOR
+    // The reactor thread closes the connection.
+    if (node_itr->second.m_client) {
+      m_reactor_key.erase(node_itr->second.m_client.get());
+      m_reactor_remove.push_back(node_itr->second.m_client);
+      m_reactor.interrupt();
+    }
+#else
+    node_itr->second.m_reader->set_data_fn(typename Node::function_type());
+    node_itr->second.m_reader->quit(true);
+    m_closing.push_back(node_itr->second);
+#endif  // MOTION_DEVICE_REACTOR
+
+    m_container.erase(node_itr);
+  }
+
+  /**
+    Wait for the reader threads of the removed nodes to exit. Call without the
+    lock held.
+  */
+  void join_closing()
+  {
+#if !MOTION_DEVICE_REACTOR
+    std::vector<Node> closing;
+    {
+      lock_type lock(m_mutex);
+      closing.swap(m_closing);
+    }
+
+    BOOST_FOREACH (Node &node, closing) {
+      if (node.m_thread && node.m_thread->joinable()) {
+        node.m_thread->join();
+      }
+    }
+#endif  // MOTION_DEVICE_REACTOR
+  }
+
+  /**
+    @param  key only decode the elements with these ids, empty list for all
+  */
+  frame_type decode_frame(const Client::data_type &data,
+                          const Format::id_list_type &key)
+  {
+    typename frame_pool_type::pointer_type frame = m_frame_pool.get();
+    if (data.empty()) {
+      frame->clear();
+    } else if (key.empty()) {
+      // Decode over the older message in the pooled frame. A live stream
+      // usually has the same elements every time, so nothing allocates.
+      format_data(data, *frame);
+    } else {
+      data_type in_data = format_data<data_type>(data, key);
+      frame->swap(in_data);
+    }
+
+    return frame;
+  }
+
   bool set_data_slot(const typename container_type::key_type &key,
                      const Client::data_type &data)
   {
     bool result = false;
 
-    data_type in_data;
-    if (!data.empty()) {
-      // Generate the formatted version of the incoming data.
-      in_data = format_data<data_type>(data);
-    }
-
     // Obtain exclusive lock on the node container state.
     lock_type lock(m_mutex);
 
     typename container_type::iterator node_itr = m_container.find(key);
     if (m_container.end() != node_itr) {
+      // Decode the incoming data once into a pooled frame, only the elements
+      // that the samplers asked for. All of the samplers share the same
+      // immutable copy.
+      const frame_type frame = decode_frame(data, node_itr->second.m_key);
+
       // Iterate through all Sampler objects listening for data on
       // from this address:port pair.
-      if (!data.empty() || node_itr->second.m_reader->m_state.quit()) {
+      if (!data.empty() || node_itr->second.state().quit()) {
         typename Node::sampler_container_type::iterator itr=node_itr->second.m_sampler_container.begin();
+        bool erased = false;
         for (; itr!=node_itr->second.m_sampler_container.end();) {
-          if (itr->set_data(in_data)) {
+          if (itr->set_data(frame)) {
             ++itr;
             result = true;
           } else {
             itr = node_itr->second.m_sampler_container.erase(itr);
+            erased = true;
           }
         }
+
+        if (erased) {
+          node_itr->second.update_key();
+        }
+      }
+
+      // Keep reading with no samplers attached.
+      if (m_keep_alive && !node_itr->second.state().quit()) {
+        result = true;
       }
     }
 
     return result;
   }
 
+#if MOTION_DEVICE_REACTOR
+  /**
+    Route the Reactor callbacks for all connections back to this Manager.
+  */
+  class ReactorHandler : public Reactor::Handler {
+   public:
+    explicit ReactorHandler(Manager &manager)
+      : m_manager(manager)
+    {
+    }
+
+    bool onMessage(Client &client, const Client::data_view_type &data)
+    {
+      return m_manager.reactor_message(client, data);
+    }
+
+    void onClose(Client &client)
+    {
+      m_manager.reactor_close(client);
+    }
+
+   private:
+    Manager &m_manager;
+  }; // class ReactorHandler
+
+  friend class ReactorHandler;
+
+  typedef std::vector<
+    boost::shared_ptr<Client>
+  > client_container_type;
+
+  typedef std::map<
+    const Client *,
+    boost::shared_ptr<const typename container_type::key_type>
+  > client_key_type;
+
+  /** Waits on all of the connections. Only used by the reactor thread. */
+  Reactor m_reactor;
+  ReactorHandler m_reactor_handler;
+
+  /** Single I/O thread for all connections. Started on the first attach. */
+  boost::shared_ptr<Thread> m_reactor_thread;
+
+  /**
+    Requests for the reactor thread, protected by m_mutex. The Reactor is
+    not thread safe, only the reactor thread adds or removes connections.
+  */
+  bool m_reactor_quit;
+  client_container_type m_reactor_add;
+  client_container_type m_reactor_remove;
+
+  /** Look up the Node of each connection, protected by m_mutex. */
+  client_key_type m_reactor_key;
+
+  /** Copy of the current message. Only used by the reactor thread. */
+  Client::data_type m_reactor_buffer;
+
+  /** Scratch XML message. Only used by the reactor thread. */
+  std::string m_reactor_xml_string;
+
+  /**
+    Open a connection and send the initialization string. Run in the thread
+    that calls attach.
+  */
+  bool reactor_connect(Node &node, const std::string &address,
+                       const std::size_t &port, const std::string &initialize)
+  {
+    boost::shared_ptr<Client> client;
+    try {
+      client.reset(new Client(address, static_cast<unsigned>(port)));
+
+      // Send initialization string to the data service if
+      // we have one.
+      if (client->isConnected() && !initialize.empty()) {
+        Client::data_type data(initialize.begin(), initialize.end());
+        if (client->writeData(data)) {
+          // Success. But no need for feedback on this one.
+        }
+      }
+#if MOTION_SDK_USE_EXCEPTIONS
+    } catch (detail::error &) {
+      client.reset();
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+    } catch (...) {
+      client.reset();
+    }
+
+    if (!client || !client->isConnected()) {
+      return false;
+    }
+
+    node.m_client = client;
+    node.m_state.connected(true);
+
+    return true;
+  }
+
+  /**
+    Reactor thread loop. Apply the pending requests and then wait for data.
+  */
+  void reactor_run()
+  {
+    while (true) {
+      client_container_type remove;
+      {
+        lock_type lock(m_mutex);
+        if (m_reactor_quit) {
+          break;
+        }
+
+        BOOST_FOREACH (boost::shared_ptr<Client> &client, m_reactor_add) {
+          try {
+            m_reactor.add(*client, m_reactor_handler);
+          } catch (...) {
+          }
+        }
+        m_reactor_add.clear();
+
+        BOOST_FOREACH (boost::shared_ptr<Client> &client, m_reactor_remove) {
+          m_reactor.remove(*client);
+        }
+
+        // Close the connections outside of the lock.
+        remove.swap(m_reactor_remove);
+      }
+      remove.clear();
+
+      try {
+        m_reactor.poll(-1);
+      } catch (...) {
+      }
+    }
+
+    // Detach everything, the Client objects may not outlive this thread.
+    lock_type lock(m_mutex);
+    BOOST_FOREACH (typename container_type::value_type &item, m_container) {
+      if (item.second.m_client) {
+        m_reactor.remove(*item.second.m_client);
+      }
+    }
+    BOOST_FOREACH (boost::shared_ptr<Client> &client, m_reactor_remove) {
+      m_reactor.remove(*client);
+    }
+  }
+
+  /**
+    Reactor callback, in the reactor thread. Export this data sample to all
+    attached sampler objects.
+  */
+  bool reactor_message(Client &client, const Client::data_view_type &data)
+  {
+    typedef typename container_type::key_type key_type;
+
+    boost::shared_ptr<const key_type> key;
+    {
+      lock_type lock(m_mutex);
+
+      typename client_key_type::const_iterator itr = m_reactor_key.find(&client);
+      if (m_reactor_key.end() == itr) {
+        return false;
+      }
+
+      key = itr->second;
+
+      typename container_type::iterator node_itr = m_container.find(*key);
+      if (m_container.end() != node_itr) {
+        // Enter the reading state.
+        Node &node = node_itr->second;
+        node.state().reading(true);
+
+        // Track the most recent XML message. Export
+        // changes to the shared state.
+        if (client.getXMLString(m_reactor_xml_string) &&
+            (m_reactor_xml_string != node.m_xml_string)) {
+          node.m_xml_string = m_reactor_xml_string;
+          node.state().xml_string(node.m_xml_string);
+        }
+      }
+    }
+
+    m_reactor_buffer.assign(data.begin(), data.end());
+    if (!set_data_slot(*key, m_reactor_buffer)) {
+      lock_type lock(m_mutex);
+
+      typename container_type::iterator node_itr = m_container.find(*key);
+      if (m_container.end() != node_itr) {
+        node_itr->second.state().quit(true);
+      }
+
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+    Reactor callback, in the reactor thread. Send a signal that we are no
+    longer connected.
+  */
+  void reactor_close(Client &client)
+  {
+    typedef typename container_type::key_type key_type;
+
+    boost::shared_ptr<const key_type> key;
+    {
+      lock_type lock(m_mutex);
+
+      typename client_key_type::const_iterator itr = m_reactor_key.find(&client);
+      if (m_reactor_key.end() == itr) {
+        return;
+      }
+
+      key = itr->second;
+
+      typename container_type::iterator node_itr = m_container.find(*key);
+      if (m_container.end() != node_itr) {
+        typename Node::state_type &state = node_itr->second.state();
+        state.connected(false);
+        state.reading(false);
+        state.quit(true);
+      }
+    }
+
+    set_data_slot(*key, Client::data_type());
+  }
+#endif  // MOTION_DEVICE_REACTOR
+
 }; // class Manager
 
 
@@ -1095,6 +2205,62 @@ Format::raw_service_type format_data(const Client::data_type &data)
   return Format::Raw(data.begin(), data.end());
 }
 
+template <>
+Format::configurable_service_type format_data(const Client::data_type &data,
+                                              const Format::id_list_type &id)
+{
+  return Format::Configurable(data.begin(), data.end(), id);
+}
+
+template <>
+Format::preview_service_type format_data(const Client::data_type &data,
+                                         const Format::id_list_type &id)
+{
+  return Format::Preview(data.begin(), data.end(), id);
+}
+
+template <>
+Format::sensor_service_type format_data(const Client::data_type &data,
+                                        const Format::id_list_type &id)
+{
+  return Format::Sensor(data.begin(), data.end(), id);
+}
+
+template <>
+Format::raw_service_type format_data(const Client::data_type &data,
+                                     const Format::id_list_type &id)
+{
+  return Format::Raw(data.begin(), data.end(), id);
+}
+
+template <>
+bool format_data(const Client::data_type &data,
+                 Format::configurable_service_type &result)
+{
+  return Format::Configurable(data.begin(), data.end(), result);
+}
+
+template <>
+bool format_data(const Client::data_type &data,
+                 Format::preview_service_type &result)
+{
+  return Format::Preview(data.begin(), data.end(), result);
+}
+
+template <>
+bool format_data(const Client::data_type &data,
+                 Format::sensor_service_type &result)
+{
+  return Format::Sensor(data.begin(), data.end(), result);
+}
+
+template <>
+bool format_data(const Client::data_type &data,
+                 Format::raw_service_type &result)
+{
+  return Format::Raw(data.begin(), data.end(), result);
+}
+
 #endif  // MOTION_SDK_PLUGIN_DEVICE_IMPL
 
 }}}  // namespace Motion::SDK::Device
@@ -0,0 +1,564 @@
+/*
+  @file    tools/sdk/cpp/plugin/Merger.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_PLUGIN_MERGER_HPP_
+#define __MOTION_SDK_PLUGIN_MERGER_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+  Depends on the Boost C++ libraries, available at http://www.boost.org/.
+*/
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <detail/instrument.hpp>
+#include <plugin/Device.hpp>
+#include <plugin/Ring.hpp>
+
+
+namespace Motion { namespace SDK { namespace Device {
+
+/**
+  Combine the data streams of several Motion Services, for example one per
+  capture volume, into one frame per tick. Built on the Manager, each stream
+  is a regular Sampler with its own connection.
+
+  The I/O thread of each stream timestamps every frame on arrival and hands
+  it to the merge thread through a lock free ring. The merge thread runs at
+  a fixed tick rate. At each tick it picks the newest frame of every stream
+  that is at least one reorder window old, so late frames from a slower host
+  still make it into the right tick. It writes all of the elements into one
+  flat frame and hands it to the application through a lock free triple
+  buffer. Nobody waits on a lock, and the application always sees the newest
+  complete tick.
+
+  If the streams carry their own timestamps, for example the Configurable
+  service timestamp channel, set a time function for the stream. The merge
+  thread estimates the offset between each host clock and the local clock,
+  the minimum of the arrival time minus the source time over the recent
+  frames. That removes the network jitter from the alignment. Otherwise the
+  frames are aligned by arrival time.
+
+  @code
+  typedef Sampler<boost::recursive_mutex, boost::recursive_mutex::scoped_lock,
+                  boost::condition_variable_any> sampler_type;
+  typedef Merger<sampler_type> merger_type;
+
+  merger_type merger;
+  merger.add("10.0.0.1", 32079);
+  merger.add("10.0.0.2", 32079);
+  if (merger.start()) {
+    const merger_type::merged_type *frame = NULL;
+    for (;;) {
+      if (merger.get_frame(frame)) {
+        // Element i is frame->get_id()[i] from stream frame->get_stream()[i].
+        // Channel c of element i is frame->get_data()[c * frame->size() + i].
+      }
+    }
+  }
+  @endcode
+*/
+template <
+  typename SamplerType,
+  typename Thread=boost::thread,
+  typename Mutex=boost::recursive_mutex,
+  typename Lock=boost::recursive_mutex::scoped_lock,
+  typename Condition=boost::condition_variable_any
+>
+class Merger : private boost::noncopyable {
+ public:
+  typedef SamplerType sampler_type;
+  typedef Manager<SamplerType,Thread,Mutex,Lock,Condition> manager_type;
+  typedef typename sampler_type::data_type data_type;
+  typedef typename sampler_type::frame_type frame_type;
+  typedef typename data_type::mapped_type element_type;
+  typedef typename element_type::value_type value_type;
+
+  /**
+    Read the source timestamp, in seconds, from a frame. Return false if the
+    frame does not have one. Called in the merge thread.
+  */
+  typedef boost::function<bool (const data_type &, double &)> time_function_type;
+
+  enum {
+    /** Frames of each stream that wait in the reorder window. */
+    WindowSize = 16,
+    /** Frames of each stream in the clock offset estimate. */
+    OffsetHistory = 64,
+    /** Frames of each stream in flight from the I/O thread. */
+    RingSize = 64
+  };
+
+  /**
+    One tick of all of the streams. Flat, struct-of-arrays layout like the
+    Format::Frame. Channel <tt>c</tt> of element <tt>i</tt> is stored at
+    <tt>get_data()[c * size() + i]</tt>.
+  */
+  class merged_type {
+   public:
+    merged_type()
+      : m_time(0), m_length(0), m_id(), m_stream(), m_data(),
+        m_stream_time(), m_offset()
+    {
+    }
+
+    /**
+      Local time of this tick, in seconds on the detail::monotonic_time
+      clock. The frames are the newest ones at or before this time.
+    */
+    double get_time() const
+    {
+      return m_time;
+    }
+
+    /** Number of elements from all of the streams. */
+    std::size_t size() const
+    {
+      return m_id.size();
+    }
+
+    /** Number of channels in each element. */
+    std::size_t length() const
+    {
+      return m_length;
+    }
+
+    bool empty() const
+    {
+      return m_id.empty();
+    }
+
+    /** Element ids, in stream order and then in id order. */
+    const Format::id_type *get_id() const
+    {
+      return m_id.empty() ? NULL : &m_id[0];
+    }
+
+    /** Index of the stream, in the order of Merger#add, of each element. */
+    const std::size_t *get_stream() const
+    {
+      return m_stream.empty() ? NULL : &m_stream[0];
+    }
+
+    /** All of the channels, <tt>length()</tt> arrays of <tt>size()</tt>. */
+    const value_type *get_data() const
+    {
+      return m_data.empty() ? NULL : &m_data[0];
+    }
+
+    /** Number of streams. */
+    std::size_t stream_size() const
+    {
+      return m_stream_time.size();
+    }
+
+    /**
+      Aligned local time of the frame from this stream, negative if the
+      stream has not sent any frames yet.
+    */
+    double get_stream_time(const std::size_t &stream) const
+    {
+      return m_stream_time[stream];
+    }
+
+    /**
+      Estimated offset from the source clock of this stream to the local
+      clock, in seconds. Zero if the stream does not have a time function.
+    */
+    double get_offset(const std::size_t &stream) const
+    {
+      return m_offset[stream];
+    }
+
+   private:
+    double m_time;
+    std::size_t m_length;
+    std::vector<Format::id_type> m_id;
+    std::vector<std::size_t> m_stream;
+    std::vector<value_type> m_data;
+    std::vector<double> m_stream_time;
+    std::vector<double> m_offset;
+
+    friend class Merger;
+  }; // class merged_type
+
+  /**
+    @param  tick_second interval between merged frames
+    @param  window_second reorder window, each tick uses frames that are at
+            least this old so a late frame from any stream still makes it
+  */
+  explicit Merger(const double &tick_second=0.01,
+                  const double &window_second=0.02)
+    : m_tick(tick_second), m_window(window_second), m_manager(),
+      m_stream(), m_output(), m_thread(), m_quit(false), m_started(false)
+  {
+  }
+
+  ~Merger()
+  {
+    stop();
+  }
+
+  /**
+    Add a data stream. Call before start.
+
+    @param  time_fn optional source timestamp of each frame
+    @return the index of this stream in the merged frames
+  */
+  std::size_t add(const std::string &address, const std::size_t &port,
+                  const std::string &initialize=std::string(),
+                  const time_function_type &time_fn=time_function_type())
+  {
+    if (m_started) {
+#if MOTION_SDK_USE_EXCEPTIONS
+      throw detail::error("can not add a data stream to a running merger");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+      return m_stream.size();
+    }
+
+    const std::size_t index = m_stream.size();
+    m_stream.push_back(boost::shared_ptr<Stream>(new Stream(
+      sampler_type(address, port, initialize,
+                   boost::bind(&Merger::on_data, this, index)),
+      time_fn)));
+
+    return index;
+  }
+
+  /**
+    Attach all of the streams and start the merge thread.
+
+    @return false if any of the streams failed to connect
+  */
+  bool start()
+  {
+    if (m_started || m_stream.empty()) {
+      return false;
+    }
+
+    m_started = true;
+    BOOST_FOREACH (boost::shared_ptr<Stream> &stream, m_stream) {
+      if (!m_manager.attach(stream->sampler)) {
+        stop();
+        return false;
+      }
+      stream->attached = true;
+    }
+
+    m_quit.store(false);
+    m_thread.reset(new Thread(boost::bind(&Merger::run, this)));
+
+    return true;
+  }
+
+  /**
+    Stop the merge thread and detach all of the streams.
+  */
+  void stop()
+  {
+    if (!m_started) {
+      return;
+    }
+
+    m_quit.store(true);
+    if (m_thread) {
+      m_thread->join();
+      m_thread.reset();
+    }
+
+    BOOST_FOREACH (boost::shared_ptr<Stream> &stream, m_stream) {
+      if (stream->attached) {
+        m_manager.detach(stream->sampler);
+        stream->attached = false;
+      }
+    }
+
+    m_started = false;
+  }
+
+  /**
+    Get the newest merged frame. Lock free, wait free, from one application
+    thread only. The frame is valid until the next call.
+
+    @return true if there is a new frame since the last call
+  */
+  bool get_frame(const merged_type *&frame)
+  {
+    const bool result = m_output.update();
+    frame = &m_output.front();
+
+    return result;
+  }
+
+  /** Number of streams. */
+  std::size_t size() const
+  {
+    return m_stream.size();
+  }
+
+ private:
+  class entry_type {
+   public:
+    entry_type()
+      : time(0), frame()
+    {
+    }
+
+    entry_type(const double &time_in, const frame_type &frame_in)
+      : time(time_in), frame(frame_in)
+    {
+    }
+
+    bool operator<(const entry_type &rhs) const
+    {
+      return time < rhs.time;
+    }
+
+    double time;
+    frame_type frame;
+  }; // class entry_type
+
+  class Stream {
+   public:
+    Stream(const sampler_type &sampler_in,
+           const time_function_type &time_fn_in)
+      : sampler(sampler_in), time_fn(time_fn_in), attached(false),
+        ring(RingSize), window(), current(), offset(0), offset_history(),
+        offset_count(0)
+    {
+    }
+
+    sampler_type sampler;
+    time_function_type time_fn;
+    bool attached;
+
+    /** From the I/O thread to the merge thread, stamped with arrival time. */
+    ring_buffer<entry_type> ring;
+
+    /**
+      The rest is only used by the merge thread. Frames sorted by aligned
+      time, waiting for their tick.
+    */
+    std::deque<entry_type> window;
+
+    /** Frame of the last tick. Held until a newer one is due. */
+    entry_type current;
+
+    double offset;
+    double offset_history[OffsetHistory];
+    std::size_t offset_count;
+  }; // class Stream
+
+  typedef std::vector<boost::shared_ptr<Stream> > stream_list_type;
+
+  double m_tick;
+  double m_window;
+  manager_type m_manager;
+  stream_list_type m_stream;
+  triple_buffer<merged_type> m_output;
+  boost::shared_ptr<Thread> m_thread;
+  boost::atomic<bool> m_quit;
+  bool m_started;
+
+  /**
+    The sampler callback, in the I/O thread of this stream. Take the frame
+    that the Manager just stored.
+  */
+  bool on_data(const std::size_t &index)
+  {
+    Stream &stream = *m_stream[index];
+
+    frame_type frame;
+    if (stream.sampler.get_data(frame) && frame && !frame->empty()) {
+      stream.ring.push(entry_type(detail::monotonic_time(), frame));
+    }
+
+    return true;
+  }
+
+  /**
+    Merge thread. Tick at a fixed rate on the local clock. If we fall more
+    than a tick behind skip ahead, do not try to catch up.
+  */
+  void run()
+  {
+    double next = detail::monotonic_time();
+    while (!m_quit.load()) {
+      next += m_tick;
+
+      const double now = detail::monotonic_time();
+      if (next < now - m_tick) {
+        next = now;
+      } else if (next > now) {
+        boost::this_thread::sleep(boost::posix_time::microseconds(
+          static_cast<long>((next - now) * 1000000)));
+      }
+
+      tick(next);
+    }
+  }
+
+  void tick(const double &time)
+  {
+    const double target = time - m_window;
+
+    merged_type &merged = m_output.back();
+    merged.m_time = target;
+    merged.m_length = 0;
+    merged.m_stream_time.resize(m_stream.size());
+    merged.m_offset.resize(m_stream.size());
+
+    std::size_t count = 0;
+    for (std::size_t i=0; i<m_stream.size(); ++i) {
+      Stream &stream = *m_stream[i];
+
+      receive(stream);
+
+      // Take the newest frame that is due, drop the older ones.
+      while (!stream.window.empty() && (stream.window.front().time <= target)) {
+        stream.current = stream.window.front();
+        stream.window.pop_front();
+      }
+
+      merged.m_stream_time[i] = stream.current.frame ? stream.current.time : -1;
+      merged.m_offset[i] = stream.offset;
+
+      if (stream.current.frame) {
+        count += stream.current.frame->size();
+        if ((0 == merged.m_length) && !stream.current.frame->empty()) {
+          merged.m_length =
+            stream.current.frame->begin()->second.access().size();
+        }
+      }
+    }
+
+    // Flat copy of all of the elements with the same number of channels.
+    merged.m_id.resize(count);
+    merged.m_stream.resize(count);
+    merged.m_data.resize(count * merged.m_length);
+
+    std::size_t n = 0;
+    for (std::size_t i=0; i<m_stream.size(); ++i) {
+      const frame_type &frame = m_stream[i]->current.frame;
+      if (!frame) {
+        continue;
+      }
+
+      typename data_type::const_iterator itr = frame->begin();
+      for (; frame->end() != itr; ++itr) {
+        const typename element_type::data_type &value = itr->second.access();
+        if (value.size() != merged.m_length) {
+          continue;
+        }
+
+        merged.m_id[n] = itr->first;
+        merged.m_stream[n] = i;
+        for (std::size_t c=0; c<merged.m_length; ++c) {
+          merged.m_data[c * count + n] = value[c];
+        }
+        ++n;
+      }
+    }
+
+    if (n < count) {
+      // Some elements did not match the channel count. Pack the channels to
+      // the shorter stride.
+      for (std::size_t c=1; c<merged.m_length; ++c) {
+        std::copy(
+          merged.m_data.begin() + c * count,
+          merged.m_data.begin() + c * count + n,
+          merged.m_data.begin() + c * n);
+      }
+
+      merged.m_id.resize(n);
+      merged.m_stream.resize(n);
+      merged.m_data.resize(n * merged.m_length);
+    }
+
+    m_output.publish();
+  }
+
+  /**
+    Move the new frames from the I/O thread into the reorder window, sorted
+    by aligned time. Keep at most WindowSize of them.
+  */
+  void receive(Stream &stream)
+  {
+    entry_type entry;
+    while (stream.ring.pop(entry)) {
+      double source = 0;
+      if (stream.time_fn && stream.time_fn(*entry.frame, source)) {
+        update_offset(stream, entry.time - source);
+        entry.time = source + stream.offset;
+      }
+
+      // Usually the newest, so search from the back.
+      typename std::deque<entry_type>::iterator itr = stream.window.end();
+      while ((stream.window.begin() != itr) && (entry < *(itr - 1))) {
+        --itr;
+      }
+      stream.window.insert(itr, entry);
+
+      if (stream.window.size() > WindowSize) {
+        stream.window.pop_front();
+      }
+    }
+  }
+
+  /**
+    The arrival time is the source time plus the clock offset plus the
+    network delay. The delay is never negative and the smallest recent one
+    is the closest to the true offset.
+  */
+  static void update_offset(Stream &stream, const double &value)
+  {
+    stream.offset_history[stream.offset_count % OffsetHistory] = value;
+    ++stream.offset_count;
+
+    const std::size_t n = std::min<std::size_t>(
+      stream.offset_count, OffsetHistory);
+    stream.offset = *std::min_element(
+      stream.offset_history, stream.offset_history + n);
+  }
+}; // class Merger
+
+}}} // namespace Motion::SDK::Device
+
+#endif // __MOTION_SDK_PLUGIN_MERGER_HPP_
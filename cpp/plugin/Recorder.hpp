@@ -0,0 +1,724 @@
+/*
+  @file    tools/sdk/cpp/plugin/Recorder.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_PLUGIN_RECORDER_HPP_
+#define __MOTION_SDK_PLUGIN_RECORDER_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+  Depends on the Boost C++ libraries, available at http://www.boost.org/.
+  Requires compilation of the Thread and System libraries.
+*/
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <Client.hpp>
+#include <detail/exception.hpp>
+
+#if defined(_WIN32)
+#  include <cstdio>
+#  include <malloc.h>
+#else
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <stdlib.h>
+#  include <sys/stat.h>
+#  include <sys/types.h>
+#  include <unistd.h>
+#endif  // _WIN32
+
+
+namespace Motion { namespace SDK { namespace Device {
+
+/**
+  Record a live data stream to disk without blocking the network thread on
+  the disk. Each message is stored exactly as it arrives on the wire, an
+  unsigned 4 byte length in network byte order followed by the message bytes.
+
+  The caller copies messages into large page aligned blocks. A dedicated I/O
+  thread writes the full blocks to the file, bypassing the operating system
+  cache where possible. If the disk falls so far behind that all blocks are
+  in use, new messages are dropped and counted instead of waiting.
+
+  Every index interval, record the time and file offset of the next message in
+  a separate index file, pathname + ".index". Use it to seek into the recording
+  with the @ref MappedFile reader.
+
+  @code
+  typedef Device::Recorder<> recorder_type;
+
+  recorder_type recorder("take.bin");
+
+  // Plug into the Client read loop.
+  Client client("", 32079);
+  Client::data_type data;
+  while (client.readData(data)) {
+    recorder.write(data);
+  }
+
+  // Or use it as the DataFunction of a Device::Reader.
+  boost::function<bool (const Client::data_type &)> fn = boost::ref(recorder);
+  @endcode
+*/
+template <
+  typename Thread=boost::thread,
+  typename Mutex=boost::mutex,
+  typename Lock=boost::mutex::scoped_lock,
+  typename Condition=boost::condition_variable
+>
+class Recorder : private boost::noncopyable {
+ public:
+  /** Number of bytes in the message length prefix. */
+  enum {
+    HeaderSize = 4,
+    Alignment = 4096
+  };
+
+  /** One entry in the index file. All values are little-endian. */
+  class index_entry {
+   public:
+    index_entry()
+      : time(), offset(), count()
+    {
+    }
+
+    index_entry(const boost::uint64_t &time_in,
+                const boost::uint64_t &offset_in,
+                const boost::uint64_t &count_in)
+      : time(time_in), offset(offset_in), count(count_in)
+    {
+    }
+
+    /** Receive time in microseconds since 1970-01-01 UTC. */
+    boost::uint64_t time;
+
+    /** Byte offset of the start of the message in the recording. */
+    boost::uint64_t offset;
+
+    /** Number of messages before this one. */
+    boost::uint64_t count;
+  }; // class index_entry
+
+  /**
+    Open the recording and start the I/O thread.
+
+    @param  pathname output file, truncate it if it exists
+    @param  block_size bytes per block, rounded up to a multiple of the page
+            alignment
+    @param  block_count number of blocks, at least two
+    @param  index_interval_millisecond minimum time between index entries
+    @throws std::runtime_error if the output files can not be opened
+  */
+  Recorder(const std::string &pathname,
+           const std::size_t &block_size=1 << 20,
+           const std::size_t &block_count=4,
+           const std::size_t &index_interval_millisecond=1000)
+    : m_block_size(
+        ((std::max)(block_size, static_cast<std::size_t>(1)) + Alignment - 1)
+        / Alignment * Alignment),
+      m_index_interval(
+        static_cast<boost::uint64_t>(index_interval_millisecond) * 1000),
+      m_file(), m_direct(false), m_index(), m_block(), m_active(NULL), m_offset(0),
+      m_count(0), m_last_index(0), m_dropped(0), m_error(false),
+      m_closed(false), m_mutex(), m_condition(), m_pending(), m_free(),
+      m_closing(false), m_thread()
+  {
+    if (!open(pathname)) {
+      abort_open();
+#if MOTION_SDK_USE_EXCEPTIONS
+      throw detail::error("failed to open recording output file");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+      m_closed = true;
+      return;
+    }
+
+    // The destructor does not run if we throw from here. Clean up first.
+    try {
+      const std::size_t n = (std::max)(block_count, static_cast<std::size_t>(2));
+      m_block.reserve(n);
+      for (std::size_t i=0; i<n; ++i) {
+        // Does not throw after the reserve, so the block is never lost.
+        m_block.push_back(new block(m_block_size));
+        m_free.push_back(m_block.back());
+      }
+
+      m_thread.reset(new Thread(boost::bind(&Recorder::run, this)));
+    } catch (...) {
+      for (std::size_t i=0; i<m_block.size(); ++i) {
+        delete m_block[i];
+      }
+      m_block.clear();
+      m_free.clear();
+
+      abort_open();
+      throw;
+    }
+  }
+
+  /**
+    Flush the remaining data and close the files. Does not throw any
+    exceptions.
+  */
+  virtual ~Recorder()
+  {
+    close();
+
+    for (std::size_t i=0; i<m_block.size(); ++i) {
+      delete m_block[i];
+    }
+  }
+
+  /**
+    Append one message to the recording. Call this from one thread only. Only
+    locks the mutex when a block is full. Empty messages are ignored.
+
+    @return false if the recording is closed or the I/O thread failed to write
+            to the file
+  */
+  bool write(const char *data, const std::size_t &size)
+  {
+    if (m_closed) {
+      return false;
+    }
+
+    if (0 == size) {
+      return true;
+    }
+
+    const std::size_t length = HeaderSize + size;
+    const std::size_t remaining =
+      (NULL != m_active) ? (m_block_size - m_active->size) : 0;
+    if (length > remaining) {
+      // Make sure there is enough room for the whole message. Only the I/O
+      // thread adds to the free list, so the blocks will still be there when
+      // we need them.
+      Lock lock(m_mutex);
+      if (m_error) {
+        return false;
+      }
+
+      if (m_free.size() * m_block_size + remaining < length) {
+        ++m_dropped;
+        return true;
+      }
+    }
+
+    const boost::uint64_t now = clock();
+    if ((0 == m_count) || (now - m_last_index >= m_index_interval)) {
+      if (NULL == m_active || (m_active->size == m_block_size)) {
+        next_block();
+      }
+
+      m_active->index.push_back(index_entry(now, m_offset, m_count));
+      m_last_index = now;
+    }
+
+    const boost::uint32_t length_in_network_order = htonl_uint32(size);
+    append(reinterpret_cast<const char *>(&length_in_network_order), HeaderSize);
+    append(data, size);
+
+    m_offset += length;
+    ++m_count;
+
+    return true;
+  }
+
+  bool write(const Client::data_type &data)
+  {
+    return write(data.empty() ? NULL : &data[0], data.size());
+  }
+
+  bool write(const Client::data_view_type &data)
+  {
+    return write(data.data(), data.size());
+  }
+
+  /**
+    DataFunction interface for the Device::Reader class.
+  */
+  bool operator()(const Client::data_type &data)
+  {
+    return write(data);
+  }
+
+  /**
+    Write the partial block, wait for the I/O thread to finish, and close the
+    files. Safe to call more than once.
+
+    @return false if there was an error writing to the files
+  */
+  bool close()
+  {
+    if (!m_thread) {
+      return !m_error;
+    }
+
+    {
+      Lock lock(m_mutex);
+      if ((NULL != m_active) && (m_active->size > 0)) {
+        m_pending.push_back(m_active);
+      }
+      m_active = NULL;
+      m_closing = true;
+      m_closed = true;
+    }
+    m_condition.notify_all();
+
+    m_thread->join();
+    m_thread.reset();
+
+    finish();
+
+    return !m_error;
+  }
+
+  /** Number of messages written to the recording. */
+  boost::uint64_t count() const
+  {
+    return m_count;
+  }
+
+  /** Number of bytes written to the recording. */
+  boost::uint64_t size() const
+  {
+    return m_offset;
+  }
+
+  /** Number of messages dropped because all of the blocks were in use. */
+  std::size_t dropped() const
+  {
+    Lock lock(m_mutex);
+    return m_dropped;
+  }
+
+  /**
+    Read one message from a recording, for example the contents of a
+    @ref MappedFile. Start at an index entry offset to seek.
+
+    @param  first start of the next record, advanced past it
+    @param  last end of the recording
+    @param  message view of the message bytes
+    @return false at the end of the recording or a truncated record
+  */
+  static bool read_message(const char *&first, const char *last,
+                           Client::data_view_type &message)
+  {
+    if (last - first < static_cast<std::ptrdiff_t>(HeaderSize)) {
+      return false;
+    }
+
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(first);
+    const std::size_t size =
+      (static_cast<std::size_t>(p[0]) << 24) |
+      (static_cast<std::size_t>(p[1]) << 16) |
+      (static_cast<std::size_t>(p[2]) << 8) |
+      static_cast<std::size_t>(p[3]);
+    if (static_cast<std::size_t>(last - first) - HeaderSize < size) {
+      return false;
+    }
+
+    message = Client::data_view_type(first + HeaderSize, size);
+    first += HeaderSize + size;
+
+    return true;
+  }
+
+  /**
+    Load all of the entries in the index file of a recording.
+
+    @param  pathname the recording, not the index file itself
+  */
+  static bool read_index(const std::string &pathname,
+                         std::vector<index_entry> &result)
+  {
+    result.clear();
+
+    std::ifstream input(
+      (pathname + ".index").c_str(), std::ios_base::binary | std::ios_base::in);
+
+    char header[IndexHeaderSize];
+    if (!input.read(header, IndexHeaderSize) ||
+        (0 != std::memcmp(header, IndexMagic(), 4))) {
+      return false;
+    }
+
+    char buffer[IndexEntrySize];
+    while (input.read(buffer, IndexEntrySize)) {
+      result.push_back(index_entry(
+        get_uint64(buffer), get_uint64(buffer + 8), get_uint64(buffer + 16)));
+    }
+
+    return true;
+  }
+
+ private:
+  enum {
+    IndexHeaderSize = 8,
+    IndexEntrySize = 24,
+    IndexVersion = 1
+  };
+
+  /** Page aligned block of message data. */
+  class block : private boost::noncopyable {
+   public:
+    explicit block(const std::size_t &capacity)
+      : data(allocate(capacity)), size(0), index()
+    {
+    }
+
+    ~block()
+    {
+#if defined(_WIN32)
+      ::_aligned_free(data);
+#else
+      ::free(data);
+#endif  // _WIN32
+    }
+
+    char *data;
+    std::size_t size;
+
+    /** Index entries of messages that start in this block. */
+    std::vector<index_entry> index;
+
+   private:
+    static char *allocate(const std::size_t &capacity)
+    {
+#if defined(_WIN32)
+      void *result = ::_aligned_malloc(capacity, Alignment);
+#else
+      void *result = NULL;
+      if (0 != ::posix_memalign(&result, Alignment, capacity)) {
+        result = NULL;
+      }
+#endif  // _WIN32
+      if (NULL == result) {
+        throw std::bad_alloc();
+      }
+
+      return static_cast<char *>(result);
+    }
+  }; // class block
+
+  std::size_t m_block_size;
+  boost::uint64_t m_index_interval;
+
+  /** Recording file descriptor. Only used by the I/O thread after open. */
+#if defined(_WIN32)
+  std::FILE *m_file;
+#else
+  int m_file;
+#endif  // _WIN32
+  bool m_direct;
+  std::ofstream m_index;
+
+  std::vector<block *> m_block;
+
+  /** State of the writer thread. */
+  block *m_active;
+  boost::uint64_t m_offset;
+  boost::uint64_t m_count;
+  boost::uint64_t m_last_index;
+
+  /** State shared with the I/O thread, protected by the mutex. */
+  std::size_t m_dropped;
+  bool m_error;
+  bool m_closed;
+  mutable Mutex m_mutex;
+  Condition m_condition;
+  std::deque<block *> m_pending;
+  std::deque<block *> m_free;
+  bool m_closing;
+
+  boost::scoped_ptr<Thread> m_thread;
+
+  static const char *IndexMagic()
+  {
+    return "MIDX";
+  }
+
+  static boost::uint32_t htonl_uint32(const std::size_t &value)
+  {
+    const unsigned char bytes[4] = {
+      static_cast<unsigned char>((value >> 24) & 0xff),
+      static_cast<unsigned char>((value >> 16) & 0xff),
+      static_cast<unsigned char>((value >> 8) & 0xff),
+      static_cast<unsigned char>(value & 0xff)
+    };
+
+    boost::uint32_t result = 0;
+    std::memcpy(&result, bytes, sizeof(result));
+    return result;
+  }
+
+  static void put_uint64(char *p, const boost::uint64_t &value)
+  {
+    for (int i=0; i<8; ++i) {
+      p[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+  }
+
+  static boost::uint64_t get_uint64(const char *p)
+  {
+    boost::uint64_t result = 0;
+    for (int i=7; i>=0; --i) {
+      result = (result << 8) | static_cast<unsigned char>(p[i]);
+    }
+    return result;
+  }
+
+  static boost::uint64_t clock()
+  {
+    static const boost::posix_time::ptime Epoch(
+      boost::gregorian::date(1970, 1, 1));
+    return static_cast<boost::uint64_t>(
+      (boost::posix_time::microsec_clock::universal_time() - Epoch)
+        .total_microseconds());
+  }
+
+  /**
+    Hand the full active block to the I/O thread and take a free one.
+    @pre there is a free block
+  */
+  void next_block()
+  {
+    {
+      Lock lock(m_mutex);
+      if (NULL != m_active) {
+        m_pending.push_back(m_active);
+      }
+
+      m_active = m_free.front();
+      m_free.pop_front();
+    }
+    m_condition.notify_all();
+
+    m_active->size = 0;
+    m_active->index.clear();
+  }
+
+  void append(const char *data, std::size_t size)
+  {
+    while (size > 0) {
+      if ((NULL == m_active) || (m_active->size == m_block_size)) {
+        next_block();
+      }
+
+      const std::size_t n = (std::min)(size, m_block_size - m_active->size);
+      std::memcpy(m_active->data + m_active->size, data, n);
+      m_active->size += n;
+      data += n;
+      size -= n;
+    }
+  }
+
+  bool open(const std::string &pathname)
+  {
+    m_direct = false;
+#if defined(_WIN32)
+    m_file = std::fopen(pathname.c_str(), "wb");
+    if (NULL == m_file) {
+      return false;
+    }
+#else
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#  if defined(O_DIRECT)
+    // Not every file system supports direct I/O. Fall back to the cache.
+    m_file = ::open(pathname.c_str(), flags | O_DIRECT, 0644);
+    m_direct = (m_file >= 0);
+    if (m_file < 0)
+#  endif  // O_DIRECT
+    {
+      m_file = ::open(pathname.c_str(), flags, 0644);
+    }
+
+    if (m_file < 0) {
+      return false;
+    }
+
+#  if defined(F_NOCACHE)
+    ::fcntl(m_file, F_NOCACHE, 1);
+#  endif  // F_NOCACHE
+#endif  // _WIN32
+
+    m_index.open(
+      (pathname + ".index").c_str(), std::ios_base::binary | std::ios_base::out);
+    if (!m_index.is_open()) {
+      return false;
+    }
+
+    char header[IndexHeaderSize] = { 0 };
+    std::memcpy(header, IndexMagic(), 4);
+    header[4] = static_cast<char>(IndexVersion);
+    m_index.write(header, IndexHeaderSize);
+
+    return m_index.good();
+  }
+
+  /**
+    Write a whole block to the recording file. With direct I/O the size must
+    be a multiple of the alignment, the caller pads the last block.
+  */
+  bool write_file(const char *data, std::size_t size)
+  {
+#if defined(_WIN32)
+    return std::fwrite(data, 1, size, m_file) == size;
+#else
+    while (size > 0) {
+      const ssize_t n = ::write(m_file, data, size);
+      if (n < 0) {
+        if (EINTR == errno) {
+          continue;
+        }
+        return false;
+      }
+
+      data += n;
+      size -= static_cast<std::size_t>(n);
+    }
+
+    return true;
+#endif  // _WIN32
+  }
+
+  bool write_index(const std::vector<index_entry> &index)
+  {
+    for (std::size_t i=0; i<index.size(); ++i) {
+      char buffer[IndexEntrySize];
+      put_uint64(buffer, index[i].time);
+      put_uint64(buffer + 8, index[i].offset);
+      put_uint64(buffer + 16, index[i].count);
+      m_index.write(buffer, IndexEntrySize);
+    }
+
+    if (!index.empty()) {
+      m_index.flush();
+    }
+
+    return m_index.good();
+  }
+
+  /** I/O thread. Write pending blocks until we are closed. */
+  void run()
+  {
+    for (;;) {
+      block *item = NULL;
+      {
+        Lock lock(m_mutex);
+        while (m_pending.empty() && !m_closing) {
+          m_condition.wait(lock);
+        }
+
+        if (m_pending.empty()) {
+          break;
+        }
+
+        item = m_pending.front();
+        m_pending.pop_front();
+      }
+
+      // The last block may be partial. Pad it to the alignment for direct
+      // I/O, the file is truncated to the actual size in close.
+      std::size_t size = item->size;
+      if (m_direct && (0 != size % Alignment)) {
+        const std::size_t padded = (size + Alignment - 1) / Alignment * Alignment;
+        std::memset(item->data + size, 0, padded - size);
+        size = padded;
+      }
+
+      // Only add index entries once the data they point at is written.
+      const bool result = write_file(item->data, size) && write_index(item->index);
+
+      {
+        Lock lock(m_mutex);
+        if (!result) {
+          m_error = true;
+        }
+        m_free.push_back(item);
+      }
+    }
+  }
+
+  /** Close whichever files open managed to open. */
+  void abort_open()
+  {
+#if defined(_WIN32)
+    if (NULL != m_file) {
+      std::fclose(m_file);
+      m_file = NULL;
+    }
+#else
+    if (m_file >= 0) {
+      ::close(m_file);
+      m_file = -1;
+    }
+#endif  // _WIN32
+
+    if (m_index.is_open()) {
+      m_index.close();
+    }
+  }
+
+  void finish()
+  {
+#if defined(_WIN32)
+    if (0 != std::fclose(m_file)) {
+      m_error = true;
+    }
+#else
+    if (m_direct) {
+      if (0 != ::ftruncate(m_file, static_cast<off_t>(m_offset))) {
+        m_error = true;
+      }
+    }
+
+    if (0 != ::close(m_file)) {
+      m_error = true;
+    }
+#endif  // _WIN32
+
+    m_index.close();
+  }
+}; // class Recorder
+
+}}} // namespace Motion::SDK::Device
+
+#endif // __MOTION_SDK_PLUGIN_RECORDER_HPP_
@@ -0,0 +1,398 @@
+/*
+  @file    tools/sdk/cpp/plugin/Ring.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_PLUGIN_RING_HPP_
+#define __MOTION_SDK_PLUGIN_RING_HPP_
+
+#include <cstddef>
+
+/**
+  Depends on the Boost C++ libraries, available at http://www.boost.org/.
+  The Atomic library is header only on all of the common platforms.
+*/
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+
+namespace Motion { namespace SDK { namespace Device {
+
+/**
+  Bounded lock free ring buffer with a single writer and any number of readers.
+  When the ring is full the writer overwrites the oldest element. It never
+  waits for the readers.
+
+  Each element lives in a node from a pool that the constructor allocates. The
+  ring itself is an array of atomic node pointers, so push and pop only
+  exchange pointers. The readers hand their nodes back on a lock free list and
+  the writer takes the whole list at once. Use a cheap to copy, default
+  constructible value type, like a boost::shared_ptr to an immutable frame.
+
+  @code
+  ring_buffer< boost::shared_ptr<const data_type> > ring(64);
+
+  // Writer thread.
+  ring.push(boost::shared_ptr<const data_type>(new data_type(data)));
+
+  // Reader threads.
+  boost::shared_ptr<const data_type> frame;
+  while (ring.pop(frame)) {
+    // ...
+  }
+  @endcode
+*/
+template <typename T>
+class ring_buffer : private boost::noncopyable {
+ public:
+  typedef T value_type;
+  typedef std::size_t size_type;
+
+  /**
+    @param  capacity number of elements in the ring, rounded up to the next
+            power of two
+  */
+  explicit ring_buffer(const size_type &capacity)
+    : m_mask(round_up(capacity) - 1), m_slot(new slot_type[m_mask + 1]),
+      m_spare(NULL), m_free(NULL), m_head(0), m_tail(0), m_maximum(0),
+      m_dropped(0)
+  {
+    for (size_type i=0; i<=m_mask; ++i) {
+      m_slot[i].store(NULL, boost::memory_order_relaxed);
+    }
+
+    // One node for every slot, and one more for the writer to fill in.
+    for (size_type i=0; i<=m_mask + 1; ++i) {
+      node *item = new node();
+      item->next = m_spare;
+      m_spare = item;
+    }
+  }
+
+  ~ring_buffer()
+  {
+    for (size_type i=0; i<=m_mask; ++i) {
+      delete m_slot[i].load(boost::memory_order_relaxed);
+    }
+
+    delete_list(m_spare);
+    delete_list(m_free.load(boost::memory_order_acquire));
+  }
+
+  /**
+    Append an element at the head of the ring. Wait free, from the single
+    writer thread only. Copies the value into a pooled node. Only allocates
+    if the readers are still copying out of more nodes than the pool has
+    ever needed before, then the pool keeps the new node.
+
+    @return false if this call overwrote an element that no reader had
+            removed yet
+  */
+  bool push(const value_type &value)
+  {
+    node *item = m_spare;
+    if (NULL == item) {
+      // Take back all of the nodes that the readers are done with. We are the
+      // only thread that removes from the list, so there is no ABA problem.
+      item = m_free.exchange(NULL, boost::memory_order_acquire);
+      if (NULL == item) {
+        item = new node();
+      }
+    }
+    m_spare = item->next;
+    item->next = NULL;
+    item->value = value;
+
+    const size_type head = m_head.load(boost::memory_order_relaxed);
+    node *old = m_slot[head & m_mask].exchange(item, boost::memory_order_acq_rel);
+    m_head.store(head + 1, boost::memory_order_seq_cst);
+
+    if (NULL != old) {
+      // Release the overwritten value now, not when the node is reused.
+      old->value = value_type();
+      old->next = m_spare;
+      m_spare = old;
+      m_dropped.fetch_add(1, boost::memory_order_relaxed);
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+    Remove the oldest element from the tail of the ring. Lock free, from any
+    number of reader threads.
+
+    @return false if the ring is empty
+  */
+  bool pop(value_type &value)
+  {
+    for (;;) {
+      size_type tail = m_tail.load(boost::memory_order_acquire);
+      const size_type head = m_head.load(boost::memory_order_seq_cst);
+      if (tail == head) {
+        return false;
+      }
+
+      // Skip over the elements past the current maximum. The writer reclaims
+      // their nodes when it comes around to those slots again.
+      const size_type limit = maximum();
+      if (head - tail > limit) {
+        m_tail.compare_exchange_weak(tail, head - limit);
+        continue;
+      }
+
+      // Claim the element at the tail. If the writer has already lapped us
+      // the slot holds a newer element, which is fine. The newer index will
+      // find an empty slot and move on.
+      if (!m_tail.compare_exchange_weak(tail, tail + 1)) {
+        continue;
+      }
+
+      node *item = m_slot[tail & m_mask].exchange(
+        NULL, boost::memory_order_acq_rel);
+      if (NULL != item) {
+        value = item->value;
+        item->value = value_type();
+        release(item);
+        return true;
+      }
+    }
+  }
+
+  /**
+    Approximate number of elements in the ring. Exact when there are no
+    concurrent calls to push or pop.
+  */
+  size_type size() const
+  {
+    const size_type tail = m_tail.load(boost::memory_order_acquire);
+    const size_type head = m_head.load(boost::memory_order_acquire);
+    const size_type limit = maximum();
+    if (head - tail > limit) {
+      return limit;
+    } else {
+      return head - tail;
+    }
+  }
+
+  bool empty() const
+  {
+    return 0 == size();
+  }
+
+  /** Number of element slots allocated by the constructor. */
+  size_type capacity() const
+  {
+    return m_mask + 1;
+  }
+
+  /**
+    Limit the number of elements returned by pop to the value most recent
+    ones. Set to zero to use the full capacity.
+  */
+  void maximum(const size_type &value)
+  {
+    m_maximum.store(value, boost::memory_order_relaxed);
+  }
+
+  size_type maximum() const
+  {
+    const size_type value = m_maximum.load(boost::memory_order_relaxed);
+    if ((0 == value) || (value > capacity())) {
+      return capacity();
+    } else {
+      return value;
+    }
+  }
+
+  /**
+    Number of elements that were overwritten before any reader removed them.
+  */
+  size_type dropped() const
+  {
+    return m_dropped.load(boost::memory_order_relaxed);
+  }
+
+ private:
+  enum {
+    CacheLineSize = 64
+  };
+
+  class node {
+   public:
+    node()
+      : value(), next(NULL)
+    {
+    }
+
+    value_type value;
+
+    /** Link in the spare or the free list. */
+    node *next;
+  }; // class node
+
+  typedef boost::atomic<node *> slot_type;
+  typedef boost::atomic<size_type> index_type;
+
+  /** Reader threads. Hand a node back to the writer. */
+  void release(node *item)
+  {
+    node *head = m_free.load(boost::memory_order_relaxed);
+    do {
+      item->next = head;
+    } while (!m_free.compare_exchange_weak(
+               head, item, boost::memory_order_release,
+               boost::memory_order_relaxed));
+  }
+
+  static void delete_list(node *item)
+  {
+    while (NULL != item) {
+      node *next = item->next;
+      delete item;
+      item = next;
+    }
+  }
+
+  static size_type round_up(const size_type &capacity)
+  {
+    size_type result = 1;
+    while (result < capacity) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  size_type m_mask;
+  boost::scoped_array<slot_type> m_slot;
+
+  /** Nodes that only the writer uses. */
+  node *m_spare;
+
+  /** Nodes that the readers handed back. */
+  slot_type m_free;
+
+  /**
+    Keep the writer and reader indices on their own cache lines. The writer
+    stores to the head and the readers store to the tail.
+  */
+  char m_pad_head[CacheLineSize];
+  index_type m_head;
+  char m_pad_tail[CacheLineSize - sizeof(index_type)];
+  index_type m_tail;
+  char m_pad_maximum[CacheLineSize - sizeof(index_type)];
+  index_type m_maximum;
+  index_type m_dropped;
+}; // class ring_buffer
+
+
+/**
+  Lock free handoff of the newest value from a single writer thread to a
+  single reader thread. There are three copies of the value. The writer fills
+  one, the reader holds one, and the third is in the middle. Each side trades
+  its copy for the middle one with one atomic exchange. Neither side ever
+  waits, and the values are reused, so a large value type like a frame does
+  not allocate once it has seen its largest size.
+
+  @code
+  triple_buffer<frame_type> buffer;
+
+  // Writer thread.
+  fill(buffer.back());
+  buffer.publish();
+
+  // Reader thread.
+  if (buffer.update()) {
+    const frame_type &frame = buffer.front();
+  }
+  @endcode
+*/
+template <typename T>
+class triple_buffer : private boost::noncopyable {
+ public:
+  typedef T value_type;
+
+  triple_buffer()
+    : m_back(0), m_middle(1), m_front(2)
+  {
+  }
+
+  /** Writer thread only. The copy to fill in before the next publish. */
+  value_type &back()
+  {
+    return m_buffer[m_back];
+  }
+
+  /**
+    Writer thread only. Make the back copy the newest value and take the
+    middle one, which the reader is not using.
+  */
+  void publish()
+  {
+    m_back = m_middle.exchange(m_back | Fresh, boost::memory_order_acq_rel) &
+      Mask;
+  }
+
+  /**
+    Reader thread only. Take the newest value if there is one.
+
+    @return true if the front copy changed
+  */
+  bool update()
+  {
+    if (0 == (m_middle.load(boost::memory_order_acquire) & Fresh)) {
+      return false;
+    }
+
+    m_front = m_middle.exchange(m_front, boost::memory_order_acq_rel) & Mask;
+    return true;
+  }
+
+  /** Reader thread only. The newest value as of the last update. */
+  const value_type &front() const
+  {
+    return m_buffer[m_front];
+  }
+
+ private:
+  enum {
+    Mask = 3,
+    Fresh = 4
+  };
+
+  value_type m_buffer[3];
+  unsigned m_back;
+  boost::atomic<unsigned> m_middle;
+  unsigned m_front;
+}; // class triple_buffer
+
+}}} // namespace Motion::SDK::Device
+
+#endif // __MOTION_SDK_PLUGIN_RING_HPP_
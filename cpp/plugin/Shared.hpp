@@ -0,0 +1,818 @@
+/*
+  @file    tools/sdk/cpp/plugin/Shared.hpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __MOTION_SDK_PLUGIN_SHARED_HPP_
+#define __MOTION_SDK_PLUGIN_SHARED_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+  Depends on the Boost C++ libraries, available at http://www.boost.org/.
+  The Interprocess and Atomic libraries are header only on all of the common
+  platforms. Some older Linux systems need to link with -lrt for the shared
+  memory calls.
+*/
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <plugin/Device.hpp>
+
+
+namespace Motion { namespace SDK { namespace Device {
+
+/**
+  Layout of the shared memory segment. A header followed by a power of two
+  number of fixed size message slots.
+
+  Each slot is a sequence lock. The publisher makes the sequence odd, copies
+  in the message, and makes it even again. A reader copies the message out
+  and then checks that the sequence did not change. If it did, the publisher
+  lapped the reader and the copy is thrown away. Readers never write to the
+  segment, so any number of them can map it read only.
+*/
+namespace shared_detail {
+
+typedef boost::uint32_t sequence_type;
+typedef boost::atomic<sequence_type> atomic_type;
+
+enum {
+  Magic = 0x4d53444b,
+  Version = 1,
+  CacheLineSize = 64
+};
+
+struct header_type {
+  boost::uint32_t magic;
+  boost::uint32_t version;
+  boost::uint32_t capacity;
+  boost::uint32_t slot_size;
+
+  /** One while the publisher is attached, zero after it closes. */
+  atomic_type open;
+
+  /** Keep the head on its own cache line, readers poll it. */
+  char pad[CacheLineSize];
+
+  /** Number of messages published so far. */
+  atomic_type head;
+}; // struct header_type
+
+struct slot_type {
+  /** Even while the slot is stable, odd while the publisher writes it. */
+  atomic_type sequence;
+
+  /** Number of the message in this slot, compared to the reader position. */
+  sequence_type index;
+
+  /** Number of bytes in the message. */
+  sequence_type size;
+}; // struct slot_type
+
+inline std::size_t round_up(const std::size_t &size)
+{
+  return ((size + CacheLineSize - 1) / CacheLineSize) * CacheLineSize;
+}
+
+inline std::size_t header_size()
+{
+  return round_up(sizeof(header_type));
+}
+
+inline std::size_t slot_stride(const std::size_t &slot_size)
+{
+  return round_up(sizeof(slot_type) + slot_size);
+}
+
+} // namespace shared_detail
+
+/**
+  Default name of the shared memory segment for a data service port.
+*/
+inline std::string shared_name(const std::size_t &port)
+{
+  std::ostringstream stream;
+  stream << "MotionSDK." << port;
+  return stream.str();
+}
+
+/**
+  Publish the messages from one Client connection into a named shared memory
+  ring. Local processes read them with a SharedReader, or through a
+  SharedManager with the same Sampler interface as the Manager. They do not
+  open their own connection to the Motion Service.
+
+  The segment stores the binary messages, in the same format that
+  Client#readData returns. A decoded container is full of pointers that do
+  not mean anything in another process. Each reader decodes the messages it
+  needs, or only the elements it needs, see Format#Preview.
+
+  @code
+  Client client("", 32079);
+  SharedPublisher publisher(shared_name(32079));
+
+  Client::data_type data;
+  while (client.readData(data)) {
+    publisher.publish(data);
+  }
+  @endcode
+
+  There is only one publisher for each segment. It removes the segment name
+  when it is destroyed.
+*/
+class SharedPublisher : private boost::noncopyable {
+ public:
+  enum {
+    /** Number of messages in the ring. */
+    DefaultCapacity = 64,
+    /** Longest message, in bytes. */
+    DefaultSlotSize = 1 << 16
+  };
+
+  /**
+    Create the named shared memory segment. Replace any old segment with the
+    same name, for example from a publisher that did not exit cleanly.
+
+    @param  capacity number of messages in the ring, rounded up to the next
+            power of two
+    @param  slot_size longest message, in bytes
+    @throws std::runtime_error if the segment can not be created
+  */
+  explicit SharedPublisher(const std::string &name,
+                           const std::size_t &capacity=DefaultCapacity,
+                           const std::size_t &slot_size=DefaultSlotSize)
+    : m_name(name), m_memory(), m_region(), m_header(NULL), m_slot(NULL),
+      m_mask(0), m_stride(0)
+  {
+    using namespace boost::interprocess;
+
+    std::size_t count = 1;
+    while (count < capacity) {
+      count <<= 1;
+    }
+
+    const std::size_t stride = shared_detail::slot_stride(slot_size);
+
+    try {
+      shared_memory_object::remove(m_name.c_str());
+
+      m_memory.reset(
+        new shared_memory_object(create_only, m_name.c_str(), read_write));
+      m_memory->truncate(static_cast<offset_t>(
+        shared_detail::header_size() + count * stride));
+
+      m_region.reset(new mapped_region(*m_memory, read_write));
+    } catch (interprocess_exception &) {
+      m_region.reset();
+      m_memory.reset();
+      shared_memory_object::remove(m_name.c_str());
+#if MOTION_SDK_USE_EXCEPTIONS
+      throw detail::error("failed to create shared memory segment");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+      return;
+    }
+
+    char *first = static_cast<char *>(m_region->get_address());
+
+    m_header = new (first) shared_detail::header_type();
+    m_slot = first + shared_detail::header_size();
+    m_mask = count - 1;
+    m_stride = stride;
+
+    for (std::size_t i=0; i<count; ++i) {
+      shared_detail::slot_type *slot =
+        new (m_slot + i * m_stride) shared_detail::slot_type();
+      slot->sequence.store(0, boost::memory_order_relaxed);
+      slot->index = 0;
+      slot->size = 0;
+    }
+
+    m_header->magic = shared_detail::Magic;
+    m_header->version = shared_detail::Version;
+    m_header->capacity = static_cast<boost::uint32_t>(count);
+    m_header->slot_size = static_cast<boost::uint32_t>(slot_size);
+    m_header->head.store(0, boost::memory_order_relaxed);
+    m_header->open.store(1, boost::memory_order_release);
+  }
+
+  /**
+    Tell the readers that there are no more messages. Remove the name, the
+    readers keep their mappings until they close them.
+  */
+  ~SharedPublisher()
+  {
+    if (NULL != m_header) {
+      m_header->open.store(0, boost::memory_order_release);
+      boost::interprocess::shared_memory_object::remove(m_name.c_str());
+    }
+  }
+
+  bool is_open() const
+  {
+    return NULL != m_header;
+  }
+
+  /**
+    Copy one message into the next slot of the ring. Overwrite the oldest
+    message, never wait for the readers. Only call this from one thread.
+
+    @return false if the message does not fit in a slot
+  */
+  bool publish(const char *data, const std::size_t &size)
+  {
+    if ((NULL == m_header) || (size > m_header->slot_size)) {
+      return false;
+    }
+
+    const shared_detail::sequence_type index =
+      m_header->head.load(boost::memory_order_relaxed);
+
+    char *first = m_slot + (index & m_mask) * m_stride;
+    shared_detail::slot_type *slot =
+      reinterpret_cast<shared_detail::slot_type *>(first);
+
+    // Mark the slot as changing before we store any of the message.
+    const shared_detail::sequence_type sequence =
+      slot->sequence.load(boost::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_release);
+
+    slot->index = index;
+    slot->size = static_cast<shared_detail::sequence_type>(size);
+    if (size > 0) {
+      std::memcpy(first + sizeof(shared_detail::slot_type), data, size);
+    }
+
+    slot->sequence.store(sequence + 2, boost::memory_order_release);
+    m_header->head.store(index + 1, boost::memory_order_release);
+
+    return true;
+  }
+
+  /** @see SharedPublisher#publish */
+  bool publish(const Client::data_type &data)
+  {
+    return publish(data.empty() ? NULL : &data[0], data.size());
+  }
+
+ private:
+  std::string m_name;
+  boost::scoped_ptr<boost::interprocess::shared_memory_object> m_memory;
+  boost::scoped_ptr<boost::interprocess::mapped_region> m_region;
+  shared_detail::header_type *m_header;
+  char *m_slot;
+  std::size_t m_mask;
+  std::size_t m_stride;
+}; // class SharedPublisher
+
+/**
+  Read the messages of a SharedPublisher from another process. Maps the
+  segment read only. Each reader has its own position in the ring, reading
+  a message is a few atomic loads and a copy, no system calls.
+
+  @code
+  SharedReader reader(shared_name(32079));
+
+  Client::data_type data;
+  Format::ElementIndex<float> index;
+  while (reader.is_publisher_open()) {
+    if (reader.read(data) &&
+        Format::Preview(data.begin(), data.end(), index)) {
+      // ...
+    }
+  }
+  @endcode
+*/
+class SharedReader : private boost::noncopyable {
+ public:
+  /**
+    Open the named shared memory segment. Does not throw any exceptions,
+    check #is_open. Start with the next message published, the messages
+    already in the ring are skipped.
+  */
+  explicit SharedReader(const std::string &name)
+    : m_memory(), m_region(), m_header(NULL), m_slot(NULL), m_mask(0),
+      m_stride(0), m_tail(0), m_dropped(0)
+  {
+    using namespace boost::interprocess;
+
+    try {
+      m_memory.reset(
+        new shared_memory_object(open_only, name.c_str(), read_only));
+      m_region.reset(new mapped_region(*m_memory, read_only));
+    } catch (interprocess_exception &) {
+      m_region.reset();
+      m_memory.reset();
+      return;
+    }
+
+    const char *first = static_cast<const char *>(m_region->get_address());
+    const std::size_t size = m_region->get_size();
+    if (size < shared_detail::header_size()) {
+      return;
+    }
+
+    const shared_detail::header_type *header =
+      reinterpret_cast<const shared_detail::header_type *>(first);
+    if ((shared_detail::Magic != header->magic) ||
+        (shared_detail::Version != header->version) ||
+        (0 == header->capacity) ||
+        (0 != (header->capacity & (header->capacity - 1)))) {
+      return;
+    }
+
+    const std::size_t stride = shared_detail::slot_stride(header->slot_size);
+    if (size < shared_detail::header_size() + header->capacity * stride) {
+      return;
+    }
+
+    m_header = header;
+    m_slot = first + shared_detail::header_size();
+    m_mask = header->capacity - 1;
+    m_stride = stride;
+    m_tail = m_header->head.load(boost::memory_order_acquire);
+  }
+
+  /** @return true if the segment is mapped and valid */
+  bool is_open() const
+  {
+    return NULL != m_header;
+  }
+
+  /** @return true until the publisher closes the segment */
+  bool is_publisher_open() const
+  {
+    return (NULL != m_header) &&
+      (0 != m_header->open.load(boost::memory_order_acquire));
+  }
+
+  /**
+    Copy the next message in the ring. If the publisher lapped this reader,
+    skip ahead to the oldest message that is still in the ring.
+
+    @return false if there is no new message
+  */
+  bool read(Client::data_type &data)
+  {
+    if (NULL == m_header) {
+      return false;
+    }
+
+    for (;;) {
+      const shared_detail::sequence_type head =
+        m_header->head.load(boost::memory_order_acquire);
+      if (head == m_tail) {
+        return false;
+      }
+
+      if (head - m_tail > m_mask + 1) {
+        m_dropped += head - m_tail - (m_mask + 1);
+        m_tail = head - static_cast<shared_detail::sequence_type>(m_mask + 1);
+      }
+
+      const char *first = m_slot + (m_tail & m_mask) * m_stride;
+      const shared_detail::slot_type *slot =
+        reinterpret_cast<const shared_detail::slot_type *>(first);
+
+      const shared_detail::sequence_type sequence =
+        slot->sequence.load(boost::memory_order_acquire);
+
+      const shared_detail::sequence_type index = slot->index;
+      const std::size_t size =
+        std::min<std::size_t>(slot->size, m_header->slot_size);
+      data.resize(size);
+      if (size > 0) {
+        std::memcpy(&data[0], first + sizeof(shared_detail::slot_type), size);
+      }
+
+      boost::atomic_thread_fence(boost::memory_order_acquire);
+      if ((0 == (sequence & 1)) && (index == m_tail) &&
+          (sequence == slot->sequence.load(boost::memory_order_relaxed))) {
+        ++m_tail;
+        return true;
+      }
+
+      // The publisher is writing this slot, so it lapped us. Move on.
+      ++m_tail;
+      ++m_dropped;
+    }
+  }
+
+  /**
+    Skip to the newest message in the ring and copy it.
+
+    @return false if there is no new message
+  */
+  bool read_latest(Client::data_type &data)
+  {
+    if (NULL == m_header) {
+      return false;
+    }
+
+    const shared_detail::sequence_type head =
+      m_header->head.load(boost::memory_order_acquire);
+    if (head != m_tail) {
+      m_dropped += head - m_tail - 1;
+      m_tail = head - 1;
+    }
+
+    return read(data);
+  }
+
+  /** Number of messages that this reader skipped over. */
+  std::size_t get_dropped() const
+  {
+    return m_dropped;
+  }
+
+ private:
+  boost::scoped_ptr<boost::interprocess::shared_memory_object> m_memory;
+  boost::scoped_ptr<boost::interprocess::mapped_region> m_region;
+  const shared_detail::header_type *m_header;
+  const char *m_slot;
+  std::size_t m_mask;
+  std::size_t m_stride;
+  shared_detail::sequence_type m_tail;
+  std::size_t m_dropped;
+}; // class SharedReader
+
+
+/**
+  Same interface as the Manager, but read the data streams from the shared
+  memory segments of local SharedPublisher processes. Attach a Sampler and
+  this class reads the segment named shared_name(Sampler port). The address
+  and initialization string of the Sampler are not used, the publisher owns
+  the connection to the Motion Service.
+
+  There is one polling thread per segment. It decodes each message once,
+  only the elements that the attached samplers asked for, and shares the
+  frame with all of them. The thread spins for a little while after each
+  message and then sleeps in short steps until the next one.
+
+  @code
+  typedef Sampler<boost::mutex, boost::mutex::scoped_lock,
+                  boost::condition_variable_any> sampler_type;
+
+  SharedManager<sampler_type> manager;
+  sampler_type sampler("", 32079);
+  if (manager.attach(sampler)) {
+    sampler_type::data_type data;
+    while (sampler.get_data_block(data)) {
+      // ...
+    }
+  }
+  @endcode
+*/
+template <
+  typename SamplerType,
+  typename Thread=boost::thread,
+  typename Mutex=boost::recursive_mutex,
+  typename Lock=boost::recursive_mutex::scoped_lock,
+  typename Condition=boost::condition_variable_any
+>
+class SharedManager : private boost::noncopyable {
+ public:
+  typedef SamplerType sampler_type;
+  typedef typename sampler_type::data_type data_type;
+  typedef typename sampler_type::frame_type frame_type;
+
+  SharedManager()
+    : m_id(), m_container(), m_mutex(), m_frame_pool(FramePoolSize)
+  {
+  }
+
+  ~SharedManager()
+  {
+    std::vector<thread_pointer_type> list;
+    {
+      lock_type lock(m_mutex);
+      while (!m_container.empty()) {
+        list.push_back(remove_node(m_container.begin()));
+      }
+    }
+
+    // Join outside of the lock, the threads need it to finish their last
+    // message.
+    BOOST_FOREACH (thread_pointer_type &thread, list) {
+      thread->join();
+    }
+  }
+
+  /**
+    Attach the sampler to the shared memory segment of its port. Start a
+    polling thread if there is not one already.
+
+    @return false if there is no publisher for this port
+  */
+  bool attach(sampler_type &sampler)
+  {
+    if (0 != sampler.m_sampler_id) {
+#if MOTION_SDK_USE_EXCEPTIONS
+      throw detail::error("sampler already attached to data stream");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+      return false;
+    }
+
+    if (0 == sampler.m_port) {
+#if MOTION_SDK_USE_EXCEPTIONS
+      throw detail::error("sampler specifies invalid port number of 0");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+      return false;
+    }
+
+    const std::string key = shared_name(sampler.m_port);
+
+    thread_pointer_type closed;
+    {
+      lock_type lock(m_mutex);
+
+      typename container_type::iterator itr = m_container.find(key);
+      if ((m_container.end() != itr) && itr->second.m_state.quit() &&
+          itr->second.m_sampler_container.empty()) {
+        // The publisher closed. Start over with the new one, if any.
+        closed = remove_node(itr);
+        itr = m_container.end();
+      }
+
+      if (m_container.end() == itr) {
+        boost::shared_ptr<SharedReader> reader(new SharedReader(key));
+        if (!reader->is_open() || !reader->is_publisher_open()) {
+#if MOTION_SDK_USE_EXCEPTIONS
+          throw detail::error("failed to open shared memory data stream");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+          return false;
+        }
+
+        itr = m_container.insert(std::make_pair(key, Node())).first;
+
+        Node &node = itr->second;
+        node.m_state.connected(true);
+        node.m_state.reading(true);
+        node.m_quit.reset(new quit_type(false));
+        node.m_thread.reset(new Thread(boost::bind(
+          &SharedManager::run, this, key, reader, node.m_quit)));
+      } else if (itr->second.m_state.quit()) {
+#if MOTION_SDK_USE_EXCEPTIONS
+        throw detail::error(
+          "failed to attach to existing, but closed, data stream");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+        return false;
+      }
+
+      sampler.m_sampler_id = ++m_id;
+      itr->second.m_sampler_container.push_back(sampler);
+      itr->second.update_key();
+      sampler.m_state = itr->second.m_state;
+    }
+
+    if (closed) {
+      closed->join();
+    }
+
+    return true;
+  }
+
+  bool detach(sampler_type &sampler)
+  {
+    if (0 == sampler.m_sampler_id) {
+#if MOTION_SDK_USE_EXCEPTIONS
+      throw detail::error("sampler not attached to data stream");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+      return false;
+    }
+
+    thread_pointer_type thread;
+    {
+      lock_type lock(m_mutex);
+
+      typename container_type::iterator node_itr =
+        m_container.find(shared_name(sampler.m_port));
+      if (m_container.end() != node_itr) {
+        typename Node::sampler_container_type &list =
+          node_itr->second.m_sampler_container;
+
+        typename Node::sampler_container_type::iterator itr = list.begin();
+        for (; itr!=list.end(); ++itr) {
+          if (sampler.m_sampler_id == itr->m_sampler_id) {
+            break;
+          }
+        }
+
+        if (list.end() != itr) {
+          list.erase(itr);
+          node_itr->second.update_key();
+          sampler.m_sampler_id = 0;
+
+          if (list.empty()) {
+            thread = remove_node(node_itr);
+          }
+        }
+      }
+    }
+
+    if (thread) {
+      thread->join();
+    }
+
+    return true;
+  }
+
+ private:
+  typedef Mutex mutex_type;
+  typedef Lock lock_type;
+  typedef boost::shared_ptr<Thread> thread_pointer_type;
+  typedef boost::atomic<bool> quit_type;
+
+  enum {
+    FramePoolSize = 16,
+    /** Number of empty polls that only yield before we start to sleep. */
+    SpinCount = 64,
+    /** Sleep between empty polls, in microseconds. */
+    SleepMicrosecond = 100
+  };
+
+  class Node {
+   public:
+    typedef std::vector<sampler_type> sampler_container_type;
+    typedef State<mutex_type,lock_type> state_type;
+
+    thread_pointer_type m_thread;
+
+    /** Set by the manager to stop the polling thread. */
+    boost::shared_ptr<quit_type> m_quit;
+
+    state_type m_state;
+
+    sampler_container_type m_sampler_container;
+
+    /**
+      Union of the keys of all of the attached samplers. Empty if any one of
+      them wants all of the elements.
+    */
+    Format::id_list_type m_key;
+
+    /** Call after any change to the sampler container. */
+    void update_key()
+    {
+      m_key.clear();
+      BOOST_FOREACH (const sampler_type &sampler, m_sampler_container) {
+        if (sampler.m_key.empty()) {
+          m_key.clear();
+          return;
+        }
+
+        m_key.insert(m_key.end(), sampler.m_key.begin(), sampler.m_key.end());
+      }
+
+      std::sort(m_key.begin(), m_key.end());
+      m_key.erase(std::unique(m_key.begin(), m_key.end()), m_key.end());
+    }
+  }; // class Node
+
+  typedef std::map<std::string,Node> container_type;
+  typedef frame_pool<data_type,mutex_type,lock_type> frame_pool_type;
+
+  std::size_t m_id;
+  container_type m_container;
+  mutex_type m_mutex;
+
+  /** Decoded frames, recycled once all of the samplers let go of them. */
+  frame_pool_type m_frame_pool;
+
+  /**
+    Tell the polling thread to stop and erase the node. Call with the lock
+    held, join the returned thread after it is released.
+  */
+  thread_pointer_type remove_node(typename container_type::iterator node_itr)
+  {
+    thread_pointer_type result = node_itr->second.m_thread;
+    node_itr->second.m_quit->store(true, boost::memory_order_release);
+    m_container.erase(node_itr);
+    return result;
+  }
+
+  /**
+    Polling thread for one segment. Owns the reader, the node may be erased
+    at any time.
+  */
+  void run(const std::string key, boost::shared_ptr<SharedReader> reader,
+           boost::shared_ptr<quit_type> quit)
+  {
+    Client::data_type data;
+    std::size_t idle = 0;
+
+    while (!quit->load(boost::memory_order_acquire)) {
+      if (reader->read(data)) {
+        set_data_slot(key, data, false);
+        idle = 0;
+      } else if (!reader->is_publisher_open()) {
+        // Drain anything that the publisher wrote before it closed.
+        while (reader->read(data)) {
+          set_data_slot(key, data, false);
+        }
+
+        set_data_slot(key, Client::data_type(), true);
+        break;
+      } else if (++idle < SpinCount) {
+        boost::this_thread::yield();
+      } else {
+        boost::this_thread::sleep(
+          boost::posix_time::microseconds(static_cast<long>(SleepMicrosecond)));
+      }
+    }
+  }
+
+  /**
+    Decode once, only the elements that the samplers asked for, and pass the
+    shared frame to all of them. Send an empty frame after the publisher
+    closes so any blocked readers wake up.
+  */
+  void set_data_slot(const std::string &key, const Client::data_type &data,
+                     bool close)
+  {
+    lock_type lock(m_mutex);
+
+    typename container_type::iterator node_itr = m_container.find(key);
+    if (m_container.end() == node_itr) {
+      return;
+    }
+
+    Node &node = node_itr->second;
+    if (close) {
+      node.m_state.connected(false);
+      node.m_state.reading(false);
+      node.m_state.quit(true);
+    }
+
+    typename frame_pool_type::pointer_type frame = m_frame_pool.get();
+    if (data.empty()) {
+      frame->clear();
+    } else if (node.m_key.empty()) {
+      format_data(data, *frame);
+    } else {
+      data_type in_data = format_data<data_type>(data, node.m_key);
+      frame->swap(in_data);
+    }
+
+    if (!data.empty() || close) {
+      const frame_type shared(frame);
+
+      typename Node::sampler_container_type::iterator itr =
+        node.m_sampler_container.begin();
+      bool erased = false;
+      while (node.m_sampler_container.end() != itr) {
+        if (itr->set_data(shared)) {
+          ++itr;
+        } else {
+          itr = node.m_sampler_container.erase(itr);
+          erased = true;
+        }
+      }
+
+      if (erased) {
+        node.update_key();
+      }
+    }
+  }
+}; // class SharedManager
+
+}}} // namespace Motion::SDK::Device
+
+#endif // __MOTION_SDK_PLUGIN_SHARED_HPP_
@@ -43,14 +43,20 @@
 #else
 #  include <arpa/inet.h>
 #  include <errno.h>
+#  include <fcntl.h>
 #  include <netinet/in.h>
 #  include <netinet/tcp.h>
+#  include <poll.h>
 #  include <sys/errno.h>
 #  include <sys/types.h>
 #  include <sys/socket.h>
+#  include <sys/uio.h>
 #  include <unistd.h>
 #endif  // _WIN32
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
 #include <cstring>
 #include <string>
 
@@ -104,6 +110,14 @@
 #  define CATCH_ERROR(expr) expr
 #endif  // MOTION_SDK_USE_EXCEPTIONS
 
+// Only record receive path statistics if the client application asks for
+// them. Compile out the hot path code otherwise.
+#if MOTION_SDK_INSTRUMENT
+#  define CLIENT_INSTRUMENT(expr) expr;
+#else
+#  define CLIENT_INSTRUMENT(expr)
+#endif  // MOTION_SDK_INSTRUMENT
+
 
 namespace Motion { namespace SDK {
 
@@ -122,11 +136,39 @@ namespace detail {
 const std::size_t MaximumMessageLength = 65535;
 
 /**
-  The maximum size (in bytes) of a single send/receive to the underlying
-  socket library. This socket will allocate this memory at instantiation
-  time.
+  The upper bound of the per connection maximum message length. The header is
+  a 32-bit length, but we still assume that a message this long is an error.
+*/
+const std::size_t MaximumMessageLengthLimit = 1 << 28;
+
+/**
+  The minimum size (in bytes) of the receive buffer. Must hold at least one
+  complete message and its length header.
+*/
+const std::size_t MinimumReceiveBufferSize =
+  sizeof(unsigned) + MaximumMessageLength;
+
+/**
+  The default size (in bytes) of the receive buffer. A single recv call may
+  fill all of the free space in the buffer. This socket will allocate this
+  memory at instantiation time.
+*/
+const std::size_t ReceiveBufferSize = 4 * 65536;
+
+/**
+  The minimum size (in bytes) of the system socket send and receive buffers.
 */
-const std::size_t ReceiveBufferSize = 1024;
+const int SocketBufferSize = 65536;
+
+/**
+  The maximum number of buffers in one gather send system call, a header and
+  a message per pair. Longer lists take more calls.
+*/
+#if defined(IOV_MAX) && (IOV_MAX < 64)
+const std::size_t MaximumSendBuffer = IOV_MAX;
+#else
+const std::size_t MaximumSendBuffer = 64;
+#endif  // IOV_MAX
 
 /**
   Set the address to this value if we get an empty string.
@@ -134,57 +176,140 @@ const std::size_t ReceiveBufferSize = 1024;
 const std::string DefaultAddress = "127.0.0.1";
 
 /**
-  Default value, in seconds, for the socket receive time out
+  Default value, in milliseconds, for the receive time out
   in the Client#waitForData method. Zero denotes blocking receive.
 */
-const std::size_t TimeOutWaitForData = 5;
+const std::size_t TimeOutWaitForData = 5000;
 
 /**
-  Default value, in seconds, for the socket receive time out
+  Default value, in milliseconds, for the receive time out
   in the Client#readData method.
 */
-const std::size_t TimeOutReadData = 1;
+const std::size_t TimeOutReadData = 1000;
 
 /**
-  Default value, in seconds, for the socket send time out
+  Default value, in milliseconds, for the send time out
   in the Client#writeData method.
 */
-const std::size_t TimeOutWriteData = 1;
+const std::size_t TimeOutWriteData = 1000;
 
 /**
   Detect XML message with the following header bytes.
 */
 const std::string XMLMagic = "<?xml";
 
-#if defined(_WIN32)
-typedef int timeval_type;
+/**
+  Returns true iff the message starts with the XMLMagic header bytes.
+*/
+bool is_xml_message(const char *data, const std::size_t &size)
+{
+  return (size >= XMLMagic.size()) &&
+    (0 == std::memcmp(data, XMLMagic.c_str(), XMLMagic.size()));
+}
 
-int make_timeval(const std::size_t &second)
+/**
+  Deadline on the monotonic_time clock that is this many milliseconds from
+  now. Zero denotes no deadline.
+*/
+double make_deadline(const std::size_t &millisecond)
 {
-  // Windows specifies this as an integer valued milliseconds.
-  return static_cast<int>(second) * 1000;
+  if (0 == millisecond) {
+    return -1;
+  }
+
+  return monotonic_time() + static_cast<double>(millisecond) / 1000;
 }
+
+/**
+  True if the socket call failed because it would block. The Windows CRT
+  defines its own EWOULDBLOCK and EAGAIN values, Winsock reports
+  WSAEWOULDBLOCK instead.
+*/
+bool would_block(const int &error_code)
+{
+#if defined(_WIN32)
+  return WSAEWOULDBLOCK == error_code;
 #else
-typedef timeval timeval_type;
+  return (EAGAIN == error_code) || (EWOULDBLOCK == error_code);
+#endif  // _WIN32
+}
+
+/**
+  Wait until the socket is ready to read or write, or until the deadline
+  passes. Start over with the remaining time if a signal interrupts the wait.
 
-timeval make_timeval(const std::size_t &second)
+  @param  deadline on the monotonic_time clock, negative to wait forever
+  @return 1 if the socket is ready, 0 if the deadline passed, -1 for any error
+*/
+int wait_socket(const int &socket, bool write, const double &deadline)
 {
-  // Linux specifies this as a timeval.
-  timeval optionval;
-  optionval.tv_sec = second;
-  optionval.tv_usec = 0;
+  for (;;) {
+    int time_out = -1;
+    if (deadline >= 0) {
+      const double remaining = deadline - monotonic_time();
+      time_out = (remaining > 0) ?
+        static_cast<int>(std::min(std::ceil(remaining * 1000), 1e9)) : 0;
+    }
+
+#if defined(_WIN32)
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(socket, &set);
+
+    timeval value;
+    value.tv_sec = time_out / 1000;
+    value.tv_usec = (time_out % 1000) * 1000;
+
+    const int result = ::select(
+      socket + 1, write ? NULL : &set, write ? &set : NULL, NULL,
+      (time_out < 0) ? NULL : &value);
+#else
+    pollfd item;
+    item.fd = socket;
+    item.events = write ? POLLOUT : POLLIN;
+    item.revents = 0;
 
-  return optionval;
+    const int result = ::poll(&item, 1, time_out);
+#endif  // _WIN32
+
+    if (result >= 0) {
+      return (result > 0) ? 1 : 0;
+    } else if (EINTR != ERROR_CODE) {
+      return -1;
+    }
+  }
 }
+
+/**
+  Make the socket non-blocking. The deadlines of the read and write methods
+  wait for it with poll instead of a socket time out option.
+*/
+bool set_non_blocking(const int &socket)
+{
+#if defined(_WIN32)
+  u_long mode = 1;
+  return 0 == ::ioctlsocket(socket, FIONBIO, &mode);
+#else
+  const int flags = ::fcntl(socket, F_GETFL, 0);
+  return (-1 != flags) && (-1 != ::fcntl(socket, F_SETFL, flags | O_NONBLOCK));
 #endif  // _WIN32
+}
 
 }  // namespace detail
 
-Client::Client(const std::string &host, const unsigned &port)
+Client::Client(const std::string &host, const unsigned &port,
+               const std::size_t &buffer_size)
   : m_socket(-1), m_host(), m_port(0), m_description(), m_xml_string(),
     m_intercept_xml(true), m_error_string(), m_initialize(false),
-    m_buffer(detail::ReceiveBufferSize), m_nextMessage(), m_time_out_second(0),
-    m_time_out_second_send(0)
+    m_buffer(
+      (0 == buffer_size) ? detail::ReceiveBufferSize :
+      std::max(buffer_size, detail::MinimumReceiveBufferSize)), m_buffer_first(0), m_buffer_last(0),
+    m_buffer_release(0), m_statistics(), m_receive_time(0), m_message_time(0),
+    m_time_out_receive(0), m_time_out_send(0),
+    m_time_out_read_default(detail::TimeOutReadData),
+    m_time_out_write_default(detail::TimeOutWriteData),
+    m_receive_deadline(-1), m_send_deadline(-1),
+    m_maximum_length(detail::MaximumMessageLength)
 {
   int socket = initialize();
   int result = 0;
@@ -248,23 +373,33 @@ Client::Client(const std::string &host, const unsigned &port)
     m_host = host;
     m_port = port;
 
-    // Set send and receive buffer sizes to something larger than the default.
+    // Set send and receive buffer sizes to something larger than the
+    // default. Let the system buffer at least as much as we can read in one
+    // call.
     {
-      const int optionval = 65536;
+      const int optionval = detail::SocketBufferSize;
 
       result = ::setsockopt(
         socket, SOL_SOCKET, SO_SNDBUF,
         reinterpret_cast<const char *>(&optionval), sizeof(optionval));
 
+      const int optionval_receive = std::max(
+        detail::SocketBufferSize, static_cast<int>(m_buffer.size()));
+
       result = ::setsockopt(
         socket, SOL_SOCKET, SO_RCVBUF,
-        reinterpret_cast<const char *>(&optionval), sizeof(optionval));
+        reinterpret_cast<const char *>(&optionval_receive),
+        sizeof(optionval_receive));
+    }
+
+    if (!detail::set_non_blocking(socket)) {
+      CLIENT_ERROR("failed to set non-blocking socket mode");
     }
 
     {
       // Read the first message from the service. It is a
       // string description of the remote service.
-      setReceiveTimeout(detail::TimeOutWaitForData);
+      m_time_out_receive = detail::TimeOutWaitForData;
       *this >> m_description;
     }
   }
@@ -273,8 +408,13 @@ Client::Client(const std::string &host, const unsigned &port)
 Client::Client()
   : m_socket(-1), m_host(), m_port(0), m_description(), m_xml_string(),
     m_intercept_xml(true), m_error_string(), m_initialize(false),
-    m_buffer(detail::ReceiveBufferSize), m_nextMessage(), m_time_out_second(0),
-    m_time_out_second_send(0)
+    m_buffer(detail::ReceiveBufferSize), m_buffer_first(0), m_buffer_last(0),
+    m_buffer_release(0), m_statistics(), m_receive_time(0), m_message_time(0),
+    m_time_out_receive(0), m_time_out_send(0),
+    m_time_out_read_default(detail::TimeOutReadData),
+    m_time_out_write_default(detail::TimeOutWriteData),
+    m_receive_deadline(-1), m_send_deadline(-1),
+    m_maximum_length(detail::MaximumMessageLength)
 {
   m_socket = initialize();
 }
@@ -325,7 +465,9 @@ void Client::close()
     m_xml_string.clear();
 
     std::fill(m_buffer.begin(), m_buffer.end(), 0);
-    m_nextMessage.clear();
+    m_buffer_first = 0;
+    m_buffer_last = 0;
+    m_buffer_release = 0;
   } else {
     CLIENT_ERROR("failed to close client, not connected");
   }
@@ -349,21 +491,15 @@ bool Client::waitForData(const int &time_out_second)
     // A default value of the time_out_second (-1)
     // indicates that we just want to use the default
     // implementation.
-    if (time_out_second < 0) {
-      if (detail::TimeOutWaitForData != m_time_out_second) {
-        setReceiveTimeout(detail::TimeOutWaitForData);
-      }
-    } else {
-      setReceiveTimeout(time_out_second);
-    }
+    setReadTimeout(time_out_second, detail::TimeOutWaitForData);
 
-    std::string message;
-    (*this) >> message;
+    data_view_type message;
+    receiveMessage(message);
 
     // Consume any incoming XML message.
-    if ((message.size() >= detail::XMLMagic.size()) &&
-        (message.substr(0, detail::XMLMagic.size()) == detail::XMLMagic)) {
-      m_xml_string.assign(message);
+    if (detail::is_xml_message(message.data(), message.size())) {
+      m_xml_string.assign(message.begin(), message.end());
+      CLIENT_INSTRUMENT(++m_statistics.xml_messages)
     }
 
     if (!message.empty()) {
@@ -381,6 +517,42 @@ bool Client::readData(data_type &data, const int &time_out_second)
 {
   data.clear();
 
+  data_view_type message;
+  if (readData(message, time_out_second)) {
+    data.assign(message.begin(), message.end());
+
+    return true;
+  }
+
+  return false;
+}
+
+bool Client::readData(char *data, const std::size_t &capacity,
+                      std::size_t &size, const int &time_out_second)
+{
+  size = 0;
+
+  data_view_type message;
+  if (!readData(message, time_out_second)) {
+    return false;
+  }
+
+  size = message.size();
+  if (size > capacity) {
+    // Do not release the message, the next receive parses it again.
+    m_buffer_release = 0;
+    return false;
+  }
+
+  std::memcpy(data, message.data(), size);
+
+  return true;
+}
+
+bool Client::readData(data_view_type &data, const int &time_out_second)
+{
+  data.clear();
+
   bool result = false;
 
   // Is this an active socket connection?
@@ -388,28 +560,19 @@ bool Client::readData(data_type &data, const int &time_out_second)
     // A default value of the time_out_second (-1)
     // indicates that we just want to use the default
     // implementation.
-    if (time_out_second < 0) {
-      if (detail::TimeOutReadData != m_time_out_second) {
-        setReceiveTimeout(detail::TimeOutReadData);
-      }
-    } else {
-      setReceiveTimeout(time_out_second);
-    }
+    setReadTimeout(time_out_second, m_time_out_read_default);
 
-    std::string message;
-    *this >> message;
+    receiveMessage(data);
 
     // Consume any incoming XML message.
-    if (m_intercept_xml && (message.size() >= detail::XMLMagic.size()) &&
-        (message.substr(0, detail::XMLMagic.size()) == detail::XMLMagic)) {
-      m_xml_string.assign(message);
+    if (m_intercept_xml && detail::is_xml_message(data.data(), data.size())) {
+      m_xml_string.assign(data.begin(), data.end());
+      CLIENT_INSTRUMENT(++m_statistics.xml_messages)
 
-      (*this) >> message;
+      receiveMessage(data);
     }
 
-    if (!message.empty()) {
-      data.assign(message.begin(), message.end());
-
+    if (!data.empty()) {
       result = true;
     }
 
@@ -420,6 +583,51 @@ bool Client::readData(data_type &data, const int &time_out_second)
   return result;
 }
 
+std::size_t Client::readBatch(std::vector<data_view_type> &data,
+                              const std::size_t &max_messages,
+                              const int &time_out_second)
+{
+  data.clear();
+
+  data_view_type message;
+  if (readData(message, time_out_second)) {
+    bool allow_receive = true;
+    do {
+      data.push_back(message);
+    } while (((0 == max_messages) || (data.size() < max_messages)) &&
+             receiveBufferedMessage(message, allow_receive));
+  }
+
+  return data.size();
+}
+
+bool Client::readLatest(data_view_type &data, std::size_t &dropped,
+                        const int &time_out_second)
+{
+  dropped = 0;
+
+  if (!readData(data, time_out_second)) {
+    return false;
+  }
+
+  dropped = receiveLatestMessage(data);
+
+  return !data.empty();
+}
+
+bool Client::readLatest(data_type &data, std::size_t &dropped,
+                        const int &time_out_second)
+{
+  data_view_type message;
+  if (readLatest(message, dropped, time_out_second)) {
+    data.assign(message.begin(), message.end());
+    return true;
+  }
+
+  data.clear();
+  return false;
+}
+
 bool Client::writeData(const data_type &data, const int &time_out_second)
 {
   bool result = false;
@@ -430,31 +638,123 @@ bool Client::writeData(const data_type &data, const int &time_out_second)
 
   // Is this an active socket connection?
   if (isConnected()) {
-    // A default value of the time_out_second (-1) indicates that we just want
-    // to use the default implementation.
-    if (time_out_second < 0) {
-      if (detail::TimeOutWriteData != m_time_out_second_send) {
-        setSendTimeout(detail::TimeOutWriteData);
-      }
-    } else {
-      setSendTimeout(m_time_out_second_send);
+    setWriteTimeout(time_out_second);
+
+    // Send the length header and the message in one gather call, straight
+    // from the caller buffer.
+    unsigned header = 0;
+    if (packHeader(data.size(), header)) {
+      const send_buffer_type buffer[2] = {
+        {reinterpret_cast<const char *>(&header), sizeof(header)},
+        {&data[0], data.size()}
+      };
+
+      result = sendAll(buffer, 2);
     }
 
-    {
-      std::string message(data.begin(), data.end());
+  } else {
+    CLIENT_ERROR("failed to write data, client is not connected");
+  }
+
+  return result;
+}
 
-      *this << message;
+bool Client::writeBatch(const std::vector<data_type> &data,
+                        const int &time_out_second)
+{
+  bool result = false;
+
+  if (data.empty()) {
+    return false;
+  }
+
+  // Is this an active socket connection?
+  if (isConnected()) {
+    setWriteTimeout(time_out_second);
+
+    // Validate every message before we send any of them. Point the gather
+    // list at the headers and straight at the caller messages.
+    std::vector<unsigned> header(data.size());
+    std::vector<send_buffer_type> buffer(2 * data.size());
+    for (std::size_t i=0; i<data.size(); ++i) {
+      if (!packHeader(data[i].size(), header[i])) {
+        return false;
+      }
+
+      buffer[2 * i].data = reinterpret_cast<const char *>(&header[i]);
+      buffer[2 * i].size = sizeof(unsigned);
+      buffer[2 * i + 1].data = &data[i][0];
+      buffer[2 * i + 1].size = data[i].size();
     }
 
-    result = true;
+    result = sendAll(&buffer[0], buffer.size());
 
   } else {
-    CLIENT_ERROR("failed to read data, client is not connected");
+    CLIENT_ERROR("failed to write data, client is not connected");
   }
 
   return result;
 }
 
+bool Client::setNoDelay(bool no_delay)
+{
+  bool result = false;
+
+  // Is this an active socket connection?
+  if (isConnected()) {
+    const int optionval = no_delay ? 1 : 0;
+
+    int set_result = ::setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY,
+                                  reinterpret_cast<const char *>(&optionval),
+                                  sizeof(optionval));
+
+    if (-1 == set_result) {
+      CLIENT_ERROR("failed to set client no delay option");
+    } else {
+      result = true;
+    }
+
+  } else {
+    CLIENT_ERROR("failed to set client no delay option, socket is not connected");
+  }
+
+  return result;
+}
+
+bool Client::setMaximumMessageLength(const std::size_t &length)
+{
+  const std::size_t value =
+    (0 == length) ? detail::MaximumMessageLength : length;
+  if (value > detail::MaximumMessageLengthLimit) {
+    CLIENT_ERROR("failed to set maximum message length, value is too large");
+    CLIENT_ERROR_OP(return false);
+  }
+
+  // The buffer holds the whole message and its length header. Only grow it,
+  // the bytes that we already received stay in place.
+  if (m_buffer.size() < sizeof(unsigned) + value) {
+    m_buffer.resize(sizeof(unsigned) + value);
+  }
+
+  m_maximum_length = value;
+
+  return true;
+}
+
+std::size_t Client::getMaximumMessageLength() const
+{
+  return m_maximum_length;
+}
+
+void Client::setDefaultTimeOut(const int &read_millisecond,
+                               const int &write_millisecond)
+{
+  m_time_out_read_default = (read_millisecond < 0) ?
+    detail::TimeOutReadData : static_cast<std::size_t>(read_millisecond);
+  m_time_out_write_default = (write_millisecond < 0) ?
+    detail::TimeOutWriteData : static_cast<std::size_t>(write_millisecond);
+}
+
 bool Client::getXMLString(std::string &xml_string)
 {
   // Note that this does not enforce the connection state. This may return true
@@ -464,6 +764,27 @@ bool Client::getXMLString(std::string &xml_string)
   return !xml_string.empty();
 }
 
+bool Client::getStatistics(statistics_type &result) const
+{
+#if MOTION_SDK_INSTRUMENT
+  result = m_statistics;
+  return true;
+#else
+  result = statistics_type();
+  return false;
+#endif  // MOTION_SDK_INSTRUMENT
+}
+
+void Client::resetStatistics()
+{
+  m_statistics.clear();
+}
+
+double Client::getMessageTime() const
+{
+  return m_message_time;
+}
+
 bool Client::getErrorString(std::string &message)
 {
   // Note that this does not enforce the connection state. This may return true
@@ -477,171 +798,367 @@ Client &Client::operator>>(std::string &message)
 {
   message.clear();
 
-  // Use these intermediary values to pipe data into from our message buffer,
-  // or from calls to recv. That way we can follow a unified path.
-  std::string toRecv;
-  std::size_t bytes = 0;
-  bool receive_timed_out = false;
+  data_view_type view;
+  if (receiveMessage(view)) {
+    message.assign(view.begin(), view.end());
+  }
 
-  // We may have saved a little something for ourselves from the buffer of
-  // another message.
-  if (!m_nextMessage.empty()) {
-    toRecv.assign(m_nextMessage);
+  return *this;
+}
 
-    bytes = toRecv.length();
-    m_nextMessage.clear();
-  } else {
-    bytes = receive(toRecv, receive_timed_out);
-  }
+bool Client::receiveMessage(data_view_type &message, bool block)
+{
+  message.clear();
 
-  // This can indicate a graceful disconnection of the socket stream (for TCP).
-  if (0 == bytes) {
-    if (!receive_timed_out) {
-      CATCH_ERROR(close());
-    }
+  // The previous message view is no longer valid. Release its bytes.
+  m_buffer_first += m_buffer_release;
+  m_buffer_release = 0;
 
-    return *this;
+  if (m_buffer_first == m_buffer_last) {
+    m_buffer_first = 0;
+    m_buffer_last = 0;
   }
 
-  // Read the length of the message from the message "header".
-  unsigned length = 0;
+  // One deadline for every receive that it takes to complete the message.
+  if (block) {
+    m_receive_deadline = detail::make_deadline(m_time_out_receive);
+  }
 
-  // Paranoia. We need at least 4 bytes to start this message. Let's give
-  // ourselves every opportunity to get them before we give up.
-  {
-    unsigned count = 0;
-    while ((bytes < sizeof(unsigned)) && (count < (sizeof(unsigned)-1))) {
-      std::string temp;
-      unsigned nextBytes = receive(temp, receive_timed_out);
-      if (0 == nextBytes) {
-        CLIENT_ERROR(
-          "communication protocol error, failed to read message header");
-        CLIENT_ERROR_OP(close());
-        CLIENT_ERROR_OP(return *this);
+  bool receive_timed_out = false;
+  while (true) {
+    // Number of contiguous bytes that we need for the current message.
+    std::size_t required = 0;
+    if (parseMessage(message, required)) {
+      return true;
+    } else if (0 == required) {
+      return false;
+    }
+
+    // Make sure the rest of the message will fit in the contiguous space at
+    // the end of the buffer. Otherwise, move the partial message to the
+    // front.
+    const std::size_t bytes = m_buffer_last - m_buffer_first;
+    if (m_buffer.size() - m_buffer_first < required) {
+      std::memmove(&m_buffer[0], &m_buffer[m_buffer_first], bytes);
+      m_buffer_first = 0;
+      m_buffer_last = bytes;
+    }
+
+    // Read as much as we can fit into the buffer in one call.
+    const unsigned received = receive(
+      &m_buffer[m_buffer_last], m_buffer.size() - m_buffer_last,
+      receive_timed_out, block);
+
+    if (0 == received) {
+      // This can indicate a graceful disconnection of the socket stream (for
+      // TCP). A time out leaves any partial message in the buffer for the next
+      // call.
+      if (!receive_timed_out) {
+        if (bytes > 0) {
+          CLIENT_ERROR("communication protocol error, message interrupted");
+          CLIENT_ERROR_OP(close());
+          CLIENT_ERROR_OP(return false);
+        }
+
+        if (isConnected()) {
+          CATCH_ERROR(close());
+        }
       }
-      toRecv.append(temp);
-      bytes += nextBytes;
-      count++;
+
+      return false;
     }
-  }
 
-  // Needs >= 4 bytes.
-  if ((bytes < sizeof(unsigned)) || (bytes != toRecv.length())) {
-    CLIENT_ERROR(
-      "communication protocol error, failed to read full message header");
-    CLIENT_ERROR_OP(close());
-    CLIENT_ERROR_OP(return *this);
+    m_buffer_last += received;
   }
+}
 
+bool Client::receiveAvailableMessage(data_view_type &message)
+{
+  while (receiveMessage(message, false)) {
+    if (m_intercept_xml &&
+        detail::is_xml_message(message.data(), message.size())) {
+      m_xml_string.assign(message.begin(), message.end());
+      CLIENT_INSTRUMENT(++m_statistics.xml_messages)
+      continue;
+    }
 
-  // Copy the network ordered message length header. Make sure it is a
-  // "reasonable" value.
-  length = *reinterpret_cast<const unsigned *>(toRecv.c_str());
-  length = ntohl(length);
-  if ((0 == length) || (length > detail::MaximumMessageLength)) {
-    CLIENT_ERROR(
-      "communication protocol error, message header specifies invalid length");
-    CLIENT_ERROR_OP(close());
-    CLIENT_ERROR_OP(return *this);
+    return true;
   }
 
-  message = toRecv.substr(sizeof(unsigned), length);
+  return false;
+}
 
+bool Client::receiveBufferedMessage(data_view_type &message,
+                                    bool &allow_receive)
+{
+  message.clear();
 
-  // We still may need more data out of the socket connection.
-  if (message.length() < length) {
-    unsigned endMessage = 0;
-    std::string nextChunk;
+  while (true) {
+    // Release the previous message, but leave it in place.
+    m_buffer_first += m_buffer_release;
+    m_buffer_release = 0;
+
+    std::size_t required = 0;
+    if (parseMessage(message, required)) {
+      if (m_intercept_xml &&
+          detail::is_xml_message(message.data(), message.size())) {
+        m_xml_string.assign(message.begin(), message.end());
+        CLIENT_INSTRUMENT(++m_statistics.xml_messages)
+        continue;
+      }
 
-    do {
-      unsigned received = receive(nextChunk, receive_timed_out);
-      if (0 == received) {
-        CLIENT_ERROR("communication protocol error, message interrupted");
-        CLIENT_ERROR_OP(message.clear());
-        CLIENT_ERROR_OP(close());
-        CLIENT_ERROR_OP(return *this);
+      return true;
+    } else if (0 == required) {
+      return false;
+    }
+
+    // Only top up the free space at the end. Defer the work of moving the
+    // partial message to the next blocking read.
+    if (!allow_receive || (m_buffer.size() - m_buffer_first < required)) {
+      return false;
+    }
+    allow_receive = false;
+
+    bool receive_timed_out = false;
+    const unsigned received = receive(
+      &m_buffer[m_buffer_last], m_buffer.size() - m_buffer_last,
+      receive_timed_out, false);
+    if (0 == received) {
+      // Nothing available right now. Leave any disconnection for the next
+      // blocking read to handle.
+      return false;
+    }
+
+    m_buffer_last += received;
+  }
+}
+
+std::size_t Client::receiveLatestMessage(data_view_type &message)
+{
+  std::size_t result = 0;
+
+  // Position and size, header included, of the newest message so far. It
+  // stays in the buffer after we release it.
+  std::size_t latest_first = m_buffer_first;
+  std::size_t latest_size = m_buffer_release;
+  double latest_time = m_message_time;
+
+  bool receive_timed_out = false;
+  while (true) {
+    m_buffer_first += m_buffer_release;
+    m_buffer_release = 0;
+
+    data_view_type next;
+    std::size_t required = 0;
+    if (parseMessage(next, required)) {
+      if (m_intercept_xml &&
+          detail::is_xml_message(next.data(), next.size())) {
+        m_xml_string.assign(next.begin(), next.end());
+        CLIENT_INSTRUMENT(++m_statistics.xml_messages)
+        continue;
       }
 
-      endMessage = length - static_cast<unsigned>(message.length());
-      message.append(nextChunk, 0, endMessage);
-    } while (message.length() < length);
+      latest_first = m_buffer_first;
+      latest_size = m_buffer_release;
+      latest_time = m_message_time;
+      ++result;
+      continue;
+    } else if (0 == required) {
+      // Protocol error, the buffer is gone.
+      message.clear();
+      return result;
+    }
 
-    // Did we walk into the next logical message with the last recv?
-    if (endMessage < nextChunk.length()) {
-      m_nextMessage = nextChunk.substr(endMessage);
+    // Make room for the rest of the partial message. Move the newest message
+    // and the partial message to the front of the buffer.
+    if (m_buffer.size() - m_buffer_first < required) {
+      if (latest_size + required > m_buffer.size()) {
+        break;
+      }
+
+      const std::size_t bytes = m_buffer_last - m_buffer_first;
+      std::memmove(&m_buffer[0], &m_buffer[latest_first], latest_size);
+      std::memmove(&m_buffer[latest_size], &m_buffer[m_buffer_first], bytes);
+      latest_first = 0;
+      m_buffer_first = latest_size;
+      m_buffer_last = latest_size + bytes;
     }
 
-  } else {
-    // We have all that we need, but do we have extra?
-    unsigned endMessage = length + sizeof(unsigned);
-    if (toRecv.length() > endMessage) {
-      m_nextMessage = toRecv.substr(endMessage);
+    // Nothing available right now. Leave any disconnection for the next
+    // blocking read to handle.
+    const unsigned received = receive(
+      &m_buffer[m_buffer_last], m_buffer.size() - m_buffer_last,
+      receive_timed_out, false);
+    if (0 == received) {
+      break;
     }
+
+    m_buffer_last += received;
   }
 
-  return *this;
+  message = data_view_type(
+    &m_buffer[latest_first + sizeof(unsigned)], latest_size - sizeof(unsigned));
+  m_message_time = latest_time;
+
+  return result;
 }
 
-Client &Client::operator<<(const std::string &message)
+bool Client::parseMessage(data_view_type &message, std::size_t &required)
 {
-  if (message.length() > 0) {
-    // If the input message is too long, give up now.
-    if (message.length() > detail::MaximumMessageLength) {
-      CLIENT_ERROR("communication protocol error, message too long to send");
+  const std::size_t bytes = m_buffer_last - m_buffer_first;
+
+  // Start with the length header.
+  required = sizeof(unsigned);
+
+  if (bytes >= sizeof(unsigned)) {
+    // Copy the network ordered message length header. Make sure it is a
+    // "reasonable" value.
+    unsigned length = 0;
+    std::memcpy(&length, &m_buffer[m_buffer_first], sizeof(unsigned));
+    length = ntohl(length);
+    if ((0 == length) || (length > m_maximum_length)) {
+      required = 0;
+      CLIENT_ERROR(
+        "communication protocol error, message header specifies invalid length");
       CLIENT_ERROR_OP(close());
-      CLIENT_ERROR_OP(return *this);
+      CLIENT_ERROR_OP(return false);
     }
 
-    // Actual outgoing message is copied into this buffer.
-    std::string toSend;
+    required = sizeof(unsigned) + length;
 
-    // Create a message length header.
-    {
-      // First thing. Dump 4 bytes of integer message length at the beginning
-      // of the message. (In network order.)
-      unsigned length = htonl(static_cast<unsigned>(message.length()));
+    // We have the whole message. Hand out a view of it in place.
+    if (bytes >= required) {
+      message = data_view_type(
+        &m_buffer[m_buffer_first + sizeof(unsigned)], length);
+      m_buffer_release = required;
 
-      // Pack the length header and byte payload into the send buffer.
-      toSend.assign(reinterpret_cast<char *>(&length), sizeof(unsigned));
+#if MOTION_SDK_INSTRUMENT
+      // Every byte of this message arrived by the time of the last recv.
+      m_message_time = m_receive_time;
+      if (m_statistics.messages > 0) {
+        m_statistics.interval.add(
+          m_message_time - m_statistics.last_arrival);
+      }
+      m_statistics.last_arrival = m_message_time;
+      ++m_statistics.messages;
+#endif  // MOTION_SDK_INSTRUMENT
+
+      return true;
     }
+  }
 
-    toSend.append(message);
+#if MOTION_SDK_INSTRUMENT
+  if (bytes > 0) {
+    ++m_statistics.partial_reads;
+  }
+#endif  // MOTION_SDK_INSTRUMENT
 
-    // Send as much of the message (with the length) as we can the first time.
-    bool send_timed_out = false;
-    unsigned bytes = send(toSend, send_timed_out);
-    if (0 == bytes) {
-      CLIENT_ERROR("communication protocol error, failed to write message");
-      CLIENT_ERROR_OP(close());
-      CLIENT_ERROR_OP(return *this);
-    }
+  return false;
+}
+
+Client &Client::operator<<(const std::string &message)
+{
+  unsigned header = 0;
+  if (packHeader(message.length(), header)) {
+    const send_buffer_type buffer[2] = {
+      {reinterpret_cast<const char *>(&header), sizeof(header)},
+      {message.data(), message.length()}
+    };
+
+    sendAll(buffer, 2);
+  }
+
+  return *this;
+}
+
+bool Client::packHeader(const std::size_t &size, unsigned &header)
+{
+  if (0 == size) {
+    return false;
+  }
+
+  // If the input message is too long, give up now.
+  if (size > m_maximum_length) {
+    CLIENT_ERROR("communication protocol error, message too long to send");
+    CLIENT_ERROR_OP(close());
+    CLIENT_ERROR_OP(return false);
+  }
+
+  // Dump 4 bytes of integer message length at the beginning of the message.
+  // (In network order.)
+  header = htonl(static_cast<unsigned>(size));
 
-    // If we couldn't send it all at once, finish the job now, Monster.
-    while (bytes < toSend.length()) {
-      std::string nextChunk = toSend.substr(bytes);
-      unsigned sent = send(nextChunk, send_timed_out);
-      if (0 == sent) {
-        CLIENT_ERROR("communication protocol error, message interrupted");
-        CLIENT_ERROR_OP(close());
-        CLIENT_ERROR_OP(return *this);
+  return true;
+}
+
+bool Client::sendAll(const send_buffer_type *buffer, const std::size_t &count)
+{
+  send_buffer_type list[detail::MaximumSendBuffer];
+
+  // One deadline for every send that it takes to write all of the buffers.
+  m_send_deadline = detail::make_deadline(m_time_out_send);
+
+  std::size_t index = 0;
+  std::size_t offset = 0;
+  bool first = true;
+  for (;;) {
+    // Gather the remaining buffers, starting part way into the current one if
+    // the previous call stopped there.
+    std::size_t n = 0;
+    for (std::size_t i=index; (i<count) && (n<detail::MaximumSendBuffer); ++i) {
+      const std::size_t skip = (i == index) ? offset : 0;
+      if (buffer[i].size > skip) {
+        list[n].data = buffer[i].data + skip;
+        list[n].size = buffer[i].size - skip;
+        ++n;
       }
+    }
 
-      bytes += sent;
+    if (0 == n) {
+      break;
     }
 
-    // Sanity check.
-    if (bytes != toSend.length()) {
-      CLIENT_ERROR(
-        "communication protocol error, failed to write complete message");
+    bool send_timed_out = false;
+    std::size_t bytes = send(list, n, send_timed_out);
+    if (0 == bytes) {
+      CLIENT_ERROR(first ?
+        "communication protocol error, failed to write message" :
+        "communication protocol error, message interrupted");
       CLIENT_ERROR_OP(close());
-      CLIENT_ERROR_OP(return *this);
+      CLIENT_ERROR_OP(return false);
+    }
+    first = false;
+
+    // Skip past everything that we sent. If we couldn't send it all at once,
+    // finish the job now, Monster.
+    while ((index < count) && (bytes >= buffer[index].size - offset)) {
+      bytes -= buffer[index].size - offset;
+      offset = 0;
+      ++index;
     }
+    offset += bytes;
   }
 
-  return *this;
+  return true;
+}
+
+void Client::setReadTimeout(const int &time_out_second,
+                            const std::size_t &default_millisecond)
+{
+  // A default value of the time_out_second (-1) indicates that we just want
+  // to use the default implementation.
+  m_time_out_receive = (time_out_second < 0) ?
+    default_millisecond : static_cast<std::size_t>(time_out_second) * 1000;
+}
+
+void Client::setWriteTimeout(const int &time_out_second)
+{
+  m_time_out_send = (time_out_second < 0) ?
+    m_time_out_write_default : static_cast<std::size_t>(time_out_second) * 1000;
 }
 
-unsigned Client::send(const std::string &data, bool &send_timed_out)
+unsigned Client::send(const send_buffer_type *buffer, const std::size_t &count,
+                     bool &send_timed_out)
 {
   send_timed_out = false;
 
@@ -649,11 +1166,53 @@ unsigned Client::send(const std::string &data, bool &send_timed_out)
     return 0;
   }
 
-  int result = ::send(m_socket, data.c_str(), static_cast<int>(data.length()),
-                      MSG_NOSIGNAL);
+  const std::size_t n = std::min(count, detail::MaximumSendBuffer);
+
+#if defined(_WIN32)
+  WSABUF list[detail::MaximumSendBuffer];
+  for (std::size_t i=0; i<n; ++i) {
+    list[i].buf = const_cast<char *>(buffer[i].data);
+    list[i].len = static_cast<ULONG>(buffer[i].size);
+  }
+#else
+  // Use sendmsg rather than writev, it takes the MSG_NOSIGNAL flag.
+  iovec list[detail::MaximumSendBuffer];
+  for (std::size_t i=0; i<n; ++i) {
+    list[i].iov_base = const_cast<char *>(buffer[i].data);
+    list[i].iov_len = buffer[i].size;
+  }
+
+  msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = list;
+  message.msg_iovlen = n;
+#endif  // _WIN32
+
+  int result = -1;
+  for (;;) {
+#if defined(_WIN32)
+    DWORD sent = 0;
+    result = ::WSASend(
+      m_socket, list, static_cast<DWORD>(n), &sent, 0, NULL, NULL);
+    if (0 == result) {
+      result = static_cast<int>(sent);
+    }
+#else
+    result = static_cast<int>(::sendmsg(m_socket, &message, MSG_NOSIGNAL));
+#endif  // _WIN32
+
+    // The system send buffer is full. Wait for room until the deadline.
+    if ((-1 == result) && detail::would_block(ERROR_CODE) &&
+        (detail::wait_socket(m_socket, true, m_send_deadline) > 0)) {
+      continue;
+    }
+
+    break;
+  }
+
   if (-1 == result) {
     const int error_code = ERROR_CODE;
-    if (ETIMEDOUT == error_code || EAGAIN == error_code) {
+    if (ETIMEDOUT == error_code || detail::would_block(error_code)) {
       // Connection timed out.
       // A connection attempt failed because the connected party did not
       // properly respond after a period of time, or the established connection
@@ -679,20 +1238,59 @@ unsigned Client::send(const std::string &data, bool &send_timed_out)
   return static_cast<unsigned>(result);
 }
 
-unsigned Client::receive(std::string &data, bool &receive_timed_out)
+unsigned Client::receive(char *data, const std::size_t &size,
+                         bool &receive_timed_out, bool block)
 {
-  data.clear();
   receive_timed_out = false;
 
   if (!isConnected()) {
     return 0;
   }
 
-  int result = ::recv(m_socket, &m_buffer[0], static_cast<int>(m_buffer.size()),
-                      MSG_NOSIGNAL);
+  int flags = MSG_NOSIGNAL;
+  if (!block) {
+#if defined(MSG_DONTWAIT)
+    flags |= MSG_DONTWAIT;
+#else
+    // Ask the system if a recv call would block. Do not call recv at all if
+    // it would. A readable socket with no data is a graceful disconnection,
+    // let recv report it.
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(m_socket, &readable);
+
+    timeval zero;
+    zero.tv_sec = 0;
+    zero.tv_usec = 0;
+    if (::select(m_socket + 1, &readable, NULL, NULL, &zero) <= 0) {
+      receive_timed_out = true;
+      return 0;
+    }
+#endif  // MSG_DONTWAIT
+  } else {
+    // Wait for data until the deadline. The socket is non-blocking, so the
+    // recv call below returns right away either way.
+    const int ready = detail::wait_socket(m_socket, false, m_receive_deadline);
+    if (0 == ready) {
+      receive_timed_out = true;
+      return 0;
+    } else if (ready < 0) {
+      CLIENT_ERROR("failed to wait for data on socket");
+      CLIENT_ERROR_OP(return 0);
+    }
+  }
+
+  int result = ::recv(m_socket, data, static_cast<int>(size), flags);
+#if MOTION_SDK_INSTRUMENT
+  m_receive_time = detail::monotonic_time();
+  ++m_statistics.receive_calls;
+  if (result > 0) {
+    m_statistics.bytes += static_cast<std::size_t>(result);
+  }
+#endif  // MOTION_SDK_INSTRUMENT
   if (-1 == result) {
     const int error_code = ERROR_CODE;
-    if (ETIMEDOUT == error_code || EAGAIN == error_code) {
+    if (ETIMEDOUT == error_code || detail::would_block(error_code)) {
       // Connection timed out.
       // A connection attempt failed because the connected party did not
       // properly respond after a period of time, or the established connection
@@ -715,10 +1313,7 @@ unsigned Client::receive(std::string &data, bool &receive_timed_out)
     }
   }
 
-  // Process real data if we have any.
-  if (result > 0) {
-    data.assign(&m_buffer[0], result);
-  } else {
+  if (result < 0) {
     result = 0;
   }
 
@@ -731,19 +1326,8 @@ bool Client::setReceiveTimeout(const std::size_t &second)
 
   // Is this an active socket connection?
   if (isConnected()) {
-    const detail::timeval_type optionval = detail::make_timeval(second);
-
-    int set_result = ::setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO,
-                                  reinterpret_cast<const char *>(&optionval),
-                                  sizeof(optionval));
-
-    if (-1 == set_result) {
-      CLIENT_ERROR("failed to set client receive time out");
-    } else {
-      m_time_out_second = second;
-      result = true;
-    }
-
+    m_time_out_receive = second * 1000;
+    result = true;
   } else {
     CLIENT_ERROR(
       "failed to set client receive time out, socket is not connected");
@@ -758,19 +1342,8 @@ bool Client::setSendTimeout(const std::size_t &second)
 
   // Is this an active socket connection?
   if (isConnected()) {
-    const detail::timeval_type optionval = detail::make_timeval(second);
-
-    int set_result = ::setsockopt(m_socket, SOL_SOCKET, SO_SNDTIMEO,
-                                  reinterpret_cast<const char *>(&optionval),
-                                  sizeof(optionval));
-
-    if (-1 == set_result) {
-      CLIENT_ERROR("failed to set client send time out");
-    } else {
-      m_time_out_second_send = second;
-      result = true;
-    }
-
+    m_time_out_send = second * 1000;
+    result = true;
   } else {
     CLIENT_ERROR("failed to set client send time out, socket is not connected");
   }
@@ -0,0 +1,566 @@
+/**
+  Implementation of the CompactPreview class. See the header file for more details.
+
+  @file    tools/sdk/cpp/src/CompactPreview.cpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <CompactPreview.hpp>
+
+#include <detail/endian_to_native.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+
+namespace Motion { namespace SDK {
+
+namespace {
+
+typedef CompactPreview::Field field_type;
+typedef CompactPreview::Element element_type;
+typedef CompactPreview::element_list_type element_list_type;
+
+/** Number of float values in one standard Preview element. */
+const std::size_t ElementLength = Format::PreviewElement::Length;
+
+/** Size of one standard Preview element, id included. */
+const std::size_t ElementSize = sizeof(unsigned) + sizeof(float) * ElementLength;
+
+/** Quantized field size. Id and all four fields for a keyframe element. */
+const std::size_t FieldBytes = 6;
+const std::size_t KeyframeElementSize =
+  sizeof(unsigned) + FieldBytes * CompactPreview::FieldSize;
+
+/** Smallest three components lie on [-1/sqrt(2), 1/sqrt(2)]. */
+const float QuaternionScale = 16383.0f * 1.41421356f;
+const int QuaternionMaximum = 16383;
+const unsigned char QuaternionZero = 4;
+
+const float Pi = 3.14159265f;
+const float EulerScale = 32767.0f / Pi;
+const float AccelerateScale = 4096.0f;
+const int ShortMaximum = 32767;
+
+/** Index of the first value of each field in the standard element. */
+const std::size_t FieldBase[CompactPreview::FieldSize] = {
+  Format::PreviewLayout::GlobalQuaternion::Base,
+  Format::PreviewLayout::LocalQuaternion::Base,
+  Format::PreviewLayout::Euler::Base,
+  Format::PreviewLayout::Accelerate::Base
+};
+
+template <typename T>
+inline T read(const char *data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return detail::little_endian_to_native(value);
+}
+
+template <typename T>
+inline void write(char *data, T value)
+{
+  value = detail::little_endian_to_native(value);
+  std::memcpy(data, &value, sizeof(T));
+}
+
+inline short quantize(const float &value, const int &maximum)
+{
+  int result = static_cast<int>(std::floor(value + 0.5f));
+  if (result > maximum) {
+    result = maximum;
+  } else if (result < -maximum) {
+    result = -maximum;
+  }
+
+  return static_cast<short>(result);
+}
+
+bool is_quaternion(const std::size_t &field)
+{
+  return field < 2;
+}
+
+void quantize_field(const float *value, const std::size_t &field,
+                    field_type &result)
+{
+  result.index = 0;
+
+  if (is_quaternion(field)) {
+    const float norm = value[0] * value[0] + value[1] * value[1] +
+      value[2] * value[2] + value[3] * value[3];
+    if (!(norm > 1e-12f)) {
+      // No data.
+      result.index = QuaternionZero;
+      result.value[0] = result.value[1] = result.value[2] = 0;
+      return;
+    }
+
+    unsigned char index = 0;
+    for (unsigned char i=1; i<4; ++i) {
+      if (std::fabs(value[i]) > std::fabs(value[index])) {
+        index = i;
+      }
+    }
+
+    // Make the dropped component positive. Scale to unit length.
+    float scale = QuaternionScale / std::sqrt(norm);
+    if (value[index] < 0) {
+      scale = -scale;
+    }
+
+    result.index = index;
+    for (std::size_t i=0, j=0; i<4; ++i) {
+      if (i != index) {
+        result.value[j++] = quantize(value[i] * scale, QuaternionMaximum);
+      }
+    }
+  } else {
+    const float scale = (2 == field) ? EulerScale : AccelerateScale;
+    for (std::size_t i=0; i<3; ++i) {
+      result.value[i] = quantize(value[i] * scale, ShortMaximum);
+    }
+  }
+}
+
+void dequantize_field(const field_type &value, const std::size_t &field,
+                      float *result)
+{
+  if (is_quaternion(field)) {
+    if (QuaternionZero == value.index) {
+      result[0] = result[1] = result[2] = result[3] = 0;
+      return;
+    }
+
+    float sum = 0;
+    for (std::size_t i=0, j=0; i<4; ++i) {
+      if (i != value.index) {
+        result[i] = value.value[j++] / QuaternionScale;
+        sum += result[i] * result[i];
+      }
+    }
+
+    result[value.index] = (sum < 1) ? std::sqrt(1 - sum) : 0.0f;
+  } else {
+    const float scale = (2 == field) ? EulerScale : AccelerateScale;
+    for (std::size_t i=0; i<3; ++i) {
+      result[i] = value.value[i] / scale;
+    }
+  }
+}
+
+/**
+  Quaternions store the dropped index in the top bit of the first two words
+  and the all zero flag in the top bit of the third word. The components are
+  offset to unsigned 15-bit values.
+*/
+void pack_field(const field_type &value, const std::size_t &field, char *data)
+{
+  if (is_quaternion(field)) {
+    unsigned short word[3];
+    for (std::size_t i=0; i<3; ++i) {
+      word[i] = static_cast<unsigned short>(value.value[i] + QuaternionMaximum);
+    }
+
+    if (QuaternionZero == value.index) {
+      word[2] |= 0x8000;
+    } else {
+      word[0] |= static_cast<unsigned short>((value.index >> 1) << 15);
+      word[1] |= static_cast<unsigned short>((value.index & 1) << 15);
+    }
+
+    for (std::size_t i=0; i<3; ++i) {
+      write<unsigned short>(data + 2 * i, word[i]);
+    }
+  } else {
+    for (std::size_t i=0; i<3; ++i) {
+      write<short>(data + 2 * i, value.value[i]);
+    }
+  }
+}
+
+bool unpack_field(const char *data, const std::size_t &field,
+                  field_type &result)
+{
+  result.index = 0;
+
+  if (is_quaternion(field)) {
+    unsigned short word[3];
+    for (std::size_t i=0; i<3; ++i) {
+      word[i] = read<unsigned short>(data + 2 * i);
+    }
+
+    if (0 != (word[2] & 0x8000)) {
+      result.index = QuaternionZero;
+    } else {
+      result.index = static_cast<unsigned char>(
+        ((word[0] >> 15) << 1) | (word[1] >> 15));
+    }
+
+    for (std::size_t i=0; i<3; ++i) {
+      const int value = (word[i] & 0x7fff) - QuaternionMaximum;
+      if (value > QuaternionMaximum) {
+        return false;
+      }
+
+      result.value[i] = static_cast<short>(value);
+    }
+  } else {
+    for (std::size_t i=0; i<3; ++i) {
+      result.value[i] = read<short>(data + 2 * i);
+    }
+  }
+
+  return true;
+}
+
+/**
+  Find the keyframe element with this id. Elements usually arrive in the same
+  order as the keyframe, so try the hint first.
+*/
+const element_type *find(const element_list_type &list,
+                         const CompactPreview::id_type &id, std::size_t &hint)
+{
+  if ((hint < list.size()) && (id == list[hint].id)) {
+    return &list[hint++];
+  }
+
+  for (std::size_t i=0; i<list.size(); ++i) {
+    if (id == list[i].id) {
+      hint = i + 1;
+      return &list[i];
+    }
+  }
+
+  return NULL;
+}
+
+void write_header(char *data, bool keyframe, const unsigned &sequence,
+                  const std::size_t &count)
+{
+  write<unsigned>(data, CompactPreview::Magic);
+  data[4] = static_cast<char>(CompactPreview::Version);
+  data[5] = static_cast<char>(keyframe ? CompactPreview::Keyframe : 0);
+  write<unsigned short>(data + 6, static_cast<unsigned short>(sequence));
+  write<unsigned>(data + 8, static_cast<unsigned>(count));
+}
+
+/** Copy the element into the standard message, in the Preview layout. */
+void write_element(const element_type &element, char *data)
+{
+  float value[ElementLength];
+  for (std::size_t i=0; i<CompactPreview::FieldSize; ++i) {
+    dequantize_field(element.field[i], i, value + FieldBase[i]);
+  }
+
+  write<unsigned>(data, static_cast<unsigned>(element.id));
+  for (std::size_t i=0; i<ElementLength; ++i) {
+    write<float>(data + sizeof(unsigned) + sizeof(float) * i, value[i]);
+  }
+}
+
+} // anonymous namespace
+
+
+std::string CompactPreview::getInitialize(const std::size_t &keyframe_interval)
+{
+  std::ostringstream out;
+  out << "<?xml version=\"1.0\"?>"
+      << "<preview encoding=\"compact\" keyframe=\"" << keyframe_interval
+      << "\"/>";
+
+  return out.str();
+}
+
+bool CompactPreview::isCompact(const char *data, const std::size_t &size)
+{
+  return (NULL != data) && (size >= HeaderSize) &&
+    (static_cast<unsigned>(Magic) == read<unsigned>(data));
+}
+
+CompactPreview::CompactPreview()
+  : m_keyframe(), m_sequence(0), m_valid(false), m_message()
+{
+}
+
+void CompactPreview::reset()
+{
+  m_keyframe.clear();
+  m_sequence = 0;
+  m_valid = false;
+}
+
+bool CompactPreview::hasKeyframe() const
+{
+  return m_valid;
+}
+
+bool CompactPreview::expand(const char *data, const std::size_t &size,
+                            data_type &message)
+{
+  message.clear();
+
+  if (!isCompact(data, size) || (Version != static_cast<unsigned char>(data[4]))) {
+    return false;
+  }
+
+  const bool keyframe = (0 != (data[5] & Keyframe));
+  const unsigned sequence = read<unsigned short>(data + 6);
+  const std::size_t count = read<unsigned>(data + 8);
+  if (0 == count) {
+    return false;
+  }
+
+  if (keyframe) {
+    // Replace the keyframe, even if the rest of this message is not valid.
+    m_valid = false;
+
+    if ((size - HeaderSize) / KeyframeElementSize < count ||
+        (size - HeaderSize) != count * KeyframeElementSize) {
+      return false;
+    }
+
+    m_keyframe.resize(count);
+    message.resize(count * ElementSize);
+
+    const char *itr = data + HeaderSize;
+    for (std::size_t i=0; i<count; ++i) {
+      element_type &element = m_keyframe[i];
+      element.id = read<unsigned>(itr);
+      itr += sizeof(unsigned);
+
+      for (std::size_t j=0; j<FieldSize; ++j) {
+        if (!unpack_field(itr, j, element.field[j])) {
+          message.clear();
+          return false;
+        }
+        itr += FieldBytes;
+      }
+
+      write_element(element, &message[i * ElementSize]);
+    }
+
+    m_sequence = sequence;
+    m_valid = true;
+
+    return true;
+  }
+
+  // A delta frame needs its keyframe.
+  if (!m_valid || (sequence != m_sequence)) {
+    return false;
+  }
+
+  // Every element is at least an id and a mode.
+  if ((size - HeaderSize) / (sizeof(unsigned) + 1) < count) {
+    return false;
+  }
+
+  message.resize(count * ElementSize);
+
+  std::size_t hint = 0;
+  std::size_t offset = HeaderSize;
+  for (std::size_t i=0; i<count; ++i) {
+    if (size - offset < sizeof(unsigned) + 1) {
+      message.clear();
+      return false;
+    }
+
+    element_type element;
+    element.id = read<unsigned>(data + offset);
+    const unsigned mode = static_cast<unsigned char>(data[offset + 4]);
+    offset += sizeof(unsigned) + 1;
+
+    const element_type *key = NULL;
+    for (std::size_t j=0; j<FieldSize; ++j) {
+      const unsigned field_mode = (mode >> (2 * j)) & 0x03;
+      if ((ModeFull != field_mode) && (NULL == key)) {
+        key = find(m_keyframe, element.id, hint);
+        if (NULL == key) {
+          message.clear();
+          return false;
+        }
+      }
+
+      if (ModeKeyframe == field_mode) {
+        element.field[j] = key->field[j];
+      } else if (ModeDelta == field_mode) {
+        if (size - offset < 3) {
+          message.clear();
+          return false;
+        }
+
+        element.field[j] = key->field[j];
+        for (std::size_t k=0; k<3; ++k) {
+          element.field[j].value[k] = static_cast<short>(
+            element.field[j].value[k] + static_cast<signed char>(data[offset + k]));
+        }
+        offset += 3;
+      } else if (ModeFull == field_mode) {
+        if ((size - offset < FieldBytes) ||
+            !unpack_field(data + offset, j, element.field[j])) {
+          message.clear();
+          return false;
+        }
+        offset += FieldBytes;
+      } else {
+        message.clear();
+        return false;
+      }
+    }
+
+    write_element(element, &message[i * ElementSize]);
+  }
+
+  // Trailing bytes. Invalid message.
+  if (offset != size) {
+    message.clear();
+    return false;
+  }
+
+  return true;
+}
+
+
+CompactPreview::Encoder::Encoder(const std::size_t &keyframe_interval)
+  : m_keyframe_interval(std::max<std::size_t>(keyframe_interval, 1)),
+    m_count(0), m_sequence(0), m_keyframe(), m_element()
+{
+}
+
+void CompactPreview::Encoder::reset()
+{
+  m_count = 0;
+}
+
+bool CompactPreview::Encoder::encode(const char *data, const std::size_t &size,
+                                     data_type &message)
+{
+  message.clear();
+
+  if ((0 == size) || (0 != (size % ElementSize))) {
+    return false;
+  }
+
+  const std::size_t count = size / ElementSize;
+  m_element.resize(count);
+  for (std::size_t i=0; i<count; ++i) {
+    const char *itr = data + i * ElementSize;
+
+    float value[ElementLength];
+    detail::copy_little_endian_to_native(
+      itr + sizeof(unsigned), ElementLength, value);
+
+    element_type &element = m_element[i];
+    element.id = read<unsigned>(itr);
+    for (std::size_t j=0; j<FieldSize; ++j) {
+      quantize_field(value + FieldBase[j], j, element.field[j]);
+    }
+  }
+
+  const bool keyframe = (0 == (m_count % m_keyframe_interval));
+  ++m_count;
+
+  if (keyframe) {
+    m_sequence = (m_sequence + 1) & 0xffff;
+    m_keyframe = m_element;
+
+    message.resize(HeaderSize + count * KeyframeElementSize);
+    write_header(&message[0], true, m_sequence, count);
+
+    char *itr = &message[HeaderSize];
+    for (std::size_t i=0; i<count; ++i) {
+      write<unsigned>(itr, static_cast<unsigned>(m_element[i].id));
+      itr += sizeof(unsigned);
+      for (std::size_t j=0; j<FieldSize; ++j) {
+        pack_field(m_element[i].field[j], j, itr);
+        itr += FieldBytes;
+      }
+    }
+
+    return true;
+  }
+
+  // Worst case, every field is full.
+  message.resize(HeaderSize + count * (KeyframeElementSize + 1));
+  write_header(&message[0], false, m_sequence, count);
+
+  std::size_t hint = 0;
+  std::size_t offset = HeaderSize;
+  for (std::size_t i=0; i<count; ++i) {
+    const element_type &element = m_element[i];
+    const element_type *key = find(m_keyframe, element.id, hint);
+
+    write<unsigned>(&message[offset], static_cast<unsigned>(element.id));
+    const std::size_t mode_offset = offset + sizeof(unsigned);
+    offset = mode_offset + 1;
+
+    unsigned mode = 0;
+    for (std::size_t j=0; j<FieldSize; ++j) {
+      const field_type &value = element.field[j];
+
+      unsigned field_mode = ModeFull;
+      int delta[3] = {0, 0, 0};
+      if ((NULL != key) && (value.index == key->field[j].index)) {
+        field_mode = ModeKeyframe;
+        for (std::size_t k=0; k<3; ++k) {
+          delta[k] = value.value[k] - key->field[j].value[k];
+          if ((delta[k] < -127) || (delta[k] > 127)) {
+            field_mode = ModeFull;
+            break;
+          } else if (0 != delta[k]) {
+            field_mode = ModeDelta;
+          }
+        }
+      }
+
+      if (ModeDelta == field_mode) {
+        for (std::size_t k=0; k<3; ++k) {
+          message[offset + k] = static_cast<char>(delta[k]);
+        }
+        offset += 3;
+      } else if (ModeFull == field_mode) {
+        pack_field(value, j, &message[offset]);
+        offset += FieldBytes;
+      }
+
+      mode |= field_mode << (2 * j);
+    }
+
+    message[mode_offset] = static_cast<char>(mode);
+  }
+
+  message.resize(offset);
+
+  return true;
+}
+
+}} // namespace Motion::SDK
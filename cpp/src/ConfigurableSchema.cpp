@@ -0,0 +1,275 @@
+/**
+  Implementation of the ConfigurableSchema class. See the header file for more details.
+
+  @file    tools/sdk/cpp/src/ConfigurableSchema.cpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <ConfigurableSchema.hpp>
+
+#include <detail/exception.hpp>
+
+#include <cctype>
+
+
+namespace Motion { namespace SDK {
+
+namespace {
+
+/**
+  Number of values in each of the Motion Service channels that the
+  Configurable service can stream.
+*/
+struct StandardChannel {
+  const char *name;
+  std::size_t length;
+};
+
+const StandardChannel StandardChannelList[] = {
+  // Preview
+  {"Gq", 4}, // global rotation, quaternion
+  {"Lq", 4}, // local rotation, quaternion
+  {"r", 3},  // local rotation, Euler angles
+  {"la", 3}, // global linear acceleration
+  {"lv", 3}, // global linear velocity
+  {"lt", 3}, // local translation
+  {"c", 4},  // contact point and weight
+  // Sensor
+  {"a", 3},  // accelerometer
+  {"m", 3},  // magnetometer
+  {"g", 3},  // gyroscope
+  // Raw
+  {"A", 3},
+  {"M", 3},
+  {"G", 3}
+};
+
+const std::size_t StandardChannelSize =
+  sizeof(StandardChannelList) / sizeof(StandardChannel);
+
+/** The root element of the definition is not a channel. */
+const char *RootName = "configurable";
+
+bool is_name_char(const char &c)
+{
+  return (0 != std::isalnum(static_cast<unsigned char>(c))) ||
+    ('_' == c) || ('-' == c) || ('.' == c) || (':' == c);
+}
+
+bool is_space(const char &c)
+{
+  return 0 != std::isspace(static_cast<unsigned char>(c));
+}
+
+/**
+  Scan the XML definition for leaf elements, an empty element tag or an
+  element with no content. Does not implement a full XML parser, only the
+  subset used for Configurable definitions.
+
+  @return false if the definition is not well formed
+*/
+bool parse_channel_list(const std::string &xml, std::vector<std::string> &result)
+{
+  result.clear();
+
+  std::string::size_type itr = 0;
+  for (;;) {
+    itr = xml.find('<', itr);
+    if (std::string::npos == itr) {
+      break;
+    }
+
+    // Comment, declaration, or processing instruction.
+    if (0 == xml.compare(itr, 4, "<!--")) {
+      itr = xml.find("-->", itr);
+      if (std::string::npos == itr) {
+        return false;
+      }
+      itr += 3;
+      continue;
+    }
+
+    const std::string::size_type end = xml.find('>', itr);
+    if (std::string::npos == end) {
+      return false;
+    }
+
+    if ((itr + 1 < end) &&
+        (('?' == xml[itr + 1]) || ('!' == xml[itr + 1]) ||
+         ('/' == xml[itr + 1]))) {
+      itr = end + 1;
+      continue;
+    }
+
+    std::string::size_type name_end = itr + 1;
+    while ((name_end < end) && is_name_char(xml[name_end])) {
+      ++name_end;
+    }
+
+    if (name_end == itr + 1) {
+      return false;
+    }
+
+    const std::string name = xml.substr(itr + 1, name_end - itr - 1);
+
+    bool is_leaf = ('/' == xml[end - 1]);
+    if (!is_leaf) {
+      // <name></name> is also a channel.
+      std::string::size_type next = end + 1;
+      while ((next < xml.size()) && is_space(xml[next])) {
+        ++next;
+      }
+
+      const std::string close = "</" + name;
+      is_leaf = (0 == xml.compare(next, close.size(), close));
+    }
+
+    if (is_leaf && (name != RootName)) {
+      result.push_back(name);
+    }
+
+    itr = end + 1;
+  }
+
+  return true;
+}
+
+} // anonymous namespace
+
+
+ConfigurableSchema::Channel::Channel()
+  : name(), base(0), length(0)
+{
+}
+
+ConfigurableSchema::Channel::Channel(const std::string &name_in,
+                                     const size_type &base_in,
+                                     const size_type &length_in)
+  : name(name_in), base(base_in), length(length_in)
+{
+}
+
+ConfigurableSchema::ConfigurableSchema()
+  : m_channel(), m_length(0), m_valid(false)
+{
+}
+
+ConfigurableSchema::ConfigurableSchema(const std::string &xml)
+  : m_channel(), m_length(0), m_valid(false)
+{
+  std::vector<std::string> name_list;
+  if (!parse_channel_list(xml, name_list)) {
+#if MOTION_SDK_USE_EXCEPTIONS
+    throw detail::error("failed to parse Configurable XML definition");
+#else
+    return;
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+  }
+
+  for (std::size_t i=0; i<name_list.size(); ++i) {
+    m_channel.push_back(
+      Channel(name_list[i], 0, getStandardLength(name_list[i])));
+  }
+
+  update();
+}
+
+bool ConfigurableSchema::isValid() const
+{
+  return m_valid;
+}
+
+ConfigurableSchema::size_type ConfigurableSchema::length() const
+{
+  return m_length;
+}
+
+const ConfigurableSchema::channel_list_type &
+ConfigurableSchema::getChannelList() const
+{
+  return m_channel;
+}
+
+ConfigurableSchema::Channel
+ConfigurableSchema::getChannel(const std::string &name) const
+{
+  for (channel_list_type::const_iterator itr=m_channel.begin();
+       itr!=m_channel.end(); ++itr) {
+    if (name == itr->name) {
+      return *itr;
+    }
+  }
+
+  return Channel();
+}
+
+bool ConfigurableSchema::setChannelLength(const std::string &name,
+                                          const size_type &length)
+{
+  bool result = false;
+  for (channel_list_type::iterator itr=m_channel.begin();
+       itr!=m_channel.end(); ++itr) {
+    if (name == itr->name) {
+      itr->length = length;
+      result = true;
+    }
+  }
+
+  update();
+
+  return result;
+}
+
+ConfigurableSchema::size_type
+ConfigurableSchema::getStandardLength(const std::string &name)
+{
+  for (std::size_t i=0; i<StandardChannelSize; ++i) {
+    if (name == StandardChannelList[i].name) {
+      return StandardChannelList[i].length;
+    }
+  }
+
+  return 0;
+}
+
+void ConfigurableSchema::update()
+{
+  m_length = 0;
+  m_valid = !m_channel.empty();
+  for (channel_list_type::iterator itr=m_channel.begin();
+       itr!=m_channel.end(); ++itr) {
+    itr->base = m_length;
+    m_length += itr->length;
+
+    if (0 == itr->length) {
+      m_valid = false;
+    }
+  }
+}
+
+}} // namespace Motion::SDK
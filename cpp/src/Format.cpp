@@ -35,6 +35,7 @@
 #include <limits>
 
 #include <detail/exception.hpp>
+#include <detail/kernel.hpp>
 
 
 namespace Motion { namespace SDK {
@@ -42,6 +43,9 @@ namespace Motion { namespace SDK {
 template<typename Quaternion>
 Format::data_type quaternion_to_R3_rotation(const Quaternion &q);
 
+void quaternion_to_R3_rotation(const Format::PreviewElement::quaternion_type &q,
+                               Format::PreviewElement::matrix_type &result);
+
 #if defined(__GNUC__)
 const std::size_t Format::PreviewElement::Length;
 const std::size_t Format::SensorElement::Length;
@@ -85,7 +89,12 @@ Format::PreviewElement::PreviewElement(const data_type &data)
 
 Format::PreviewElement::data_type Format::PreviewElement::getEuler() const
 {
-  return getData(8, 3);
+  return getData<PreviewLayout::Euler>();
+}
+
+void Format::PreviewElement::getEuler(vector_type &result) const
+{
+  getData<PreviewLayout::Euler>(result);
 }
 
 Format::PreviewElement::data_type
@@ -94,20 +103,42 @@ Format::PreviewElement::getMatrix(bool local) const
   return quaternion_to_R3_rotation(getQuaternion(local));
 }
 
+void Format::PreviewElement::getMatrix(bool local, matrix_type &result) const
+{
+  quaternion_type q;
+  getQuaternion(local, q);
+  quaternion_to_R3_rotation(q, result);
+}
+
 Format::PreviewElement::data_type
 Format::PreviewElement::getQuaternion(bool local) const
 {
   if (local) {
-    return getData(4, 4);
+    return getData<PreviewLayout::LocalQuaternion>();
   } else {
-    return getData(0, 4);
+    return getData<PreviewLayout::GlobalQuaternion>();
+  }
+}
+
+void Format::PreviewElement::getQuaternion(bool local,
+                                           quaternion_type &result) const
+{
+  if (local) {
+    getData<PreviewLayout::LocalQuaternion>(result);
+  } else {
+    getData<PreviewLayout::GlobalQuaternion>(result);
   }
 }
 
 Format::PreviewElement::data_type
 Format::PreviewElement::getAccelerate() const
 {
-  return getData(11, 3);
+  return getData<PreviewLayout::Accelerate>();
+}
+
+void Format::PreviewElement::getAccelerate(vector_type &result) const
+{
+  getData<PreviewLayout::Accelerate>(result);
 }
 
 
@@ -119,19 +150,34 @@ Format::SensorElement::SensorElement(const data_type &data)
 Format::SensorElement::data_type
 Format::SensorElement::getAccelerometer() const
 {
-  return getData(0, 3);
+  return getData<SensorLayout::Accelerometer>();
+}
+
+void Format::SensorElement::getAccelerometer(vector_type &result) const
+{
+  getData<SensorLayout::Accelerometer>(result);
 }
 
 Format::SensorElement::data_type
 Format::SensorElement::getGyroscope() const
 {
-  return getData(6, 3);
+  return getData<SensorLayout::Gyroscope>();
+}
+
+void Format::SensorElement::getGyroscope(vector_type &result) const
+{
+  getData<SensorLayout::Gyroscope>(result);
 }
 
 Format::SensorElement::data_type
 Format::SensorElement::getMagnetometer() const
 {
-  return getData(3, 3);
+  return getData<SensorLayout::Magnetometer>();
+}
+
+void Format::SensorElement::getMagnetometer(vector_type &result) const
+{
+  getData<SensorLayout::Magnetometer>(result);
 }
 
 
@@ -143,37 +189,118 @@ Format::RawElement::RawElement(const data_type &data)
 Format::RawElement::data_type
 Format::RawElement::getAccelerometer() const
 {
-  return getData(0, 3);
+  return getData<RawLayout::Accelerometer>();
+}
+
+void Format::RawElement::getAccelerometer(vector_type &result) const
+{
+  getData<RawLayout::Accelerometer>(result);
 }
 
 Format::RawElement::data_type
 Format::RawElement::getGyroscope() const
 {
-  return getData(6, 3);
+  return getData<RawLayout::Gyroscope>();
+}
+
+void Format::RawElement::getGyroscope(vector_type &result) const
+{
+  getData<RawLayout::Gyroscope>(result);
 }
 
 Format::RawElement::data_type
 Format::RawElement::getMagnetometer() const
 {
-  return getData(3, 3);
+  return getData<RawLayout::Magnetometer>();
 }
 
+void Format::RawElement::getMagnetometer(vector_type &result) const
+{
+  getData<RawLayout::Magnetometer>(result);
+}
 
-/**
-  Ported from the Boost.Quaternion library at:
-  http://www.boost.org/libs/math/quaternion/HSO3.hpp
 
+bool Format::ConfigurableElementView::getRange(const size_type &base,
+                                               const size_type &length,
+                                               value_type *result) const
+{
+  return getData(base, length, result);
+}
+
+
+void Format::PreviewElementView::getEuler(vector_type &result) const
+{
+  getData<PreviewLayout::Euler>(result);
+}
+
+void Format::PreviewElementView::getMatrix(bool local,
+                                           matrix_type &result) const
+{
+  quaternion_type q;
+  getQuaternion(local, q);
+  quaternion_to_R3_rotation(q, result);
+}
+
+void Format::PreviewElementView::getQuaternion(bool local,
+                                               quaternion_type &result) const
+{
+  if (local) {
+    getData<PreviewLayout::LocalQuaternion>(result);
+  } else {
+    getData<PreviewLayout::GlobalQuaternion>(result);
+  }
+}
+
+void Format::PreviewElementView::getAccelerate(vector_type &result) const
+{
+  getData<PreviewLayout::Accelerate>(result);
+}
+
+
+void Format::SensorElementView::getAccelerometer(vector_type &result) const
+{
+  getData<SensorLayout::Accelerometer>(result);
+}
+
+void Format::SensorElementView::getGyroscope(vector_type &result) const
+{
+  getData<SensorLayout::Gyroscope>(result);
+}
+
+void Format::SensorElementView::getMagnetometer(vector_type &result) const
+{
+  getData<SensorLayout::Magnetometer>(result);
+}
+
+
+void Format::RawElementView::getAccelerometer(vector_type &result) const
+{
+  getData<RawLayout::Accelerometer>(result);
+}
+
+void Format::RawElementView::getGyroscope(vector_type &result) const
+{
+  getData<RawLayout::Gyroscope>(result);
+}
+
+void Format::RawElementView::getMagnetometer(vector_type &result) const
+{
+  getData<RawLayout::Magnetometer>(result);
+}
+
+
+/**
   @param q defines a quaternion in the format [w x y z] where
   <tt>q = w + x*i + y*j + z*k = (w, x, y, z)</tt>
   @return an array of 16 elements that defines a 4-by-4 rotation
   matrix computed from the input quaternion or identity matrix if
   the input quaternion has zero length
+
+  @see detail::quaternion_to_matrix
 */
 template<typename Quaternion>
 Format::PreviewElement::data_type quaternion_to_R3_rotation(const Quaternion &q)
 {
-  typedef Format::data_type::value_type real_type;
-
   // Initialize the result matrix to the identity.
   Format::PreviewElement::data_type result(16);
   {
@@ -184,38 +311,20 @@ Format::PreviewElement::data_type quaternion_to_R3_rotation(const Quaternion &q)
     return result;
   }
 
-	const real_type a = q[0];
-	const real_type b = q[1];
-	const real_type c = q[2];
-	const real_type d = q[3];
-
-	const real_type aa = a*a;
-	const real_type ab = a*b;
-	const real_type ac = a*c;
-	const real_type ad = a*d;
-	const real_type bb = b*b;
-	const real_type bc = b*c;
-	const real_type bd = b*d;
-	const real_type cc = c*c;
-	const real_type cd = c*d;
-	const real_type dd = d*d;
-
-	const real_type norme_carre = aa+bb+cc+dd;
-
-  if (norme_carre > 1e-6) {
-    result[0] = (aa+bb-cc-dd)/norme_carre;
-    result[1] = 2*(-ad+bc)/norme_carre;
-    result[2] = 2*(ac+bd)/norme_carre;
-    result[4] = 2*(ad+bc)/norme_carre;
-    result[5] = (aa-bb+cc-dd)/norme_carre;
-    result[6] = 2*(-ab+cd)/norme_carre;
-    result[7] = 0;
-    result[8] = 2*(-ac+bd)/norme_carre;
-    result[9] = 2*(ab+cd)/norme_carre;
-    result[10] = (aa-bb-cc+dd)/norme_carre;
-  }
+  detail::quaternion_to_matrix(&q[0], &q[1], &q[2], &q[3], 1, &result[0]);
+
+  return result;
+}
+
+/**
+  Non-allocating version of the rotation matrix conversion.
 
-	return result;
+  @see quaternion_to_R3_rotation
+*/
+void quaternion_to_R3_rotation(const Format::PreviewElement::quaternion_type &q,
+                               Format::PreviewElement::matrix_type &result)
+{
+  detail::quaternion_to_matrix(&q[0], &q[1], &q[2], &q[3], 1, result.data());
 }
 
 }} // namespace Motion::SDK
@@ -0,0 +1,269 @@
+/**
+  Implementation of the MappedFile class. See the header file for more details.
+
+  @file    tools/sdk/cpp/src/MappedFile.cpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <MappedFile.hpp>
+
+#if defined(_WIN32)
+#  if !defined(WIN32_LEAN_AND_MEAN)
+#    define WIN32_LEAN_AND_MEAN 1
+#  endif  // WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <sys/types.h>
+#  include <unistd.h>
+#endif  // _WIN32
+
+#include <fstream>
+
+#include <detail/endian_to_native.hpp>
+#include <detail/exception.hpp>
+
+// Define MOTION_SDK_MAPPED_FILE_BUFFERED to always read the file into memory.
+// The samples are stored in little-endian byte order, so we can not use the
+// mapped view directly on big-endian platforms.
+#if MOTION_SDK_BIG_ENDIAN && !defined(MOTION_SDK_MAPPED_FILE_BUFFERED)
+#  define MOTION_SDK_MAPPED_FILE_BUFFERED 1
+#endif  // MOTION_SDK_BIG_ENDIAN
+
+
+namespace Motion { namespace SDK {
+
+MappedFile::MappedFile(const std::string &pathname)
+  : m_data(NULL), m_size(0), m_offset(0), m_open(false), m_mapped(false),
+    m_buffer(), m_native_size(0)
+{
+#if !MOTION_SDK_MAPPED_FILE_BUFFERED
+  if (!map(pathname))
+#endif  // MOTION_SDK_MAPPED_FILE_BUFFERED
+  {
+    if (!read(pathname)) {
+#if MOTION_SDK_USE_EXCEPTIONS
+      throw detail::error("failed to open input file");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+    }
+  }
+}
+
+MappedFile::~MappedFile()
+{
+  unmap();
+}
+
+void MappedFile::close()
+{
+  if (m_open) {
+    unmap();
+  } else {
+#if MOTION_SDK_USE_EXCEPTIONS
+    throw detail::error("failed to close input file, not open");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+  }
+}
+
+bool MappedFile::isMapped() const
+{
+  return m_mapped;
+}
+
+std::size_t MappedFile::size() const
+{
+  return m_size;
+}
+
+const char *MappedFile::data(const std::size_t &element_size) const
+{
+#if MOTION_SDK_BIG_ENDIAN
+  // Convert the buffer to native byte order the first time we know the size
+  // of the elements.
+  if (!m_buffer.empty() && (element_size != m_native_size)) {
+    if (0 != m_native_size) {
+#if MOTION_SDK_USE_EXCEPTIONS
+      throw detail::error("input file already accessed with another type");
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+      return NULL;
+    }
+
+    char *first = &m_buffer[0];
+    const std::size_t n = m_buffer.size() / element_size;
+    if (sizeof(unsigned short) == element_size) {
+      detail::transform_little_endian_to_native(
+        reinterpret_cast<unsigned short *>(first), n);
+    } else if (sizeof(unsigned int) == element_size) {
+      detail::transform_little_endian_to_native(
+        reinterpret_cast<unsigned int *>(first), n);
+    } else if (sizeof(double) == element_size) {
+      detail::transform_little_endian_to_native(
+        reinterpret_cast<double *>(first), n);
+    }
+
+    m_native_size = element_size;
+  }
+#else
+  static_cast<void>(element_size);
+#endif  // MOTION_SDK_BIG_ENDIAN
+
+  return m_data;
+}
+
+bool MappedFile::map(const std::string &pathname)
+{
+  bool result = false;
+
+#if defined(_WIN32)
+  HANDLE file = ::CreateFileA(
+    pathname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL, NULL);
+  if (INVALID_HANDLE_VALUE != file) {
+    LARGE_INTEGER file_size;
+    if (::GetFileSizeEx(file, &file_size) && (file_size.QuadPart > 0)) {
+      const std::size_t size = static_cast<std::size_t>(file_size.QuadPart);
+      if (static_cast<LONGLONG>(size) == file_size.QuadPart) {
+        HANDLE mapping =
+          ::CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (NULL != mapping) {
+          const void *view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+          if (NULL != view) {
+            m_data = static_cast<const char *>(view);
+            m_size = size;
+            result = true;
+          }
+
+          // The view holds its own reference to the mapping.
+          ::CloseHandle(mapping);
+        }
+      }
+    }
+
+    ::CloseHandle(file);
+  }
+#else
+  const int fd = ::open(pathname.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat info;
+    if ((0 == ::fstat(fd, &info)) && S_ISREG(info.st_mode) &&
+        (info.st_size > 0)) {
+      const std::size_t size = static_cast<std::size_t>(info.st_size);
+      if (static_cast<off_t>(size) == info.st_size) {
+        void *view = ::mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED != view) {
+          m_data = static_cast<const char *>(view);
+          m_size = size;
+          result = true;
+        }
+      }
+    }
+
+    // The mapping holds its own reference to the file.
+    ::close(fd);
+  }
+#endif  // _WIN32
+
+  if (result) {
+    m_open = true;
+    m_mapped = true;
+  }
+
+  return result;
+}
+
+bool MappedFile::read(const std::string &pathname)
+{
+  std::ifstream input(
+    pathname.c_str(), std::ios_base::binary | std::ios_base::in);
+  if (!input.is_open()) {
+    return false;
+  }
+
+  // Read the whole file in large blocks. Reserve the full size if the stream
+  // knows it.
+  const std::size_t BlockSize = 1 << 20;
+
+  std::vector<char> buffer;
+  {
+    input.seekg(0, std::ios_base::end);
+    const std::streamoff size = input.tellg();
+    input.seekg(0, std::ios_base::beg);
+    if (size > 0) {
+      buffer.reserve(static_cast<std::size_t>(size));
+    }
+  }
+
+  for (;;) {
+    const std::size_t offset = buffer.size();
+    buffer.resize(offset + BlockSize);
+    input.read(&buffer[offset], static_cast<std::streamsize>(BlockSize));
+
+    const std::size_t n = static_cast<std::size_t>(input.gcount());
+    buffer.resize(offset + n);
+    if (n < BlockSize) {
+      break;
+    }
+  }
+
+  if (input.bad()) {
+    return false;
+  }
+
+  m_buffer.swap(buffer);
+  if (!m_buffer.empty()) {
+    m_data = &m_buffer[0];
+  }
+  m_size = m_buffer.size();
+  m_open = true;
+  m_mapped = false;
+
+  return true;
+}
+
+void MappedFile::unmap()
+{
+  if (m_mapped && (NULL != m_data)) {
+#if defined(_WIN32)
+    ::UnmapViewOfFile(m_data);
+#else
+    ::munmap(const_cast<char *>(m_data), m_size);
+#endif  // _WIN32
+  }
+
+  std::vector<char>().swap(m_buffer);
+  m_data = NULL;
+  m_size = 0;
+  m_offset = 0;
+  m_open = false;
+  m_mapped = false;
+  m_native_size = 0;
+}
+
+}}  // namespace Motion::SDK
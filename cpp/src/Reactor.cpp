@@ -0,0 +1,535 @@
+/**
+  Implementation of the Reactor class. See the header file for more details.
+
+  @file    tools/sdk/cpp/src/Reactor.cpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Reactor.hpp>
+
+// Choose the event notification system call. Define MOTION_SDK_REACTOR_POLL
+// to use the portable poll back end everywhere.
+#if !defined(MOTION_SDK_REACTOR_POLL)
+#  if defined(_WIN32)
+#    define MOTION_SDK_REACTOR_WSAPOLL 1
+#  elif defined(__linux__)
+#    define MOTION_SDK_REACTOR_EPOLL 1
+#  elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
+        defined(__NetBSD__)
+#    define MOTION_SDK_REACTOR_KQUEUE 1
+#  else
+#    define MOTION_SDK_REACTOR_POLL 1
+#  endif
+#endif  // MOTION_SDK_REACTOR_POLL
+
+#if defined(_WIN32)
+#  if !defined(WIN32_LEAN_AND_MEAN)
+#    define WIN32_LEAN_AND_MEAN 1
+#  endif  // WIN32_LEAN_AND_MEAN
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#else
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <unistd.h>
+#  if MOTION_SDK_REACTOR_EPOLL
+#    include <sys/epoll.h>
+#  elif MOTION_SDK_REACTOR_KQUEUE
+#    include <sys/types.h>
+#    include <sys/event.h>
+#    include <sys/time.h>
+#  endif
+#endif  // _WIN32
+
+#include <cstring>
+
+#include <detail/exception.hpp>
+
+#if defined(_WIN32)
+#  define ERROR_CODE WSAGetLastError()
+#  define SYSTEM_POLL(fds, n, time_out) ::WSAPoll(fds, n, time_out)
+#  define SYSTEM_READ(fd, buffer, n) ::recv(fd, buffer, n, 0)
+#  if !defined(EINTR)
+#    define EINTR    WSAEINTR
+#  endif
+#else
+#  define ERROR_CODE errno
+#  define SYSTEM_POLL(fds, n, time_out) ::poll(fds, n, time_out)
+#  define SYSTEM_READ(fd, buffer, n) ::read(fd, buffer, n)
+#endif  // _WIN32
+
+// Create some error handler macros. Use exceptions by default
+// but allow the client application to disable them.
+#if MOTION_SDK_USE_EXCEPTIONS
+#  define REACTOR_ERROR(msg) { throw detail::error(msg); }
+#else
+#  define REACTOR_ERROR(msg) {}
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+
+
+namespace Motion { namespace SDK {
+
+namespace detail {
+
+/**
+  Maximum number of ready descriptors to handle in one system wait call.
+*/
+const std::size_t ReactorEventSize = 64;
+
+/**
+  Interrupt channel messages.
+*/
+const char ReactorInterrupt = 'i';
+const char ReactorStop = 's';
+
+#if MOTION_SDK_REACTOR_EPOLL
+typedef epoll_event event_type;
+#elif MOTION_SDK_REACTOR_KQUEUE
+typedef struct kevent event_type;
+#else
+typedef pollfd event_type;
+#endif  // MOTION_SDK_REACTOR_EPOLL
+
+void close_descriptor(int &descriptor)
+{
+  if (descriptor >= 0) {
+#if defined(_WIN32)
+    ::closesocket(descriptor);
+#else
+    ::close(descriptor);
+#endif  // _WIN32
+    descriptor = -1;
+  }
+}
+
+/**
+  Create the interrupt channel. A pipe on POSIX systems. Windows can only
+  wait on sockets, so use a UDP socket that is connected to itself.
+*/
+bool create_interrupt(int *result)
+{
+  result[0] = result[1] = -1;
+
+#if defined(_WIN32)
+  int socket = static_cast<int>(::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+  if (-1 == socket) {
+    return false;
+  }
+
+  sockaddr_in address;
+  int length = sizeof(address);
+  {
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  }
+
+  u_long non_blocking = 1;
+  if ((0 != ::bind(socket, reinterpret_cast<sockaddr *>(&address),
+                   sizeof(address))) ||
+      (0 != ::getsockname(socket, reinterpret_cast<sockaddr *>(&address),
+                          &length)) ||
+      (0 != ::connect(socket, reinterpret_cast<sockaddr *>(&address),
+                      sizeof(address))) ||
+      (0 != ::ioctlsocket(socket, FIONBIO, &non_blocking))) {
+    close_descriptor(socket);
+    return false;
+  }
+
+  result[0] = result[1] = socket;
+#else
+  if (0 != ::pipe(result)) {
+    result[0] = result[1] = -1;
+    return false;
+  }
+
+  // Never block on the interrupt channel.
+  for (int i=0; i<2; ++i) {
+    const int flags = ::fcntl(result[i], F_GETFL, 0);
+    ::fcntl(result[i], F_SETFL, flags | O_NONBLOCK);
+    ::fcntl(result[i], F_SETFD, FD_CLOEXEC);
+  }
+#endif  // _WIN32
+
+  return true;
+}
+
+}  // namespace detail
+
+Reactor::Reactor()
+  : m_connection(), m_descriptor(-1), m_stop(false), m_ready(),
+    m_event(detail::ReactorEventSize * sizeof(detail::event_type))
+{
+  m_interrupt[0] = m_interrupt[1] = -1;
+
+#if defined(_WIN32)
+  // Winsock API requires per application or DLL initialization. Balance this
+  // with a call to WSACleanup in the destructor.
+  WSADATA wsaData;
+  if (0 != WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+    REACTOR_ERROR("failed to initialize Winsock at \"WSAStartup\"");
+    return;
+  }
+#endif  // _WIN32
+
+#if MOTION_SDK_REACTOR_EPOLL
+  m_descriptor = ::epoll_create(static_cast<int>(detail::ReactorEventSize));
+  if (-1 == m_descriptor) {
+    REACTOR_ERROR("failed to create epoll descriptor");
+    return;
+  }
+  ::fcntl(m_descriptor, F_SETFD, FD_CLOEXEC);
+#elif MOTION_SDK_REACTOR_KQUEUE
+  m_descriptor = ::kqueue();
+  if (-1 == m_descriptor) {
+    REACTOR_ERROR("failed to create kqueue descriptor");
+    return;
+  }
+#endif  // MOTION_SDK_REACTOR_EPOLL
+
+  if (!detail::create_interrupt(m_interrupt)) {
+    REACTOR_ERROR("failed to create reactor interrupt channel");
+    return;
+  }
+
+  if (!watch(m_interrupt[0], true)) {
+    REACTOR_ERROR("failed to watch reactor interrupt channel");
+  }
+}
+
+Reactor::~Reactor()
+{
+  detail::close_descriptor(m_descriptor);
+
+#if defined(_WIN32)
+  // Both ends are the same socket.
+  detail::close_descriptor(m_interrupt[0]);
+  m_interrupt[1] = -1;
+
+  WSACleanup();
+#else
+  detail::close_descriptor(m_interrupt[0]);
+  detail::close_descriptor(m_interrupt[1]);
+#endif  // _WIN32
+}
+
+bool Reactor::add(Client &client, Handler &handler)
+{
+  if (!client.isConnected()) {
+    REACTOR_ERROR("failed to add client to reactor, not connected");
+    return false;
+  }
+
+  const int socket = client.m_socket;
+  if (m_connection.end() != m_connection.find(socket)) {
+    REACTOR_ERROR("failed to add client to reactor, already attached");
+    return false;
+  }
+
+  if (!watch(socket, true)) {
+    REACTOR_ERROR("failed to add client socket to reactor event set");
+    return false;
+  }
+
+  m_connection.insert(std::make_pair(socket, Connection(&client, &handler)));
+
+  return true;
+}
+
+bool Reactor::remove(Client &client)
+{
+  for (container_type::iterator itr=m_connection.begin();
+       itr!=m_connection.end(); ++itr) {
+    if (&client == itr->second.client) {
+      // The system removes closed descriptors from the event set on its own.
+      if (client.isConnected()) {
+        watch(itr->first, false);
+      }
+
+      m_connection.erase(itr);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::size_t Reactor::size() const
+{
+  return m_connection.size();
+}
+
+bool Reactor::empty() const
+{
+  return m_connection.empty();
+}
+
+std::size_t Reactor::poll(const int &time_out_millisecond)
+{
+  std::size_t result = 0;
+
+  if (!wait(time_out_millisecond)) {
+    return result;
+  }
+
+  for (std::vector<int>::const_iterator itr=m_ready.begin();
+       itr!=m_ready.end(); ++itr) {
+    if (m_interrupt[0] == *itr) {
+      drainInterrupt();
+    } else {
+      result += dispatch(*itr);
+    }
+  }
+
+  return result;
+}
+
+std::size_t Reactor::run()
+{
+  std::size_t result = 0;
+
+  m_stop = false;
+  while (!m_stop && !m_connection.empty()) {
+    result += poll(-1);
+  }
+  m_stop = false;
+
+  return result;
+}
+
+void Reactor::interrupt()
+{
+  writeInterrupt(detail::ReactorInterrupt);
+}
+
+void Reactor::stop()
+{
+  writeInterrupt(detail::ReactorStop);
+}
+
+const char *Reactor::backend()
+{
+#if MOTION_SDK_REACTOR_EPOLL
+  return "epoll";
+#elif MOTION_SDK_REACTOR_KQUEUE
+  return "kqueue";
+#elif MOTION_SDK_REACTOR_WSAPOLL
+  return "WSAPoll";
+#else
+  return "poll";
+#endif  // MOTION_SDK_REACTOR_EPOLL
+}
+
+std::size_t Reactor::dispatch(const int &socket)
+{
+  std::size_t result = 0;
+
+  // Look up the connection again, a previous handler may have removed it.
+  container_type::iterator itr = m_connection.find(socket);
+  if (m_connection.end() == itr) {
+    return result;
+  }
+
+  // Copy, the connection record does not outlive a call to remove.
+  const Connection connection = itr->second;
+
+  bool keep = true;
+#if MOTION_SDK_USE_EXCEPTIONS
+  try {
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+    Client::data_view_type data;
+    while (connection.client->receiveAvailableMessage(data)) {
+      ++result;
+      if (!connection.handler->onMessage(*connection.client, data)) {
+        keep = false;
+        break;
+      }
+
+      // The handler may have detached this connection.
+      itr = m_connection.find(socket);
+      if ((m_connection.end() == itr) ||
+          (connection.client != itr->second.client)) {
+        return result;
+      }
+    }
+#if MOTION_SDK_USE_EXCEPTIONS
+  } catch (detail::error &) {
+    // Protocol or socket error on this connection only. Close it and keep
+    // the rest of the connections running.
+    if (connection.client->isConnected()) {
+      try {
+        connection.client->close();
+      } catch (detail::error &) {
+      }
+    }
+  }
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+
+  if (!keep) {
+    remove(*connection.client);
+  } else if (!connection.client->isConnected()) {
+    // Graceful disconnection or communication error. The closed descriptor
+    // is already out of the system event set.
+    m_connection.erase(socket);
+    connection.handler->onClose(*connection.client);
+  }
+
+  return result;
+}
+
+void Reactor::drainInterrupt()
+{
+  char buffer[64];
+  while (true) {
+    const int received = static_cast<int>(
+      SYSTEM_READ(m_interrupt[0], buffer, sizeof(buffer)));
+    if (received <= 0) {
+      break;
+    }
+
+    for (int i=0; i<received; ++i) {
+      if (detail::ReactorStop == buffer[i]) {
+        m_stop = true;
+      }
+    }
+  }
+}
+
+void Reactor::writeInterrupt(const char &value)
+{
+  if (m_interrupt[1] >= 0) {
+#if defined(_WIN32)
+    ::send(m_interrupt[1], &value, 1, 0);
+#else
+    // The pipe is non-blocking. If it is full there is already a wake up
+    // pending, but make sure a stop request is not lost.
+    while ((-1 == ::write(m_interrupt[1], &value, 1)) && (EINTR == errno)) {
+    }
+#endif  // _WIN32
+  }
+}
+
+bool Reactor::watch(const int &socket, bool enable)
+{
+#if MOTION_SDK_REACTOR_EPOLL
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.u64 = 0;
+  event.data.fd = socket;
+
+  return 0 == ::epoll_ctl(
+    m_descriptor, enable ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, socket, &event);
+#elif MOTION_SDK_REACTOR_KQUEUE
+  struct kevent event;
+  EV_SET(&event, socket, EVFILT_READ, enable ? EV_ADD : EV_DELETE, 0, 0, NULL);
+
+  return 0 == ::kevent(m_descriptor, &event, 1, NULL, 0, NULL);
+#else
+  // The poll back end builds the descriptor list in every wait call.
+  static_cast<void>(socket);
+  static_cast<void>(enable);
+  return true;
+#endif  // MOTION_SDK_REACTOR_EPOLL
+}
+
+bool Reactor::wait(const int &time_out_millisecond)
+{
+  m_ready.clear();
+
+  const int time_out = (time_out_millisecond < 0) ? -1 : time_out_millisecond;
+
+#if MOTION_SDK_REACTOR_EPOLL
+  detail::event_type *event =
+    reinterpret_cast<detail::event_type *>(&m_event[0]);
+
+  const int result = ::epoll_wait(
+    m_descriptor, event, static_cast<int>(detail::ReactorEventSize), time_out);
+  for (int i=0; i<result; ++i) {
+    m_ready.push_back(event[i].data.fd);
+  }
+#elif MOTION_SDK_REACTOR_KQUEUE
+  detail::event_type *event =
+    reinterpret_cast<detail::event_type *>(&m_event[0]);
+
+  timespec time_out_spec;
+  time_out_spec.tv_sec = time_out / 1000;
+  time_out_spec.tv_nsec = (time_out % 1000) * 1000000;
+
+  const int result = ::kevent(
+    m_descriptor, NULL, 0, event, static_cast<int>(detail::ReactorEventSize),
+    (time_out < 0) ? NULL : &time_out_spec);
+  for (int i=0; i<result; ++i) {
+    m_ready.push_back(static_cast<int>(event[i].ident));
+  }
+#else
+  // One entry for the interrupt channel plus one for each connection.
+  const std::size_t n = 1 + m_connection.size();
+  if (m_event.size() < n * sizeof(detail::event_type)) {
+    m_event.resize(n * sizeof(detail::event_type));
+  }
+
+  detail::event_type *event =
+    reinterpret_cast<detail::event_type *>(&m_event[0]);
+  {
+    event[0].fd = m_interrupt[0];
+    event[0].events = POLLIN;
+    event[0].revents = 0;
+
+    std::size_t i = 1;
+    for (container_type::const_iterator itr=m_connection.begin();
+         itr!=m_connection.end(); ++itr, ++i) {
+      event[i].fd = itr->first;
+      event[i].events = POLLIN;
+      event[i].revents = 0;
+    }
+  }
+
+  const int result = SYSTEM_POLL(event, static_cast<unsigned long>(n), time_out);
+  for (std::size_t i=0; (result > 0) && (i<n); ++i) {
+    if (0 != event[i].revents) {
+      m_ready.push_back(static_cast<int>(event[i].fd));
+    }
+  }
+#endif  // MOTION_SDK_REACTOR_EPOLL
+
+  if (-1 == result) {
+    if (EINTR == ERROR_CODE) {
+      // Interrupted by a signal. Not an error.
+      return false;
+    }
+
+    REACTOR_ERROR("failed to wait for incoming data in reactor");
+    return false;
+  }
+
+  return !m_ready.empty();
+}
+
+}}  // namespace Motion::SDK
@@ -0,0 +1,349 @@
+/**
+  Implementation of the Resampler class. See the header file for more details.
+
+  @file    tools/sdk/cpp/src/Resampler.cpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <Resampler.hpp>
+
+#include <detail/kernel.hpp>
+
+#include <algorithm>
+
+
+namespace Motion { namespace SDK {
+
+namespace {
+
+typedef Format::PreviewLayout layout_type;
+
+const std::size_t MinimumHistory = 2;
+
+/**
+  Predict the next rotation of each element at constant angular velocity,
+  <tt>result = b * conj(a) * b</tt>. All arrays are four contiguous arrays of
+  <tt>n</tt> values <tt>{w..., x..., y..., z...}</tt>.
+*/
+void quaternion_predict(const float *a, const float *b, const std::size_t &n,
+                        float *result)
+{
+  for (std::size_t i=0; i<n; ++i) {
+    const float aw = a[i];
+    const float ax = -a[n + i];
+    const float ay = -a[2 * n + i];
+    const float az = -a[3 * n + i];
+
+    const float bw = b[i];
+    const float bx = b[n + i];
+    const float by = b[2 * n + i];
+    const float bz = b[3 * n + i];
+
+    // d = b * conj(a)
+    const float dw = bw * aw - bx * ax - by * ay - bz * az;
+    const float dx = bw * ax + bx * aw + by * az - bz * ay;
+    const float dy = bw * ay - bx * az + by * aw + bz * ax;
+    const float dz = bw * az + bx * ay - by * ax + bz * aw;
+
+    // result = d * b
+    result[i] = dw * bw - dx * bx - dy * by - dz * bz;
+    result[n + i] = dw * bx + dx * bw + dy * bz - dz * by;
+    result[2 * n + i] = dw * by - dx * bz + dy * bw + dz * bx;
+    result[3 * n + i] = dw * bz + dx * by - dy * bx + dz * bw;
+  }
+}
+
+/** Recompute the Euler angle channel from the local quaternion. */
+void update_euler(const std::size_t &n, float *data)
+{
+  const float *q = data + layout_type::LocalQuaternion::Base * n;
+  detail::quaternion_to_euler(
+    q, q + n, q + 2 * n, q + 3 * n, n,
+    data + layout_type::Euler::Base * n);
+}
+
+}  // namespace
+
+Resampler::Resampler(const size_type &history)
+  : m_frame(std::max(history, MinimumHistory)),
+    m_time(m_frame.size(), 0.0), m_first(0), m_size(0), m_extrapolate(0),
+    m_scratch()
+{
+}
+
+bool Resampler::push(const double &time, const frame_type &frame)
+{
+  if (frame.empty() || !isNewer(time)) {
+    return false;
+  }
+
+  m_frame[getNext()] = frame;
+  commit(time);
+  return true;
+}
+
+bool Resampler::push(const double &time,
+                     const Format::preview_service_type &preview)
+{
+  if (preview.empty() || !isNewer(time)) {
+    return false;
+  }
+
+  typedef Format::preview_service_type::const_iterator iterator;
+
+  // Reuse the id list of the newest frame when it matches, the usual case.
+  frame_type::id_list_type id;
+  if (m_size > 0) {
+    id = m_frame[getIndex(m_size - 1)].getId();
+  }
+
+  bool same = (id.size() == preview.size());
+  if (same) {
+    std::size_t i = 0;
+    for (iterator itr=preview.begin(); itr!=preview.end(); ++itr) {
+      if (id[i++] != itr->first) {
+        same = false;
+        break;
+      }
+    }
+  }
+
+  if (!same) {
+    id.clear();
+    for (iterator itr=preview.begin(); itr!=preview.end(); ++itr) {
+      id.push_back(itr->first);
+    }
+  }
+
+  const std::size_t n = id.size();
+  const std::size_t length = Format::PreviewElement::Length;
+
+  frame_type &frame = m_frame[getNext()];
+  value_type *data = frame.assign(id, length);
+
+  std::size_t i = 0;
+  for (iterator itr=preview.begin(); itr!=preview.end(); ++itr, ++i) {
+    const Format::PreviewElement::data_type &element = itr->second.access();
+    if (element.size() != length) {
+      discard();
+      return false;
+    }
+
+    for (std::size_t c=0; c<length; ++c) {
+      data[c * n + i] = element[c];
+    }
+  }
+
+  commit(time);
+  return true;
+}
+
+bool Resampler::sample(const double &time, frame_type &result)
+{
+  if (0 == m_size) {
+    result.clear();
+    return false;
+  }
+
+  const size_type newest = getIndex(m_size - 1);
+  if (time >= m_time[newest]) {
+    if ((m_size > 1) && (m_extrapolate > 0) && (time > m_time[newest])) {
+      const size_type previous = getIndex(m_size - 2);
+      const double interval = m_time[newest] - m_time[previous];
+      const double s =
+        std::min(std::min(time - m_time[newest], m_extrapolate), interval) /
+        interval;
+
+      extrapolate(
+        m_frame[previous], m_frame[newest], static_cast<value_type>(s),
+        result);
+    } else {
+      result = m_frame[newest];
+    }
+
+    return true;
+  }
+
+  const size_type oldest = getIndex(0);
+  if (time <= m_time[oldest]) {
+    result = m_frame[oldest];
+    return true;
+  }
+
+  // The history is short and the sample time is usually near the newest
+  // frame, search backwards.
+  size_type i = m_size - 1;
+  while ((i > 1) && (m_time[getIndex(i - 1)] > time)) {
+    --i;
+  }
+
+  const size_type a = getIndex(i - 1);
+  const size_type b = getIndex(i);
+  const double t = (time - m_time[a]) / (m_time[b] - m_time[a]);
+
+  interpolate(m_frame[a], m_frame[b], static_cast<value_type>(t), result);
+
+  return true;
+}
+
+void Resampler::setExtrapolate(const double &seconds)
+{
+  m_extrapolate = std::max(seconds, 0.0);
+}
+
+double Resampler::getExtrapolate() const
+{
+  return m_extrapolate;
+}
+
+void Resampler::clear()
+{
+  m_first = 0;
+  m_size = 0;
+}
+
+Resampler::size_type Resampler::size() const
+{
+  return m_size;
+}
+
+bool Resampler::empty() const
+{
+  return 0 == m_size;
+}
+
+bool Resampler::getTime(double &first, double &last) const
+{
+  if (0 == m_size) {
+    return false;
+  }
+
+  first = m_time[getIndex(0)];
+  last = m_time[getIndex(m_size - 1)];
+
+  return true;
+}
+
+bool Resampler::isNewer(const double &time) const
+{
+  return (0 == m_size) || (time > m_time[getIndex(m_size - 1)]);
+}
+
+Resampler::size_type Resampler::getNext() const
+{
+  return getIndex(m_size);
+}
+
+Resampler::size_type Resampler::getIndex(const size_type &i) const
+{
+  return (m_first + i) % m_frame.size();
+}
+
+void Resampler::commit(const double &time)
+{
+  const size_type next = getNext();
+  m_time[next] = time;
+
+  // Interpolation needs the same elements in every frame. Start over if the
+  // set of elements changes.
+  if ((m_size > 0) &&
+      (m_frame[getIndex(m_size - 1)].getId() != m_frame[next].getId())) {
+    m_first = next;
+    m_size = 1;
+    return;
+  }
+
+  if (m_size < m_frame.size()) {
+    ++m_size;
+  } else {
+    m_first = (m_first + 1) % m_frame.size();
+  }
+}
+
+void Resampler::discard()
+{
+  // A full ring stores the next frame over the oldest one.
+  if (m_size == m_frame.size()) {
+    m_first = (m_first + 1) % m_frame.size();
+    --m_size;
+  }
+}
+
+void Resampler::interpolate(const frame_type &a, const frame_type &b,
+                            const value_type &t, frame_type &result)
+{
+  const std::size_t n = a.size();
+  const value_type *da = &a.access()[0];
+  const value_type *db = &b.access()[0];
+
+  value_type *data = result.assign(a.getId(), a.length());
+
+  const std::size_t gq = layout_type::GlobalQuaternion::Base * n;
+  const std::size_t lq = layout_type::LocalQuaternion::Base * n;
+  const std::size_t la = layout_type::Accelerate::Base * n;
+
+  detail::quaternion_slerp(da + gq, db + gq, n, t, data + gq);
+  detail::quaternion_slerp(da + lq, db + lq, n, t, data + lq);
+  detail::linear_interpolate(
+    da + la, db + la, layout_type::Accelerate::Length * n, t, data + la);
+
+  update_euler(n, data);
+}
+
+void Resampler::extrapolate(const frame_type &a, const frame_type &b,
+                            const value_type &s, frame_type &result)
+{
+  const std::size_t n = a.size();
+  const value_type *da = &a.access()[0];
+  const value_type *db = &b.access()[0];
+
+  value_type *data = result.assign(a.getId(), a.length());
+
+  const std::size_t gq = layout_type::GlobalQuaternion::Base * n;
+  const std::size_t lq = layout_type::LocalQuaternion::Base * n;
+  const std::size_t la = layout_type::Accelerate::Base * n;
+
+  // Predict one full frame interval ahead and then move part of the way
+  // there. Keeps the slerp parameter on [0, 1] where it is accurate.
+  m_scratch.resize(4 * n);
+  value_type *predict = &m_scratch[0];
+
+  quaternion_predict(da + gq, db + gq, n, predict);
+  detail::quaternion_slerp(db + gq, predict, n, s, data + gq);
+
+  quaternion_predict(da + lq, db + lq, n, predict);
+  detail::quaternion_slerp(db + lq, predict, n, s, data + lq);
+
+  // Linear interpolation past t = 1 is linear extrapolation.
+  detail::linear_interpolate(
+    da + la, db + la, layout_type::Accelerate::Length * n, 1 + s, data + la);
+
+  update_euler(n, data);
+}
+
+}} // namespace Motion::SDK
@@ -0,0 +1,347 @@
+/**
+  Implementation of the TakeSet class. See the header file for more details.
+
+  @file    tools/sdk/cpp/src/TakeSet.cpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <TakeSet.hpp>
+
+#if defined(_WIN32)
+#  if !defined(WIN32_LEAN_AND_MEAN)
+#    define WIN32_LEAN_AND_MEAN 1
+#  endif  // WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <sys/types.h>
+#  include <unistd.h>
+#endif  // _WIN32
+
+#include <cstring>
+#include <utility>
+
+
+namespace Motion { namespace SDK {
+
+namespace detail {
+
+/** Alignment and rounding of the read buffer and of each read. */
+const std::size_t PageSize = 4096;
+
+std::size_t round_page(const std::size_t &size)
+{
+  return ((std::max<std::size_t>(size, 1) + PageSize - 1) / PageSize) *
+    PageSize;
+}
+
+/**
+  @return size of the file in bytes, or -1 if it does not exist
+*/
+double file_size(const std::string &pathname)
+{
+#if defined(_WIN32)
+  WIN32_FILE_ATTRIBUTE_DATA info;
+  if (::GetFileAttributesExA(
+        pathname.c_str(), GetFileExInfoStandard, &info)) {
+    return static_cast<double>(info.nFileSizeHigh) * 4294967296.0 +
+      static_cast<double>(info.nFileSizeLow);
+  }
+#else
+  struct stat info;
+  if (0 == ::stat(pathname.c_str(), &info)) {
+    return static_cast<double>(info.st_size);
+  }
+#endif  // _WIN32
+
+  return -1;
+}
+
+}  // namespace detail
+
+
+TakeSet::Reader::Reader(const std::string &pathname, const Backend &backend,
+                        const std::size_t &read_size)
+  : m_backend(backend), m_read_size(detail::round_page(read_size)),
+    m_map(NULL), m_file(NULL),
+#if defined(_WIN32)
+    m_handle(INVALID_HANDLE_VALUE),
+#else
+    m_handle(-1),
+#endif  // _WIN32
+    m_storage(NULL), m_buffer(NULL), m_capacity(0), m_first(0), m_last(0),
+    m_open(false), m_error(false)
+{
+  // The File and MappedFile constructors only report a missing file with an
+  // exception. Check for it first so that we never throw.
+  if (detail::file_size(pathname) < 0) {
+    return;
+  }
+
+  if (Map == m_backend || Stream == m_backend) {
+#if MOTION_SDK_USE_EXCEPTIONS
+    try {
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+      if (Map == m_backend) {
+        m_map = new MappedFile(pathname);
+      } else {
+        m_file = new File(pathname);
+      }
+      m_open = true;
+#if MOTION_SDK_USE_EXCEPTIONS
+    } catch (std::exception &) {
+    }
+#endif  // MOTION_SDK_USE_EXCEPTIONS
+    return;
+  }
+
+#if defined(_WIN32)
+  m_handle = ::CreateFileA(
+    pathname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  m_open = (INVALID_HANDLE_VALUE != m_handle);
+#else
+  m_handle = ::open(pathname.c_str(), O_RDONLY);
+  m_open = (m_handle >= 0);
+  if (m_open) {
+    // We read the whole file once, front to back. Ask for a larger read
+    // ahead window and for the first blocks now.
+#if defined(POSIX_FADV_SEQUENTIAL)
+    ::posix_fadvise(m_handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+    ::posix_fadvise(
+      m_handle, 0, static_cast<off_t>(PrefetchSize), POSIX_FADV_WILLNEED);
+#elif defined(F_RDAHEAD)
+    ::fcntl(m_handle, F_RDAHEAD, 1);
+#endif  // POSIX_FADV_SEQUENTIAL
+  }
+#endif  // _WIN32
+}
+
+TakeSet::Reader::~Reader()
+{
+  delete m_map;
+  delete m_file;
+
+#if defined(_WIN32)
+  if (INVALID_HANDLE_VALUE != m_handle) {
+    ::CloseHandle(m_handle);
+  }
+#else
+  if (m_handle >= 0) {
+    ::close(m_handle);
+  }
+#endif  // _WIN32
+
+  ::operator delete(m_storage);
+}
+
+bool TakeSet::Reader::isOpen() const
+{
+  return m_open;
+}
+
+bool TakeSet::Reader::isError() const
+{
+  return m_error;
+}
+
+char *TakeSet::Reader::read(const std::size_t &frame_size,
+                            std::size_t &count)
+{
+  count = 0;
+  if (!m_open || m_error) {
+    return NULL;
+  }
+
+  // Move the partial frame from the end of the last block to the front.
+  // Every read is the same whole number of pages, so the file offsets stay
+  // page aligned too.
+  const std::size_t partial = m_last - m_first;
+  char *buffer = reserve(partial + m_read_size);
+  if (partial > 0) {
+    std::memmove(buffer, buffer + m_first, partial);
+  }
+
+  std::size_t size = 0;
+  while (size < m_read_size) {
+    char *first = buffer + partial + size;
+    const std::size_t remaining = m_read_size - size;
+
+#if defined(_WIN32)
+    DWORD n = 0;
+    if (!::ReadFile(
+          m_handle, first, static_cast<DWORD>(remaining), &n, NULL)) {
+      m_error = true;
+      break;
+    }
+#else
+    const ssize_t n = ::read(m_handle, first, remaining);
+    if (n < 0) {
+      if (EINTR == errno) {
+        continue;
+      }
+      m_error = true;
+      break;
+    }
+#endif  // _WIN32
+
+    if (0 == n) {
+      break;
+    }
+
+    size += static_cast<std::size_t>(n);
+  }
+
+  const std::size_t available = partial + size;
+
+  count = available / frame_size;
+  m_first = count * frame_size;
+  m_last = available;
+
+  return (count > 0) ? buffer : NULL;
+}
+
+char *TakeSet::Reader::reserve(const std::size_t &size)
+{
+  if (size > m_capacity) {
+    // Keep the bytes that are already in the buffer.
+    const std::size_t capacity = detail::round_page(size);
+    char *storage = static_cast<char *>(
+      ::operator new(capacity + detail::PageSize));
+
+    const std::size_t offset = reinterpret_cast<std::size_t>(storage) %
+      detail::PageSize;
+    char *buffer = storage + ((0 == offset) ? 0 : detail::PageSize - offset);
+
+    if (NULL != m_buffer) {
+      std::memcpy(buffer, m_buffer, m_capacity);
+    }
+
+    ::operator delete(m_storage);
+    m_storage = storage;
+    m_buffer = buffer;
+    m_capacity = capacity;
+  }
+
+  return m_buffer;
+}
+
+
+TakeSet::TakeSet(const path_list_type &pathname)
+  : m_pathname(pathname), m_error(pathname.size()), m_thread_count(0),
+    m_backend(Read), m_read_size(DefaultReadSize)
+{
+}
+
+std::size_t TakeSet::size() const
+{
+  return m_pathname.size();
+}
+
+const std::string &TakeSet::getPathname(const std::size_t &index) const
+{
+  return m_pathname.at(index);
+}
+
+const std::string &TakeSet::getError(const std::size_t &index) const
+{
+  return m_error.at(index);
+}
+
+void TakeSet::setThreadCount(const std::size_t &count)
+{
+  m_thread_count = count;
+}
+
+std::size_t TakeSet::getThreadCount() const
+{
+  return m_thread_count;
+}
+
+void TakeSet::setBackend(const Backend &backend)
+{
+  m_backend = backend;
+}
+
+TakeSet::Backend TakeSet::getBackend() const
+{
+  return m_backend;
+}
+
+void TakeSet::setReadSize(const std::size_t &read_size)
+{
+  m_read_size = detail::round_page(read_size);
+}
+
+std::size_t TakeSet::getReadSize() const
+{
+  return m_read_size;
+}
+
+std::vector<std::size_t> TakeSet::getSchedule() const
+{
+  // Sort by size, largest first. Keep the original order for ties, and put
+  // missing files at the end.
+  typedef std::pair<double, std::size_t> item_type;
+
+  std::vector<item_type> item;
+  item.reserve(m_pathname.size());
+  for (std::size_t i=0; i<m_pathname.size(); ++i) {
+    item.push_back(item_type(-detail::file_size(m_pathname[i]), i));
+  }
+
+  std::sort(item.begin(), item.end());
+
+  std::vector<std::size_t> result;
+  result.reserve(item.size());
+  for (std::size_t i=0; i<item.size(); ++i) {
+    result.push_back(item[i].second);
+  }
+
+  return result;
+}
+
+void TakeSet::prefetch(const std::string &pathname)
+{
+#if defined(POSIX_FADV_WILLNEED)
+  const int fd = ::open(pathname.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    // Starts an asynchronous read in to the page cache. Closing the file
+    // does not cancel it.
+    ::posix_fadvise(fd, 0, static_cast<off_t>(PrefetchSize),
+                    POSIX_FADV_WILLNEED);
+    ::close(fd);
+  }
+#else
+  static_cast<void>(pathname);
+#endif  // POSIX_FADV_WILLNEED
+}
+
+}}  // namespace Motion::SDK
@@ -0,0 +1,131 @@
+/**
+  Implementation of the arena memory resource. See the header file for more
+  details.
+
+  @file    tools/sdk/cpp/src/arena.cpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <detail/arena.hpp>
+
+#include <algorithm>
+
+
+namespace Motion { namespace SDK { namespace detail {
+
+namespace {
+
+std::size_t round_size(const std::size_t &size)
+{
+  const std::size_t n = std::max<std::size_t>(size, 1);
+  return (n + arena::Alignment - 1) & ~static_cast<std::size_t>(
+    arena::Alignment - 1);
+}
+
+}  // namespace
+
+arena::arena(const std::size_t &block_size)
+  : m_block(), m_block_size(round_size(block_size)), m_current(0),
+    m_offset(0)
+{
+  std::fill(m_free, m_free + FreeListSize, static_cast<free_type *>(NULL));
+}
+
+arena::~arena()
+{
+  for (std::size_t i=0; i<m_block.size(); ++i) {
+    ::operator delete(m_block[i].data);
+  }
+}
+
+void *arena::allocate(const std::size_t &size)
+{
+  const std::size_t bytes = round_size(size);
+
+  // Reuse a small allocation of the same size.
+  const std::size_t index = bytes / Alignment - 1;
+  if ((index < FreeListSize) && (NULL != m_free[index])) {
+    free_type *node = m_free[index];
+    m_free[index] = node->next;
+    return node;
+  }
+
+  // Take the next bytes of the first block that has room, starting with the
+  // current one.
+  while (m_current < m_block.size()) {
+    block_type &block = m_block[m_current];
+    if (m_offset + bytes <= block.size) {
+      void *result = block.data + m_offset;
+      m_offset += bytes;
+      return result;
+    }
+
+    ++m_current;
+    m_offset = 0;
+  }
+
+  // Make room in the list first so that the push does not throw. Double
+  // the capacity so that the list only moves once in a while.
+  if (m_block.size() == m_block.capacity()) {
+    m_block.reserve(std::max<std::size_t>(2 * m_block.size(), 4));
+  }
+
+  block_type block;
+  block.size = std::max(m_block_size, bytes);
+  block.data = static_cast<char *>(::operator new(block.size));
+  m_block.push_back(block);
+
+  m_current = m_block.size() - 1;
+  m_offset = bytes;
+
+  return block.data;
+}
+
+void arena::deallocate(void *pointer, const std::size_t &size)
+{
+  const std::size_t index = round_size(size) / Alignment - 1;
+  if ((NULL != pointer) && (index < FreeListSize)) {
+    free_type *node = static_cast<free_type *>(pointer);
+    node->next = m_free[index];
+    m_free[index] = node;
+  }
+}
+
+void arena::reset()
+{
+  m_current = 0;
+  m_offset = 0;
+  std::fill(m_free, m_free + FreeListSize, static_cast<free_type *>(NULL));
+}
+
+std::size_t arena::getBlockCount() const
+{
+  return m_block.size();
+}
+
+}}} // namespace Motion::SDK::detail
@@ -0,0 +1,165 @@
+/**
+  Implementation of the instrumentation clock and counters. See the header
+  file for more details.
+
+  @file    tools/sdk/cpp/src/instrument.cpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <detail/instrument.hpp>
+
+#include <cmath>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif  // _WIN32
+
+
+namespace Motion { namespace SDK { namespace detail {
+
+double monotonic_time()
+{
+#if defined(_WIN32)
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  if (!::QueryPerformanceFrequency(&frequency) ||
+      !::QueryPerformanceCounter(&counter)) {
+    return 0;
+  }
+
+  return static_cast<double>(counter.QuadPart) /
+    static_cast<double>(frequency.QuadPart);
+#else
+  timespec now;
+  if (0 != ::clock_gettime(CLOCK_MONOTONIC, &now)) {
+    return 0;
+  }
+
+  return static_cast<double>(now.tv_sec) +
+    static_cast<double>(now.tv_nsec) * 1e-9;
+#endif  // _WIN32
+}
+
+
+histogram::histogram()
+{
+  clear();
+}
+
+void histogram::add(const double &second)
+{
+  const double value = (second > 0) ? second : 0;
+
+  if ((0 == count) || (value < min)) {
+    min = value;
+  }
+  if ((0 == count) || (value > max)) {
+    max = value;
+  }
+
+  ++count;
+  sum += value;
+  sum_square += value * value;
+
+  std::size_t index = 0;
+  for (double limit=1e-6; (index + 1 < Size) && (value >= limit);
+       limit *= 2) {
+    ++index;
+  }
+
+  ++bucket[index];
+}
+
+void histogram::clear()
+{
+  count = 0;
+  sum = 0;
+  sum_square = 0;
+  min = 0;
+  max = 0;
+
+  for (std::size_t i=0; i<Size; ++i) {
+    bucket[i] = 0;
+  }
+}
+
+double histogram::mean() const
+{
+  if (0 == count) {
+    return 0;
+  }
+
+  return sum / static_cast<double>(count);
+}
+
+double histogram::deviation() const
+{
+  if (count < 2) {
+    return 0;
+  }
+
+  const double m = mean();
+  const double variance = sum_square / static_cast<double>(count) - m * m;
+
+  return (variance > 0) ? std::sqrt(variance) : 0;
+}
+
+
+client_statistics::client_statistics()
+{
+  clear();
+}
+
+void client_statistics::clear()
+{
+  bytes = 0;
+  messages = 0;
+  receive_calls = 0;
+  partial_reads = 0;
+  xml_messages = 0;
+  last_arrival = 0;
+  interval.clear();
+}
+
+
+sampler_statistics::sampler_statistics()
+{
+  clear();
+}
+
+void sampler_statistics::clear()
+{
+  stored = 0;
+  delivered = 0;
+  depth_max = 0;
+  dwell.clear();
+}
+
+}}} // namespace Motion::SDK::detail
@@ -0,0 +1,1158 @@
+/**
+  Implementation of the batch math kernels. See the header file for more
+  details.
+
+  @file    tools/sdk/cpp/src/kernel.cpp
+  @author  Luke Tokheim, luke@motionnode.com
+  @version 2.2
+
+  Copyright (c) 2015, Motion Workshop
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <detail/kernel.hpp>
+
+#include <cmath>
+
+// Use the vectorized kernels unless the client application asks for the
+// portable scalar versions only.
+#if !defined(MOTION_SDK_KERNEL_SCALAR)
+#  if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+      defined(_M_IX86)
+#    define MOTION_SDK_KERNEL_X86 1
+#  elif defined(__aarch64__) && defined(__ARM_NEON)
+#    define MOTION_SDK_KERNEL_NEON 1
+#  endif
+#endif  // MOTION_SDK_KERNEL_SCALAR
+
+#if MOTION_SDK_KERNEL_X86
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif  // _MSC_VER
+#  include <immintrin.h>
+#elif MOTION_SDK_KERNEL_NEON
+#  include <arm_neon.h>
+#endif  // MOTION_SDK_KERNEL_X86
+
+// GCC and Clang only allow instruction set specific intrinsics in functions
+// that are compiled for that instruction set. Visual C++ allows them anywhere.
+#if defined(__GNUC__)
+#  define MOTION_SDK_TARGET(name) __attribute__((target(name)))
+#else
+#  define MOTION_SDK_TARGET(name)
+#endif  // __GNUC__
+
+
+namespace Motion { namespace SDK { namespace detail {
+
+namespace {
+
+/**
+  Quaternions with a squared length smaller than this are treated as zero
+  length.
+*/
+const float MinimumNormSquared = 1e-6f;
+
+const float Pi = 3.14159265358979323846f;
+
+/**
+  Signature shared by all of the kernel implementations.
+*/
+typedef void (*kernel_function)(const float *, const float *, const float *,
+                                const float *, const std::size_t &, float *);
+
+/**
+  Signature of the slerp kernel implementations.
+*/
+typedef void (*slerp_function)(const float *, const float *,
+                               const std::size_t &, const float &, float *);
+
+/**
+  Polynomial approximation of slerp from "A Fast and Accurate Algorithm for
+  Computing SLERP", David Eberly, 2011. Only multiply and add, no
+  trigonometric functions or branches, so it vectorizes. The last term
+  includes the correction factor for single precision.
+*/
+const float SlerpOnePlusMu = 1.90110745351730037f;
+
+const float SlerpU[8] = {
+  1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9),
+  1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15),
+  SlerpOnePlusMu / (8 * 17)
+};
+
+const float SlerpV[8] = {
+  1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13, 7.0f / 15,
+  SlerpOnePlusMu * 8 / 17
+};
+
+/**
+  The polynomial coefficients only depend on the interpolation parameter,
+  which is the same for every quaternion in a batch.
+*/
+class slerp_coefficient {
+ public:
+  explicit slerp_coefficient(const float &value)
+    : t(value), d(1 - value)
+  {
+    for (std::size_t i=0; i<8; ++i) {
+      ct[i] = SlerpU[i] * t * t - SlerpV[i];
+      cd[i] = SlerpU[i] * d * d - SlerpV[i];
+    }
+  }
+
+  float t;
+  float d;
+  float ct[8];
+  float cd[8];
+}; // class slerp_coefficient
+
+/**
+  Scalar implementation of a single quaternion to rotation matrix conversion.
+  Ported from the Boost.Quaternion library at:
+  http://www.boost.org/libs/math/quaternion/HSO3.hpp
+*/
+inline void quaternion_to_matrix_one(const float &a, const float &b,
+                                     const float &c, const float &d,
+                                     float *result)
+{
+  for (std::size_t i=0; i<16; ++i) {
+    result[i] = 0;
+  }
+  result[0] = result[5] = result[10] = result[15] = 1;
+
+  const float aa = a*a;
+  const float ab = a*b;
+  const float ac = a*c;
+  const float ad = a*d;
+  const float bb = b*b;
+  const float bc = b*c;
+  const float bd = b*d;
+  const float cc = c*c;
+  const float cd = c*d;
+  const float dd = d*d;
+
+  const float norme_carre = aa+bb+cc+dd;
+
+  if (norme_carre > MinimumNormSquared) {
+    result[0] = (aa+bb-cc-dd)/norme_carre;
+    result[1] = 2*(-ad+bc)/norme_carre;
+    result[2] = 2*(ac+bd)/norme_carre;
+    result[4] = 2*(ad+bc)/norme_carre;
+    result[5] = (aa-bb+cc-dd)/norme_carre;
+    result[6] = 2*(-ab+cd)/norme_carre;
+    result[8] = 2*(-ac+bd)/norme_carre;
+    result[9] = 2*(ab+cd)/norme_carre;
+    result[10] = (aa-bb-cc+dd)/norme_carre;
+  }
+}
+
+/**
+  Scalar implementation of a single quaternion to Euler angle conversion. Uses
+  the terms of the rotation matrix above, <tt>R = Rz * Ry * Rx</tt>.
+*/
+inline void quaternion_to_euler_one(const float &a, const float &b,
+                                    const float &c, const float &d,
+                                    float &rx, float &ry, float &rz)
+{
+  rx = ry = rz = 0;
+
+  const float aa = a*a;
+  const float bb = b*b;
+  const float cc = c*c;
+  const float dd = d*d;
+
+  const float norme_carre = aa+bb+cc+dd;
+
+  if (norme_carre > MinimumNormSquared) {
+    float sin_y = 2*(a*c-b*d)/norme_carre;
+    if (sin_y > 1) {
+      sin_y = 1;
+    } else if (sin_y < -1) {
+      sin_y = -1;
+    }
+
+    rx = std::atan2(2*(a*b+c*d), aa-bb-cc+dd);
+    ry = std::asin(sin_y);
+    rz = std::atan2(2*(a*d+b*c), aa+bb-cc-dd);
+  }
+}
+
+void quaternion_to_matrix_scalar(const float *w, const float *x,
+                                 const float *y, const float *z,
+                                 const std::size_t &n, float *result)
+{
+  for (std::size_t i=0; i<n; ++i) {
+    quaternion_to_matrix_one(w[i], x[i], y[i], z[i], result + 16 * i);
+  }
+}
+
+void quaternion_to_euler_scalar(const float *w, const float *x,
+                                const float *y, const float *z,
+                                const std::size_t &n, float *result)
+{
+  for (std::size_t i=0; i<n; ++i) {
+    quaternion_to_euler_one(
+      w[i], x[i], y[i], z[i], result[i], result[n + i], result[2 * n + i]);
+  }
+}
+
+/**
+  Scalar implementation of a single slerp. Interpolate along the shorter arc,
+  negate <tt>b</tt> if the quaternions are more than 90 degrees apart.
+*/
+inline void quaternion_slerp_one(const slerp_coefficient &c, const float *a,
+                                 const float *b, const std::size_t &n,
+                                 const std::size_t &i, float *result)
+{
+  float dot =
+    a[i] * b[i] + a[n + i] * b[n + i] + a[2 * n + i] * b[2 * n + i] +
+    a[3 * n + i] * b[3 * n + i];
+
+  float sign = 1;
+  if (dot < 0) {
+    dot = -dot;
+    sign = -1;
+  }
+
+  const float xm1 = dot - 1;
+
+  float ct = 1;
+  float cd = 1;
+  for (std::size_t k=8; k>0; --k) {
+    ct = 1 + c.ct[k - 1] * xm1 * ct;
+    cd = 1 + c.cd[k - 1] * xm1 * cd;
+  }
+  ct *= c.t * sign;
+  cd *= c.d;
+
+  for (std::size_t j=0; j<4; ++j) {
+    result[j * n + i] = cd * a[j * n + i] + ct * b[j * n + i];
+  }
+}
+
+void quaternion_slerp_scalar(const float *a, const float *b,
+                             const std::size_t &n, const float &t,
+                             float *result)
+{
+  const slerp_coefficient c(t);
+  for (std::size_t i=0; i<n; ++i) {
+    quaternion_slerp_one(c, a, b, n, i, result);
+  }
+}
+
+#if MOTION_SDK_KERNEL_X86
+
+/**
+  SSE2 helpers. Four quaternions per iteration.
+*/
+MOTION_SDK_TARGET("sse2")
+inline __m128 select_sse(const __m128 &mask, const __m128 &a, const __m128 &b)
+{
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/**
+  Polynomial approximation of atan(x), ported from the Cephes Math Library
+  atanf function. Accurate to about 2 units in the last place.
+*/
+MOTION_SDK_TARGET("sse2")
+inline __m128 atan_sse(const __m128 &value)
+{
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  const __m128 sign = _mm_and_ps(value, sign_mask);
+  const __m128 x = _mm_andnot_ps(sign_mask, value);
+
+  // Range reduction, tan(3*pi/8) and tan(pi/8).
+  const __m128 large = _mm_cmpgt_ps(x, _mm_set1_ps(2.414213562373095f));
+  const __m128 medium = _mm_andnot_ps(
+    large, _mm_cmpgt_ps(x, _mm_set1_ps(0.4142135623730950f)));
+
+  const __m128 x_large = _mm_div_ps(_mm_set1_ps(-1.0f), x);
+  const __m128 x_medium = _mm_div_ps(_mm_sub_ps(x, one), _mm_add_ps(x, one));
+
+  const __m128 xr = select_sse(large, x_large, select_sse(medium, x_medium, x));
+  const __m128 y0 = _mm_or_ps(
+    _mm_and_ps(large, _mm_set1_ps(Pi / 2)),
+    _mm_and_ps(medium, _mm_set1_ps(Pi / 4)));
+
+  const __m128 z = _mm_mul_ps(xr, xr);
+  __m128 p = _mm_set1_ps(8.05374449538e-2f);
+  p = _mm_sub_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.38776856032e-1f));
+  p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.99777106478e-1f));
+  p = _mm_sub_ps(_mm_mul_ps(p, z), _mm_set1_ps(3.33329491539e-1f));
+  p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), xr), xr);
+
+  return _mm_xor_ps(_mm_add_ps(y0, p), sign);
+}
+
+MOTION_SDK_TARGET("sse2")
+inline __m128 atan2_sse(const __m128 &y, const __m128 &x)
+{
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 pi = _mm_set1_ps(Pi);
+  const __m128 half_pi = _mm_set1_ps(Pi / 2);
+
+  __m128 result = atan_sse(_mm_div_ps(y, x));
+
+  // Left half plane, add or subtract pi.
+  const __m128 offset = select_sse(
+    _mm_cmpge_ps(y, zero), pi, _mm_sub_ps(zero, pi));
+  result = _mm_add_ps(
+    result, _mm_and_ps(_mm_cmplt_ps(x, zero), offset));
+
+  // On the y axis, including the origin.
+  const __m128 axis = _mm_or_ps(
+    _mm_and_ps(_mm_cmpgt_ps(y, zero), half_pi),
+    _mm_and_ps(_mm_cmplt_ps(y, zero), _mm_sub_ps(zero, half_pi)));
+
+  return select_sse(_mm_cmpeq_ps(x, zero), axis, result);
+}
+
+/**
+  Store four matrix entries <tt>{m[k], m[k+1], m[k+2], m[k+3]}</tt> of four
+  consecutive quaternions. Transpose from one register per entry to one
+  register per matrix.
+*/
+MOTION_SDK_TARGET("sse2")
+inline void store_sse(float *result, __m128 r0, __m128 r1, __m128 r2,
+                      __m128 r3)
+{
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_storeu_ps(result, r0);
+  _mm_storeu_ps(result + 16, r1);
+  _mm_storeu_ps(result + 32, r2);
+  _mm_storeu_ps(result + 48, r3);
+}
+
+MOTION_SDK_TARGET("sse2")
+void quaternion_to_matrix_sse(const float *w, const float *x, const float *y,
+                              const float *z, const std::size_t &n,
+                              float *result)
+{
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 minimum = _mm_set1_ps(MinimumNormSquared);
+
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128 a = _mm_loadu_ps(w + i);
+    const __m128 b = _mm_loadu_ps(x + i);
+    const __m128 c = _mm_loadu_ps(y + i);
+    const __m128 d = _mm_loadu_ps(z + i);
+
+    const __m128 aa = _mm_mul_ps(a, a);
+    const __m128 ab = _mm_mul_ps(a, b);
+    const __m128 ac = _mm_mul_ps(a, c);
+    const __m128 ad = _mm_mul_ps(a, d);
+    const __m128 bb = _mm_mul_ps(b, b);
+    const __m128 bc = _mm_mul_ps(b, c);
+    const __m128 bd = _mm_mul_ps(b, d);
+    const __m128 cc = _mm_mul_ps(c, c);
+    const __m128 cd = _mm_mul_ps(c, d);
+    const __m128 dd = _mm_mul_ps(d, d);
+
+    const __m128 norm = _mm_add_ps(_mm_add_ps(_mm_add_ps(aa, bb), cc), dd);
+    const __m128 valid = _mm_cmpgt_ps(norm, minimum);
+
+    // Same order of operations as the scalar version.
+    const __m128 m0 = select_sse(valid, _mm_div_ps(
+      _mm_sub_ps(_mm_sub_ps(_mm_add_ps(aa, bb), cc), dd), norm), one);
+    const __m128 m1 = _mm_and_ps(valid, _mm_div_ps(
+      _mm_mul_ps(two, _mm_sub_ps(bc, ad)), norm));
+    const __m128 m2 = _mm_and_ps(valid, _mm_div_ps(
+      _mm_mul_ps(two, _mm_add_ps(ac, bd)), norm));
+    const __m128 m4 = _mm_and_ps(valid, _mm_div_ps(
+      _mm_mul_ps(two, _mm_add_ps(ad, bc)), norm));
+    const __m128 m5 = select_sse(valid, _mm_div_ps(
+      _mm_sub_ps(_mm_add_ps(_mm_sub_ps(aa, bb), cc), dd), norm), one);
+    const __m128 m6 = _mm_and_ps(valid, _mm_div_ps(
+      _mm_mul_ps(two, _mm_sub_ps(cd, ab)), norm));
+    const __m128 m8 = _mm_and_ps(valid, _mm_div_ps(
+      _mm_mul_ps(two, _mm_sub_ps(bd, ac)), norm));
+    const __m128 m9 = _mm_and_ps(valid, _mm_div_ps(
+      _mm_mul_ps(two, _mm_add_ps(ab, cd)), norm));
+    const __m128 m10 = select_sse(valid, _mm_div_ps(
+      _mm_add_ps(_mm_sub_ps(_mm_sub_ps(aa, bb), cc), dd), norm), one);
+
+    float *matrix = result + 16 * i;
+    store_sse(matrix, m0, m1, m2, zero);
+    store_sse(matrix + 4, m4, m5, m6, zero);
+    store_sse(matrix + 8, m8, m9, m10, zero);
+    store_sse(matrix + 12, zero, zero, zero, one);
+  }
+
+  quaternion_to_matrix_scalar(
+    w + i, x + i, y + i, z + i, n - i, result + 16 * i);
+}
+
+MOTION_SDK_TARGET("sse2")
+void quaternion_to_euler_sse(const float *w, const float *x, const float *y,
+                             const float *z, const std::size_t &n,
+                             float *result)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 minimum = _mm_set1_ps(MinimumNormSquared);
+
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128 a = _mm_loadu_ps(w + i);
+    const __m128 b = _mm_loadu_ps(x + i);
+    const __m128 c = _mm_loadu_ps(y + i);
+    const __m128 d = _mm_loadu_ps(z + i);
+
+    const __m128 aa = _mm_mul_ps(a, a);
+    const __m128 bb = _mm_mul_ps(b, b);
+    const __m128 cc = _mm_mul_ps(c, c);
+    const __m128 dd = _mm_mul_ps(d, d);
+
+    const __m128 norm = _mm_add_ps(_mm_add_ps(_mm_add_ps(aa, bb), cc), dd);
+    const __m128 valid = _mm_cmpgt_ps(norm, minimum);
+
+    __m128 sin_y = _mm_div_ps(
+      _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(a, c), _mm_mul_ps(b, d))), norm);
+    sin_y = _mm_max_ps(_mm_min_ps(sin_y, one), _mm_sub_ps(_mm_setzero_ps(), one));
+
+    const __m128 rx = atan2_sse(
+      _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(a, b), _mm_mul_ps(c, d))),
+      _mm_add_ps(_mm_sub_ps(_mm_sub_ps(aa, bb), cc), dd));
+    const __m128 ry = atan2_sse(
+      sin_y, _mm_sqrt_ps(_mm_sub_ps(one, _mm_mul_ps(sin_y, sin_y))));
+    const __m128 rz = atan2_sse(
+      _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(a, d), _mm_mul_ps(b, c))),
+      _mm_sub_ps(_mm_sub_ps(_mm_add_ps(aa, bb), cc), dd));
+
+    _mm_storeu_ps(result + i, _mm_and_ps(valid, rx));
+    _mm_storeu_ps(result + n + i, _mm_and_ps(valid, ry));
+    _mm_storeu_ps(result + 2 * n + i, _mm_and_ps(valid, rz));
+  }
+
+  for (; i<n; ++i) {
+    quaternion_to_euler_one(
+      w[i], x[i], y[i], z[i], result[i], result[n + i], result[2 * n + i]);
+  }
+}
+
+MOTION_SDK_TARGET("sse2")
+void quaternion_slerp_sse(const float *a, const float *b,
+                          const std::size_t &n, const float &t, float *result)
+{
+  const slerp_coefficient c(t);
+
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 vt = _mm_set1_ps(c.t);
+  const __m128 vd = _mm_set1_ps(c.d);
+
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 qa[4];
+    __m128 qb[4];
+    for (std::size_t j=0; j<4; ++j) {
+      qa[j] = _mm_loadu_ps(a + j * n + i);
+      qb[j] = _mm_loadu_ps(b + j * n + i);
+    }
+
+    const __m128 dot = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(qa[0], qb[0]), _mm_mul_ps(qa[1], qb[1])),
+      _mm_add_ps(_mm_mul_ps(qa[2], qb[2]), _mm_mul_ps(qa[3], qb[3])));
+
+    // Shorter arc. Move the sign of the dot product on to the b weight.
+    const __m128 sign = _mm_and_ps(dot, sign_mask);
+    const __m128 xm1 = _mm_sub_ps(_mm_andnot_ps(sign_mask, dot), one);
+
+    __m128 ct = one;
+    __m128 cd = one;
+    for (std::size_t k=8; k>0; --k) {
+      ct = _mm_add_ps(
+        one, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(c.ct[k - 1]), xm1), ct));
+      cd = _mm_add_ps(
+        one, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(c.cd[k - 1]), xm1), cd));
+    }
+    ct = _mm_xor_ps(_mm_mul_ps(ct, vt), sign);
+    cd = _mm_mul_ps(cd, vd);
+
+    for (std::size_t j=0; j<4; ++j) {
+      _mm_storeu_ps(
+        result + j * n + i,
+        _mm_add_ps(_mm_mul_ps(cd, qa[j]), _mm_mul_ps(ct, qb[j])));
+    }
+  }
+
+  for (; i<n; ++i) {
+    quaternion_slerp_one(c, a, b, n, i, result);
+  }
+}
+
+/**
+  AVX2 helpers. Eight quaternions per iteration.
+*/
+MOTION_SDK_TARGET("avx2")
+inline __m256 select_avx(const __m256 &mask, const __m256 &a, const __m256 &b)
+{
+  return _mm256_blendv_ps(b, a, mask);
+}
+
+/** @see atan_sse */
+MOTION_SDK_TARGET("avx2")
+inline __m256 atan_avx(const __m256 &value)
+{
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+  const __m256 one = _mm256_set1_ps(1.0f);
+
+  const __m256 sign = _mm256_and_ps(value, sign_mask);
+  const __m256 x = _mm256_andnot_ps(sign_mask, value);
+
+  const __m256 large = _mm256_cmp_ps(
+    x, _mm256_set1_ps(2.414213562373095f), _CMP_GT_OQ);
+  const __m256 medium = _mm256_andnot_ps(large, _mm256_cmp_ps(
+    x, _mm256_set1_ps(0.4142135623730950f), _CMP_GT_OQ));
+
+  const __m256 x_large = _mm256_div_ps(_mm256_set1_ps(-1.0f), x);
+  const __m256 x_medium = _mm256_div_ps(
+    _mm256_sub_ps(x, one), _mm256_add_ps(x, one));
+
+  const __m256 xr = select_avx(
+    large, x_large, select_avx(medium, x_medium, x));
+  const __m256 y0 = _mm256_or_ps(
+    _mm256_and_ps(large, _mm256_set1_ps(Pi / 2)),
+    _mm256_and_ps(medium, _mm256_set1_ps(Pi / 4)));
+
+  const __m256 z = _mm256_mul_ps(xr, xr);
+  __m256 p = _mm256_set1_ps(8.05374449538e-2f);
+  p = _mm256_sub_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(1.38776856032e-1f));
+  p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(1.99777106478e-1f));
+  p = _mm256_sub_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(3.33329491539e-1f));
+  p = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(p, z), xr), xr);
+
+  return _mm256_xor_ps(_mm256_add_ps(y0, p), sign);
+}
+
+/** @see atan2_sse */
+MOTION_SDK_TARGET("avx2")
+inline __m256 atan2_avx(const __m256 &y, const __m256 &x)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 pi = _mm256_set1_ps(Pi);
+  const __m256 half_pi = _mm256_set1_ps(Pi / 2);
+
+  __m256 result = atan_avx(_mm256_div_ps(y, x));
+
+  const __m256 offset = select_avx(
+    _mm256_cmp_ps(y, zero, _CMP_GE_OQ), pi, _mm256_sub_ps(zero, pi));
+  result = _mm256_add_ps(
+    result, _mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_LT_OQ), offset));
+
+  const __m256 axis = _mm256_or_ps(
+    _mm256_and_ps(_mm256_cmp_ps(y, zero, _CMP_GT_OQ), half_pi),
+    _mm256_and_ps(
+      _mm256_cmp_ps(y, zero, _CMP_LT_OQ), _mm256_sub_ps(zero, half_pi)));
+
+  return select_avx(_mm256_cmp_ps(x, zero, _CMP_EQ_OQ), axis, result);
+}
+
+/**
+  Store four matrix entries of eight consecutive quaternions. Transpose in
+  each 128-bit lane, the low lane holds quaternions 0-3 and the high lane
+  holds quaternions 4-7.
+*/
+MOTION_SDK_TARGET("avx2")
+inline void store_avx(float *result, const __m256 &a, const __m256 &b,
+                      const __m256 &c, const __m256 &d)
+{
+  const __m256 t0 = _mm256_unpacklo_ps(a, b);
+  const __m256 t1 = _mm256_unpackhi_ps(a, b);
+  const __m256 t2 = _mm256_unpacklo_ps(c, d);
+  const __m256 t3 = _mm256_unpackhi_ps(c, d);
+
+  const __m256 r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  const __m256 r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+  _mm_storeu_ps(result, _mm256_castps256_ps128(r0));
+  _mm_storeu_ps(result + 16, _mm256_castps256_ps128(r1));
+  _mm_storeu_ps(result + 32, _mm256_castps256_ps128(r2));
+  _mm_storeu_ps(result + 48, _mm256_castps256_ps128(r3));
+  _mm_storeu_ps(result + 64, _mm256_extractf128_ps(r0, 1));
+  _mm_storeu_ps(result + 80, _mm256_extractf128_ps(r1, 1));
+  _mm_storeu_ps(result + 96, _mm256_extractf128_ps(r2, 1));
+  _mm_storeu_ps(result + 112, _mm256_extractf128_ps(r3, 1));
+}
+
+MOTION_SDK_TARGET("avx2")
+void quaternion_to_matrix_avx(const float *w, const float *x, const float *y,
+                              const float *z, const std::size_t &n,
+                              float *result)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  const __m256 minimum = _mm256_set1_ps(MinimumNormSquared);
+
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 a = _mm256_loadu_ps(w + i);
+    const __m256 b = _mm256_loadu_ps(x + i);
+    const __m256 c = _mm256_loadu_ps(y + i);
+    const __m256 d = _mm256_loadu_ps(z + i);
+
+    const __m256 aa = _mm256_mul_ps(a, a);
+    const __m256 ab = _mm256_mul_ps(a, b);
+    const __m256 ac = _mm256_mul_ps(a, c);
+    const __m256 ad = _mm256_mul_ps(a, d);
+    const __m256 bb = _mm256_mul_ps(b, b);
+    const __m256 bc = _mm256_mul_ps(b, c);
+    const __m256 bd = _mm256_mul_ps(b, d);
+    const __m256 cc = _mm256_mul_ps(c, c);
+    const __m256 cd = _mm256_mul_ps(c, d);
+    const __m256 dd = _mm256_mul_ps(d, d);
+
+    const __m256 norm = _mm256_add_ps(
+      _mm256_add_ps(_mm256_add_ps(aa, bb), cc), dd);
+    const __m256 valid = _mm256_cmp_ps(norm, minimum, _CMP_GT_OQ);
+
+    const __m256 m0 = select_avx(valid, _mm256_div_ps(
+      _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(aa, bb), cc), dd), norm), one);
+    const __m256 m1 = _mm256_and_ps(valid, _mm256_div_ps(
+      _mm256_mul_ps(two, _mm256_sub_ps(bc, ad)), norm));
+    const __m256 m2 = _mm256_and_ps(valid, _mm256_div_ps(
+      _mm256_mul_ps(two, _mm256_add_ps(ac, bd)), norm));
+    const __m256 m4 = _mm256_and_ps(valid, _mm256_div_ps(
+      _mm256_mul_ps(two, _mm256_add_ps(ad, bc)), norm));
+    const __m256 m5 = select_avx(valid, _mm256_div_ps(
+      _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(aa, bb), cc), dd), norm), one);
+    const __m256 m6 = _mm256_and_ps(valid, _mm256_div_ps(
+      _mm256_mul_ps(two, _mm256_sub_ps(cd, ab)), norm));
+    const __m256 m8 = _mm256_and_ps(valid, _mm256_div_ps(
+      _mm256_mul_ps(two, _mm256_sub_ps(bd, ac)), norm));
+    const __m256 m9 = _mm256_and_ps(valid, _mm256_div_ps(
+      _mm256_mul_ps(two, _mm256_add_ps(ab, cd)), norm));
+    const __m256 m10 = select_avx(valid, _mm256_div_ps(
+      _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(aa, bb), cc), dd), norm), one);
+
+    float *matrix = result + 16 * i;
+    store_avx(matrix, m0, m1, m2, zero);
+    store_avx(matrix + 4, m4, m5, m6, zero);
+    store_avx(matrix + 8, m8, m9, m10, zero);
+    store_avx(matrix + 12, zero, zero, zero, one);
+  }
+
+  quaternion_to_matrix_sse(w + i, x + i, y + i, z + i, n - i, result + 16 * i);
+}
+
+MOTION_SDK_TARGET("avx2")
+void quaternion_to_euler_avx(const float *w, const float *x, const float *y,
+                             const float *z, const std::size_t &n,
+                             float *result)
+{
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  const __m256 minimum = _mm256_set1_ps(MinimumNormSquared);
+
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 a = _mm256_loadu_ps(w + i);
+    const __m256 b = _mm256_loadu_ps(x + i);
+    const __m256 c = _mm256_loadu_ps(y + i);
+    const __m256 d = _mm256_loadu_ps(z + i);
+
+    const __m256 aa = _mm256_mul_ps(a, a);
+    const __m256 bb = _mm256_mul_ps(b, b);
+    const __m256 cc = _mm256_mul_ps(c, c);
+    const __m256 dd = _mm256_mul_ps(d, d);
+
+    const __m256 norm = _mm256_add_ps(
+      _mm256_add_ps(_mm256_add_ps(aa, bb), cc), dd);
+    const __m256 valid = _mm256_cmp_ps(norm, minimum, _CMP_GT_OQ);
+
+    __m256 sin_y = _mm256_div_ps(_mm256_mul_ps(two, _mm256_sub_ps(
+      _mm256_mul_ps(a, c), _mm256_mul_ps(b, d))), norm);
+    sin_y = _mm256_max_ps(
+      _mm256_min_ps(sin_y, one), _mm256_sub_ps(_mm256_setzero_ps(), one));
+
+    const __m256 rx = atan2_avx(
+      _mm256_mul_ps(two, _mm256_add_ps(
+        _mm256_mul_ps(a, b), _mm256_mul_ps(c, d))),
+      _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(aa, bb), cc), dd));
+    const __m256 ry = atan2_avx(
+      sin_y, _mm256_sqrt_ps(_mm256_sub_ps(one, _mm256_mul_ps(sin_y, sin_y))));
+    const __m256 rz = atan2_avx(
+      _mm256_mul_ps(two, _mm256_add_ps(
+        _mm256_mul_ps(a, d), _mm256_mul_ps(b, c))),
+      _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(aa, bb), cc), dd));
+
+    _mm256_storeu_ps(result + i, _mm256_and_ps(valid, rx));
+    _mm256_storeu_ps(result + n + i, _mm256_and_ps(valid, ry));
+    _mm256_storeu_ps(result + 2 * n + i, _mm256_and_ps(valid, rz));
+  }
+
+  for (; i<n; ++i) {
+    quaternion_to_euler_one(
+      w[i], x[i], y[i], z[i], result[i], result[n + i], result[2 * n + i]);
+  }
+}
+
+MOTION_SDK_TARGET("avx2")
+void quaternion_slerp_avx(const float *a, const float *b,
+                          const std::size_t &n, const float &t, float *result)
+{
+  const slerp_coefficient c(t);
+
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 vt = _mm256_set1_ps(c.t);
+  const __m256 vd = _mm256_set1_ps(c.d);
+
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 qa[4];
+    __m256 qb[4];
+    for (std::size_t j=0; j<4; ++j) {
+      qa[j] = _mm256_loadu_ps(a + j * n + i);
+      qb[j] = _mm256_loadu_ps(b + j * n + i);
+    }
+
+    const __m256 dot = _mm256_add_ps(
+      _mm256_add_ps(_mm256_mul_ps(qa[0], qb[0]), _mm256_mul_ps(qa[1], qb[1])),
+      _mm256_add_ps(_mm256_mul_ps(qa[2], qb[2]), _mm256_mul_ps(qa[3], qb[3])));
+
+    const __m256 sign = _mm256_and_ps(dot, sign_mask);
+    const __m256 xm1 = _mm256_sub_ps(_mm256_andnot_ps(sign_mask, dot), one);
+
+    __m256 ct = one;
+    __m256 cd = one;
+    for (std::size_t k=8; k>0; --k) {
+      ct = _mm256_add_ps(
+        one,
+        _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(c.ct[k - 1]), xm1), ct));
+      cd = _mm256_add_ps(
+        one,
+        _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(c.cd[k - 1]), xm1), cd));
+    }
+    ct = _mm256_xor_ps(_mm256_mul_ps(ct, vt), sign);
+    cd = _mm256_mul_ps(cd, vd);
+
+    for (std::size_t j=0; j<4; ++j) {
+      _mm256_storeu_ps(
+        result + j * n + i,
+        _mm256_add_ps(_mm256_mul_ps(cd, qa[j]), _mm256_mul_ps(ct, qb[j])));
+    }
+  }
+
+  for (; i<n; ++i) {
+    quaternion_slerp_one(c, a, b, n, i, result);
+  }
+}
+
+/**
+  Query the processor for SSE2 and AVX2 support. AVX2 also requires that the
+  operating system saves the full register state.
+*/
+void get_x86_features(bool &sse2, bool &avx2)
+{
+  sse2 = avx2 = false;
+
+  unsigned regs[4] = {0, 0, 0, 0};
+  unsigned regs7[4] = {0, 0, 0, 0};
+  // Only the low word of XCR0 holds the XMM and YMM state bits.
+  unsigned xcr0 = 0;
+
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  const int max_leaf = info[0];
+
+  __cpuid(info, 1);
+  for (int i=0; i<4; ++i) {
+    regs[i] = static_cast<unsigned>(info[i]);
+  }
+
+  if (max_leaf >= 7) {
+    __cpuidex(info, 7, 0);
+    for (int i=0; i<4; ++i) {
+      regs7[i] = static_cast<unsigned>(info[i]);
+    }
+  }
+
+  if (regs[2] & (1u << 27)) {
+    xcr0 = static_cast<unsigned>(_xgetbv(0));
+  }
+#else
+  const unsigned max_leaf = __get_cpuid_max(0, NULL);
+  if (max_leaf < 1) {
+    return;
+  }
+
+  __cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+
+  if (max_leaf >= 7) {
+    __cpuid_count(7, 0, regs7[0], regs7[1], regs7[2], regs7[3]);
+  }
+
+  if (regs[2] & (1u << 27)) {
+    unsigned eax = 0;
+    unsigned edx = 0;
+    __asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    xcr0 = eax;
+  }
+#endif  // _MSC_VER
+
+  // CPUID.1:EDX.SSE2[bit 26]
+  sse2 = 0 != (regs[3] & (1u << 26));
+
+  // CPUID.1:ECX.AVX[bit 28], CPUID.7.0:EBX.AVX2[bit 5], and the OS saves the
+  // XMM and YMM state.
+  avx2 =
+    (0 != (regs[2] & (1u << 28))) && (0 != (regs7[1] & (1u << 5))) &&
+    (6 == (xcr0 & 6));
+}
+
+#elif MOTION_SDK_KERNEL_NEON
+
+/**
+  NEON helpers. Four quaternions per iteration.
+*/
+inline float32x4_t atan_neon(const float32x4_t &value)
+{
+  const float32x4_t one = vdupq_n_f32(1.0f);
+
+  const float32x4_t x = vabsq_f32(value);
+
+  const uint32x4_t large = vcgtq_f32(x, vdupq_n_f32(2.414213562373095f));
+  const uint32x4_t medium = vbicq_u32(
+    vcgtq_f32(x, vdupq_n_f32(0.4142135623730950f)), large);
+
+  const float32x4_t x_large = vdivq_f32(vdupq_n_f32(-1.0f), x);
+  const float32x4_t x_medium = vdivq_f32(vsubq_f32(x, one), vaddq_f32(x, one));
+
+  const float32x4_t xr = vbslq_f32(
+    large, x_large, vbslq_f32(medium, x_medium, x));
+  const float32x4_t y0 = vbslq_f32(
+    large, vdupq_n_f32(Pi / 2),
+    vbslq_f32(medium, vdupq_n_f32(Pi / 4), vdupq_n_f32(0.0f)));
+
+  const float32x4_t z = vmulq_f32(xr, xr);
+  float32x4_t p = vdupq_n_f32(8.05374449538e-2f);
+  p = vsubq_f32(vmulq_f32(p, z), vdupq_n_f32(1.38776856032e-1f));
+  p = vaddq_f32(vmulq_f32(p, z), vdupq_n_f32(1.99777106478e-1f));
+  p = vsubq_f32(vmulq_f32(p, z), vdupq_n_f32(3.33329491539e-1f));
+  p = vaddq_f32(vmulq_f32(vmulq_f32(p, z), xr), xr);
+
+  // Copy the sign bit of the input.
+  const uint32x4_t sign_mask = vdupq_n_u32(0x80000000u);
+  return vbslq_f32(sign_mask, value, vaddq_f32(y0, p));
+}
+
+inline float32x4_t atan2_neon(const float32x4_t &y, const float32x4_t &x)
+{
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t pi = vdupq_n_f32(Pi);
+  const float32x4_t half_pi = vdupq_n_f32(Pi / 2);
+
+  float32x4_t result = atan_neon(vdivq_f32(y, x));
+
+  const float32x4_t offset = vbslq_f32(vcgeq_f32(y, zero), pi, vnegq_f32(pi));
+  result = vaddq_f32(result, vbslq_f32(vcltq_f32(x, zero), offset, zero));
+
+  const float32x4_t axis = vbslq_f32(
+    vcgtq_f32(y, zero), half_pi,
+    vbslq_f32(vcltq_f32(y, zero), vnegq_f32(half_pi), zero));
+
+  return vbslq_f32(vceqq_f32(x, zero), axis, result);
+}
+
+/** @see store_sse */
+inline void store_neon(float *result, const float32x4_t &a,
+                       const float32x4_t &b, const float32x4_t &c,
+                       const float32x4_t &d)
+{
+  const float32x4x2_t ac = vzipq_f32(a, c);
+  const float32x4x2_t bd = vzipq_f32(b, d);
+  const float32x4x2_t r01 = vzipq_f32(ac.val[0], bd.val[0]);
+  const float32x4x2_t r23 = vzipq_f32(ac.val[1], bd.val[1]);
+
+  vst1q_f32(result, r01.val[0]);
+  vst1q_f32(result + 16, r01.val[1]);
+  vst1q_f32(result + 32, r23.val[0]);
+  vst1q_f32(result + 48, r23.val[1]);
+}
+
+void quaternion_to_matrix_neon(const float *w, const float *x, const float *y,
+                               const float *z, const std::size_t &n,
+                               float *result)
+{
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  const float32x4_t two = vdupq_n_f32(2.0f);
+  const float32x4_t minimum = vdupq_n_f32(MinimumNormSquared);
+
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t a = vld1q_f32(w + i);
+    const float32x4_t b = vld1q_f32(x + i);
+    const float32x4_t c = vld1q_f32(y + i);
+    const float32x4_t d = vld1q_f32(z + i);
+
+    const float32x4_t aa = vmulq_f32(a, a);
+    const float32x4_t ab = vmulq_f32(a, b);
+    const float32x4_t ac = vmulq_f32(a, c);
+    const float32x4_t ad = vmulq_f32(a, d);
+    const float32x4_t bb = vmulq_f32(b, b);
+    const float32x4_t bc = vmulq_f32(b, c);
+    const float32x4_t bd = vmulq_f32(b, d);
+    const float32x4_t cc = vmulq_f32(c, c);
+    const float32x4_t cd = vmulq_f32(c, d);
+    const float32x4_t dd = vmulq_f32(d, d);
+
+    const float32x4_t norm = vaddq_f32(vaddq_f32(vaddq_f32(aa, bb), cc), dd);
+    const uint32x4_t valid = vcgtq_f32(norm, minimum);
+
+    const float32x4_t m0 = vbslq_f32(valid, vdivq_f32(
+      vsubq_f32(vsubq_f32(vaddq_f32(aa, bb), cc), dd), norm), one);
+    const float32x4_t m1 = vbslq_f32(valid, vdivq_f32(
+      vmulq_f32(two, vsubq_f32(bc, ad)), norm), zero);
+    const float32x4_t m2 = vbslq_f32(valid, vdivq_f32(
+      vmulq_f32(two, vaddq_f32(ac, bd)), norm), zero);
+    const float32x4_t m4 = vbslq_f32(valid, vdivq_f32(
+      vmulq_f32(two, vaddq_f32(ad, bc)), norm), zero);
+    const float32x4_t m5 = vbslq_f32(valid, vdivq_f32(
+      vsubq_f32(vaddq_f32(vsubq_f32(aa, bb), cc), dd), norm), one);
+    const float32x4_t m6 = vbslq_f32(valid, vdivq_f32(
+      vmulq_f32(two, vsubq_f32(cd, ab)), norm), zero);
+    const float32x4_t m8 = vbslq_f32(valid, vdivq_f32(
+      vmulq_f32(two, vsubq_f32(bd, ac)), norm), zero);
+    const float32x4_t m9 = vbslq_f32(valid, vdivq_f32(
+      vmulq_f32(two, vaddq_f32(ab, cd)), norm), zero);
+    const float32x4_t m10 = vbslq_f32(valid, vdivq_f32(
+      vaddq_f32(vsubq_f32(vsubq_f32(aa, bb), cc), dd), norm), one);
+
+    float *matrix = result + 16 * i;
+    store_neon(matrix, m0, m1, m2, zero);
+    store_neon(matrix + 4, m4, m5, m6, zero);
+    store_neon(matrix + 8, m8, m9, m10, zero);
+    store_neon(matrix + 12, zero, zero, zero, one);
+  }
+
+  quaternion_to_matrix_scalar(
+    w + i, x + i, y + i, z + i, n - i, result + 16 * i);
+}
+
+void quaternion_to_euler_neon(const float *w, const float *x, const float *y,
+                              const float *z, const std::size_t &n,
+                              float *result)
+{
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  const float32x4_t two = vdupq_n_f32(2.0f);
+  const float32x4_t minimum = vdupq_n_f32(MinimumNormSquared);
+
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t a = vld1q_f32(w + i);
+    const float32x4_t b = vld1q_f32(x + i);
+    const float32x4_t c = vld1q_f32(y + i);
+    const float32x4_t d = vld1q_f32(z + i);
+
+    const float32x4_t aa = vmulq_f32(a, a);
+    const float32x4_t bb = vmulq_f32(b, b);
+    const float32x4_t cc = vmulq_f32(c, c);
+    const float32x4_t dd = vmulq_f32(d, d);
+
+    const float32x4_t norm = vaddq_f32(vaddq_f32(vaddq_f32(aa, bb), cc), dd);
+    const uint32x4_t valid = vcgtq_f32(norm, minimum);
+
+    float32x4_t sin_y = vdivq_f32(
+      vmulq_f32(two, vsubq_f32(vmulq_f32(a, c), vmulq_f32(b, d))), norm);
+    sin_y = vmaxq_f32(vminq_f32(sin_y, one), vnegq_f32(one));
+
+    const float32x4_t rx = atan2_neon(
+      vmulq_f32(two, vaddq_f32(vmulq_f32(a, b), vmulq_f32(c, d))),
+      vaddq_f32(vsubq_f32(vsubq_f32(aa, bb), cc), dd));
+    const float32x4_t ry = atan2_neon(
+      sin_y, vsqrtq_f32(vsubq_f32(one, vmulq_f32(sin_y, sin_y))));
+    const float32x4_t rz = atan2_neon(
+      vmulq_f32(two, vaddq_f32(vmulq_f32(a, d), vmulq_f32(b, c))),
+      vsubq_f32(vsubq_f32(vaddq_f32(aa, bb), cc), dd));
+
+    vst1q_f32(result + i, vbslq_f32(valid, rx, zero));
+    vst1q_f32(result + n + i, vbslq_f32(valid, ry, zero));
+    vst1q_f32(result + 2 * n + i, vbslq_f32(valid, rz, zero));
+  }
+
+  for (; i<n; ++i) {
+    quaternion_to_euler_one(
+      w[i], x[i], y[i], z[i], result[i], result[n + i], result[2 * n + i]);
+  }
+}
+
+void quaternion_slerp_neon(const float *a, const float *b,
+                           const std::size_t &n, const float &t,
+                           float *result)
+{
+  const slerp_coefficient c(t);
+
+  const uint32x4_t sign_mask = vdupq_n_u32(0x80000000u);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  const float32x4_t vt = vdupq_n_f32(c.t);
+  const float32x4_t vd = vdupq_n_f32(c.d);
+
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t qa[4];
+    float32x4_t qb[4];
+    for (std::size_t j=0; j<4; ++j) {
+      qa[j] = vld1q_f32(a + j * n + i);
+      qb[j] = vld1q_f32(b + j * n + i);
+    }
+
+    const float32x4_t dot = vaddq_f32(
+      vaddq_f32(vmulq_f32(qa[0], qb[0]), vmulq_f32(qa[1], qb[1])),
+      vaddq_f32(vmulq_f32(qa[2], qb[2]), vmulq_f32(qa[3], qb[3])));
+
+    const uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(dot), sign_mask);
+    const float32x4_t xm1 = vsubq_f32(vabsq_f32(dot), one);
+
+    float32x4_t ct = one;
+    float32x4_t cd = one;
+    for (std::size_t k=8; k>0; --k) {
+      ct = vaddq_f32(
+        one, vmulq_f32(vmulq_f32(vdupq_n_f32(c.ct[k - 1]), xm1), ct));
+      cd = vaddq_f32(
+        one, vmulq_f32(vmulq_f32(vdupq_n_f32(c.cd[k - 1]), xm1), cd));
+    }
+    ct = vreinterpretq_f32_u32(
+      veorq_u32(vreinterpretq_u32_f32(vmulq_f32(ct, vt)), sign));
+    cd = vmulq_f32(cd, vd);
+
+    for (std::size_t j=0; j<4; ++j) {
+      vst1q_f32(
+        result + j * n + i,
+        vaddq_f32(vmulq_f32(cd, qa[j]), vmulq_f32(ct, qb[j])));
+    }
+  }
+
+  for (; i<n; ++i) {
+    quaternion_slerp_one(c, a, b, n, i, result);
+  }
+}
+
+#endif  // MOTION_SDK_KERNEL_X86
+
+/**
+  Table of the kernel implementations for the current processor.
+*/
+class kernel_table {
+ public:
+  kernel_table()
+    : matrix(&quaternion_to_matrix_scalar),
+      euler(&quaternion_to_euler_scalar),
+      slerp(&quaternion_slerp_scalar),
+      name("scalar")
+  {
+#if MOTION_SDK_KERNEL_X86
+    bool sse2 = false;
+    bool avx2 = false;
+    get_x86_features(sse2, avx2);
+
+    if (avx2) {
+      matrix = &quaternion_to_matrix_avx;
+      euler = &quaternion_to_euler_avx;
+      slerp = &quaternion_slerp_avx;
+      name = "avx2";
+    } else if (sse2) {
+      matrix = &quaternion_to_matrix_sse;
+      euler = &quaternion_to_euler_sse;
+      slerp = &quaternion_slerp_sse;
+      name = "sse2";
+    }
+#elif MOTION_SDK_KERNEL_NEON
+    // NEON is a required part of the ARMv8-A architecture.
+    matrix = &quaternion_to_matrix_neon;
+    euler = &quaternion_to_euler_neon;
+    slerp = &quaternion_slerp_neon;
+    name = "neon";
+#endif  // MOTION_SDK_KERNEL_X86
+  }
+
+  kernel_function matrix;
+  kernel_function euler;
+  slerp_function slerp;
+  const char *name;
+}; // class kernel_table
+
+/**
+  Select the kernels on first use. This may be called from the static
+  initialization of other translation units.
+*/
+const kernel_table &get_kernel()
+{
+  static const kernel_table table;
+  return table;
+}
+
+}  // namespace
+
+void quaternion_to_matrix(const float *w, const float *x, const float *y,
+                          const float *z, const std::size_t &n,
+                          float *result)
+{
+  get_kernel().matrix(w, x, y, z, n, result);
+}
+
+void quaternion_to_euler(const float *w, const float *x, const float *y,
+                         const float *z, const std::size_t &n,
+                         float *result)
+{
+  get_kernel().euler(w, x, y, z, n, result);
+}
+
+void quaternion_slerp(const float *a, const float *b, const std::size_t &n,
+                      const float &t, float *result)
+{
+  get_kernel().slerp(a, b, n, t, result);
+}
+
+void linear_interpolate(const float *a, const float *b, const std::size_t &n,
+                        const float &t, float *result)
+{
+  // Simple enough for the compiler to vectorize.
+  const float d = 1 - t;
+  for (std::size_t i=0; i<n; ++i) {
+    result[i] = d * a[i] + t * b[i];
+  }
+}
+
+const char *kernel_name()
+{
+  return get_kernel().name;
+}
+
+}}} // namespace Motion::SDK::detail
@@ -31,14 +31,30 @@
   POSSIBILITY OF SUCH DAMAGE.
 */
 #include <Client.hpp>
+#include <CompactPreview.hpp>
+#include <ConfigurableSchema.hpp>
 #include <LuaConsole.hpp>
 #include <File.hpp>
 #include <Format.hpp>
-
+#include <MappedFile.hpp>
+#include <Reactor.hpp>
+#include <Resampler.hpp>
+#include <TakeSet.hpp>
+#include <detail/arena.hpp>
+#include <detail/thread.hpp>
+#include <plugin/Ring.hpp>
+#include <plugin/Shared.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 
 // Defaults to "127.0.0.1"
@@ -69,7 +85,9 @@ int test_Configurable(const std::string &host, const unsigned &port)
     std::cout << "Connected to " << host << ":" << port << std::endl;
 
     // The Configurable data service requires an XML definition of the
-    // requested channel names.
+    // requested channel names. Keep the channel layout around to decode the
+    // incoming data.
+    Motion::SDK::ConfigurableSchema schema;
     {
       Client::data_type xml_definition;
       {
@@ -108,6 +126,9 @@ int test_Configurable(const std::string &host, const unsigned &port)
         std::cout
           << "Sent active channel definition to Configurable service"
           << std::endl;
+
+        schema = Motion::SDK::ConfigurableSchema(
+          std::string(xml_definition.begin(), xml_definition.end()));
       }
     }
 
@@ -118,7 +139,30 @@ int test_Configurable(const std::string &host, const unsigned &port)
       // we can simply wait on an open connection until a data
       // sample comes in.
       Client::data_type data;
+      Format::ConfigurableFrame frame;
       while ((sample_count++ < NSample) && client.readData(data)) {
+        // Fixed layout decode, access channels by name.
+        if (schema.isValid() &&
+            schema.decode(data.begin(), data.end(), frame)) {
+          const Motion::SDK::ConfigurableSchema::channel_list_type &list =
+            schema.getChannelList();
+          for (std::size_t i=0; i<frame.size(); ++i) {
+            std::cout << "node(" << frame.getId()[i] << ")";
+            for (std::size_t j=0; j<list.size(); ++j) {
+              std::vector<float> value;
+              list[j].get(frame, i, std::back_inserter(value));
+
+              std::cout << " " << list[j].name << " = ";
+              std::copy(
+                value.begin(), value.end(),
+                std::ostream_iterator<float>(std::cout, " "));
+            }
+            std::cout << std::endl;
+          }
+
+          continue;
+        }
+
         typedef Format::configurable_service_type map_type;
 
         map_type container = Format::Configurable(data.begin(), data.end());
@@ -173,6 +217,7 @@ int test_Client(const std::string &host, const unsigned &port)
       // we can simply wait on an open connection until a data
       // sample comes in.
       Client::data_type data;
+      Format::PreviewFrame frame;
       while ((sample_count++ < NSample) && client.readData(data)) {
 
         if (PortPreview == port) {
@@ -192,6 +237,19 @@ int test_Client(const std::string &host, const unsigned &port)
                 << std::endl;
             }
           }
+
+          // Decode the same message into a flat frame. All of the
+          // quaternions are in four contiguous arrays.
+          if (Format::Preview(data.begin(), data.end(), frame)) {
+            const float *q = frame.getQuaternion(false);
+            for (std::size_t i=0; i<frame.size(); ++i) {
+              std::cout
+                << " q(" << frame.getId()[i] << ") = (" << q[i] << ", "
+                << q[frame.size() + i] << ", " << q[2 * frame.size() + i]
+                << ", " << q[3 * frame.size() + i] << ")"
+                << std::endl;
+            }
+          }
         }
 
 
@@ -251,6 +309,54 @@ int test_Client(const std::string &host, const unsigned &port)
   return 0;
 }
 
+class ReactorHandler : public Motion::SDK::Reactor::Handler {
+ public:
+  ReactorHandler()
+    : m_sample_count(0)
+  {
+  }
+
+  bool onMessage(Motion::SDK::Client &,
+                 const Motion::SDK::Client::data_view_type &data)
+  {
+    std::cout << "Message of " << data.size() << " bytes" << std::endl;
+
+    // Detach all of the connections once we have read enough samples.
+    return ++m_sample_count < NSample;
+  }
+
+ private:
+  std::size_t m_sample_count;
+};
+
+int test_Reactor(const std::string &host)
+{
+  try {
+    using Motion::SDK::Client;
+    using Motion::SDK::Reactor;
+
+    // Read from two data services in one thread.
+    Client preview(host, PortPreview);
+    Client sensor(host, PortSensor);
+
+    ReactorHandler handler;
+
+    Reactor reactor;
+    reactor.add(preview, handler);
+    reactor.add(sensor, handler);
+
+    std::cout
+      << "Reactor using " << Reactor::backend() << " read "
+      << reactor.run() << " messages" << std::endl;
+
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+
 int test_LuaConsole(const std::string &host, const unsigned &port)
 {
   try {
@@ -284,6 +390,35 @@ int test_LuaConsole(const std::string &host, const unsigned &port)
       std::cerr << "command failed: " << result.second << std::endl;
     }
 
+    // Send a list of chunks without a round trip per chunk.
+    {
+      LuaConsole::Pipeline<Client> pipeline(client);
+      pipeline.push(std::string("print(node.is_reading())"));
+      pipeline.push(std::string("print(node.num_reading())"));
+
+      std::vector<LuaConsole::result_type> list;
+      pipeline.flush(list);
+      for (std::size_t i=0; i<list.size(); ++i) {
+        std::cout << "chunk " << i << ": " << list[i].second;
+      }
+    }
+
+    // Run a list of statements as one chunk, one result per statement.
+    {
+      std::vector<std::string> statement;
+      statement.push_back("print(node.num_reading())");
+      statement.push_back("error('expected failure')");
+
+      std::vector<LuaConsole::result_type> list;
+      result = LuaConsole::SendBatch(
+        client, statement.begin(), statement.end(), list);
+      for (std::size_t i=0; i<list.size(); ++i) {
+        std::cout
+          << "statement " << i << ": " << list[i].first << " "
+          << list[i].second << std::endl;
+      }
+    }
+
     std::string message;
     if (client.getErrorString(message)) {
       std::cerr << "Error: " << message << std::endl;
@@ -297,6 +432,330 @@ int test_LuaConsole(const std::string &host, const unsigned &port)
   return 0;
 }
 
+int test_CompactPreview()
+{
+  int result = 0;
+
+  try {
+    using Motion::SDK::CompactPreview;
+    using Motion::SDK::Format;
+
+    // Build a standard Preview message of a few nodes. In an application, this
+    // is what the Preview service sends without the compact initialization
+    // string.
+    const std::size_t NNode = 4;
+    const float Element[Format::PreviewElement::Length] = {
+      0.5f, 0.5f, -0.5f, 0.5f,
+      0.9238795f, 0.3826834f, 0.0f, 0.0f,
+      0.7853982f, 0.0f, 0.0f,
+      0.01f, -0.02f, 0.98f
+    };
+
+    CompactPreview::data_type data;
+    for (std::size_t i=0; i<NNode; ++i) {
+      const unsigned id = static_cast<unsigned>(i + 1);
+      data.insert(
+        data.end(), reinterpret_cast<const char *>(&id),
+        reinterpret_cast<const char *>(&id) + sizeof(id));
+      data.insert(
+        data.end(), reinterpret_cast<const char *>(Element),
+        reinterpret_cast<const char *>(Element + Format::PreviewElement::Length));
+    }
+
+    // The service side. The first message is a keyframe, the rest are deltas.
+    CompactPreview::Encoder encoder;
+    CompactPreview decoder;
+
+    for (std::size_t sample=0; sample<3; ++sample) {
+      CompactPreview::data_type compact;
+      Format::PreviewFrame frame;
+      if (!encoder.encode(data.begin(), data.end(), compact) ||
+          !decoder.decode(compact.begin(), compact.end(), frame) ||
+          (NNode != frame.size())) {
+        std::cerr << "failed to decode compact Preview message" << std::endl;
+        result = 1;
+        break;
+      }
+
+      std::cout
+        << "compact Preview message of " << compact.size() << " bytes, "
+        << data.size() << " bytes standard" << std::endl;
+
+      // Quantized to 15 bits per component. Compare with the input.
+      const float *q = frame.getQuaternion(true);
+      for (std::size_t i=0; i<frame.size(); ++i) {
+        if (std::fabs(q[i] - Element[4]) > 1e-3f) {
+          std::cerr << "compact Preview quaternion mismatch" << std::endl;
+          result = 1;
+        }
+      }
+    }
+
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    result = 1;
+  }
+
+  return result;
+}
+
+int test_Resampler()
+{
+  int result = 0;
+
+  try {
+    using Motion::SDK::Format;
+    using Motion::SDK::Resampler;
+
+    // One node rotating about the z axis at half a radian per frame. Frames
+    // arrive every 10 milliseconds.
+    Resampler resampler;
+    for (std::size_t sample=0; sample<4; ++sample) {
+      const float angle = 0.5f * static_cast<float>(sample);
+      float element[Format::PreviewElement::Length] = {0};
+      element[0] = element[4] = std::cos(angle / 2);
+      element[3] = element[7] = std::sin(angle / 2);
+
+      const unsigned id = 1;
+      std::vector<char> data(
+        reinterpret_cast<const char *>(&id),
+        reinterpret_cast<const char *>(&id) + sizeof(id));
+      data.insert(
+        data.end(), reinterpret_cast<const char *>(element),
+        reinterpret_cast<const char *>(element + Format::PreviewElement::Length));
+
+      if (!resampler.push(0.01 * sample, data.begin(), data.end())) {
+        std::cerr << "failed to push Preview frame" << std::endl;
+        return 1;
+      }
+    }
+
+    // Halfway between the second and third frame, and 5 milliseconds past
+    // the newest frame.
+    resampler.setExtrapolate(0.005);
+
+    const double time[] = {0.015, 0.035};
+    const float expect[] = {0.75f, 1.75f};
+    for (std::size_t i=0; i<2; ++i) {
+      Resampler::frame_type pose;
+      if (!resampler.sample(time[i], pose) || (1 != pose.size())) {
+        std::cerr << "failed to sample Preview frame" << std::endl;
+        result = 1;
+        break;
+      }
+
+      const float *r = pose.getEuler();
+      std::cout
+        << "resampled rotation of " << r[2] << " radians at " << time[i]
+        << " seconds" << std::endl;
+
+      if (std::fabs(r[2] - expect[i]) > 1e-3f) {
+        std::cerr << "resampled rotation mismatch" << std::endl;
+        result = 1;
+      }
+    }
+
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    result = 1;
+  }
+
+  return result;
+}
+
+int test_Arena()
+{
+  int result = 0;
+
+  try {
+    using Motion::SDK::Format;
+    namespace detail = Motion::SDK::detail;
+
+    typedef Format::FixedElement<Format::SensorLayout> element_type;
+    typedef std::map<
+      Format::id_type, element_type, std::less<Format::id_type>,
+      detail::arena_allocator<std::pair<const Format::id_type, element_type> >
+    > map_type;
+
+    // Sensor message of a few nodes with all zero values.
+    std::vector<char> data;
+    for (unsigned id=1; id<=8; ++id) {
+      data.insert(
+        data.end(), reinterpret_cast<const char *>(&id),
+        reinterpret_cast<const char *>(&id) + sizeof(id));
+      data.resize(data.size() + sizeof(float) * Format::SensorLayout::Length);
+    }
+
+    // Decoding the same size of message again reuses the map nodes.
+    detail::arena memory;
+    const map_type::allocator_type allocator(&memory);
+    map_type map(map_type::key_compare(), allocator);
+
+    std::size_t block = 0;
+    for (std::size_t sample=0; sample<100; ++sample) {
+      if (!Format::Decode(data.begin(), data.end(), map) || (8 != map.size())) {
+        std::cerr << "failed to decode Sensor message" << std::endl;
+        return 1;
+      }
+
+      if (0 == sample) {
+        block = memory.getBlockCount();
+      }
+    }
+
+    std::cout
+      << "decoded 100 messages from " << memory.getBlockCount()
+      << " arena blocks" << std::endl;
+
+    if (block != memory.getBlockCount()) {
+      std::cerr << "arena did not reuse memory" << std::endl;
+      result = 1;
+    }
+
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    result = 1;
+  }
+
+  return result;
+}
+
+int test_ElementIndex()
+{
+  int result = 0;
+
+  try {
+    using Motion::SDK::Format;
+
+    // Preview message of many nodes, the values of each node start at its id.
+    const std::size_t NNode = 40;
+
+    std::vector<char> data;
+    for (std::size_t i=0; i<NNode; ++i) {
+      const unsigned id = static_cast<unsigned>(i + 1);
+      data.insert(
+        data.end(), reinterpret_cast<const char *>(&id),
+        reinterpret_cast<const char *>(&id) + sizeof(id));
+
+      for (std::size_t j=0; j<Format::PreviewElement::Length; ++j) {
+        const float value = static_cast<float>(id + j);
+        data.insert(
+          data.end(), reinterpret_cast<const char *>(&value),
+          reinterpret_cast<const char *>(&value) + sizeof(value));
+      }
+    }
+
+    // Decode only two of the nodes.
+    Format::id_list_type id;
+    id.push_back(3);
+    id.push_back(17);
+
+    Format::preview_service_type preview =
+      Format::Preview(data.begin(), data.end(), id);
+    if ((2 != preview.size()) || (1 != preview.count(17)) ||
+        (17 != preview.find(17)->second.getQuaternion(false)[0])) {
+      std::cerr << "failed to decode selected Preview elements" << std::endl;
+      result = 1;
+    }
+
+    // A duplicate id is an invalid message, even if it is not selected.
+    {
+      std::vector<char> duplicate(data);
+      duplicate.insert(
+        duplicate.end(), data.end() - (data.size() / NNode), data.end());
+
+      if (!Format::Preview(duplicate.begin(), duplicate.end()).empty() ||
+          !Format::Preview(duplicate.begin(), duplicate.end(), id).empty()) {
+        std::cerr
+          << "failed to reject Preview message with duplicate id"
+          << std::endl;
+        result = 1;
+      }
+    }
+
+    // Or index the message once and pull out single channels.
+    Format::ElementIndex<float> index;
+    Format::PreviewElement::vector_type a;
+    Format::PreviewElementView element;
+    if (!Format::Preview(data.begin(), data.end(), index) ||
+        (NNode != index.size()) ||
+        !index.getView(index.find(3), element)) {
+      std::cerr << "failed to index Preview message" << std::endl;
+      result = 1;
+    } else {
+      element.getAccelerate(a);
+      std::cout << "indexed " << index.size() << " elements, node 3 "
+        << "acceleration " << a[0] << " " << a[1] << " " << a[2] << std::endl;
+    }
+
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    result = 1;
+  }
+
+  return result;
+}
+
+int test_DecodeInto()
+{
+  int result = 0;
+
+  try {
+    using Motion::SDK::Format;
+
+    // Preview messages of a few nodes. Drop one node from the second message
+    // and add a new one at the end.
+    std::vector<char> data[2];
+    for (std::size_t k=0; k<2; ++k) {
+      for (unsigned id=1; id<=5; ++id) {
+        const unsigned key = ((1 == k) && (id >= 3)) ? id + 1 : id;
+        data[k].insert(
+          data[k].end(), reinterpret_cast<const char *>(&key),
+          reinterpret_cast<const char *>(&key) + sizeof(key));
+
+        for (std::size_t j=0; j<Format::PreviewElement::Length; ++j) {
+          const float value = static_cast<float>(10 * k + key + j);
+          data[k].insert(
+            data[k].end(), reinterpret_cast<const char *>(&value),
+            reinterpret_cast<const char *>(&value) + sizeof(value));
+        }
+      }
+    }
+
+    // Decode every message into the same map. The nodes and their buffers
+    // are reused.
+    Format::preview_service_type preview;
+    for (std::size_t k=0; k<2; ++k) {
+      const Format::preview_service_type expect =
+        Format::Preview(data[k].begin(), data[k].end());
+
+      bool same = Format::Preview(data[k].begin(), data[k].end(), preview) &&
+        (expect.size() == preview.size());
+      Format::preview_service_type::const_iterator itr = preview.begin();
+      Format::preview_service_type::const_iterator expect_itr = expect.begin();
+      for (; same && (preview.end() != itr); ++itr, ++expect_itr) {
+        same = (expect_itr->first == itr->first) &&
+          (expect_itr->second.access() == itr->second.access());
+      }
+
+      if (!same) {
+        std::cerr << "failed to decode Preview message into map" << std::endl;
+        result = 1;
+      }
+    }
+
+    std::cout << "decoded " << preview.size() << " elements into map, node 6 "
+      << "quaternion " << preview.find(6)->second.getQuaternion(false)[0]
+      << std::endl;
+
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    result = 1;
+  }
+
+  return result;
+}
+
 int test_File()
 {
   int result = 0;
@@ -350,6 +809,146 @@ int test_File()
       // Read the three vector of magnetometer data.
       Format::SensorElement::data_type magnetometer =
         element.getMagnetometer();
+
+      // Or copy into a fixed size array, without a memory allocation.
+      Format::SensorElement::vector_type gyroscope;
+      element.getGyroscope(gyroscope);
+    }
+
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    result = 1;
+  }
+
+  try {
+    using Motion::SDK::File;
+    using Motion::SDK::Format;
+
+    File file("../../test_data/sensor.bin");
+
+    // Read many samples per call into the same buffer.
+    std::vector<float> data;
+    std::size_t n = 0;
+    while ((n = file.readBlock(data, Format::SensorElement::Length, 64)) > 0) {
+      std::cout << "block of " << n << " samples" << std::endl;
+    }
+
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    result = 1;
+  }
+
+  try {
+    using Motion::SDK::FrameSpan;
+    using Motion::SDK::MappedFile;
+    using Motion::SDK::Format;
+
+    MappedFile file("../../test_data/sensor.bin");
+
+    // Random access to any sample in the take, no copy.
+    FrameSpan<float> frames =
+      file.getFrames<float>(Format::SensorElement::Length);
+    if (!frames.empty()) {
+      const float *last = frames[frames.size() - 1];
+      std::copy(
+        last, last + frames.length(),
+        std::ostream_iterator<float>(std::cout, " "));
+      std::cout << std::endl;
+    }
+
+    // Or process the take in blocks of samples.
+    FrameSpan<float> block;
+    while (!(block = file.readBlock<float>(frames.length(), 64)).empty()) {
+      std::cout << "block of " << block.size() << " samples" << std::endl;
+    }
+
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    result = 1;
+  }
+
+  return result;
+}
+
+/**
+  Sum each channel over all of the frames in a take.
+*/
+class ChannelSum {
+public:
+  ChannelSum()
+    : count(0), sum()
+  {
+  }
+
+  void operator()(const Motion::SDK::FrameSpan<float> &block)
+  {
+    sum.resize(block.length(), 0);
+    for (std::size_t i=0; i<block.size(); ++i) {
+      for (std::size_t j=0; j<block.length(); ++j) {
+        sum[j] += block[i][j];
+      }
+    }
+    count += block.size();
+  }
+
+  std::size_t count;
+  std::vector<double> sum;
+};
+
+class MergeChannelSum {
+public:
+  void operator()(ChannelSum &lhs, const ChannelSum &rhs) const
+  {
+    lhs.count += rhs.count;
+    lhs.sum.resize(std::max(lhs.sum.size(), rhs.sum.size()), 0);
+    for (std::size_t i=0; i<rhs.sum.size(); ++i) {
+      lhs.sum[i] += rhs.sum[i];
+    }
+  }
+};
+
+int test_TakeSet()
+{
+  int result = 0;
+
+  try {
+    using Motion::SDK::Format;
+    using Motion::SDK::TakeSet;
+
+    TakeSet::path_list_type pathname;
+    for (std::size_t i=0; i<8; ++i) {
+      pathname.push_back("../../test_data/sensor.bin");
+    }
+
+    TakeSet take(pathname);
+
+    // Every backend reads the same samples.
+    const TakeSet::Backend backend[] = {
+      TakeSet::Read, TakeSet::Map, TakeSet::Stream
+    };
+
+    std::vector<ChannelSum> sum;
+    for (std::size_t i=0; i<sizeof(backend) / sizeof(backend[0]); ++i) {
+      take.setBackend(backend[i]);
+      take.setReadSize(4096);
+
+      ChannelSum kernel;
+      if (!take.reduce<float>(
+            Format::SensorElement::Length, kernel, MergeChannelSum())) {
+        std::cerr << take.getError(0) << std::endl;
+        result = 1;
+      }
+
+      std::cout << "take set of " << take.size() << " files, "
+        << kernel.count << " samples" << std::endl;
+
+      if (!sum.empty() && ((sum.front().count != kernel.count) ||
+                           (sum.front().sum != kernel.sum))) {
+        std::cerr << "take set backends do not agree" << std::endl;
+        result = 1;
+      }
+
+      sum.push_back(kernel);
     }
 
   } catch (std::runtime_error &e) {
@@ -360,6 +959,343 @@ int test_File()
   return result;
 }
 
+/**
+  Write a few small take files of different sizes. Every backend and thread
+  count must produce the same per take results. Does not need any test data.
+*/
+int test_TakeSetLocal()
+{
+  int result = 0;
+
+  using Motion::SDK::Format;
+  using Motion::SDK::TakeSet;
+
+  const std::size_t NTake = 6;
+  const std::size_t Length = Format::SensorElement::Length;
+
+  TakeSet::path_list_type pathname;
+  std::vector<std::size_t> expect_count;
+  for (std::size_t k=0; k<NTake; ++k) {
+    char name[64];
+    std::sprintf(name, "test_take_%u.bin", static_cast<unsigned>(k));
+    pathname.push_back(name);
+
+    // Not a whole number of reads, so frames span the read boundaries.
+    const std::size_t n = 500 * (k + 1) + 7 * k;
+    expect_count.push_back(n);
+
+    std::vector<float> data(n * Length);
+    for (std::size_t i=0; i<data.size(); ++i) {
+      data[i] = static_cast<float>((i + k) % 101);
+    }
+
+    std::ofstream out(name, std::ios_base::binary | std::ios_base::out);
+    out.write(reinterpret_cast<const char *>(&data[0]),
+              static_cast<std::streamsize>(data.size() * sizeof(float)));
+    if (!out) {
+      std::cerr << "failed to write take file " << name << std::endl;
+      result = 1;
+    }
+  }
+
+  try {
+    TakeSet take(pathname);
+    take.setReadSize(4096);
+
+    const TakeSet::Backend backend[] = {
+      TakeSet::Read, TakeSet::Map, TakeSet::Stream
+    };
+
+    std::vector<ChannelSum> first;
+    std::size_t run = 0;
+    for (std::size_t i=0; i<sizeof(backend) / sizeof(backend[0]); ++i) {
+      take.setBackend(backend[i]);
+      for (std::size_t thread_count=1; thread_count<=NTake + 1;
+           ++thread_count) {
+        take.setThreadCount(thread_count);
+
+        std::vector<ChannelSum> kernel;
+        if (!take.process<float>(Length, ChannelSum(), kernel)) {
+          std::cerr << "take set failed to read the take files" << std::endl;
+          result = 1;
+        }
+
+        bool same = (NTake == kernel.size());
+        for (std::size_t k=0; same && (k<NTake); ++k) {
+          same = (expect_count[k] == kernel[k].count) &&
+            (first.empty() || (first[k].sum == kernel[k].sum));
+        }
+
+        if (!same) {
+          std::cerr
+            << "take set results differ for backend " << i
+            << " and " << thread_count << " threads" << std::endl;
+          result = 1;
+        }
+
+        if (first.empty()) {
+          first = kernel;
+        }
+        ++run;
+      }
+    }
+
+    std::cout << "take set of " << take.size() << " local files agreed over "
+      << run << " runs" << std::endl;
+
+  } catch (std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    result = 1;
+  }
+
+  for (std::size_t k=0; k<NTake; ++k) {
+    std::remove(pathname[k].c_str());
+  }
+
+  return result;
+}
+
+/**
+  One writer pushes a sequence of numbers, the other threads pop them.
+*/
+struct RingState {
+  enum {
+    Count = 100000
+  };
+
+  explicit RingState(const std::size_t &reader_count)
+    : ring(16), ready(0), done(false), popped(reader_count)
+  {
+  }
+
+  Motion::SDK::Device::ring_buffer<std::size_t> ring;
+  boost::atomic<std::size_t> ready;
+  boost::atomic<bool> done;
+  std::vector<std::vector<std::size_t> > popped;
+};
+
+void run_ring(void *argument, std::size_t index)
+{
+  RingState &state = *static_cast<RingState *>(argument);
+  if (0 == index) {
+    // Start once all of the readers are running. Give up on the ones that
+    // did not start after a while.
+    for (std::size_t i=0; i<100000000; ++i) {
+      if (state.ready.load() >= state.popped.size()) {
+        break;
+      }
+    }
+
+    for (std::size_t i=1; i<=RingState::Count; ++i) {
+      state.ring.push(i);
+    }
+    state.done.store(true);
+  } else {
+    std::vector<std::size_t> &popped = state.popped[index - 1];
+    std::size_t value = 0;
+    state.ready.fetch_add(1);
+    while (!state.done.load()) {
+      if (state.ring.pop(value)) {
+        popped.push_back(value);
+      }
+    }
+  }
+}
+
+int test_Ring()
+{
+  int result = 0;
+
+  using Motion::SDK::Device::ring_buffer;
+
+  // The writer overwrites the oldest elements once the ring is full.
+  {
+    ring_buffer<std::size_t> ring(4);
+    for (std::size_t i=1; i<=6; ++i) {
+      ring.push(i);
+    }
+
+    std::vector<std::size_t> popped;
+    std::size_t value = 0;
+    while (ring.pop(value)) {
+      popped.push_back(value);
+    }
+
+    if ((2 != ring.dropped()) || (4 != popped.size()) ||
+        (3 != popped.front()) || (6 != popped.back())) {
+      std::cerr << "ring buffer did not keep the newest elements" << std::endl;
+      result = 1;
+    }
+  }
+
+  // Every element is popped at most once. The rest were either overwritten
+  // or are still in the ring.
+  {
+    const std::size_t ReaderCount = 3;
+    RingState state(ReaderCount);
+    Motion::SDK::detail::run_threads(&run_ring, &state, ReaderCount + 1);
+
+    std::vector<std::size_t> all;
+    for (std::size_t i=0; i<ReaderCount; ++i) {
+      all.insert(all.end(), state.popped[i].begin(), state.popped[i].end());
+    }
+
+    std::size_t value = 0;
+    while (state.ring.pop(value)) {
+      all.push_back(value);
+    }
+
+    std::sort(all.begin(), all.end());
+    const bool unique = (all.end() == std::adjacent_find(all.begin(), all.end()));
+
+    std::cout << "ring buffer popped " << all.size() << " and dropped "
+      << state.ring.dropped() << " of " << RingState::Count << std::endl;
+
+    if (!unique ||
+        (all.size() + state.ring.dropped() != RingState::Count)) {
+      std::cerr << "ring buffer lost or repeated an element" << std::endl;
+      result = 1;
+    }
+  }
+
+  return result;
+}
+
+struct SharedState {
+  enum {
+    Count = 100000,
+    SlotSize = 256
+  };
+
+  SharedState(const std::string &name, const std::size_t &reader_count)
+    : name(name), publisher(name, 8, SlotSize), ready(0), done(false),
+      read(reader_count), torn(reader_count)
+  {
+  }
+
+  std::string name;
+  Motion::SDK::Device::SharedPublisher publisher;
+  boost::atomic<std::size_t> ready;
+  boost::atomic<bool> done;
+  std::vector<std::size_t> read;
+  std::vector<std::size_t> torn;
+};
+
+void run_shared(void *argument, std::size_t index)
+{
+  SharedState &state = *static_cast<SharedState *>(argument);
+  if (0 == index) {
+    for (std::size_t i=0; i<100000000; ++i) {
+      if (state.ready.load() >= state.read.size()) {
+        break;
+      }
+    }
+
+    // Every byte in a message is the same value, and the value sets the
+    // length. A torn copy mixes two messages.
+    std::vector<char> message(SharedState::SlotSize);
+    for (std::size_t i=1; i<=SharedState::Count; ++i) {
+      const std::size_t value = i % (SharedState::SlotSize - 1);
+      std::fill(message.begin(), message.begin() + value + 1,
+                static_cast<char>(value));
+      state.publisher.publish(&message[0], value + 1);
+    }
+    state.done.store(true);
+  } else {
+    Motion::SDK::Device::SharedReader reader(state.name);
+    Motion::SDK::Client::data_type data;
+    std::size_t &read = state.read[index - 1];
+    std::size_t &torn = state.torn[index - 1];
+    state.ready.fetch_add(1);
+    while (!state.done.load()) {
+      if (!reader.read(data)) {
+        continue;
+      }
+
+      ++read;
+      const std::size_t value = static_cast<unsigned char>(data[0]);
+      if ((data.size() != value + 1) ||
+          (static_cast<std::size_t>(
+             std::count(data.begin(), data.end(), data[0])) != data.size())) {
+        ++torn;
+      }
+    }
+  }
+}
+
+int test_Shared()
+{
+  int result = 0;
+
+  using Motion::SDK::Device::SharedPublisher;
+  using Motion::SDK::Device::SharedReader;
+
+  const std::string name = "MotionSDK.test";
+
+  // The publisher rejects a message that is larger than one slot.
+  {
+    SharedPublisher publisher(name, 4, 64);
+    const std::vector<char> message(65);
+
+    if (!publisher.is_open() || publisher.publish(&message[0], 65) ||
+        !publisher.publish(&message[0], 64)) {
+      std::cerr << "shared ring did not reject an oversize message"
+        << std::endl;
+      result = 1;
+    }
+  }
+
+  // A reader that falls behind skips to the oldest message that is still in
+  // the ring and counts the ones it missed.
+  {
+    SharedPublisher publisher(name, 4, 64);
+    SharedReader reader(name);
+
+    for (char i=1; i<=10; ++i) {
+      publisher.publish(&i, 1);
+    }
+
+    std::vector<char> values;
+    Motion::SDK::Client::data_type data;
+    while (reader.read(data)) {
+      values.push_back(data.empty() ? 0 : data[0]);
+    }
+
+    if (!reader.is_open() || (6 != reader.get_dropped()) ||
+        (4 != values.size()) || (7 != values.front()) ||
+        (10 != values.back())) {
+      std::cerr << "shared ring reader did not detect the lapped ring"
+        << std::endl;
+      result = 1;
+    }
+  }
+
+  // Readers in other threads never copy half of one message and half of
+  // the next.
+  {
+    const std::size_t ReaderCount = 3;
+    SharedState state(name, ReaderCount);
+    Motion::SDK::detail::run_threads(&run_shared, &state, ReaderCount + 1);
+
+    std::size_t read = 0;
+    std::size_t torn = 0;
+    for (std::size_t i=0; i<ReaderCount; ++i) {
+      read += state.read[i];
+      torn += state.torn[i];
+    }
+
+    std::cout << "shared ring readers copied " << read << " messages of "
+      << SharedState::Count << std::endl;
+
+    if (!state.publisher.is_open() || (torn > 0)) {
+      std::cerr << "shared ring reader copied a torn message" << std::endl;
+      result = 1;
+    }
+  }
+
+  return result;
+}
+
 int main(int argc, char **argv)
 {
   // Choose a remote host on the command line. Note that this must be an IP
@@ -383,8 +1319,44 @@ int main(int argc, char **argv)
   //test_Client(host, PortSensor);
   //test_Client(host, PortRaw);
 
-  // File class reads binary take files.
+  // Reactor class reads from many connections in one thread.
+  //test_Reactor(host);
+
+  // File and MappedFile classes read binary take files.
   //test_File();
 
+  // TakeSet class processes many take files in parallel.
+  //test_TakeSet();
+
+  // Every TakeSet backend and thread count agrees on a few generated take
+  // files. Does not need a service.
+  test_TakeSetLocal();
+
+  // Compact Preview encoding round trip. Does not need a service.
+  test_CompactPreview();
+
+  // Interpolate and extrapolate timestamped Preview frames. Does not need a
+  // service.
+  test_Resampler();
+
+  // Decode into a map that allocates from an arena. Does not need a service.
+  test_Arena();
+
+  // Index a message and decode only the requested elements. Does not need a
+  // service.
+  test_ElementIndex();
+
+  // Decode messages into the same map over and over. Does not need a
+  // service.
+  test_DecodeInto();
+
+  // Lock free ring buffer with one writer and many readers. Does not need a
+  // service.
+  test_Ring();
+
+  // Shared memory ring between a publisher and readers in this process.
+  // Does not need a service.
+  test_Shared();
+
   return 0;
 }